@@ -0,0 +1,59 @@
+#include "admission_control.h"
+#include "config_utils.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+// Zero or negative values would wrap to huge limits (or disable admission) once stored as size_t
+static size_t PositiveSetting(const unordered_map<string, string>& config, const string& key, size_t fallback) {
+    long value = ConfigLong(config, key, static_cast<long>(fallback));
+    if (value <= 0) {
+        throw runtime_error("Admission: " + key + " must be positive, got " + to_string(value));
+    }
+    return static_cast<size_t>(value);
+}
+
+AdmissionConfig LoadAdmissionConfig(const string& filename) {
+    auto config = LoadConfig(filename);
+    AdmissionConfig ac;
+    ac.large_upload_bytes           = PositiveSetting(config, "largeUploadBytes", ac.large_upload_bytes);
+    ac.max_concurrent_large_uploads = PositiveSetting(config, "maxConcurrentLargeUploads", ac.max_concurrent_large_uploads);
+    ac.max_inflight_bytes           = PositiveSetting(config, "maxInflightBytes", ac.max_inflight_bytes);
+    ac.retry_after_seconds          = PositiveSetting(config, "retryAfterSeconds", ac.retry_after_seconds);
+    return ac;
+}
+
+AdmissionController::Decision AdmissionController::TryAdmit(size_t bytes) {
+    lock_guard<mutex> lock(mtx_);
+    bool large = bytes >= config_.large_upload_bytes;
+
+    if (large && active_large_ >= config_.max_concurrent_large_uploads) {
+        return {false, large, config_.retry_after_seconds};
+    }
+    // A single body larger than the whole budget is still admitted when nothing else is
+    // in flight, otherwise it could never make progress.
+    if (inflight_bytes_ > 0 && inflight_bytes_ + bytes > config_.max_inflight_bytes) {
+        return {false, large, config_.retry_after_seconds};
+    }
+
+    inflight_bytes_ += bytes;
+    if (large) active_large_++;
+    return {true, large, 0};
+}
+
+void AdmissionController::Release(size_t bytes, bool large) {
+    lock_guard<mutex> lock(mtx_);
+    inflight_bytes_ -= bytes < inflight_bytes_ ? bytes : inflight_bytes_;
+    if (large && active_large_ > 0) active_large_--;
+}
+
+size_t AdmissionController::InflightBytes() {
+    lock_guard<mutex> lock(mtx_);
+    return inflight_bytes_;
+}
+
+size_t AdmissionController::ActiveLargeUploads() {
+    lock_guard<mutex> lock(mtx_);
+    return active_large_;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+// Admission control for request bodies buffered by api_server.
+// Large uploads need one of a fixed number of upload slots, and every admitted
+// body is charged against a global in-flight byte budget until it is released.
+struct AdmissionConfig {
+    size_t large_upload_bytes = 1 << 20;          // bodies at/above this size need an upload slot
+    size_t max_concurrent_large_uploads = 4;
+    size_t max_inflight_bytes = 256ull << 20;     // budget shared by all buffered bodies
+    size_t retry_after_seconds = 2;               // hint returned with 429 responses
+};
+
+// Load admission settings from a key=value file (server_config.txt); missing keys keep defaults,
+// values that are not positive throw
+AdmissionConfig LoadAdmissionConfig(const std::string& filename);
+
+class AdmissionController {
+public:
+    struct Decision {
+        bool admitted;
+        bool large;              // holds an upload slot (pass back to Release)
+        size_t retry_after_s;    // set when rejected
+    };
+
+    explicit AdmissionController(const AdmissionConfig& config) : config_(config) {}
+
+    // Try to admit a body of `bytes`. On success the bytes stay charged until Release.
+    Decision TryAdmit(size_t bytes);
+    void Release(size_t bytes, bool large);
+
+    size_t InflightBytes();
+    size_t ActiveLargeUploads();
+    const AdmissionConfig& Config() const { return config_; }
+
+private:
+    AdmissionConfig config_;
+    std::mutex mtx_;
+    size_t inflight_bytes_ = 0;
+    size_t active_large_ = 0;
+};
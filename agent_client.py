@@ -0,0 +1,30 @@
+import json
+import socket
+import sys
+
+# Talk to a resident client_agent over its Unix socket.
+# Usage: python3 agent_client.py <socket_path> <encrypt|partial|decrypt|plan|precompute|ping|shutdown> [round]
+
+
+def agent_request(socket_path, command, round_num=None, timeout=3600):
+    line = command if round_num is None else f"{command} {round_num}"
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as s:
+        s.settimeout(timeout)
+        s.connect(socket_path)
+        s.sendall((line + "\n").encode())
+        chunks = []
+        while True:
+            data = s.recv(4096)
+            if not data:
+                break
+            chunks.append(data)
+    return json.loads(b"".join(chunks).decode())
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        print("Usage: python3 agent_client.py <socket_path> <encrypt|partial|decrypt|plan|precompute|ping|shutdown> [round]")
+        sys.exit(1)
+    reply = agent_request(sys.argv[1], sys.argv[2], sys.argv[3] if len(sys.argv) >= 4 else None)
+    print(f"[agent_client.py] {json.dumps(reply)}")
+    sys.exit(0 if reply.get("status") == "ok" else 1)
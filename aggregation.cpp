@@ -0,0 +1,711 @@
+#include "aggregation.h"
+
+#include "curl_utils.h"
+#include "keystore.h"
+#include "layer_policy.h"
+#include "messages.h"
+#include "parallel_utils.h"
+#include "serialization_utils.h"
+#include "trace_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <nlohmann/json.hpp>
+
+using json = nlohmann::json;
+using namespace lbcrypto;
+
+static EvalKey<DCRTPoly> FetchReKey(const std::string& from, const std::string& to) {
+    std::string response = HttpGetJson(ServerUrl() + "/s2c/rekey?from=" + from + "&to=" + to);
+    RekeyResponse rekey;
+    try {
+        rekey = ParseMessage<RekeyResponse>(response);
+    } catch (const MessageError&) {
+        throw std::runtime_error("[aggregation] Missing rekey " + from + " -> " + to);
+    }
+    return DeserializeEvalKeyFromBase64(rekey.rekey.view());
+}
+
+HubReKeys FetchHubReKeys(const std::vector<std::string>& client_ids, const std::string& hub, size_t threads,
+                         bool to_hub_keys, bool from_hub_keys) {
+    std::vector<std::string> others;
+    for (const std::string& client_id : client_ids) {
+        if (client_id != hub) others.push_back(client_id);
+    }
+
+    std::vector<EvalKey<DCRTPoly>> to_hub(others.size()), from_hub(others.size());
+    {
+        TraceSpan span("key_load");
+        ParallelFor(others.size(), threads, [&](size_t i) {
+            if (to_hub_keys) to_hub[i] = FetchReKey(others[i], hub);
+            if (from_hub_keys) from_hub[i] = FetchReKey(hub, others[i]);
+        });
+    }
+
+    HubReKeys rekeys;
+    for (size_t i = 0; i < others.size(); ++i) {
+        if (to_hub_keys) rekeys.to_hub[others[i]] = to_hub[i];
+        if (from_hub_keys) rekeys.from_hub[others[i]] = from_hub[i];
+    }
+    return rekeys;
+}
+
+// Number of chunks every client sent (they must all agree)
+static size_t CommonChunkCount(const CiphertextSet& params) {
+    if (params.empty()) {
+        throw std::runtime_error("[aggregation] No client params to aggregate");
+    }
+    const auto& [first_id, first] = *params.begin();
+    for (const auto& [client_id, cts] : params) {
+        if (cts.size() != first.size()) {
+            throw std::runtime_error("[aggregation] Ciphertext count mismatch: " + client_id + " has " +
+                                     std::to_string(cts.size()) + ", " + first_id + " has " + std::to_string(first.size()));
+        }
+    }
+    return first.size();
+}
+
+std::vector<Ciphertext<DCRTPoly>> SumInCommonDomain(const CryptoContext<DCRTPoly>& cc,
+                                                    const CiphertextSet& params,
+                                                    const std::string& mode,
+                                                    const std::string& hub,
+                                                    const HubReKeys& rekeys,
+                                                    size_t threads,
+                                                    const std::map<std::string, double>& weights) {
+    if (mode == "threshold") {
+        if (!weights.empty()) {
+            throw std::runtime_error("[aggregation] Weighted sums are only supported in pre mode");
+        }
+        return SumCiphertexts(cc, params, threads);
+    }
+    if (mode != "pre") {
+        throw std::runtime_error("[aggregation] Unknown aggregation mode " + mode);
+    }
+    const size_t num_ct = CommonChunkCount(params);
+
+    std::vector<std::string> others;
+    std::vector<EvalKey<DCRTPoly>> to_hub;
+    for (const auto& [client_id, cts] : params) {
+        if (client_id == hub) continue;
+        if (!rekeys.to_hub.count(client_id)) {
+            throw std::runtime_error("[aggregation] Missing rekey from " + client_id + " to " + hub);
+        }
+        others.push_back(client_id);
+        to_hub.push_back(rekeys.to_hub.at(client_id));
+    }
+
+    // Re-encrypt every other client's chunks into the hub's domain; (client, chunk)
+    // pairs are independent, so they spread over the workers even with one chunk
+    std::vector<Ciphertext<DCRTPoly>> in_hub(others.size() * num_ct);
+    {
+        TraceSpan span("reencrypt", "{\"direction\":\"to_hub\"}");
+        ParallelFor(in_hub.size(), threads, [&](size_t k) {
+            size_t i = k / num_ct, c = k % num_ct;
+            in_hub[k] = cc->ReEncrypt(params.at(others[i])[c], to_hub[i]);
+        });
+    }
+
+    // The hub's own chunks (when it is in this subset) need no re-encryption
+    auto hub_it = params.find(hub);
+    auto weigh = [&](const std::string& client_id, const Ciphertext<DCRTPoly>& ct) {
+        return weights.empty() ? ct : cc->EvalMult(ct, weights.at(client_id));
+    };
+    for (const auto& [client_id, cts] : params) {
+        if (!weights.empty() && !weights.count(client_id)) {
+            throw std::runtime_error("[aggregation] Missing weight for " + client_id);
+        }
+    }
+
+    std::vector<Ciphertext<DCRTPoly>> sum(num_ct);
+    TraceSpan span("aggregate", "{\"clients\":" + std::to_string(params.size()) + "}");
+    ParallelFor(num_ct, threads, [&](size_t c) {
+        size_t first = 0;
+        Ciphertext<DCRTPoly> acc = hub_it != params.end() ? weigh(hub, hub_it->second[c])
+                                                          : weigh(others[0], in_hub[first++ * num_ct + c]);
+        for (size_t i = first; i < others.size(); ++i) {
+            acc = cc->EvalAdd(acc, weigh(others[i], in_hub[i * num_ct + c]));
+        }
+        sum[c] = acc;
+    });
+    return sum;
+}
+
+CiphertextSet NormalizeAndFanOut(const CryptoContext<DCRTPoly>& cc,
+                                 const std::vector<Ciphertext<DCRTPoly>>& sum,
+                                 double scale,
+                                 const std::vector<std::string>& client_ids,
+                                 const std::string& hub,
+                                 const HubReKeys& rekeys,
+                                 size_t threads) {
+    const size_t num_ct = sum.size();
+
+    // Scale by 1/n. A scalar multiply scales every slot; the old packed {0.5}
+    // plaintext only covered slot 0. Weighted sums are already normalized.
+    std::vector<Ciphertext<DCRTPoly>> avg = sum;
+    if (scale != 1.0) {
+        TraceSpan span("aggregate", "{\"step\":\"normalize\"}");
+        ParallelFor(num_ct, threads, [&](size_t c) { avg[c] = cc->EvalMult(sum[c], scale); });
+    }
+
+    std::vector<std::string> others;
+    std::vector<EvalKey<DCRTPoly>> from_hub;
+    for (const std::string& client_id : client_ids) {
+        if (client_id == hub) continue;
+        if (!rekeys.from_hub.count(client_id)) {
+            throw std::runtime_error("[aggregation] Missing rekey from " + hub + " to " + client_id);
+        }
+        others.push_back(client_id);
+        from_hub.push_back(rekeys.from_hub.at(client_id));
+    }
+
+    // Re-encrypt the average back to every other client
+    std::vector<Ciphertext<DCRTPoly>> out(others.size() * num_ct);
+    {
+        TraceSpan span("reencrypt", "{\"direction\":\"from_hub\"}");
+        ParallelFor(out.size(), threads, [&](size_t k) {
+            size_t i = k / num_ct, c = k % num_ct;
+            out[k] = cc->ReEncrypt(avg[c], from_hub[i]);
+        });
+    }
+
+    CiphertextSet result;
+    for (size_t i = 0; i < others.size(); ++i) {
+        result[others[i]].assign(out.begin() + i * num_ct, out.begin() + (i + 1) * num_ct);
+    }
+    if (std::find(client_ids.begin(), client_ids.end(), hub) != client_ids.end()) {
+        result[hub] = std::move(avg);
+    }
+    return result;
+}
+
+CiphertextSet AverageCiphertexts(const CryptoContext<DCRTPoly>& cc,
+                                 const CiphertextSet& params,
+                                 const std::string& hub,
+                                 const HubReKeys& rekeys,
+                                 size_t threads) {
+    std::vector<std::string> client_ids;
+    for (const auto& [client_id, cts] : params) client_ids.push_back(client_id);
+
+    std::vector<Ciphertext<DCRTPoly>> sum = SumInCommonDomain(cc, params, "pre", hub, rekeys, threads);
+    return NormalizeAndFanOut(cc, sum, 1.0 / static_cast<double>(params.size()), client_ids, hub, rekeys, threads);
+}
+
+std::vector<Ciphertext<DCRTPoly>> SumCiphertexts(const CryptoContext<DCRTPoly>& cc,
+                                                 const CiphertextSet& params,
+                                                 size_t threads) {
+    const size_t num_ct = CommonChunkCount(params);
+    std::vector<const std::vector<Ciphertext<DCRTPoly>>*> clients;
+    for (const auto& [client_id, cts] : params) clients.push_back(&cts);
+
+    std::vector<Ciphertext<DCRTPoly>> sum(num_ct);
+    TraceSpan span("aggregate", "{\"clients\":" + std::to_string(params.size()) + "}");
+    ParallelFor(num_ct, threads, [&](size_t c) {
+        Ciphertext<DCRTPoly> acc = (*clients[0])[c];
+        for (size_t i = 1; i < clients.size(); ++i) {
+            acc = cc->EvalAdd(acc, (*clients[i])[c]);
+        }
+        sum[c] = acc;
+    });
+    return sum;
+}
+
+PublicKey<DCRTPoly> JointPublicKey(const CryptoContext<DCRTPoly>& cc,
+                                   const std::vector<PublicKey<DCRTPoly>>& shares,
+                                   const std::string& key_tag) {
+    if (shares.empty()) {
+        throw std::runtime_error("[aggregation] No public key shares to combine");
+    }
+    PublicKey<DCRTPoly> joint = shares[0];
+    for (size_t i = 1; i < shares.size(); ++i) {
+        joint = cc->MultiAddPubKeys(joint, shares[i], key_tag);
+    }
+    return joint;
+}
+
+void PublishJointKey(const CryptoContext<DCRTPoly>& cc, const std::vector<std::string>& client_ids) {
+    std::vector<PublicKey<DCRTPoly>> shares(client_ids.size());
+    std::string share_fps;
+    {
+        TraceSpan span("key_load");
+        for (size_t i = 0; i < client_ids.size(); ++i) {
+            std::string response = HttpGetJson(ServerUrl() + "/s2c/public_key?client_id=" + client_ids[i]);
+            PublicKeyResponse share;
+            try {
+                share = ParseMessage<PublicKeyResponse>(response);
+            } catch (const MessageError&) {
+                throw std::runtime_error("[aggregation] Missing public key share of " + client_ids[i]);
+            }
+            share_fps += Fingerprint(share.public_key.view());
+            shares[i] = DeserializePublicKeyFromBase64(share.public_key.view());
+        }
+    }
+
+    // A tag unique to this set of shares: clients' zero pools drop Enc(0) made under an
+    // earlier joint key by comparing tags
+    PublicKey<DCRTPoly> joint;
+    {
+        TraceSpan span("keygen", "{\"kind\":\"joint\"}");
+        joint = JointPublicKey(cc, shares, std::string(kJointKeyId) + "-" + Fingerprint(share_fps));
+    }
+
+    PublicKeyUpload upload;
+    upload.client_id = kJointKeyId;
+    upload.public_key = SerializePublicKeyToBase64(joint);
+    upload.participants = client_ids;
+    std::string resp = HttpPostJson(ServerUrl() + "/c2s/public_key", WriteMessage(upload));
+    std::cout << "[aggregation] Joint public key of " << client_ids.size() << " clients: " << resp << std::endl;
+}
+
+static void CheckMode(const std::string& mode) {
+    if (mode != "pre" && mode != "threshold") {
+        throw std::runtime_error("[aggregation] Unknown aggregation mode " + mode);
+    }
+}
+
+// Uploads after the deadline are refused, so nothing is missed by not waiting longer
+void WaitForUploads(int round) {
+    TraceSpan span("wait_uploads");
+    while (true) {
+        auto plan = ParseMessage<RoundPlanResponse>(
+            HttpGetJson(ServerUrl() + "/s2c/round_plan?round=" + std::to_string(round)));
+        long long deadline = plan.deadline_unix_ms;
+        long long now = plan.now_unix_ms;
+        size_t participants = plan.participants.size();
+        size_t uploaded = plan.uploaded.size();
+        if (!plan.sampling || deadline == 0 || uploaded >= participants) return;
+        if (now > deadline) {
+            std::cout << "[aggregation] Round " << round << ": deadline passed with " << uploaded << " of "
+                      << participants << " participants uploaded\n";
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(std::min(250LL, deadline - now + 1)));
+    }
+}
+
+// Fetch and decode this round's params (`query` narrows them, e.g. to one shard)
+static CiphertextSet FetchRoundParams(int round, const std::string& query, size_t threads) {
+    std::string params_response = HttpGetJson(ServerUrl() + "/s2c/params?round=" + std::to_string(round) + query);
+    // Each client's params stay a view into the response until they are decoded
+    std::map<std::string, Blob> all_params;
+    {
+        TraceSpan span("json_parse");
+        try {
+            all_params = ParseMessage<std::map<std::string, Blob>>(params_response);
+        } catch (const MessageError& e) {
+            throw std::runtime_error("[aggregation] Malformed params response for round " + std::to_string(round) +
+                                     ": " + e.what());
+        }
+    }
+
+    std::vector<std::string> client_ids;
+    std::vector<std::string_view> params_b64;
+    for (const auto& [client_id, b64] : all_params) {
+        client_ids.push_back(client_id);
+        params_b64.push_back(b64.view());
+    }
+
+    // Deserialize ciphertext vectors for each client
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> decoded(client_ids.size());
+    ParallelFor(client_ids.size(), threads, [&](size_t i) {
+        decoded[i] = DeserializeCiphertextVectorFromBase64(params_b64[i]);
+    });
+
+    CiphertextSet params;
+    for (size_t i = 0; i < client_ids.size(); ++i) params[client_ids[i]] = std::move(decoded[i]);
+    return params;
+}
+
+// Number of parts this round's clients uploaded their params in (maxPartChunks); parts
+// are aggregated one at a time, so every client must have split its params the same way
+static size_t FetchPartCount(int round) {
+    auto counts = ParseMessage<std::map<std::string, size_t>>(
+        HttpGetJson(ServerUrl() + "/s2c/param_parts?round=" + std::to_string(round)));
+    size_t parts = 0;
+    for (const auto& [client_id, client_parts] : counts) {
+        if (parts != 0 && client_parts != parts) {
+            throw std::runtime_error("[aggregation] Round " + std::to_string(round) + ": " + client_id + " uploaded " +
+                                     std::to_string(client_parts) + " parts, others " + std::to_string(parts) +
+                                     " (clients must share maxPartChunks)");
+        }
+        parts = client_parts;
+    }
+    return std::max<size_t>(parts, 1);
+}
+
+// Multipart uploads are only aggregated part by part by the flat PRE path
+static void RequireSinglePart(size_t parts, const std::string& path) {
+    if (parts > 1) {
+        throw std::runtime_error("[aggregation] " + path + " does not support multipart uploads (" +
+                                 std::to_string(parts) + " parts); raise maxPartChunks or use flat pre aggregation");
+    }
+}
+
+// Plaintext layers of this round's clients: { "client1": { "<index>": "base64" }, ... }
+// ({} when every client encrypts every layer); `query` narrows them like FetchRoundParams
+static std::map<std::string, json> FetchPlainParams(int round, const std::string& query = "") {
+    return ParseMessage<std::map<std::string, json>>(
+        HttpGetJson(ServerUrl() + "/s2c/plain_params?round=" + std::to_string(round) + query));
+}
+
+// Sum the plaintext layers the clients' layer policy left unencrypted (weights by client
+// ID; empty = unweighted). Empty when no client sent any; otherwise every client must have.
+static PlainLayers SumPlainLayers(const std::map<std::string, json>& plain_params,
+                                  const std::vector<std::string>& client_ids,
+                                  const std::map<std::string, double>& weights = {}) {
+    PlainLayers sum;
+    if (plain_params.empty()) return sum;
+    TraceSpan span("aggregate", "{\"step\":\"plain\"}");
+    for (const std::string& client_id : client_ids) {
+        auto it = plain_params.find(client_id);
+        if (it == plain_params.end()) {
+            throw std::runtime_error("[aggregation] " + client_id +
+                                     " sent no plaintext layers (clients must share one layer policy)");
+        }
+        AccumulatePlainLayers(sum, DecodePlainLayers(it->second),
+                              weights.empty() ? 1.0 : weights.at(client_id));
+    }
+    return sum;
+}
+
+// Aggregate upload fields carrying averaged plaintext layers (none when there are none)
+static AggregateUpload PlainLayersFields(const PlainLayers& average) {
+    AggregateUpload fields;
+    if (!average.empty()) fields.plain_layers = EncodePlainLayers(average);
+    return fields;
+}
+
+// Serialize and Base64 encode each client's aggregate
+static std::map<std::string, Blob> EncodeAggregates(const CiphertextSet& aggregates, size_t threads) {
+    std::vector<const std::string*> client_ids;
+    for (const auto& [client_id, cts] : aggregates) client_ids.push_back(&client_id);
+    std::vector<std::string> encoded(client_ids.size());
+    ParallelFor(client_ids.size(), threads, [&](size_t i) {
+        encoded[i] = SerializeCiphertextVectorToBase64(aggregates.at(*client_ids[i]));
+    });
+
+    std::map<std::string, Blob> agg_params;
+    for (size_t i = 0; i < client_ids.size(); ++i) agg_params[*client_ids[i]] = Blob(std::move(encoded[i]));
+    return agg_params;
+}
+
+WorkerLease::WorkerLease(size_t want, size_t holders) {
+    auto response = ParseMessage<WorkerLeaseResponse>(
+        HttpPostJson(ServerUrl() + "/c2s/workers/acquire", WriteMessage(WorkerAcquireRequest{want, holders})));
+    id_ = response.lease_id;
+    threads_ = std::max<size_t>(1, response.threads);
+    std::cout << "[aggregation] Leased " << threads_ << " of " << response.pool << " pool threads ("
+              << response.active_jobs << " job(s) aggregating)\n";
+}
+
+WorkerLease::~WorkerLease() {
+    try {
+        HttpPostJson(ServerUrl() + "/c2s/workers/release", WriteMessage(WorkerReleaseRequest{id_}));
+    } catch (const std::exception& e) {
+        // The lease expires on the server anyway
+        std::cerr << "[aggregation] Releasing worker lease " << id_ << ": " << e.what() << "\n";
+    }
+}
+
+// Aggregate POSTs stay well below the server's request cap (MG_MAX_HTTP_REQUEST_SIZE)
+static const size_t kMaxPostBytes = 64 * 1024 * 1024;
+
+// POST aggregated encrypted weights to server (the other fields of `first` go with the
+// first payload). Many or large aggregates go in batches of clients under kMaxPostBytes,
+// which the server merges; `part`/`parts` tag every batch of a multipart round.
+static void PostAggregates(int round, std::map<std::string, Blob> agg_params, AggregateUpload first = {},
+                           size_t part = 0, size_t parts = 1) {
+    std::vector<AggregateUpload> batches(1, std::move(first));
+    size_t batch_bytes = 0;
+    for (auto& [client_id, agg_b64] : agg_params) {
+        size_t bytes = agg_b64.size();
+        if (batch_bytes > 0 && batch_bytes + bytes > kMaxPostBytes) {
+            batches.emplace_back();
+            batch_bytes = 0;
+        }
+        batches.back().agg_params[client_id] = std::move(agg_b64);
+        batch_bytes += bytes;
+    }
+    agg_params.clear();
+
+    for (AggregateUpload& payload : batches) {
+        payload.round = round;
+        payload.trace_id = TraceId();
+        if (parts > 1) {
+            payload.part = part;
+            payload.parts = parts;
+        }
+        std::string resp = HttpPostJson(ServerUrl() + "/c2s/server/agg_params", WriteMessage(payload));
+        payload = AggregateUpload();
+        std::cout << "[aggregation] POST response: " << resp << std::endl;
+    }
+}
+
+size_t AggregateRound(const CryptoContext<DCRTPoly>& cc, int round, const std::string& mode,
+                      const std::string& hub, size_t threads) {
+    CheckMode(mode);
+    WaitForUploads(round);
+    const size_t parts = FetchPartCount(round);
+    if (mode == "threshold") RequireSinglePart(parts, "Threshold aggregation");
+
+    // Multipart rounds are averaged one part at a time (only one part of every client's
+    // params in memory), last part first: clients fetch part 0 once it is there, and by
+    // then every other part is
+    size_t clients = 0;
+    std::vector<std::string> client_ids;
+    PlainLayers plain;
+    HubReKeys rekeys;
+    for (size_t part = parts; part-- > 0;) {
+        CiphertextSet params = FetchRoundParams(round, part == 0 ? "" : "&part=" + std::to_string(part), threads);
+        if (params.empty()) {
+            throw std::runtime_error("[aggregation] No client params for round " + std::to_string(round));
+        }
+        if (clients == 0) {
+            clients = params.size();
+            for (const auto& [client_id, cts] : params) client_ids.push_back(client_id);
+
+            // Plaintext layers are averaged in the clear, whatever the mode
+            plain = SumPlainLayers(FetchPlainParams(round), client_ids);
+            ScalePlainLayers(plain, 1.0 / static_cast<double>(clients));
+
+            if (mode == "threshold") {
+                std::cout << "[aggregation] Round " << round << ": summing " << clients
+                          << " clients under the joint key on " << threads << " threads\n";
+            } else {
+                std::cout << "[aggregation] Round " << round << ": averaging " << clients << " clients in "
+                          << hub << "'s domain on " << threads << " threads"
+                          << (parts > 1 ? " in " + std::to_string(parts) + " parts" : "") << "\n";
+                rekeys = FetchHubReKeys(client_ids, hub, threads);
+            }
+        } else if (params.size() != clients) {
+            throw std::runtime_error("[aggregation] Round " + std::to_string(round) + ": part " + std::to_string(part) +
+                                     " has params of " + std::to_string(params.size()) + " clients, expected " +
+                                     std::to_string(clients));
+        }
+
+        std::map<std::string, Blob> agg_params;
+        if (mode == "threshold") {
+            // One sum under the joint key serves every client
+            agg_params["*"] = Blob(SerializeCiphertextVectorToBase64(SumCiphertexts(cc, params, threads)));
+        } else {
+            CiphertextSet averaged = AverageCiphertexts(cc, params, hub, rekeys, threads);
+            params.clear();
+            agg_params = EncodeAggregates(averaged, threads);
+        }
+        PostAggregates(round, std::move(agg_params), part == 0 ? PlainLayersFields(plain) : AggregateUpload(),
+                       part, parts);
+    }
+    return clients;
+}
+
+size_t EdgeAggregateRound(const CryptoContext<DCRTPoly>& cc, int round, const std::string& mode,
+                          const std::string& hub, const std::string& edge_id,
+                          size_t shard, size_t shards, size_t threads) {
+    CheckMode(mode);
+    if (shards == 0 || shard >= shards) {
+        throw std::runtime_error("[aggregation] Invalid shard " + std::to_string(shard) + " of " + std::to_string(shards));
+    }
+
+    WaitForUploads(round);
+    RequireSinglePart(FetchPartCount(round), "Hierarchical aggregation");
+    const std::string shard_query = "&shard=" + std::to_string(shard) + "&shards=" + std::to_string(shards);
+    CiphertextSet params = FetchRoundParams(round, shard_query, threads);
+    std::vector<std::string> client_ids;
+    for (const auto& [client_id, cts] : params) client_ids.push_back(client_id);
+
+    // An empty shard (more edges than clients) still reports in, so the root knows it is done
+    std::string sum_b64;
+    PlainLayers plain_sum;
+    if (!params.empty()) {
+        std::cout << "[aggregation] Round " << round << ": " << edge_id << " summing " << params.size()
+                  << " clients (shard " << shard << "/" << shards << ") on " << threads << " threads\n";
+        HubReKeys rekeys;
+        if (mode == "pre") rekeys = FetchHubReKeys(client_ids, hub, threads, true, false);
+        sum_b64 = SerializeCiphertextVectorToBase64(SumInCommonDomain(cc, params, mode, hub, rekeys, threads));
+        plain_sum = SumPlainLayers(FetchPlainParams(round, shard_query), client_ids);
+    }
+
+    PartialSumUpload payload;
+    payload.edge_id = edge_id;
+    payload.round = round;
+    payload.trace_id = TraceId();
+    payload.clients = client_ids;
+    payload.sum = Blob(std::move(sum_b64));
+    payload.plain_sum = EncodePlainLayers(plain_sum);
+    std::string resp = HttpPostJson(ServerUrl() + "/c2s/partial_sum", WriteMessage(payload));
+    std::cout << "[aggregation] POST response: " << resp << std::endl;
+    return client_ids.size();
+}
+
+void WaitForPartialSums(int round, double wait_seconds) {
+    TraceSpan span("wait_edges");
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(wait_seconds);
+    while (true) {
+        // summary=1: coverage only, the sums stay on the server until the root fetches them
+        auto response = ParseMessage<PartialSumsResponse>(
+            HttpGetJson(ServerUrl() + "/s2c/partial_sums?round=" + std::to_string(round) + "&summary=1"));
+        if (response.metadata.complete) return;
+        if (std::chrono::steady_clock::now() >= deadline) {
+            throw std::runtime_error("[aggregation] Timed out waiting for edge aggregators: partial sums cover " +
+                                     std::to_string(response.metadata.covered.size()) + " of " +
+                                     std::to_string(response.metadata.expected.size()) + " clients");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+}
+
+size_t RootAggregateRound(const CryptoContext<DCRTPoly>& cc, int round, const std::string& mode,
+                          const std::string& hub, size_t threads) {
+    CheckMode(mode);
+
+    // The server only sends the partial sums once they cover every client that uploaded;
+    // the sums stay views into the response until they are decoded
+    std::string response_text = HttpGetJson(ServerUrl() + "/s2c/partial_sums?round=" + std::to_string(round));
+    auto response = ParseMessage<PartialSumsResponse>(response_text);
+    if (!response.data) {
+        throw std::runtime_error("[aggregation] Partial sums for round " + std::to_string(round) +
+                                 " do not cover every client yet");
+    }
+
+    // Every client must be covered by exactly one edge
+    std::map<std::string, PartialSumEntry>& edges = response.data->edges;
+    std::vector<std::string> edge_ids, client_ids;
+    for (const auto& [edge_id, edge] : edges) {
+        if (!edge.sum.empty()) edge_ids.push_back(edge_id);
+        client_ids.insert(client_ids.end(), edge.clients.begin(), edge.clients.end());
+    }
+    std::sort(client_ids.begin(), client_ids.end());
+    auto dup = std::adjacent_find(client_ids.begin(), client_ids.end());
+    if (dup != client_ids.end()) {
+        throw std::runtime_error("[aggregation] Client " + *dup + " was summed by more than one edge");
+    }
+    if (edge_ids.empty()) {
+        throw std::runtime_error("[aggregation] No client params for round " + std::to_string(round));
+    }
+
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> decoded(edge_ids.size());
+    ParallelFor(edge_ids.size(), threads, [&](size_t i) {
+        decoded[i] = DeserializeCiphertextVectorFromBase64(edges.at(edge_ids[i]).sum.view());
+    });
+    std::map<std::string, json> plain_sums;
+    for (const std::string& edge_id : edge_ids) {
+        std::optional<json>& plain_sum = edges.at(edge_id).plain_sum;
+        if (plain_sum && !plain_sum->empty()) plain_sums[edge_id] = std::move(*plain_sum);
+    }
+    response = PartialSumsResponse();
+    response_text.clear();
+    response_text.shrink_to_fit();
+    CiphertextSet partial_sums;
+    for (size_t i = 0; i < edge_ids.size(); ++i) partial_sums[edge_ids[i]] = std::move(decoded[i]);
+
+    // Partial sums are all in the common domain, so combining them is a plain sum
+    std::cout << "[aggregation] Round " << round << ": root combining " << partial_sums.size()
+              << " partial sums of " << client_ids.size() << " clients on " << threads << " threads\n";
+    std::vector<Ciphertext<DCRTPoly>> sum = SumCiphertexts(cc, partial_sums, threads);
+    partial_sums.clear();
+    PlainLayers plain = SumPlainLayers(plain_sums, edge_ids);
+    ScalePlainLayers(plain, 1.0 / static_cast<double>(client_ids.size()));
+
+    std::map<std::string, Blob> agg_params;
+    if (mode == "threshold") {
+        agg_params["*"] = Blob(SerializeCiphertextVectorToBase64(sum));
+    } else {
+        HubReKeys rekeys = FetchHubReKeys(client_ids, hub, threads, false, true);
+        agg_params = EncodeAggregates(
+            NormalizeAndFanOut(cc, sum, 1.0 / static_cast<double>(client_ids.size()), client_ids, hub, rekeys, threads),
+            threads);
+    }
+
+    PostAggregates(round, std::move(agg_params), PlainLayersFields(plain));
+    return client_ids.size();
+}
+
+double StalenessWeight(int staleness, double exponent) {
+    return std::pow(1.0 + std::max(staleness, 0), -exponent);
+}
+
+size_t AsyncBufferedUpdates(const std::string& hub, const AsyncPolicy& policy) {
+    // A min_updates no group reaches keeps the params out of the response
+    auto response = ParseMessage<AsyncBufferResponse>(
+        HttpGetJson(ServerUrl() + "/s2c/async_buffer?hub=" + hub + "&max_staleness=" +
+                    std::to_string(policy.max_staleness) +
+                    "&min_updates=" + std::to_string(std::numeric_limits<size_t>::max())));
+    return response.metadata.buffered;
+}
+
+void CheckAsyncJob() {
+    auto job = ParseMessage<JobResponse>(HttpGetJson(ServerUrl() + "/s2c/job"));
+    if (job.clients_per_round != 0 || job.round_deadline_seconds != 0) {
+        throw std::runtime_error("[aggregation] Async aggregation does not support clientsPerRound or "
+                                 "roundDeadlineSeconds (job " + job.job + ")");
+    }
+}
+
+size_t AsyncAggregateStep(const CryptoContext<DCRTPoly>& cc, const std::string& mode, const std::string& hub,
+                          const AsyncPolicy& policy, size_t threads, std::map<std::string, int>* consumed) {
+    CheckMode(mode);
+    if (mode != "pre") {
+        // Every key holder has to take part in a threshold decryption, so nobody may lag
+        throw std::runtime_error("[aggregation] Async aggregation needs aggregationMode=pre");
+    }
+
+    // The buffered params stay views into the response until they are decoded
+    std::string response_text = HttpGetJson(ServerUrl() + "/s2c/async_buffer?hub=" + hub +
+                                            "&max_staleness=" + std::to_string(policy.max_staleness) +
+                                            "&min_updates=" + std::to_string(policy.buffer_size));
+    auto response = ParseMessage<AsyncBufferResponse>(response_text);
+    if (!response.data) return 0;
+
+    const int version = response.metadata.version;
+    const std::vector<std::string>& group = response.metadata.clients;
+    std::map<std::string, BufferedUpdate>& updates = response.data->updates;
+
+    std::vector<std::string> client_ids;
+    for (const auto& [client_id, update] : updates) {
+        RequireSinglePart(update.parts.value_or(1), "Async aggregation");
+        client_ids.push_back(client_id);
+    }
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> decoded(client_ids.size());
+    ParallelFor(client_ids.size(), threads, [&](size_t i) {
+        decoded[i] = DeserializeCiphertextVectorFromBase64(updates.at(client_ids[i]).params.view());
+    });
+
+    // Normalized staleness weights: the result stays an average of the buffered models
+    CiphertextSet params;
+    std::map<std::string, double> weights;
+    std::map<std::string, int> bases;
+    std::map<std::string, json> plain_params;
+    double total_weight = 0;
+    for (size_t i = 0; i < client_ids.size(); ++i) {
+        BufferedUpdate& update = updates.at(client_ids[i]);
+        int base = update.round;
+        weights[client_ids[i]] = StalenessWeight(version - base, policy.staleness_exponent);
+        total_weight += weights[client_ids[i]];
+        bases[client_ids[i]] = base;
+        params[client_ids[i]] = std::move(decoded[i]);
+        if (update.plain_layers) plain_params[client_ids[i]] = std::move(*update.plain_layers);
+    }
+    for (auto& [client_id, weight] : weights) weight /= total_weight;
+    PlainLayers plain = SumPlainLayers(plain_params, client_ids, weights);
+
+    std::cout << "[aggregation] Version " << version + 1 << ": averaging " << params.size()
+              << " buffered updates in " << hub << "'s domain on " << threads << " threads\n";
+    HubReKeys rekeys = FetchHubReKeys(client_ids, hub, threads, true, false);
+    rekeys.from_hub = FetchHubReKeys(group, hub, threads, false, true).from_hub;
+    std::vector<Ciphertext<DCRTPoly>> sum = SumInCommonDomain(cc, params, "pre", hub, rekeys, threads, weights);
+    params.clear();
+
+    // The new version goes to the whole group, not only to the clients that contributed
+    AggregateUpload extra = PlainLayersFields(plain);
+    if (consumed) *consumed = bases;
+    extra.consumed = std::move(bases);
+    extra.chunk_counts = std::move(updates.at(client_ids[0]).chunk_counts);
+    extra.orig_sizes = std::move(updates.at(client_ids[0]).orig_sizes);
+    PostAggregates(version + 1, EncodeAggregates(NormalizeAndFanOut(cc, sum, 1.0, group, hub, rekeys, threads), threads),
+                   std::move(extra));
+    return client_ids.size();
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "openfhe.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Server-side homomorphic aggregation for any number of clients (operations and the
+// benchmarks), in one of two modes (aggregationMode in cc_config.txt):
+//   pre       ciphertexts are re-encrypted into one hub client's key domain with the
+//             <client>-><hub> rekeys, summed and scaled by 1/n, then re-encrypted back to
+//             every client with the <hub>-><client> rekeys.
+//   threshold every client encrypts under one joint public key, so the server only sums;
+//             clients fuse each other's partial decryptions and divide by n.
+// Pre mode can also run asynchronously: clients upload params tagged with the model version
+// they trained from, and once enough of them are buffered the server averages them weighted
+// by staleness and publishes the next version, without waiting for stragglers.
+// Either mode also runs as a tree: edge aggregators each sum one shard of the clients into
+// the common domain (the hub's key or the joint key) and post the partial sum; the root
+// adds the partial sums, then normalizes and fans out like a single aggregator would.
+// Layers the clients' layer policy leaves in plaintext (layer_policy.h) skip all of this:
+// every path averages them in the clear and posts one copy for all clients.
+// Every step throws std::runtime_error on failure.
+
+using CiphertextSet = std::map<std::string, std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>>>;
+
+// Client ID the joint public key is published under (threshold mode)
+constexpr const char* kJointKeyId = "joint";
+
+// Proxy re-encryption keys between the hub and every other client
+struct HubReKeys {
+    std::map<std::string, lbcrypto::EvalKey<lbcrypto::DCRTPoly>> to_hub;    // client -> hub
+    std::map<std::string, lbcrypto::EvalKey<lbcrypto::DCRTPoly>> from_hub;  // hub -> client
+};
+
+// Fetch the rekeys to and/or from the hub for every client other than the hub from the server
+HubReKeys FetchHubReKeys(const std::vector<std::string>& client_ids, const std::string& hub, size_t threads,
+                         bool to_hub = true, bool from_hub = true);
+
+// Average each client's chunk vectors (all the same length) and return one aggregate per
+// client under its own key. `hub` need not be one of the clients (only its rekeys are
+// used); work runs on `threads` workers.
+CiphertextSet AverageCiphertexts(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                                 const CiphertextSet& params,
+                                 const std::string& hub,
+                                 const HubReKeys& rekeys,
+                                 size_t threads);
+
+// Sum any subset of the clients' chunk vectors into the common domain: the hub's key (pre;
+// only the to_hub rekeys are needed) or the joint key (threshold). Pre mode can weight
+// each client's input (weights by client ID; empty = unweighted).
+std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>> SumInCommonDomain(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+    const CiphertextSet& params,
+    const std::string& mode,
+    const std::string& hub,
+    const HubReKeys& rekeys,
+    size_t threads,
+    const std::map<std::string, double>& weights = {});
+
+// Pre mode: scale a hub-domain sum (1/n for n inputs, 1 when already weighted) and
+// re-encrypt it to each of client_ids (only the from_hub rekeys are needed)
+CiphertextSet NormalizeAndFanOut(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                                 const std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>>& sum,
+                                 double scale,
+                                 const std::vector<std::string>& client_ids,
+                                 const std::string& hub,
+                                 const HubReKeys& rekeys,
+                                 size_t threads);
+
+// Chunk-wise sum of all entries' ciphertexts, which must share one domain (e.g. the joint key)
+std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>> SumCiphertexts(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+    const CiphertextSet& params,
+    size_t threads);
+
+// Threshold mode: combine the clients' public key shares into the joint public key
+lbcrypto::PublicKey<lbcrypto::DCRTPoly> JointPublicKey(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+    const std::vector<lbcrypto::PublicKey<lbcrypto::DCRTPoly>>& shares,
+    const std::string& key_tag);
+
+// Threshold mode: fetch the clients' key shares, combine them and publish the joint key
+void PublishJointKey(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                     const std::vector<std::string>& client_ids);
+
+// With client sampling and a deadline, wait until every participant of `round` has uploaded
+// or the deadline has passed (on the server's clock); returns at once without sampling or
+// once the wait is over. AggregateRound and EdgeAggregateRound start with it; callers that
+// lease threads call it first so no lease is held while waiting.
+void WaitForUploads(int round);
+
+// Wait up to wait_seconds for the edges' partial sums to cover every client that uploaded
+// (polling their coverage only); throws on timeout
+void WaitForPartialSums(int round, double wait_seconds);
+
+// Fetch this round's params from the server, aggregate them in `mode` ("pre" or
+// "threshold"; `hub` only matters for pre) and post the result. With client sampling
+// (clientsPerRound/roundDeadlineSeconds in server_config.txt) this first waits for the
+// participants or the deadline, then averages whoever uploaded; only they get the result.
+// Params uploaded in parts (maxPartChunks in client_config.txt) are averaged part by part
+// (pre mode only; the edge, root and async paths refuse them).
+// Returns the number of clients that took part.
+size_t AggregateRound(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                      int round,
+                      const std::string& mode,
+                      const std::string& hub,
+                      size_t threads);
+
+// Edge aggregator: sum shard `shard` of `shards` of this round's clients (every shards-th
+// client ID in sorted order) into the common domain and post the partial sum.
+// Returns the number of clients in the shard.
+size_t EdgeAggregateRound(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                          int round,
+                          const std::string& mode,
+                          const std::string& hub,
+                          const std::string& edge_id,
+                          size_t shard,
+                          size_t shards,
+                          size_t threads);
+
+// Root aggregator: combine the partial sums (once WaitForPartialSums saw them cover every
+// client that uploaded), normalize and fan out, and post the result.
+// Returns the number of clients that took part.
+size_t RootAggregateRound(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                          int round,
+                          const std::string& mode,
+                          const std::string& hub,
+                          size_t threads);
+
+// Threads leased from the server's aggregation pool (shared by every job, see jobs.h) for
+// one aggregation's compute: at most `want` (0 = the job's share divided among `holders`
+// aggregators of the job running at once), released on destruction
+class WorkerLease {
+public:
+    explicit WorkerLease(size_t want, size_t holders = 1);
+    ~WorkerLease();
+    WorkerLease(const WorkerLease&) = delete;
+    WorkerLease& operator=(const WorkerLease&) = delete;
+
+    size_t Threads() const { return threads_; }
+
+private:
+    std::string id_;
+    size_t threads_ = 1;
+};
+
+// Buffered asynchronous aggregation (server_config.txt async*)
+struct AsyncPolicy {
+    size_t buffer_size = 2;            // fresh updates that trigger an aggregation
+    int max_staleness = 4;             // updates trained on a version older than this many versions are dropped
+    double staleness_exponent = 0.5;   // an update s versions old weighs (1 + s)^-exponent
+};
+
+// Weight of an update trained `staleness` versions ago
+double StalenessWeight(int staleness, double exponent);
+
+// Fresh updates buffered for the hub's group (metadata only, nothing is downloaded)
+size_t AsyncBufferedUpdates(const std::string& hub, const AsyncPolicy& policy);
+
+// Throw unless the server's job is fit for async aggregation: model versions are not rounds,
+// so client sampling (clientsPerRound) and round deadlines (roundDeadlineSeconds) must be off
+void CheckAsyncJob();
+
+// If at least buffer_size fresh updates from the hub's group (the hub and every client with
+// rekeys to and from it) are buffered, average all of them weighted by staleness and publish
+// the result to the whole group as the next model version. Pre mode only.
+// Returns the number of updates aggregated (0 when the buffer is not full yet); `consumed`,
+// if given, receives the version each aggregated update was trained on.
+size_t AsyncAggregateStep(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+                          const std::string& mode,
+                          const std::string& hub,
+                          const AsyncPolicy& policy,
+                          size_t threads,
+                          std::map<std::string, int>* consumed = nullptr);
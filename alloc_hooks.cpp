@@ -0,0 +1,64 @@
+// Global operator new/delete counting every C++ heap allocation per thread (alloc_stats.h).
+// Linked into the binaries only with `make ALLOC_STATS=1`; memory still comes from malloc,
+// i.e. from whichever allocator the binary was linked with.
+
+#include "alloc_stats.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+static const bool marked = [] {
+    AllocStatsMarkHooked();
+    return true;
+}();
+
+void* operator new(size_t size) {
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    AllocStatsOnAlloc(p, size);
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    void* p = std::malloc(size ? size : 1);
+    if (p) AllocStatsOnAlloc(p, size);
+    return p;
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+
+// Over-aligned types (alignas above __STDCPP_DEFAULT_NEW_ALIGNMENT__); aligned_alloc wants a
+// multiple of the alignment, and its memory goes back through free like the rest
+static void* AlignedAlloc(size_t size, std::align_val_t align) noexcept {
+    const size_t alignment = static_cast<size_t>(align);
+    size_t rounded = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+    void* p = std::aligned_alloc(alignment, rounded);
+    if (p) AllocStatsOnAlloc(p, size);
+    return p;
+}
+void* operator new(size_t size, std::align_val_t align) {
+    void* p = AlignedAlloc(size, align);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size, std::align_val_t align) { return operator new(size, align); }
+void* operator new(size_t size, std::align_val_t align, const std::nothrow_t&) noexcept { return AlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return AlignedAlloc(size, align);
+}
+
+void operator delete(void* p) noexcept {
+    AllocStatsOnFree(p);
+    std::free(p);
+}
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete(void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { operator delete(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { operator delete(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { operator delete(p); }
@@ -0,0 +1,115 @@
+#include "alloc_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <malloc.h>
+
+#if defined(FL_ALLOCATOR_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(FL_ALLOCATOR_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#endif
+
+// Zero-initialized TLS: safe to touch from inside operator new
+static thread_local AllocCounters thread_counters;
+static std::atomic<bool> hooks_linked{false};
+static std::atomic<uint64_t> process_allocs{0};
+static std::atomic<uint64_t> process_bytes{0};
+
+#if defined(FL_ALLOCATOR_MIMALLOC)
+// mimalloc does not report live bytes, so the hooks track them
+static std::atomic<int64_t> live_bytes{0};
+#endif
+
+#if defined(FL_HUGE_PAGES) && defined(FL_ALLOCATOR_JEMALLOC)
+// Read by jemalloc at initialization: transparent huge pages for the heap and its metadata
+extern "C" const char* malloc_conf = "thp:always,metadata_thp:auto";
+#endif
+
+#if defined(FL_HUGE_PAGES) && defined(FL_ALLOCATOR_MIMALLOC)
+// Large OS pages for every segment mimalloc maps from here on
+static const bool large_pages_enabled = [] {
+    mi_option_enable(mi_option_large_os_pages);
+    return true;
+}();
+#endif
+
+AllocCounters ThreadAllocCounters() {
+    return thread_counters;
+}
+
+AllocCounters ProcessAllocCounters() {
+    return {process_allocs.load(std::memory_order_relaxed), process_bytes.load(std::memory_order_relaxed)};
+}
+
+bool AllocHooksLinked() {
+    return hooks_linked.load(std::memory_order_relaxed);
+}
+
+void AllocStatsOnAlloc(void* p, size_t size) {
+    thread_counters.allocs++;
+    thread_counters.bytes += size;
+    process_allocs.fetch_add(1, std::memory_order_relaxed);
+    process_bytes.fetch_add(size, std::memory_order_relaxed);
+#if defined(FL_ALLOCATOR_MIMALLOC)
+    live_bytes.fetch_add(static_cast<int64_t>(mi_usable_size(p)), std::memory_order_relaxed);
+#endif
+}
+
+void AllocStatsOnFree(void* p) {
+#if defined(FL_ALLOCATOR_MIMALLOC)
+    if (p) live_bytes.fetch_sub(static_cast<int64_t>(mi_usable_size(p)), std::memory_order_relaxed);
+#endif
+}
+
+void AllocStatsMarkHooked() {
+    hooks_linked.store(true, std::memory_order_relaxed);
+}
+
+std::optional<double> HeapStats::Fragmentation() const {
+    if (!in_use_known) return std::nullopt;
+    if (resident == 0 || in_use >= resident) return 0.0;
+    return 1.0 - static_cast<double>(in_use) / resident;
+}
+
+HeapStats ReadHeapStats() {
+    HeapStats stats;
+#if defined(FL_ALLOCATOR_JEMALLOC)
+    // Statistics are cached until the epoch is advanced
+    uint64_t epoch = 1;
+    size_t len = sizeof(epoch);
+    mallctl("epoch", &epoch, &len, &epoch, len);
+    len = sizeof(size_t);
+    mallctl("stats.allocated", &stats.in_use, &len, nullptr, 0);
+    mallctl("stats.resident", &stats.resident, &len, nullptr, 0);
+#elif defined(FL_ALLOCATOR_MIMALLOC)
+    // Memory mimalloc has committed for its heap, not the whole process RSS
+    size_t elapsed, user, system, rss, peak_rss, commit, peak_commit, faults;
+    mi_process_info(&elapsed, &user, &system, &rss, &peak_rss, &commit, &peak_commit, &faults);
+    stats.resident = commit;
+    stats.in_use_known = AllocHooksLinked();
+    if (stats.in_use_known) {
+        stats.in_use = static_cast<size_t>(std::max<int64_t>(0, live_bytes.load(std::memory_order_relaxed)));
+    }
+#else
+    // glibc: small chunks in use plus mmapped large ones; arenas plus mmapped regions
+    struct mallinfo2 info = mallinfo2();
+    stats.in_use = info.uordblks + info.hblkhd;
+    stats.resident = info.arena + info.hblkhd;
+#endif
+    return stats;
+}
+
+std::string AllocatorName() {
+#if defined(FL_ALLOCATOR_MIMALLOC)
+    std::string name = "mimalloc";
+#elif defined(FL_ALLOCATOR_JEMALLOC)
+    std::string name = "jemalloc";
+#else
+    std::string name = "glibc";
+#endif
+#if defined(FL_HUGE_PAGES) && (defined(FL_ALLOCATOR_MIMALLOC) || defined(FL_ALLOCATOR_JEMALLOC))
+    name += ", huge pages";
+#endif
+    return name;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Heap statistics for the phase log (trace_utils) and bench_allocator.
+// Allocation counts come from the operator new/delete hooks in alloc_hooks.cpp, linked into
+// the binaries with `make ALLOC_STATS=1`. They are per thread, so a phase counts what its
+// spans' threads allocate; OpenFHE's OpenMP helper threads count towards no phase.
+// Heap totals come from the allocator the binaries were linked with
+// (`make ALLOCATOR=glibc|mimalloc|jemalloc`, `HUGE_PAGES=1` to back the heap with huge pages).
+
+struct AllocCounters {
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+};
+
+// Allocations made by the calling thread so far (zeros without the hooks)
+AllocCounters ThreadAllocCounters();
+
+// Allocations made by every thread of the process so far (zeros without the hooks)
+AllocCounters ProcessAllocCounters();
+
+// True when the operator new hooks are linked in
+bool AllocHooksLinked();
+
+// Called by the hooks on every operator new / delete; must not allocate
+void AllocStatsOnAlloc(void* p, size_t size);
+void AllocStatsOnFree(void* p);
+void AllocStatsMarkHooked();
+
+struct HeapStats {
+    size_t in_use = 0;          // bytes handed out by the allocator and not freed
+    size_t resident = 0;        // bytes the heap keeps resident (mimalloc: committed)
+    bool in_use_known = true;   // mimalloc only reports in_use through the hooks
+
+    // Share of the heap's resident memory not holding live allocations (unknown without in_use)
+    std::optional<double> Fragmentation() const;
+};
+
+// Current totals, as the linked allocator reports them
+HeapStats ReadHeapStats();
+
+// Linked allocator: "glibc", "mimalloc" or "jemalloc", with ", huge pages" when built with them
+std::string AllocatorName();
@@ -1,18 +1,107 @@
 #include "mongoose.h"
 #include "rest_storage.h"
+#include "metrics.h"
+#include "trace_utils.h"
+#include "admission_control.h"
+#include "config_utils.h"
+#include "jobs.h"
+#include "local_transport.h"
+#include "messages.h"
+#include "parallel_utils.h"
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <iterator>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
-// Global storage instance
-FederatedStorage storage;
+// Every job's storage and settings, and the aggregation threads they share
+static JobRegistry* jobs = nullptr;
+static WorkerPool* workers = nullptr;
+
+// Admission control for buffered request bodies (configured from server_config.txt)
+static AdmissionController* admission = nullptr;
+
+// Connections whose current request body is charged against the admission budget
+struct AdmittedBody {
+    size_t bytes;
+    bool large;
+};
+static std::unordered_map<struct mg_connection*, AdmittedBody> admitted_bodies;
+
+// Unix domain socket listeners (`listen` in server_config.txt): their clients are on this
+// host and may pass large bodies in shared memory (local_transport.h)
+static std::vector<struct mg_connection*> local_listeners;
+
+// Set for each request: its client takes large response bodies from shared memory
+static bool shm_reply = false;
+
+// Response segments sent over each connection. The client removes a segment once it has
+// mapped it; the server removes whatever is left (a client that died before reading) when
+// the connection closes, or kShmReplySeconds after sending on connections kept open
+struct ShmReply {
+    SharedBody body;
+    std::chrono::steady_clock::time_point sent;
+};
+static std::unordered_map<struct mg_connection*, std::vector<ShmReply>> shm_replies;
+static const std::chrono::seconds kShmReplySeconds(60);
+
+static void expire_shm_replies() {
+    const auto cutoff = std::chrono::steady_clock::now() - kShmReplySeconds;
+    for (auto it = shm_replies.begin(); it != shm_replies.end();) {
+        auto& sent = it->second;
+        sent.erase(std::remove_if(sent.begin(), sent.end(), [&](const ShmReply& r) { return r.sent < cutoff; }),
+                   sent.end());
+        it = sent.empty() ? shm_replies.erase(it) : std::next(it);
+    }
+}
+
+static bool is_local(struct mg_connection* c) {
+    return c->listener && std::find(local_listeners.begin(), local_listeners.end(), c->listener) != local_listeners.end();
+}
+
+#ifdef MG_MAX_HTTP_REQUEST_SIZE
+static const size_t kMaxRequestBytes = MG_MAX_HTTP_REQUEST_SIZE;
+#else
+static const size_t kMaxRequestBytes = 100 * 1024 * 1024;
+#endif
 
 static void send_json(struct mg_connection* c, const std::string& data) {
+    // Large responses to co-located clients go through shared memory (see shm_replies)
+    const size_t shm_min = ShmMinBytes();
+    if (shm_reply && shm_min > 0 && data.size() >= shm_min) {
+        try {
+            SharedBody shared = SharedBody::Create(data);
+            mg_printf(c,
+                      "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
+                      "%s: %s\r\nContent-Length: 0\r\n\r\n",
+                      kShmBodyHeader, shared.name().c_str());
+            shm_replies[c].push_back({std::move(shared), std::chrono::steady_clock::now()});
+            MetricsRecordResponse(200, data.size());
+            return;
+        } catch (const std::exception& e) {
+            std::cerr << "[REST Server] " << e.what() << ", sending the response inline\n";
+        }
+    }
     mg_printf(c,
               "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n"
               "Content-Length: %lu\r\n\r\n%s",
               (unsigned long)data.size(), data.c_str());
+    MetricsRecordResponse(200, data.size());
+}
+
+static void send_text(struct mg_connection* c, const std::string& data) {
+    mg_printf(c,
+              "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+              "Content-Length: %lu\r\n\r\n%s",
+              (unsigned long)data.size(), data.c_str());
+    MetricsRecordResponse(200, data.size());
 }
 
 static void send_error(struct mg_connection* c, int code, const std::string& message) {
@@ -21,6 +110,65 @@ static void send_error(struct mg_connection* c, int code, const std::string& mes
               "HTTP/1.1 %d ERROR\r\nContent-Type: application/json\r\n"
               "Content-Length: %lu\r\n\r\n%s",
               code, (unsigned long)payload.size(), payload.c_str());
+    MetricsRecordResponse(code, payload.size());
+}
+
+// Refuse a request before its body is buffered, telling the client when to retry
+static void send_rejection(struct mg_connection* c, int code, size_t retry_after_s, const std::string& message) {
+    std::string payload = "{ \"error\": \"" + message + "\" }";
+    mg_printf(c,
+              "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+              "Retry-After: %lu\r\nConnection: close\r\n"
+              "Content-Length: %lu\r\n\r\n%s",
+              code, code == 429 ? "Too Many Requests" : "Payload Too Large",
+              (unsigned long)retry_after_s, (unsigned long)payload.size(), payload.c_str());
+    MetricsRecordResponse(code, payload.size());
+    c->flags |= MG_F_SEND_AND_CLOSE;
+}
+
+// Called on MG_EV_RECV, before mongoose has buffered the whole body: once the request
+// headers are in, charge the declared Content-Length against the admission budget or
+// reject with 413/429. Rejected connections drop everything else they send.
+static void admit_request(struct mg_connection* c) {
+    if (c->flags & MG_F_USER_1) {
+        mbuf_remove(&c->recv_mbuf, c->recv_mbuf.len);
+        return;
+    }
+    if (admitted_bodies.count(c)) return;
+
+    struct http_message hm;
+    int header_len = mg_parse_http(c->recv_mbuf.buf, (int)c->recv_mbuf.len, &hm, 1);
+    if (header_len <= 0) return;  // headers incomplete, or malformed (mongoose answers those)
+
+    // No Content-Length on a POST: assume the worst case mongoose would accept. Bodies in
+    // shared memory are charged at the size their client declares.
+    size_t body_len = hm.body.len == (size_t)~0 ? kMaxRequestBytes : hm.body.len;
+    struct mg_str* shm_len = is_local(c) ? mg_get_http_header(&hm, kShmBodyLengthHeader) : nullptr;
+    if (shm_len) body_len = std::strtoull(std::string(shm_len->p, shm_len->len).c_str(), nullptr, 10);
+    if (body_len > kMaxRequestBytes) {
+        send_rejection(c, 413, 0, "Request body exceeds server limit");
+        c->flags |= MG_F_USER_1;
+        mbuf_remove(&c->recv_mbuf, c->recv_mbuf.len);
+        return;
+    }
+
+    auto decision = admission->TryAdmit(body_len);
+    if (!decision.admitted) {
+        std::cout << "⏳ 429 " << std::string(hm.uri.p, hm.uri.len) << " (" << body_len << " bytes, "
+                  << admission->InflightBytes() << " bytes in flight)" << std::endl;
+        send_rejection(c, 429, decision.retry_after_s, "Server busy, retry later");
+        c->flags |= MG_F_USER_1;
+        mbuf_remove(&c->recv_mbuf, c->recv_mbuf.len);
+        return;
+    }
+    admitted_bodies[c] = {body_len, decision.large};
+}
+
+static void release_admission(struct mg_connection* c) {
+    auto it = admitted_bodies.find(c);
+    if (it == admitted_bodies.end()) return;
+    admission->Release(it->second.bytes, it->second.large);
+    admitted_bodies.erase(it);
 }
 
 static std::string get_query_param(struct mg_str* query_string, const std::string& key) {
@@ -29,35 +177,130 @@ static std::string get_query_param(struct mg_str* query_string, const std::strin
     return std::string(buf);
 }
 
+// Edge aggregators' shard/shards query parameters; false when invalid, `sharded` false when absent
+static bool get_shard(struct mg_str* query_string, bool& sharded, size_t& shard, size_t& shards) {
+    std::string shard_str = get_query_param(query_string, "shard");
+    std::string shards_str = get_query_param(query_string, "shards");
+    sharded = !shard_str.empty() || !shards_str.empty();
+    if (!sharded) return true;
+    shard = shard_str.empty() ? 0 : std::stoul(shard_str);
+    shards = shards_str.empty() ? 0 : std::stoul(shards_str);
+    return shards != 0 && shard < shards;
+}
+
 static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
     auto* hm = (struct http_message*)ev_data;
 
     std::string uri(hm->uri.p, hm->uri.len);
     std::string method(hm->method.p, hm->method.len);
-    std::string body(hm->body.p, hm->body.len);
+    // Typed messages parse the body in place; Base64 fields stay views into it. Co-located
+    // clients pass large bodies in shared memory, mapped here for the request's duration.
+    std::string_view body(hm->body.p, hm->body.len);
+    std::optional<SharedBody> shm_body;
+    const bool local = is_local(c);
+    shm_reply = local && mg_get_http_header(hm, kShmAcceptHeader);
+    if (struct mg_str* shm_name = local ? mg_get_http_header(hm, kShmBodyHeader) : nullptr) {
+        try {
+            shm_body = SharedBody::Open(std::string(shm_name->p, shm_name->len));
+        } catch (const std::exception& e) {
+            send_error(c, 400, e.what());
+            return;
+        }
+        auto admitted = admitted_bodies.find(c);
+        if (admitted == admitted_bodies.end() || shm_body->size() > admitted->second.bytes) {
+            send_error(c, 400, "Shared-memory body larger than declared");
+            return;
+        }
+        body = shm_body->view();
+    }
 
     std::cout << "📥 " << method << " " << uri << " (body length: " << body.length() << " bytes)" << std::endl;
 
+    // /jobs/<name>/<endpoint> addresses job <name>; the rest is the default job
+    std::string job;
+    std::string path;
+    if (!SplitJobPath(uri, job, path) || !jobs->Storage(job)) {
+        send_error(c, 404, "Unknown job");
+        return;
+    }
+    uri = path;
+    FederatedStorage& storage = *jobs->Storage(job);
+    // Picks up a context ./cc rebuilt since (fingerprint, aggregation mode and with it sampling)
+    const JobConfig& job_config = *jobs->Refresh(job);
+
+    MetricsRequestScope request_metrics(MetricsEndpointSlot(uri), body.length());
+
+    // Join the caller's round trace when it sent one
+    struct mg_str* trace_hdr = mg_get_http_header(hm, "X-Trace-Id");
+    TraceSetId(trace_hdr ? std::string(trace_hdr->p, trace_hdr->len) : "server");
+    // Args are only built when tracing is on; this runs on every request
+    TraceSpan request_span("http_handler",
+                           TraceEnabled() ? json{{"method", method}, {"uri", uri}}.dump() : std::string());
+
     try {
-        json payload;
-        if (method == "POST" && !body.empty()) {
-            payload = json::parse(body);
+        // METRICS (Prometheus text format)
+        if (uri == "/metrics" && method == "GET") {
+            std::string text = MetricsRenderPrometheus(jobs->StorageBytes());
+            text += "# HELP fl_admission_inflight_bytes Request-body bytes currently admitted.\n"
+                    "# TYPE fl_admission_inflight_bytes gauge\n"
+                    "fl_admission_inflight_bytes " + std::to_string(admission->InflightBytes()) + "\n"
+                    "# HELP fl_admission_large_uploads Large uploads currently holding a slot.\n"
+                    "# TYPE fl_admission_large_uploads gauge\n"
+                    "fl_admission_large_uploads " + std::to_string(admission->ActiveLargeUploads()) + "\n";
+            send_text(c, text);
+            return;
+        }
+
+        // JOBS
+        if (uri == "/s2c/job" && method == "GET") {
+            send_json(c, WriteMessage(JobResponse{
+                job, job_config.context_fp, job_config.aggregation_mode, storage.LatestRound(), storage.GetClients(),
+                job_config.clients_per_round, job_config.deadline_seconds, job_config.keep_rounds, job_config.weight}));
+            return;
+        }
+
+        if (uri == "/s2c/jobs" && method == "GET") {
+            json listed = json::array();
+            for (const std::string& name : jobs->Names()) {
+                const JobConfig& config = *jobs->Refresh(name);
+                listed.push_back({{"job", name}, {"aggregation_mode", config.aggregation_mode},
+                                  {"latest_round", jobs->Storage(name)->LatestRound()},
+                                  {"aggregation_weight", config.weight}});
+            }
+            send_json(c, json{{"jobs", listed}, {"pool_threads", workers->Threads()},
+                              {"workers", workers->Status()}}.dump());
+            return;
+        }
+
+        // AGGREGATION WORKER POOL
+        if (uri == "/c2s/workers/acquire" && method == "POST") {
+            auto request = body.empty() ? WorkerAcquireRequest{} : ParseMessage<WorkerAcquireRequest>(body);
+            WorkerPool::Lease lease = workers->Acquire(job, job_config.weight, request.want.value_or(0),
+                                                       std::max<size_t>(1, request.holders.value_or(1)));
+            send_json(c, WriteMessage(WorkerLeaseResponse{lease.id, lease.threads, workers->Threads(), lease.active_jobs}));
+            return;
+        }
+
+        if (uri == "/c2s/workers/release" && method == "POST") {
+            workers->Release(ParseMessage<WorkerReleaseRequest>(body).lease_id);
+            send_json(c, R"({"status":"released"})");
+            return;
         }
 
         // KEY MANAGEMENT
         if (uri == "/c2s/public_key" && method == "POST") {
-            if (!payload.contains("client_id") || !payload.contains("public_key") ||
-                !payload.contains("eval_mult_key") || !payload.contains("eval_sum_key")) {
-                send_error(c, 400, "Missing required fields in public_key JSON");
+            // Eval keys are optional: clients only generate the kinds they were asked for
+            auto upload = ParseMessage<PublicKeyUpload>(body);
+            // Decrypting under the joint key takes a share from each of its participants
+            const bool joint = upload.client_id == "joint";
+            if (joint && (!upload.participants || upload.participants->empty())) {
+                send_error(c, 400, "The joint public key must list its participants");
                 return;
             }
-
-            std::string client_id = payload["client_id"];
-            std::string pubkey    = payload["public_key"];
-            std::string eval_mult = payload["eval_mult_key"];
-            std::string eval_sum  = payload["eval_sum_key"];
-
-            storage.StorePublicKey(client_id, pubkey, eval_mult, eval_sum);
+            if (joint) storage.StoreJointKeyHolders(*upload.participants);
+            storage.StorePublicKey(upload.client_id, upload.public_key.str(),
+                                   upload.eval_mult_key ? upload.eval_mult_key->str() : "",
+                                   upload.eval_sum_key ? upload.eval_sum_key->str() : "");
             send_json(c, R"({"status":"public key stored"})");
             return;
         }
@@ -75,22 +318,23 @@ static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
                 return;
             }
 
-            send_json(c, pk_json.dump());
+            // Keys are written straight from `pk_json`
+            PublicKeyResponse response;
+            response.public_key = Blob::View(pk_json["public_key"].get_ref<const std::string&>());
+            if (pk_json.contains("eval_mult_key")) {
+                response.eval_mult_key = Blob::View(pk_json["eval_mult_key"].get_ref<const std::string&>());
+            }
+            if (pk_json.contains("eval_sum_key")) {
+                response.eval_sum_key = Blob::View(pk_json["eval_sum_key"].get_ref<const std::string&>());
+            }
+            send_json(c, WriteMessage(response));
             return;
         }
 
         // REKEY MANAGEMENT
         if (uri == "/c2s/rekey" && method == "POST") {
-            if (!payload.contains("from_client_id") || !payload.contains("to_client_id") || !payload.contains("rekey")) {
-                send_error(c, 400, "Missing fields in rekey JSON");
-                return;
-            }
-
-            std::string from  = payload["from_client_id"];
-            std::string to    = payload["to_client_id"];
-            std::string rekey = payload["rekey"];
-
-            storage.StoreRekey(from, to, rekey);
+            auto upload = ParseMessage<RekeyUpload>(body);
+            storage.StoreRekey(upload.from_client_id, upload.to_client_id, upload.rekey.str());
             send_json(c, R"({"status":"rekey stored"})");
             return;
         }
@@ -110,65 +354,151 @@ static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
                 return;
             }
 
-            send_json(c, rekey_json.dump());
+            send_json(c, WriteMessage(RekeyResponse{
+                from, to, Blob::View(rekey_json["rekey"].get_ref<const std::string&>())}));
             return;
         }
 
         // PARAMETERS MANAGEMENT (Encrypted model weights per round per client)
-        // Expect JSON payload with "metadata" and "data" keys
+        // Payloads have "metadata" and "data" keys (ParamsUpload)
 
         if (uri == "/c2s/params" && method == "POST") {
-            if (!payload.contains("metadata") || !payload.contains("data")) {
-                send_error(c, 400, "Missing 'metadata' or 'data' in params JSON");
+            ParamsUpload upload;
+            {
+                TraceSpan span("json_parse");
+                upload = ParseMessage<ParamsUpload>(body);
+            }
+            const std::string& client = upload.metadata.client_id;
+            int round = upload.metadata.round;
+            std::string_view params_b64 = upload.data.params.view();
+
+            std::vector<size_t> chunk_counts = upload.data.chunk_counts.value_or(std::vector<size_t>{});
+            std::vector<size_t> orig_sizes = upload.data.orig_sizes.value_or(std::vector<size_t>{});
+
+            // Layers the client's layer policy left in plaintext (no chunks in chunk_counts)
+            json plain_layers = upload.data.plain_layers.value_or(json::object());
+
+            // Multipart uploads (maxPartChunks): every part but the last is stored as it comes;
+            // the last one carries the layout and completes the upload
+            size_t part = upload.metadata.part.value_or(0);
+            size_t parts = upload.metadata.parts.value_or(1);
+            if (parts == 0 || part >= parts) {
+                send_error(c, 400, "Invalid part or parts in metadata");
                 return;
             }
-            json metadata = payload["metadata"];
-            json data = payload["data"];
 
-            if (!metadata.contains("client_id") || !metadata.contains("round")) {
-                send_error(c, 400, "Missing client_id or round in metadata");
+            // Store entire Base64 encoded ciphertext vector string and chunk counts and original sizes
+            ParamsStatus status = part + 1 < parts
+                ? storage.StoreParamsPart(client, round, part, params_b64)
+                : storage.StoreParams(client, round, params_b64, chunk_counts, orig_sizes, plain_layers, parts);
+            if (status == ParamsStatus::kMissingParts) {
+                send_error(c, 400, "Upload of " + client + " ended before all of its " + std::to_string(parts) + " parts arrived");
+                return;
+            }
+            if (status == ParamsStatus::kNotSelected) {
+                send_error(c, 403, "Client " + client + " is not a participant of round " + std::to_string(round));
                 return;
             }
-            if (!data.contains("params")) {
-                send_error(c, 400, "Missing params in data");
+            if (status == ParamsStatus::kPastDeadline) {
+                send_error(c, 409, "Upload deadline of round " + std::to_string(round) + " has passed");
+                return;
+            }
+            send_json(c, part + 1 < parts ? R"({"status":"params part stored"})" : R"({"status":"params stored"})");
+            return;
+        }
+
+        if (uri == "/s2c/params" && method == "GET") {
+            std::string round_str = get_query_param(&hm->query_string, "round");
+            if (round_str.empty()) {
+                send_error(c, 400, "Missing round parameter");
                 return;
             }
 
-            const std::string client = metadata["client_id"];
-            int round = metadata["round"];
-            const std::string params_b64 = data["params"];
+            int round = std::stoi(round_str);
+
+            // Edge aggregators ask for one shard; an empty shard is not an error
+            bool sharded = false;
+            size_t shard = 0, shards = 0;
+            if (!get_shard(&hm->query_string, sharded, shard, shards)) {
+                send_error(c, 400, "Invalid shard or shards parameter");
+                return;
+            }
+            if (sharded) {
+                send_json(c, storage.GetParamsShard(round, shard, shards).dump());
+                return;
+            }
 
-            std::vector<size_t> chunk_counts;
-            if (data.contains("chunk_counts")) {
-                chunk_counts = data["chunk_counts"].get<std::vector<size_t>>();
+            std::string part_str = get_query_param(&hm->query_string, "part");
+            auto params_json = storage.GetParamsPart(round, part_str.empty() ? 0 : std::stoul(part_str));
+            if (params_json.empty()) {
+                send_error(c, 404, "No client params found for that round");
+                return;
             }
 
-            std::vector<size_t> orig_sizes;
-            if (data.contains("orig_sizes")) {
-                orig_sizes = data["orig_sizes"].get<std::vector<size_t>>();
+            send_json(c, params_json.dump());
+            return;
+        }
+
+        if (uri == "/s2c/param_parts" && method == "GET") {
+            std::string round_str = get_query_param(&hm->query_string, "round");
+            if (round_str.empty()) {
+                send_error(c, 400, "Missing round parameter");
+                return;
             }
 
-            // Store entire Base64 encoded ciphertext vector string and chunk counts and original sizes
-            storage.StoreParams(client, round, params_b64, chunk_counts, orig_sizes);
-            send_json(c, R"({"status":"params stored"})");
+            send_json(c, storage.GetParamsPartCounts(std::stoi(round_str)).dump());
             return;
         }
 
-        if (uri == "/s2c/params" && method == "GET") {
+        if (uri == "/s2c/plain_params" && method == "GET") {
             std::string round_str = get_query_param(&hm->query_string, "round");
             if (round_str.empty()) {
                 send_error(c, 400, "Missing round parameter");
                 return;
             }
 
+            // Empty when every client encrypts every layer; edge aggregators ask for their shard
+            bool sharded = false;
+            size_t shard = 0, shards = 0;
+            if (!get_shard(&hm->query_string, sharded, shard, shards)) {
+                send_error(c, 400, "Invalid shard or shards parameter");
+                return;
+            }
             int round = std::stoi(round_str);
-            auto params_json = storage.GetAllParams(round);
-            if (params_json.empty()) {
-                send_error(c, 404, "No client params found for that round");
+            send_json(c, (sharded ? storage.GetPlainParamsShard(round, shard, shards)
+                                  : storage.GetAllPlainParams(round)).dump());
+            return;
+        }
+
+        // ROUND PLAN (client sampling): which clients take part in a round and until when
+        // they may upload. Not a pure read: the first request for a round (this GET, an upload
+        // or the aggregator's wait) opens it, drawing the sample and starting the deadline.
+        // Async aggregation has no rounds and refuses sampling (CheckAsyncJob)
+
+        if (uri == "/s2c/round_plan" && method == "GET") {
+            std::string round_str = get_query_param(&hm->query_string, "round");
+            if (round_str.empty()) {
+                send_error(c, 400, "Missing round parameter");
                 return;
             }
 
-            send_json(c, params_json.dump());
+            json plan = storage.GetRoundPlan(std::stoi(round_str));
+            RoundPlanResponse response;
+            response.round = plan["round"];
+            response.sampling = plan["sampling"];
+            response.participants = plan["participants"].get<std::vector<std::string>>();
+            response.uploaded = plan["uploaded"].get<std::vector<std::string>>();
+            response.deadline_unix_ms = plan["deadline_unix_ms"];
+            response.now_unix_ms = plan["now_unix_ms"];
+            std::string client_id = get_query_param(&hm->query_string, "client_id");
+            if (!client_id.empty()) {
+                const std::vector<std::string>& participants = response.participants;
+                response.client_id = client_id;
+                response.selected = !response.sampling ||
+                    std::find(participants.begin(), participants.end(), client_id) != participants.end();
+            }
+
+            send_json(c, WriteMessage(response));
             return;
         }
 
@@ -176,15 +506,33 @@ static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
         // Responses formatted with "metadata" and "data" keys
 
         if (uri == "/c2s/server/agg_params" && method == "POST") {
-            if (!payload.contains("round") || !payload.contains("agg_params")) {
-                send_error(c, 400, "Missing fields in aggregated params JSON");
-                return;
+            AggregateUpload upload;
+            {
+                TraceSpan span("json_parse");
+                upload = ParseMessage<AggregateUpload>(body);
+            }
+            int round = upload.round;
+            std::map<std::string, std::string> agg_params_map;  // { client1: base64_vec, client2: base64_vec, ... }
+            for (const auto& [client, agg_b64] : upload.agg_params) agg_params_map[client] = agg_b64.str();
+
+            // Multipart rounds: one POST (or batch of them) per part, part 0 last
+            size_t part = upload.part.value_or(0);
+            size_t parts = upload.parts.value_or(1);
+            storage.StoreAggregatedParams(round, std::move(agg_params_map), part, parts);
+            if (upload.plain_layers) {
+                storage.StoreAggregatedPlainLayers(round, *upload.plain_layers);
             }
 
-            int round = payload["round"];
-            json agg_params_map = payload["agg_params"];  // { client1: base64_vec, client2: base64_vec, ... }
-
-            storage.StoreAggregatedParams(round, agg_params_map);
+            // Async aggregates: the layout for clients without params in this round, and
+            // which buffered params went into it
+            if (upload.chunk_counts && upload.orig_sizes) {
+                storage.StoreAggregatedLayout(round, *upload.chunk_counts, *upload.orig_sizes);
+            }
+            if (upload.consumed) {
+                for (const auto& [client, consumed_round] : *upload.consumed) {
+                    storage.MarkParamsConsumed(client, consumed_round);
+                }
+            }
             send_json(c, R"({"status":"aggregated params stored"})");
             return;
         }
@@ -198,50 +546,214 @@ static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
             }
 
             int round = std::stoi(round_str);
-            auto agg = storage.GetAggregatedParam(client_id, round);
-            if (agg.is_null() || agg.empty()) {
+            std::string part_str = get_query_param(&hm->query_string, "part");
+            size_t part = part_str.empty() ? 0 : std::stoul(part_str);
+            size_t parts = 1;
+            std::shared_ptr<const std::string> agg = storage.GetAggregatedParam(client_id, round, part, parts);
+            if (!agg) {
                 send_error(c, 404, "No aggregated param found");
                 return;
             }
 
+            // Wrap response in "metadata" and "data"; the ciphertexts are written straight from
+            // the stored aggregate, which `agg` keeps alive even if it is replaced meanwhile
+            AggregateDownload response;
+            response.metadata.client_id = client_id;
+            response.metadata.round = round;
+            response.data.agg_params = Blob::View(*agg);
+
+            // Later parts of a multipart aggregate: the ciphertexts only, the layout came with part 0
+            if (part > 0) {
+                response.metadata.part = part;
+                send_json(c, WriteMessage(response));
+                return;
+            }
+
             auto chunk_counts = storage.GetChunkCounts(client_id, round);
             auto orig_sizes = storage.GetOrigSizes(client_id, round); // << Added retrieval of original sizes
+            if (chunk_counts.empty()) {
+                chunk_counts = storage.GetAggregatedChunkCounts(round);
+                orig_sizes = storage.GetAggregatedOrigSizes(round);
+            }
 
-            // Wrap response in "metadata" and "data"
-            json response_json = {
-                {"metadata", {
-                    {"client_id", client_id},
-                    {"round", round}
-                }},
-                {"data", {
-                    {"agg_params", agg["agg_params"]}
-                }}
-            };
-
+            if (parts > 1) {
+                response.data.parts = parts;
+            }
             if (!chunk_counts.empty()) {
-                response_json["data"]["chunk_counts"] = chunk_counts;
+                response.data.chunk_counts = std::move(chunk_counts);
             }
             if (!orig_sizes.empty()) {
-                response_json["data"]["orig_sizes"] = orig_sizes; // << Added original sizes in response
+                response.data.orig_sizes = std::move(orig_sizes); // << Added original sizes in response
+            }
+            json plain_layers = storage.GetAggregatedPlainLayers(round);
+            if (!plain_layers.empty()) {
+                response.data.plain_layers = std::move(plain_layers);
             }
 
-            send_json(c, response_json.dump());
+            send_json(c, WriteMessage(response));
             return;
         }
 
-        // RESULTS MANAGEMENT (Accuracy/Metrics)
-        if (uri == "/c2s/result" && method == "POST") {
-            if (!payload.contains("client_id") || !payload.contains("round") || !payload.contains("accuracy") || !payload.contains("model")) {
-                send_error(c, 400, "Missing fields in result JSON");
+        // ASYNC AGGREGATION: clients upload params tagged with the model version they trained
+        // from; the aggregator drains the buffer once enough fresh updates are waiting
+
+        if (uri == "/s2c/model_version" && method == "GET") {
+            std::string client_id = get_query_param(&hm->query_string, "client_id");
+            if (client_id.empty()) {
+                send_error(c, 400, "Missing client_id parameter");
+                return;
+            }
+
+            send_json(c, WriteMessage(ModelVersionResponse{client_id, storage.LatestAggregatedRound(client_id)}));
+            return;
+        }
+
+        if (uri == "/s2c/async_buffer" && method == "GET") {
+            std::string hub = get_query_param(&hm->query_string, "hub");
+            std::string staleness_str = get_query_param(&hm->query_string, "max_staleness");
+            std::string min_updates_str = get_query_param(&hm->query_string, "min_updates");
+            if (hub.empty() || staleness_str.empty() || min_updates_str.empty()) {
+                send_error(c, 400, "Missing hub, max_staleness or min_updates");
                 return;
             }
 
-            std::string client = payload["client_id"];
-            int round = payload["round"];
-            double accuracy = payload["accuracy"];
-            std::string model = payload["model"];
+            // Params are only sent once min_updates are waiting, so polling stays cheap
+            int version = storage.LatestAggregatedRound(hub);
+            std::vector<std::string> clients = storage.GetHubGroup(hub);
+            size_t stale = 0;
+            json pending = storage.GetPendingParams(clients, version - std::stoi(staleness_str), stale);
+
+            AsyncBufferResponse response;
+            response.metadata = {hub, version, std::move(clients), pending.size(), stale};
+            if (pending.size() >= std::stoul(min_updates_str)) {
+                // The params are written straight from `pending`
+                auto& updates = response.data.emplace().updates;
+                for (auto it = pending.begin(); it != pending.end(); ++it) {
+                    json& entry = it.value();
+                    BufferedUpdate& update = updates[it.key()];
+                    update.round = entry["round"];
+                    update.params = Blob::View(entry["params"].get_ref<const std::string&>());
+                    update.chunk_counts = entry["chunk_counts"].get<std::vector<size_t>>();
+                    update.orig_sizes = entry["orig_sizes"].get<std::vector<size_t>>();
+                    if (entry.contains("parts")) update.parts = entry["parts"].get<size_t>();
+                    if (entry.contains("plain_layers")) update.plain_layers = std::move(entry["plain_layers"]);
+                }
+            }
+
+            send_json(c, WriteMessage(response));
+            return;
+        }
+
+        // PARTIAL SUMS (hierarchical aggregation): every edge aggregator posts the sum of its
+        // shard of the clients; the root combines them once they cover every client
+
+        if (uri == "/c2s/partial_sum" && method == "POST") {
+            auto upload = ParseMessage<PartialSumUpload>(body);
+            storage.StorePartialSum(upload.edge_id, upload.round, upload.clients, upload.sum.str(),
+                                    upload.plain_sum.value_or(json::object()));
+            send_json(c, R"({"status":"partial sum stored"})");
+            return;
+        }
+
+        if (uri == "/s2c/partial_sums" && method == "GET") {
+            std::string round_str = get_query_param(&hm->query_string, "round");
+            if (round_str.empty()) {
+                send_error(c, 400, "Missing round parameter");
+                return;
+            }
+
+            // Sums are only sent once they cover every client (and never with summary=1), so
+            // polling stays cheap
+            int round = std::stoi(round_str);
+            bool summary = get_query_param(&hm->query_string, "summary") == "1";
+            std::vector<std::string> expected = storage.GetParamsClients(round);
+            std::vector<std::string> covered = storage.GetPartialSumClients(round);
+            bool complete = !expected.empty() &&
+                std::all_of(expected.begin(), expected.end(), [&](const std::string& id) {
+                    return std::find(covered.begin(), covered.end(), id) != covered.end();
+                });
+
+            PartialSumsResponse response;
+            response.metadata = {round, std::move(expected), std::move(covered), complete};
+            json sums;
+            if (complete && !summary) {
+                // The sums are written straight from `sums`
+                sums = storage.GetPartialSums(round);
+                auto& edges = response.data.emplace().edges;
+                for (auto it = sums.begin(); it != sums.end(); ++it) {
+                    json& entry = it.value();
+                    PartialSumEntry& edge = edges[it.key()];
+                    edge.clients = entry["clients"].get<std::vector<std::string>>();
+                    edge.sum = Blob::View(entry["sum"].get_ref<const std::string&>());
+                    if (entry.contains("plain_sum")) edge.plain_sum = std::move(entry["plain_sum"]);
+                }
+            }
+
+            send_json(c, WriteMessage(response));
+            return;
+        }
 
-            storage.StoreResult(client, round, accuracy, model);
+        // PARTIAL DECRYPTIONS (threshold mode): every client that uploaded params for a
+        // round posts its share of the aggregate's decryption; each client fuses all of them
+
+        if (uri == "/c2s/partial_dec" && method == "POST") {
+            auto upload = ParseMessage<PartialDecryptionUpload>(body);
+            std::vector<std::string> holders = storage.GetJointKeyHolders();
+            if (std::find(holders.begin(), holders.end(), upload.client_id) == holders.end()) {
+                send_error(c, 403, "Client " + upload.client_id + " holds no share of the joint key");
+                return;
+            }
+            storage.StorePartialDecryption(upload.client_id, upload.round, upload.partial.str());
+            send_json(c, R"({"status":"partial decryption stored"})");
+            return;
+        }
+
+        if (uri == "/s2c/partial_dec" && method == "GET") {
+            std::string client_id = get_query_param(&hm->query_string, "client_id");
+            std::string round_str = get_query_param(&hm->query_string, "round");
+            if (client_id.empty() || round_str.empty()) {
+                send_error(c, 400, "Missing client_id or round");
+                return;
+            }
+
+            // Partials are only sent once every joint key holder's is in (the uploaders' alone
+            // cannot decrypt), so polling stays cheap
+            int round = std::stoi(round_str);
+            std::vector<std::string> expected = storage.GetJointKeyHolders();
+            if (expected.empty()) {
+                send_error(c, 409, "No joint public key stored; run ./operations joint_key first");
+                return;
+            }
+            std::vector<std::string> received = storage.GetPartialDecryptionClients(round);
+            bool complete =
+                std::all_of(expected.begin(), expected.end(), [&](const std::string& id) {
+                    return std::find(received.begin(), received.end(), id) != received.end();
+                });
+
+            PartialDecryptionsResponse response;
+            response.metadata = {client_id, round, std::move(expected), std::move(received)};
+            json partials;
+            if (complete) {
+                // The partials are written straight from `partials`
+                partials = storage.GetPartialDecryptions(round);
+                PartialDecryptionsData& data = response.data.emplace();
+                for (auto it = partials.begin(); it != partials.end(); ++it) {
+                    data.partials[it.key()] = Blob::View(it.value().get_ref<const std::string&>());
+                }
+                data.clients = storage.GetParamsClients(round);
+                data.chunk_counts = storage.GetChunkCounts(client_id, round);
+                data.orig_sizes = storage.GetOrigSizes(client_id, round);
+                data.plain_layers = storage.GetAggregatedPlainLayers(round);
+            }
+
+            send_json(c, WriteMessage(response));
+            return;
+        }
+
+        // RESULTS MANAGEMENT (Accuracy/Metrics)
+        if (uri == "/c2s/result" && method == "POST") {
+            auto upload = ParseMessage<ResultUpload>(body);
+            storage.StoreResult(upload.client_id, upload.round, upload.accuracy, upload.model);
             send_json(c, R"({"status":"result stored"})");
             return;
         }
@@ -268,6 +780,9 @@ static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
 
         send_error(c, 404, "Unknown endpoint");
     }
+    catch (const MessageError& me) {
+        send_error(c, 400, std::string("Invalid message: ") + me.what());
+    }
     catch (const json::exception& je) {
         send_error(c, 400, std::string("JSON parse error: ") + je.what());
     }
@@ -279,25 +794,133 @@ static void handle_request(struct mg_connection* c, int ev, void* ev_data) {
     }
 }
 
+// Endpoints reported individually in /metrics
+static const char* kEndpoints[] = {
+    "/metrics",
+    "/c2s/public_key", "/s2c/public_key",
+    "/c2s/rekey", "/s2c/rekey",
+    "/c2s/params", "/s2c/params", "/s2c/param_parts", "/s2c/plain_params", "/s2c/round_plan",
+    "/c2s/server/agg_params", "/s2c/agg_params",
+    "/c2s/partial_dec", "/s2c/partial_dec",
+    "/c2s/partial_sum", "/s2c/partial_sums",
+    "/s2c/model_version", "/s2c/async_buffer",
+    "/c2s/result", "/s2c/result",
+    "/s2c/job", "/s2c/jobs", "/c2s/workers/acquire", "/c2s/workers/release",
+};
+
 int main() {
-    struct mg_mgr mgr;
-    mg_mgr_init(&mgr, nullptr);
+    TraceInit("api_server");
 
-    struct mg_connection* c = mg_bind(&mgr, "0.0.0.0:8000", [](mg_connection* conn, int ev, void* ev_data) {
-        if (ev == MG_EV_HTTP_REQUEST)
-            handle_request(conn, ev, ev_data);
-    });
+    for (const char* endpoint : kEndpoints) {
+        MetricsRegisterEndpoint(endpoint);
+    }
+
+    AdmissionConfig admission_config;
+    try {
+        admission_config = LoadAdmissionConfig("server_config.txt");
+    } catch (const std::exception& e) {
+        std::cerr << "[REST Server] " << e.what() << "\n";
+        return 1;
+    }
+    admission = new AdmissionController(admission_config);
+    std::cout << "[REST Server] Admission: " << admission_config.max_concurrent_large_uploads
+              << " concurrent uploads >= " << admission_config.large_upload_bytes << " bytes, "
+              << admission_config.max_inflight_bytes << " bytes in flight\n";
+
+    // Jobs, each with its own client sampling (threshold decryption needs every key holder,
+    // so sampling stays off there) and retention
+    std::vector<JobConfig> job_configs;
+    try {
+        job_configs = LoadJobConfigs("server_config.txt");
+    } catch (const std::exception& e) {
+        std::cerr << "[REST Server] " << e.what() << "\n";
+        return 1;
+    }
+    jobs = new JobRegistry(job_configs);
+    for (const JobConfig& configured : job_configs) {
+        if (configured.aggregation_mode == "threshold" && (configured.clients_per_round > 0 || configured.deadline_seconds > 0)) {
+            std::cerr << "[REST Server] Job " << configured.name
+                      << ": clientsPerRound/roundDeadlineSeconds ignored while in threshold mode\n";
+        }
+        const JobConfig& job = *jobs->Config(configured.name);
+        std::cout << "[REST Server] Job " << job.name << " (" << (job.name == kDefaultJob ? "/" : "/jobs/" + job.name + "/")
+                  << ", dir " << job.dir << ", " << job.aggregation_mode << ")";
+        if (job.clients_per_round > 0 || job.deadline_seconds > 0) {
+            std::cout << ": sampling " << (job.clients_per_round ? std::to_string(job.clients_per_round) : "all")
+                      << " clients per round, upload deadline " << job.deadline_seconds << " s";
+        }
+        if (job.keep_rounds > 0) std::cout << ", keeping " << job.keep_rounds << " rounds";
+        std::cout << "\n";
+    }
 
-    if (!c) {
-        std::cerr << "Failed to bind to port 8000\n";
+    auto server_config = LoadConfig("server_config.txt");
+    try {
+        SetComputeBudget(LoadComputeBudget(server_config), "api_server");
+    } catch (const std::exception& e) {
+        std::cerr << "[REST Server] " << e.what() << "\n";
         return 1;
     }
+    // The pool defaults to the compute budget's cores
+    workers = new WorkerPool(ResolveThreadCount(ConfigLong(server_config, "aggregationPoolThreads", 0)),
+                             std::stod(ConfigString(server_config, "aggregationLeaseSeconds", "600")));
+    std::cout << "[REST Server] Aggregation pool: " << workers->Threads() << " threads shared by "
+              << job_configs.size() << " job(s)\n";
+
+    struct mg_mgr mgr;
+    mg_mgr_init(&mgr, nullptr);
 
-    mg_set_protocol_http_websocket(c);
-    std::cout << "[REST Server] Listening on http://localhost:8000\n";
+    auto handler = [](mg_connection* conn, int ev, void* ev_data) {
+        if (ev == MG_EV_RECV) {
+            admit_request(conn);
+        } else if (ev == MG_EV_HTTP_REQUEST) {
+            handle_request(conn, ev, ev_data);
+            release_admission(conn);
+        } else if (ev == MG_EV_CLOSE) {
+            release_admission(conn);
+            shm_replies.erase(conn);
+        }
+    };
+
+    // http://<host>:<port> listens on TCP; http+unix://<%-encoded path> on a Unix domain
+    // socket for binaries on this host. Mongoose only binds TCP/UDP itself, so the Unix
+    // socket is created here and handed to it as a listening connection.
+    std::stringstream listen_urls(ConfigString(server_config, "listen", "http://0.0.0.0:8000"));
+    std::string listen_url;
+    while (std::getline(listen_urls, listen_url, ',')) {
+        // "a, b" lists are fine too
+        listen_url.erase(0, listen_url.find_first_not_of(" \t"));
+        listen_url.erase(listen_url.find_last_not_of(" \t") + 1);
+        if (listen_url.empty()) continue;
+        struct mg_connection* c = nullptr;
+        try {
+            UnixSocketUrl local;
+            if (ParseUnixSocketUrl(listen_url, local)) {
+                c = mg_add_sock(&mgr, ListenUnixSocket(local.socket_path), handler);
+                if (c) {
+                    c->flags |= MG_F_LISTENING;
+                    local_listeners.push_back(c);
+                }
+            } else if (listen_url.rfind("http://", 0) == 0) {
+                c = mg_bind(&mgr, listen_url.substr(7).c_str(), handler);
+            } else {
+                throw std::runtime_error("listen: unsupported URL " + listen_url);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[REST Server] " << e.what() << "\n";
+            return 1;
+        }
+        if (!c) {
+            std::cerr << "Failed to listen on " << listen_url << "\n";
+            return 1;
+        }
+        mg_set_protocol_http_websocket(c);
+        std::cout << "[REST Server] Listening on " << listen_url << "\n";
+    }
 
     while (true) {
         mg_mgr_poll(&mgr, 1000);
+        expire_shm_replies();
+        TraceFlush();
     }
 
     mg_mgr_free(&mgr);
@@ -56,7 +56,7 @@ std::string Base64Encode(const std::vector<uint8_t>& data) {
     return ret;
 }
 
-std::vector<uint8_t> Base64Decode(const std::string& encoded_string) {
+std::vector<uint8_t> Base64Decode(std::string_view encoded_string) {
     size_t in_len = encoded_string.size();
     size_t i = 0;
     size_t in_ = 0;
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <cstdint>
 
@@ -8,5 +9,5 @@
 std::string Base64Encode(const std::vector<uint8_t>& data);
 
 // Decode a Base64 string into a byte buffer
-std::vector<uint8_t> Base64Decode(const std::string& base64);
+std::vector<uint8_t> Base64Decode(std::string_view base64);
 
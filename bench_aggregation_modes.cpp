@@ -0,0 +1,225 @@
+// PRE vs threshold aggregation as the number of clients grows.
+// Runs both modes' setup and rounds in-process on random weights (no server, no network)
+// and reports, per mode and N: setup time, the per-round critical path (one client's
+// encrypt + server aggregation + one client's decrypt; threshold adds the partial
+// decryption and the fusion of all N partials) and the bytes every round and the setup
+// move over the wire (Base64 payload sizes, as the HTTP API sends them).
+//
+// Usage: ./bench_aggregation_modes [clients=2,4,8,16,32] [values=4096] [rounds=3] [threads=hardware]
+//
+// Contexts come from cc_config.txt with aggregationMode overridden per mode.
+
+#include "aggregation.h"
+#include "bench_utils.h"
+#include "cc.h"
+#include "client_ops.h"
+#include "config_utils.h"
+#include "parallel_utils.h"
+#include "serialization_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+struct ModeResult {
+    double setup_ms = 0;
+    double encrypt_ms = 0;   // per client
+    double server_ms = 0;
+    double decrypt_ms = 0;   // per client: decrypt (pre) or partial + fuse (threshold)
+    size_t setup_bytes = 0;
+    size_t round_bytes = 0;
+    double max_error = 0;
+};
+
+static ModeResult RunPre(const CryptoContext<DCRTPoly>& cc, size_t n, size_t values, size_t rounds, size_t threads) {
+    ModeResult r;
+    std::vector<std::string> ids(n);
+    for (size_t i = 0; i < n; ++i) ids[i] = "c" + std::to_string(i);
+    const std::string& hub = ids[0];
+
+    // Setup: every key pair, then both rekeys between the hub and each other client
+    HubReKeys rekeys;
+    auto start = Clock::now();
+    std::vector<KeyPair<DCRTPoly>> keys = MakeHubKeys(cc, ids, threads, rekeys);
+    r.setup_ms = MillisSince(start);
+
+    // Keys up; each rekey's target key down and the rekey up
+    size_t pk_bytes = SerializePublicKeyToBase64(keys[0].publicKey).size();
+    size_t rk_bytes = SerializeEvalKeyToBase64(rekeys.to_hub.at(ids[1])).size();
+    r.setup_bytes = n * pk_bytes + 2 * (n - 1) * (pk_bytes + rk_bytes);
+
+    for (size_t round = 0; round < rounds; ++round) {
+        std::vector<std::vector<double>> expected;
+        auto weights = RandomRound(n, {values}, round, expected);
+
+        CiphertextSet params;
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> cts(n);
+        std::vector<double> enc_ms(n), dec_ms(n);
+        std::vector<size_t> chunk_counts;
+        ParallelFor(n, threads, [&](size_t i) {
+            auto t = Clock::now();
+            std::vector<size_t> counts;
+            cts[i] = EncryptLayers(cc, keys[i].publicKey, ViewLayers(weights[i]), 1, counts);
+            enc_ms[i] = MillisSince(t);
+            if (i == 0) chunk_counts = counts;
+        });
+        for (size_t i = 0; i < n; ++i) params[ids[i]] = std::move(cts[i]);
+
+        auto t = Clock::now();
+        CiphertextSet averaged = AverageCiphertexts(cc, params, hub, rekeys, threads);
+        r.server_ms += MillisSince(t);
+
+        std::vector<std::vector<std::vector<double>>> results(n);
+        ParallelFor(n, threads, [&](size_t i) {
+            auto t = Clock::now();
+            results[i] = DecryptLayers(cc, keys[i].secretKey, averaged.at(ids[i]), chunk_counts, {values}, 1);
+            dec_ms[i] = MillisSince(t);
+        });
+
+        r.encrypt_ms += Mean(enc_ms);
+        r.decrypt_ms += Mean(dec_ms);
+        for (const auto& layers : results) r.max_error = std::max(r.max_error, MaxLayerError(layers, expected));
+
+        // Params up, every rekey to the server's aggregation step, one aggregate down per client
+        size_t up = SerializeCiphertextVectorToBase64(params.at(hub)).size();
+        size_t down = SerializeCiphertextVectorToBase64(averaged.at(ids[1])).size();
+        r.round_bytes += n * up + 2 * (n - 1) * rk_bytes + n * down;
+    }
+    return r;
+}
+
+static ModeResult RunThreshold(const CryptoContext<DCRTPoly>& cc, size_t n, size_t values, size_t rounds, size_t threads) {
+    ModeResult r;
+
+    // Setup: the lead's key pair, every other share from it, then the joint key
+    std::vector<KeyPair<DCRTPoly>> keys(n);
+    PublicKey<DCRTPoly> joint;
+    auto start = Clock::now();
+    keys[0] = cc->KeyGen();
+    ParallelFor(n - 1, threads, [&](size_t i) { keys[i + 1] = cc->MultipartyKeyGen(keys[0].publicKey, false, true); });
+    std::vector<PublicKey<DCRTPoly>> shares(n);
+    for (size_t i = 0; i < n; ++i) shares[i] = keys[i].publicKey;
+    joint = JointPublicKey(cc, shares, kJointKeyId);
+    r.setup_ms = MillisSince(start);
+
+    // Shares up, the lead's key down to each other client, shares to the server, joint key up and down
+    size_t pk_bytes = SerializePublicKeyToBase64(keys[0].publicKey).size();
+    r.setup_bytes = n * pk_bytes + (n - 1) * pk_bytes + n * pk_bytes + (n + 1) * pk_bytes;
+
+    for (size_t round = 0; round < rounds; ++round) {
+        std::vector<std::vector<double>> expected;
+        auto weights = RandomRound(n, {values}, round, expected);
+
+        CiphertextSet params;
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> cts(n);
+        std::vector<double> enc_ms(n), part_ms(n), fuse_ms(n);
+        std::vector<size_t> chunk_counts;
+        ParallelFor(n, threads, [&](size_t i) {
+            auto t = Clock::now();
+            std::vector<size_t> counts;
+            cts[i] = EncryptLayers(cc, joint, ViewLayers(weights[i]), 1, counts);
+            enc_ms[i] = MillisSince(t);
+            if (i == 0) chunk_counts = counts;
+        });
+        for (size_t i = 0; i < n; ++i) params["c" + std::to_string(i)] = std::move(cts[i]);
+
+        auto t = Clock::now();
+        std::vector<Ciphertext<DCRTPoly>> sum = SumCiphertexts(cc, params, threads);
+        r.server_ms += MillisSince(t);
+
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> partials(n);
+        ParallelFor(n, threads, [&](size_t i) {
+            auto t = Clock::now();
+            partials[i] = i == 0 ? cc->MultipartyDecryptLead(sum, keys[i].secretKey)
+                                 : cc->MultipartyDecryptMain(sum, keys[i].secretKey);
+            part_ms[i] = MillisSince(t);
+        });
+
+        // Every client fuses all N partials itself
+        std::vector<std::vector<std::vector<double>>> results(n);
+        ParallelFor(n, threads, [&](size_t i) {
+            auto t = Clock::now();
+            results[i] = FuseLayers(cc, partials, chunk_counts, {values}, 1.0 / n, 1);
+            fuse_ms[i] = MillisSince(t);
+        });
+
+        r.encrypt_ms += Mean(enc_ms);
+        r.decrypt_ms += Mean(part_ms) + Mean(fuse_ms);
+        for (const auto& layers : results) r.max_error = std::max(r.max_error, MaxLayerError(layers, expected));
+
+        // Params up, the one sum down per client, each partial up and every partial down to every client
+        size_t up = SerializeCiphertextVectorToBase64(params.begin()->second).size();
+        size_t agg = SerializeCiphertextVectorToBase64(sum).size();
+        size_t partial = SerializeCiphertextVectorToBase64(partials[1]).size();
+        r.round_bytes += n * up + n * agg + n * partial + n * n * partial;
+    }
+    return r;
+}
+
+int main(int argc, char** argv) {
+    std::vector<size_t> client_counts = ParseList(argc >= 2 ? argv[1] : "2,4,8,16,32");
+    size_t values = argc >= 3 ? std::stoul(argv[2]) : 4096;
+    size_t rounds = argc >= 4 ? std::stoul(argv[3]) : 3;
+    size_t threads = ResolveThreadCount(argc >= 5 ? std::stol(argv[4]) : 0);
+
+    auto base_config = LoadConfig("cc_config.txt");
+    CryptoContext<DCRTPoly> pre_cc, threshold_cc;
+    try {
+        auto config = base_config;
+        config["aggregationMode"] = "pre";
+        pre_cc = GenerateCC(config);
+        config["aggregationMode"] = "threshold";
+        threshold_cc = GenerateCC(config);
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_aggregation_modes] " << e.what() << "\n";
+        return 1;
+    }
+    WarmUpCC(pre_cc);
+    WarmUpCC(threshold_cc);
+
+    std::cout << "[bench_aggregation_modes] ring=" << pre_cc->GetRingDimension() << " values/client=" << values
+              << " rounds=" << rounds << " threads=" << threads << " (times per round, ms; bytes per round, MB)\n";
+    std::cout << std::left << std::setw(11) << "mode" << std::setw(6) << "N"
+              << std::setw(11) << "setup_ms" << std::setw(11) << "setup_MB"
+              << std::setw(11) << "encrypt" << std::setw(11) << "server" << std::setw(11) << "decrypt"
+              << std::setw(11) << "round" << std::setw(11) << "round_MB" << "max_err\n";
+
+    for (size_t n : client_counts) {
+        if (n < 2) {
+            std::cerr << "[bench_aggregation_modes] Skipping N=" << n << ": aggregation needs at least 2 clients\n";
+            continue;
+        }
+        for (const std::string mode : {"pre", "threshold"}) {
+            ModeResult r;
+            try {
+                r = mode == "pre" ? RunPre(pre_cc, n, values, rounds, threads)
+                                  : RunThreshold(threshold_cc, n, values, rounds, threads);
+            } catch (const std::exception& e) {
+                std::cerr << "[bench_aggregation_modes] " << mode << " N=" << n << ": " << e.what() << "\n";
+                return 1;
+            }
+
+            double per_round = 1.0 / rounds;
+            double critical_ms = (r.encrypt_ms + r.server_ms + r.decrypt_ms) * per_round;
+            std::cout << std::left << std::fixed << std::setprecision(1)
+                      << std::setw(11) << mode << std::setw(6) << n
+                      << std::setw(11) << r.setup_ms << std::setw(11) << r.setup_bytes / 1048576.0
+                      << std::setw(11) << r.encrypt_ms * per_round << std::setw(11) << r.server_ms * per_round
+                      << std::setw(11) << r.decrypt_ms * per_round << std::setw(11) << critical_ms
+                      << std::setw(11) << r.round_bytes * per_round / 1048576.0
+                      << std::scientific << std::setprecision(1) << r.max_error << "\n";
+            if (r.max_error > 1e-3) {
+                std::cerr << "[bench_aggregation_modes] FAIL: " << mode << " aggregate does not match the plaintext average\n";
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Allocator comparison: one PRE round pipeline in-process (no server, no network), timed
+// and counted per stage under the allocator this binary was linked with (make ALLOCATOR=...;
+// `make bench-allocators` builds and runs one per allocator). Per round, every client
+// encrypts its chunks, serializes them to Base64 (the upload), the server decodes them,
+// averages them (AverageCiphertexts) and serializes one aggregate per client (the
+// download), and every client decodes and decrypts its aggregate.
+// Reports per stage: ms, heap allocations and MB allocated per round (operator new hooks,
+// every thread); overall: rounds/s, peak RSS and the heap's in-use/resident/fragmentation.
+//
+// Usage: ./bench_allocator [clients=4] [chunks=8] [rounds=5] [threads=budget]
+
+#include "aggregation.h"
+#include "alloc_stats.h"
+#include "cc.h"
+#include "config_utils.h"
+#include "parallel_utils.h"
+#include "serialization_utils.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+struct StageStats {
+    const char* name;
+    double ms = 0;
+    uint64_t allocs = 0;
+    uint64_t bytes = 0;
+};
+
+// Run one stage, adding its wall time and every thread's allocations to `stats`
+static void RunStage(StageStats& stats, const std::function<void()>& stage) {
+    AllocCounters before = ProcessAllocCounters();
+    auto start = Clock::now();
+    stage();
+    stats.ms += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    AllocCounters after = ProcessAllocCounters();
+    stats.allocs += after.allocs - before.allocs;
+    stats.bytes += after.bytes - before.bytes;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc >= 2 ? std::stoul(argv[1]) : 4;
+    size_t chunks = argc >= 3 ? std::stoul(argv[2]) : 8;
+    size_t rounds = argc >= 4 ? std::stoul(argv[3]) : 5;
+    size_t threads = ResolveThreadCount(argc >= 5 ? std::stol(argv[4]) : 0);
+
+    if (n < 2) {
+        std::cerr << "[bench_allocator] Aggregation needs at least 2 clients\n";
+        return 1;
+    }
+
+    CryptoContext<DCRTPoly> cc;
+    try {
+        auto config = LoadConfig("cc_config.txt");
+        config["aggregationMode"] = "pre";
+        cc = GenerateCC(config);
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_allocator] " << e.what() << "\n";
+        return 1;
+    }
+    WarmUpCC(cc);
+
+    // Setup (not timed): key pairs and the rekeys to and from the hub c0
+    std::vector<KeyPair<DCRTPoly>> keys(n);
+    std::vector<std::string> ids(n);
+    ParallelFor(n, threads, [&](size_t i) { keys[i] = cc->KeyGen(); });
+    HubReKeys rekeys;
+    for (size_t i = 0; i < n; ++i) ids[i] = "c" + std::to_string(i);
+    for (size_t i = 1; i < n; ++i) {
+        rekeys.to_hub[ids[i]] = cc->ReKeyGen(keys[i].secretKey, keys[0].publicKey);
+        rekeys.from_hub[ids[i]] = cc->ReKeyGen(keys[0].secretKey, keys[i].publicKey);
+    }
+    const size_t slots = cc->GetRingDimension() / 2;
+    Plaintext pt = cc->MakeCKKSPackedPlaintext(std::vector<double>(slots, 0.25));
+
+    std::vector<StageStats> stages = {{"encrypt"}, {"serialize"}, {"deserialize"}, {"aggregate"},
+                                      {"fan_out"}, {"decrypt"}};
+    HeapStats before = ReadHeapStats();
+    auto start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> cts(n, std::vector<Ciphertext<DCRTPoly>>(chunks));
+        std::vector<std::string> uploads(n), downloads(n);
+        CiphertextSet params, averaged;
+
+        RunStage(stages[0], [&] {
+            ParallelFor(n * chunks, threads, [&](size_t k) {
+                cts[k / chunks][k % chunks] = cc->Encrypt(keys[k / chunks].publicKey, pt);
+            });
+        });
+        RunStage(stages[1], [&] {
+            ParallelFor(n, threads, [&](size_t i) { uploads[i] = SerializeCiphertextVectorToBase64(cts[i]); });
+        });
+        cts.clear();
+        RunStage(stages[2], [&] {
+            std::vector<std::vector<Ciphertext<DCRTPoly>>> decoded(n);
+            ParallelFor(n, threads, [&](size_t i) { decoded[i] = DeserializeCiphertextVectorFromBase64(uploads[i]); });
+            for (size_t i = 0; i < n; ++i) params[ids[i]] = std::move(decoded[i]);
+        });
+        uploads.clear();
+        RunStage(stages[3], [&] { averaged = AverageCiphertexts(cc, params, ids[0], rekeys, threads); });
+        params.clear();
+        RunStage(stages[4], [&] {
+            ParallelFor(n, threads, [&](size_t i) { downloads[i] = SerializeCiphertextVectorToBase64(averaged.at(ids[i])); });
+        });
+        averaged.clear();
+        RunStage(stages[5], [&] {
+            ParallelFor(n, threads, [&](size_t i) {
+                for (const auto& ct : DeserializeCiphertextVectorFromBase64(downloads[i])) {
+                    Plaintext out;
+                    cc->Decrypt(keys[i].secretKey, ct, &out);
+                }
+            });
+        });
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    HeapStats after = ReadHeapStats();
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+
+    std::cout << "[bench_allocator] allocator=" << AllocatorName() << " ring=" << cc->GetRingDimension()
+              << " clients=" << n << " chunks/client=" << chunks << " rounds=" << rounds << " threads=" << threads
+              << (AllocHooksLinked() ? "" : " (no allocation hooks)") << "\n";
+    std::cout << std::left << std::setw(14) << "stage" << std::setw(12) << "ms/round" << std::setw(14)
+              << "allocs/round" << "alloc_MB/round\n";
+    for (const StageStats& stage : stages) {
+        std::cout << std::left << std::fixed << std::setprecision(1) << std::setw(14) << stage.name
+                  << std::setw(12) << stage.ms / rounds << std::setw(14) << stage.allocs / rounds
+                  << stage.bytes / rounds / 1048576.0 << "\n";
+    }
+    std::cout << std::fixed << std::setprecision(3) << "[bench_allocator] " << AllocatorName() << ": "
+              << rounds / seconds << " rounds/s, peak RSS " << usage.ru_maxrss / 1024 << " MB, heap ";
+    if (after.in_use_known) {
+        std::cout << "in use " << after.in_use / 1048576 << " MB of " << after.resident / 1048576
+                  << " MB resident (fragmentation " << std::setprecision(2) << *after.Fragmentation() << ", was "
+                  << *before.Fragmentation() << " before the rounds)\n";
+    } else {
+        std::cout << after.resident / 1048576 << " MB resident (in use and fragmentation unknown without "
+                  << "ALLOC_STATS=1)\n";
+    }
+    return 0;
+}
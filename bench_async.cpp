@@ -0,0 +1,219 @@
+// Synchronous vs buffered asynchronous aggregation with heterogeneous client speeds,
+// against a running api_server. Simulates N clients in-process (random weights, PRE mode)
+// whose "training" takes train_ms * 1..slowdown (spread linearly from the fastest to the
+// slowest client), and runs each mode for the same wall time:
+//   sync   every round waits for all N uploads, aggregates (AggregateRound) and every
+//          client downloads the result before training again
+//   async  clients loop download-latest / train / upload on their own; the aggregator
+//          publishes a version whenever `buffer` fresh updates are waiting (AsyncAggregateStep)
+// Reports model versions and client updates aggregated per hour, then decrypts the last
+// version of each mode and checks it against the plain (staleness-weighted) average of the
+// weights that went into it, failing above 1e-3.
+//
+// Usage: ./bench_async [clients=8] [seconds=60] [train_ms=200] [slowdown=10] [buffer=clients/2]
+//                      [max_staleness=4] [layer_shapes=64x64,64] [threads=hardware]
+//
+// Needs cc.bin (./cc). Clients are named sy_<i> / as_<i>; sync rounds start at 9000000 so
+// a sweep never touches real clients' rounds.
+
+#include "aggregation.h"
+#include "bench_utils.h"
+#include "cc.h"
+#include "client_ops.h"
+#include "curl_utils.h"
+#include "parallel_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+// N simulated clients with keys and rekeys to and from the first one (the hub)
+static std::vector<ClientContext> MakeGroup(const CryptoContext<DCRTPoly>& cc, const std::string& prefix,
+                                            size_t n, size_t threads) {
+    std::vector<ClientContext> clients(n);
+    for (size_t i = 0; i < n; ++i) {
+        clients[i].client_id = prefix + std::to_string(i);
+        clients[i].data_dir = "bench_async_data";
+        clients[i].cc = cc;
+    }
+    SimulateHubSetup(clients, threads);
+    return clients;
+}
+
+struct ModeStats {
+    size_t versions = 0;
+    size_t aggregated = 0;  // client updates that went into a version
+    size_t uploaded = 0;
+    double seconds = 0;
+    double max_error = 0;   // last version against the plain average
+};
+
+// An async client's weights depend only on the version it trained on, so the aggregator can
+// rebuild every update it consumed
+static std::vector<std::vector<double>> AsyncLayers(const std::vector<size_t>& layer_sizes, int version, size_t i) {
+    return RandomLayers(layer_sizes, static_cast<uint64_t>(version) * 7919 + i);
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc >= 2 ? std::stoul(argv[1]) : 8;
+    double seconds = argc >= 3 ? std::stod(argv[2]) : 60;
+    double train_ms = argc >= 4 ? std::stod(argv[3]) : 200;
+    double slowdown = argc >= 5 ? std::stod(argv[4]) : 10;
+    AsyncPolicy policy;
+    policy.buffer_size = argc >= 6 ? std::stoul(argv[5]) : std::max<size_t>(1, n / 2);
+    policy.max_staleness = argc >= 7 ? std::stoi(argv[6]) : 4;
+    std::vector<size_t> layer_sizes = ParseLayerSizes(argc >= 8 ? argv[7] : "64x64,64");
+    size_t threads = ResolveThreadCount(argc >= 9 ? std::stol(argv[8]) : 0);
+
+    if (n < 2) {
+        std::cerr << "[bench_async] Aggregation needs at least 2 clients\n";
+        return 1;
+    }
+    auto train_time = [&](size_t i) {
+        double factor = 1.0 + (slowdown - 1.0) * static_cast<double>(i) / static_cast<double>(n - 1);
+        return std::chrono::duration<double, std::milli>(train_ms * factor);
+    };
+
+    // The pipeline steps log every request; keep the report readable
+    DiscardCout quiet;
+    std::ostream report(quiet.original());
+
+    ModeStats sync_stats, async_stats;
+    try {
+        CryptoContext<DCRTPoly> cc = LoadCC("cc.bin");
+        WarmUpCC(cc);
+        std::filesystem::create_directories("bench_async_data");
+
+        // Sync: the slowest client sets the pace of every round
+        {
+            std::vector<ClientContext> clients = MakeGroup(cc, "sy_", n, threads);
+            int round = 9000000;
+            std::vector<std::vector<double>> last;
+            auto start = Clock::now();
+            for (; SecondsSince(start) < seconds; ++round) {
+                ParallelFor(n, n, [&](size_t i) {
+                    auto layers = RandomLayers(layer_sizes, round * 7919 + i);
+                    std::this_thread::sleep_for(train_time(i));
+                    UploadLayers(clients[i], round, ViewLayers(layers));
+                });
+                sync_stats.uploaded += n;
+                sync_stats.aggregated += AggregateRound(cc, round, "pre", clients[0].client_id, threads);
+                ++sync_stats.versions;
+                ParallelFor(n, n, [&](size_t i) {
+                    auto layers = DownloadLayers(clients[i], round);
+                    if (i == 0) last = std::move(layers);
+                });
+            }
+            sync_stats.seconds = SecondsSince(start);
+            if (sync_stats.versions > 0) {
+                std::vector<std::vector<double>> expected;
+                RandomRound(n, layer_sizes, round - 1, expected);
+                sync_stats.max_error = MaxLayerError(last, expected);
+            }
+        }
+
+        // Async: clients never wait for each other; stale updates weigh less or are dropped
+        {
+            std::vector<ClientContext> clients = MakeGroup(cc, "as_", n, threads);
+            std::atomic<size_t> uploaded{0};
+            std::atomic<bool> client_failed{false};
+            std::map<std::string, int> consumed;  // by the last version
+            auto start = Clock::now();
+            {
+                std::vector<std::jthread> workers;
+                for (size_t i = 0; i < n; ++i) {
+                    workers.emplace_back([&, i](std::stop_token stop) {
+                        try {
+                            while (!stop.stop_requested()) {
+                                int version = LatestModelVersion(clients[i]);
+                                if (version > 0) DownloadLayers(clients[i], version);
+                                auto layers = AsyncLayers(layer_sizes, version, i);
+                                std::this_thread::sleep_for(train_time(i));
+                                if (stop.stop_requested()) break;
+                                UploadLayers(clients[i], version, ViewLayers(layers));
+                                ++uploaded;
+                            }
+                        } catch (const std::exception& e) {
+                            std::cerr << "[bench_async] " << clients[i].client_id << ": " << e.what() << "\n";
+                            client_failed = true;
+                        }
+                    });
+                }
+                while (SecondsSince(start) < seconds) {
+                    if (client_failed) throw std::runtime_error("a simulated client failed");
+                    size_t updates = AsyncAggregateStep(cc, "pre", clients[0].client_id, policy, threads, &consumed);
+                    if (updates == 0) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                        continue;
+                    }
+                    async_stats.aggregated += updates;
+                    ++async_stats.versions;
+                }
+                // jthreads request stop and join here
+            }
+            async_stats.seconds = SecondsSince(start);
+            async_stats.uploaded = uploaded;
+
+            // Rebuild the last version from the updates it consumed, weighted as AsyncAggregateStep does
+            int version = LatestModelVersion(clients[0]);
+            if (version > 0) {
+                std::vector<std::vector<double>> expected(layer_sizes.size());
+                for (size_t l = 0; l < layer_sizes.size(); ++l) expected[l].assign(layer_sizes[l], 0.0);
+                double total_weight = 0;
+                for (const auto& [client_id, base] : consumed) {
+                    total_weight += StalenessWeight(version - 1 - base, policy.staleness_exponent);
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    auto it = consumed.find(clients[i].client_id);
+                    if (it == consumed.end()) continue;
+                    double weight = StalenessWeight(version - 1 - it->second, policy.staleness_exponent) / total_weight;
+                    auto layers = AsyncLayers(layer_sizes, it->second, i);
+                    for (size_t l = 0; l < layer_sizes.size(); ++l) {
+                        for (size_t j = 0; j < layer_sizes[l]; ++j) expected[l][j] += weight * layers[l][j];
+                    }
+                }
+                async_stats.max_error = MaxLayerError(DownloadLayers(clients[0], version), expected);
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_async] Exception: " << e.what() << "\n";
+        return 1;
+    }
+
+    size_t total_values = 0;
+    for (size_t size : layer_sizes) total_values += size;
+    report << std::fixed << std::setprecision(0)
+           << "[bench_async] clients=" << n << " train=" << train_ms << ".." << train_ms * slowdown
+           << "ms values/client=" << total_values << " buffer=" << policy.buffer_size
+           << " max_staleness=" << policy.max_staleness << " threads=" << threads << "\n";
+    report << std::left << std::setw(8) << "mode" << std::setw(11) << "versions" << std::setw(13) << "versions/h"
+           << std::setw(12) << "updates/h" << std::setw(12) << "uploads/h" << "aggregated\n";
+    for (const auto& [mode, stats] : {std::pair<const char*, const ModeStats&>{"sync", sync_stats},
+                                      std::pair<const char*, const ModeStats&>{"async", async_stats}}) {
+        double per_hour = 3600.0 / stats.seconds;
+        report << std::left << std::setw(8) << mode << std::setw(11) << stats.versions
+               << std::setw(13) << stats.versions * per_hour << std::setw(12) << stats.aggregated * per_hour
+               << std::setw(12) << stats.uploaded * per_hour << std::setprecision(1)
+               << 100.0 * stats.aggregated / std::max<size_t>(stats.uploaded, 1) << "%"
+               << std::scientific << std::setprecision(2) << "  max |error| " << stats.max_error << "\n"
+               << std::fixed << std::setprecision(0);
+    }
+    if (sync_stats.max_error > 1e-3 || async_stats.max_error > 1e-3) {
+        std::cerr << "[bench_async] FAIL: a published version does not match the plain average\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Compute budget sweep: how to split the cores between our ParallelFor workers and the
+// OpenMP threads OpenFHE runs inside each of them, at the ring dimension of cc_config.txt.
+// For each task count it times a client-side step (encrypt one chunk per task) and a
+// server-side step (re-encrypt one chunk per task, the PRE aggregation hot path) under
+// every split workers x OpenMP threads = cores, plus "auto" (computeInnerThreads=0) and
+// "unmanaged" (one plain thread per core, each left at OpenMP's default of one thread per
+// core, as before the budget), and prints the best fixed computeInnerThreads for each.
+//
+// Usage: ./bench_compute_budget [tasks=2,8,64] [cores=all] [pinning=none] [reps=3]
+
+#include "bench_utils.h"
+#include "cc.h"
+#include "config_utils.h"
+#include "parallel_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+// The old ParallelFor: plain threads that never touch the OpenMP width
+static void UnmanagedFor(size_t count, size_t num_threads, const std::function<void(size_t)>& body) {
+    std::atomic<size_t> next{0};
+    auto worker = [&] {
+        for (size_t i = next++; i < count; i = next++) body(i);
+    };
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < std::min(num_threads, count); ++t) workers.emplace_back(worker);
+    worker();
+    for (auto& w : workers) w.join();
+}
+
+struct CoreSplit {
+    std::string name;
+    size_t inner;      // computeInnerThreads (0 = auto)
+    bool unmanaged;
+};
+
+int main(int argc, char** argv) {
+    std::vector<size_t> task_counts = ParseList(argc >= 2 ? argv[1] : "2,8,64");
+    ComputeBudget budget;
+    budget.cores = argc >= 3 ? std::stoul(argv[2]) : 0;
+    budget.pinning = argc >= 4 ? argv[3] : "none";
+    size_t reps = argc >= 5 ? std::stoul(argv[4]) : 3;
+
+    CryptoContext<DCRTPoly> cc;
+    try {
+        SetComputeBudget(budget, "bench_compute_budget");
+        cc = GenerateCC(LoadConfig("cc_config.txt"));
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_compute_budget] " << e.what() << "\n";
+        return 1;
+    }
+    const size_t cores = CurrentComputeBudget().cores;
+    const size_t slots = cc->GetRingDimension() / 2;
+
+    // Setup (not timed): two key pairs and the rekey between them
+    auto from = cc->KeyGen();
+    auto to = cc->KeyGen();
+    auto rekey = cc->ReKeyGen(from.secretKey, to.publicKey);
+    WarmUpCC(cc, from.publicKey, from.secretKey);
+
+    std::vector<CoreSplit> splits = {{"unmanaged", 0, true}, {"auto", 0, false}};
+    for (size_t inner = 1; inner <= cores; inner *= 2) {
+        splits.push_back({std::to_string(cores / inner) + "x" + std::to_string(inner), inner, false});
+    }
+
+    std::cout << "[bench_compute_budget] ring=" << cc->GetRingDimension() << " cores=" << cores
+              << " pinning=" << budget.pinning << " reps=" << reps
+              << " (ms per step, best of reps; split = workers x OpenMP threads)\n";
+    std::cout << std::left << std::setw(8) << "tasks" << std::setw(12) << "split" << std::setw(12) << "encrypt"
+              << std::setw(12) << "reencrypt" << "total\n";
+
+    for (size_t tasks : task_counts) {
+        Plaintext pt = cc->MakeCKKSPackedPlaintext(std::vector<double>(slots, 0.5));
+        std::vector<Ciphertext<DCRTPoly>> cts(tasks), reencrypted(tasks);
+
+        auto encrypt = [&](size_t i) { cts[i] = cc->Encrypt(from.publicKey, pt); };
+        auto reencrypt = [&](size_t i) { reencrypted[i] = cc->ReEncrypt(cts[i], rekey); };
+
+        // Best of reps under one split
+        auto time_step = [&](const CoreSplit& split, const std::function<void(size_t)>& body) {
+            ComputeBudget b = budget;
+            b.inner = split.inner;
+            SetComputeBudget(b, "bench_compute_budget");
+            double best = std::numeric_limits<double>::max();
+            for (size_t r = 0; r < reps; ++r) {
+                auto start = Clock::now();
+                if (split.unmanaged) UnmanagedFor(tasks, cores, body);
+                else ParallelFor(tasks, cores, body);
+                best = std::min(best, MillisSince(start));
+            }
+            return best;
+        };
+
+        std::string best_split;
+        size_t best_inner = 0;
+        double best_total = std::numeric_limits<double>::max();
+        for (const CoreSplit& split : splits) {
+            double enc_ms = time_step(split, encrypt);
+            double reenc_ms = time_step(split, reencrypt);
+            double total = enc_ms + reenc_ms;
+            std::cout << std::left << std::fixed << std::setprecision(1) << std::setw(8) << tasks
+                      << std::setw(12) << split.name << std::setw(12) << enc_ms << std::setw(12) << reenc_ms
+                      << total << "\n";
+            if (split.inner > 0 && total < best_total) {
+                best_total = total;
+                best_split = split.name;
+                best_inner = split.inner;
+            }
+        }
+        std::cout << "[bench_compute_budget] " << tasks << " tasks: best fixed split " << best_split
+                  << " (computeInnerThreads=" << best_inner << ")\n";
+    }
+    return 0;
+}
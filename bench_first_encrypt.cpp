@@ -0,0 +1,135 @@
+// Time-to-first-encryption benchmark for the context registry and warm-up.
+// Each sample runs in a fresh child process, because OpenFHE's precomputed tables are
+// process-global and would make every run after the first one warm:
+//   baseline: Deserialize(cc.bin) + keys, then time the first encode+encrypt (today)
+//   warmed:   LoadCC + keys + WarmUpCC, then time the first encode+encrypt
+// Reports load, warm-up and first-encrypt latency, and the total for each mode.
+//
+// Usage: ./bench_first_encrypt [runs=5]   (needs cc.bin; run ./cc first)
+
+#include "bench_utils.h"
+#include "cc.h"
+
+#include "cryptocontext-ser.h"
+#include "pke/key/key-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+static const char* kKeyFile = "bench_first_encrypt.key";
+
+struct Sample {
+    double load_ms = 0;
+    double warmup_ms = 0;
+    double first_encrypt_ms = 0;
+};
+
+static Sample Measure(bool warmed) {
+    Sample s;
+    auto start = Clock::now();
+    CryptoContext<DCRTPoly> cc;
+    if (warmed) {
+        cc = LoadCC("cc.bin");
+    } else {
+        std::ifstream in("cc.bin", std::ios::binary);
+        Serial::Deserialize(cc, in, SerType::BINARY);
+    }
+    PublicKey<DCRTPoly> pk;
+    std::ifstream key_in(kKeyFile, std::ios::binary);
+    Serial::Deserialize(pk, key_in, SerType::BINARY);
+    s.load_ms = MillisSince(start);
+
+    if (warmed) {
+        start = Clock::now();
+        WarmUpCC(cc, pk);
+        s.warmup_ms = MillisSince(start);
+    }
+
+    std::vector<double> values(cc->GetRingDimension() / 2, 0.25);
+    start = Clock::now();
+    Plaintext pt = cc->MakeCKKSPackedPlaintext(values);
+    cc->Encrypt(pk, pt);
+    s.first_encrypt_ms = MillisSince(start);
+    return s;
+}
+
+// Run fn in a child process and return what it writes back
+template <typename T, typename Fn>
+static T InChild(Fn fn) {
+    int fds[2];
+    if (pipe(fds) != 0) throw std::runtime_error("pipe failed");
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        T result = fn();
+        ssize_t written = write(fds[1], &result, sizeof(result));
+        _exit(written == sizeof(result) ? 0 : 1);
+    }
+    close(fds[1]);
+    T result{};
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (got != sizeof(result) || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        throw std::runtime_error("benchmark child failed");
+    }
+    return result;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc >= 2 ? std::stoi(argv[1]) : 5;
+    if (!std::filesystem::exists("cc.bin")) {
+        std::cerr << "[bench_first_encrypt] cc.bin not found; run ./cc first\n";
+        return 1;
+    }
+
+    try {
+        // A throwaway key pair, generated in its own process so the parent stays cold
+        InChild<int>([] {
+            CryptoContext<DCRTPoly> cc;
+            std::ifstream in("cc.bin", std::ios::binary);
+            Serial::Deserialize(cc, in, SerType::BINARY);
+            auto kp = cc->KeyGen();
+            std::ofstream out(kKeyFile, std::ios::binary);
+            Serial::Serialize(kp.publicKey, out, SerType::BINARY);
+            return 0;
+        });
+
+        std::cout << std::left << std::setw(10) << "mode" << std::setw(12) << "load_ms"
+                  << std::setw(12) << "warmup_ms" << std::setw(18) << "first_encrypt_ms" << "total_ms\n";
+        for (bool warmed : {false, true}) {
+            Sample avg;
+            for (int r = 0; r < runs; ++r) {
+                Sample s = InChild<Sample>([warmed] { return Measure(warmed); });
+                avg.load_ms += s.load_ms / runs;
+                avg.warmup_ms += s.warmup_ms / runs;
+                avg.first_encrypt_ms += s.first_encrypt_ms / runs;
+            }
+            std::cout << std::left << std::setw(10) << (warmed ? "warmed" : "baseline") << std::fixed
+                      << std::setprecision(2) << std::setw(12) << avg.load_ms << std::setw(12) << avg.warmup_ms
+                      << std::setw(18) << avg.first_encrypt_ms
+                      << avg.load_ms + avg.warmup_ms + avg.first_encrypt_ms << "\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_first_encrypt] " << e.what() << "\n";
+        std::remove(kKeyFile);
+        return 1;
+    }
+    std::remove(kKeyFile);
+    return 0;
+}
@@ -0,0 +1,195 @@
+// Aggregation tree fan-in vs round latency against a running api_server.
+// Simulates N clients in-process (random weights, PRE mode) and, for every fan-in F,
+// aggregates the same kind of round through ceil(N/F) `./operations edge` processes plus one
+// `./operations root` on this host, launched together the way run.sh does. Reports the
+// edge phase (until the last edge exits) and the whole aggregation (until the root exits)
+// next to a single flat `./operations` on the same inputs, then checks every client
+// decrypts the plaintext average.
+//
+// Usage: ./bench_hierarchy [clients=32] [fan_in=2,4,8,16,32] [rounds=3] [layer_shapes=64x64,64]
+//
+// Needs cc.bin (./cc), the operations binary and aggregationMode=pre. Clients are named
+// hb<N>_<i> and use rounds 5000000+1000*F+r (F=0 for flat), so real clients' data is never
+// touched. Edges get hardware/edges threads each, the root and flat runs all of them.
+
+#include "bench_utils.h"
+#include "cc.h"
+#include "client_ops.h"
+#include "config_utils.h"
+#include "curl_utils.h"
+#include "parallel_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+extern char** environ;
+
+// Start ./operations with `args`, stdout discarded (stderr still reaches the terminal)
+static pid_t SpawnOperations(const std::vector<std::string>& args) {
+    std::vector<std::string> argv_strings = {"./operations"};
+    argv_strings.insert(argv_strings.end(), args.begin(), args.end());
+    std::vector<char*> argv;
+    for (std::string& arg : argv_strings) argv.push_back(arg.data());
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid = 0;
+    int rc = posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) {
+        throw std::runtime_error("[bench_hierarchy] Cannot start ./operations: " + std::string(strerror(rc)));
+    }
+    return pid;
+}
+
+// Wait for every process; returns each one's exit time in ms since `start`
+static std::map<pid_t, double> WaitAll(const std::vector<pid_t>& pids, Clock::time_point start) {
+    std::map<pid_t, double> exit_ms;
+    bool failed = false;
+    while (exit_ms.size() < pids.size()) {
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) break;
+        if (std::find(pids.begin(), pids.end(), pid) == pids.end()) continue;
+        exit_ms[pid] = MillisSince(start);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) failed = true;
+    }
+    if (failed || exit_ms.size() < pids.size()) {
+        throw std::runtime_error("[bench_hierarchy] An aggregator process failed");
+    }
+    return exit_ms;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc >= 2 ? std::stoul(argv[1]) : 32;
+    std::vector<std::string> fan_ins = Split(argc >= 3 ? argv[2] : "2,4,8,16,32", ',');
+    size_t rounds = argc >= 4 ? std::stoul(argv[3]) : 3;
+    std::vector<size_t> layer_sizes = ParseLayerSizes(argc >= 5 ? argv[4] : "64x64,64");
+    size_t hardware = ResolveThreadCount(0);
+
+    if (n < 2) {
+        std::cerr << "[bench_hierarchy] Aggregation needs at least 2 clients\n";
+        return 1;
+    }
+    if (ConfigString(LoadConfig("cc_config.txt"), "aggregationMode", "pre") != "pre") {
+        std::cerr << "[bench_hierarchy] ERROR: simulated clients use PRE keys; set aggregationMode=pre\n";
+        return 1;
+    }
+
+    // The pipeline steps log every request; keep the report readable
+    DiscardCout quiet;
+    std::ostream report(quiet.original());
+
+    try {
+        CryptoContext<DCRTPoly> cc = LoadCC("cc.bin");
+        WarmUpCC(cc);
+        std::filesystem::create_directories("bench_hierarchy_data");
+
+        size_t total_values = 0;
+        for (size_t size : layer_sizes) total_values += size;
+
+        std::vector<ClientContext> clients(n);
+        for (size_t i = 0; i < n; ++i) {
+            clients[i].client_id = "hb" + std::to_string(n) + "_" + std::to_string(i);
+            clients[i].data_dir = "bench_hierarchy_data";
+            clients[i].cc = cc;
+        }
+        const std::string hub = clients[0].client_id;
+
+        // Setup: every client's key pair, then rekeys to and from the hub
+        SimulateHubSetup(clients, hardware);
+
+        report << "[bench_hierarchy] ring=" << cc->GetRingDimension() << " clients=" << n
+               << " values/client=" << total_values << " rounds=" << rounds << " threads=" << hardware
+               << " (p50 ms over rounds)\n";
+        report << std::left << std::setw(9) << "fan_in" << std::setw(8) << "edges"
+               << std::setw(12) << "edge_phase" << std::setw(12) << "aggregate" << "vs_flat\n";
+
+        double flat_ms = 0;
+        fan_ins.insert(fan_ins.begin(), "0");  // flat baseline first
+        for (const std::string& fan_in_arg : fan_ins) {
+            const size_t fan_in = std::stoul(fan_in_arg);
+            const size_t edges = fan_in == 0 ? 0 : (n + fan_in - 1) / fan_in;
+            std::vector<double> edge_ms, total_ms;
+            double max_error = 0;
+
+            for (size_t r = 0; r < rounds; ++r) {
+                int round = static_cast<int>(5000000 + 1000 * fan_in + r);
+
+                // Fresh random weights per client, uploaded outside the timed region
+                std::vector<std::vector<double>> expected;
+                auto weights = RandomRound(n, layer_sizes, round, expected);
+                ParallelFor(n, hardware, [&](size_t i) { UploadLayers(clients[i], round, ViewLayers(weights[i])); });
+
+                std::vector<std::string> common = {"--round", std::to_string(round), "--hub", hub};
+                auto start = Clock::now();
+                std::vector<pid_t> edge_pids;
+                pid_t root_pid = 0;
+                if (edges == 0) {
+                    std::vector<std::string> args = common;
+                    args.insert(args.end(), {"--threads", std::to_string(hardware)});
+                    root_pid = SpawnOperations(args);
+                } else {
+                    size_t edge_threads = std::max<size_t>(1, hardware / edges);
+                    for (size_t e = 0; e < edges; ++e) {
+                        std::vector<std::string> args = common;
+                        args.insert(args.end(), {"--threads", std::to_string(edge_threads), "edge",
+                                                 "hbedge" + std::to_string(e), std::to_string(e), std::to_string(edges)});
+                        edge_pids.push_back(SpawnOperations(args));
+                    }
+                    std::vector<std::string> args = common;
+                    args.insert(args.end(), {"--threads", std::to_string(hardware), "root"});
+                    root_pid = SpawnOperations(args);
+                }
+
+                std::vector<pid_t> pids = edge_pids;
+                pids.push_back(root_pid);
+                std::map<pid_t, double> exit_ms = WaitAll(pids, start);
+                double last_edge = 0;
+                for (pid_t pid : edge_pids) last_edge = std::max(last_edge, exit_ms[pid]);
+                edge_ms.push_back(last_edge);
+                total_ms.push_back(exit_ms[root_pid]);
+
+                // Every client must decrypt the same average of all inputs
+                std::vector<std::vector<std::vector<double>>> results(n);
+                ParallelFor(n, hardware, [&](size_t i) { results[i] = DownloadLayers(clients[i], round); });
+                for (const auto& layers : results) max_error = std::max(max_error, MaxLayerError(layers, expected));
+            }
+
+            double p50 = Percentile(total_ms, 50);
+            if (edges == 0) flat_ms = p50;
+            report << std::left << std::fixed << std::setprecision(1)
+                   << std::setw(9) << (edges == 0 ? "flat" : fan_in_arg) << std::setw(8) << edges
+                   << std::setw(12) << (edges == 0 ? 0.0 : Percentile(edge_ms, 50)) << std::setw(12) << p50
+                   << std::setprecision(2) << flat_ms / p50 << "x\n";
+
+            if (max_error > 1e-3) {
+                std::cerr << "[bench_hierarchy] FAIL: fan-in " << fan_in_arg
+                          << " aggregate does not match the plaintext average (max |error| " << max_error << ")\n";
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_hierarchy] Exception: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,196 @@
+// Per-layer selective encryption: what leaving layers in plaintext saves.
+// Runs PRE rounds in-process on random weights (no server, no network) under each layer
+// policy and reports, per round: one client's encryption (policy split + encrypt), the
+// server's aggregation (encrypted layers re-encrypted, averaged and fanned out; plaintext
+// layers averaged on the vectorized path, also shown on its own), one client's decryption
+// and each client's upload payload (Base64, as the HTTP API sends it), with the savings
+// against the first policy.
+//
+// Usage: ./bench_layer_policy [clients=4] [policies=all,layer_policy.txt]
+//                             [layer_shapes=16x200,50x200,200,50x1,1] [rounds=3] [threads=hardware]
+//
+// "all" encrypts every layer; any other policy is a policy file. The default shapes are the
+// LSTM(50) + Dense(1) model's weights for 16 input features. The context comes from
+// cc_config.txt with aggregationMode=pre.
+
+#include "aggregation.h"
+#include "bench_utils.h"
+#include "cc.h"
+#include "client_ops.h"
+#include "config_utils.h"
+#include "layer_policy.h"
+#include "parallel_utils.h"
+#include "serialization_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+struct PolicyResult {
+    size_t encrypted_layers = 0;
+    size_t chunks = 0;          // per client
+    double encrypt_ms = 0;      // per client
+    double server_ms = 0;       // whole aggregation
+    double plain_ms = 0;        // plaintext part of it
+    double decrypt_ms = 0;      // per client
+    size_t upload_bytes = 0;    // per client
+    double max_error = 0;
+};
+
+static PolicyResult RunPolicy(const CryptoContext<DCRTPoly>& cc, const LayerPolicy& policy,
+                              const std::vector<KeyPair<DCRTPoly>>& keys, const HubReKeys& rekeys,
+                              const std::vector<std::vector<size_t>>& shapes, size_t rounds, size_t threads) {
+    PolicyResult r;
+    const size_t n = keys.size();
+    std::vector<std::string> ids(n);
+    for (size_t i = 0; i < n; ++i) ids[i] = "c" + std::to_string(i);
+    std::vector<size_t> layer_sizes;
+    for (const auto& shape : shapes) {
+        size_t size = 1;
+        for (size_t d : shape) size *= d;
+        layer_sizes.push_back(size);
+    }
+
+    for (size_t round = 0; round < rounds; ++round) {
+        // Fresh random weights per client and their plaintext average
+        std::vector<std::vector<double>> expected;
+        auto weights = RandomRound(n, layer_sizes, round, expected);
+
+        // Clients: split by policy, encrypt the rest
+        CiphertextSet params;
+        std::vector<std::vector<Ciphertext<DCRTPoly>>> cts(n);
+        std::vector<PlainLayers> plain(n);
+        std::vector<double> enc_ms(n), dec_ms(n);
+        std::vector<size_t> encrypted_counts;
+        ParallelFor(n, threads, [&](size_t i) {
+            std::vector<WeightsLayerView> views = ViewLayers(weights[i]);
+            for (size_t l = 0; l < views.size(); ++l) views[l].shape = shapes[l];
+            auto t = Clock::now();
+            std::vector<size_t> counts;
+            cts[i] = EncryptLayers(cc, keys[i].publicKey, SplitLayers(policy, views, plain[i]), 1, counts);
+            enc_ms[i] = MillisSince(t);
+            if (i == 0) encrypted_counts = counts;
+        });
+        r.upload_bytes += SerializeCiphertextVectorToBase64(cts[0]).size() + EncodePlainLayers(plain[0]).dump().size();
+        for (size_t i = 0; i < n; ++i) params[ids[i]] = std::move(cts[i]);
+
+        // Full layout, as the client uploads it: no chunks for plaintext layers
+        std::vector<size_t> chunk_counts, orig_sizes;
+        for (size_t l = 0, next = 0; l < expected.size(); ++l) {
+            chunk_counts.push_back(plain[0].count(l) ? 0 : encrypted_counts[next++]);
+            orig_sizes.push_back(expected[l].size());
+        }
+        r.encrypted_layers = encrypted_counts.size();
+        r.chunks = params.at(ids[0]).size();
+
+        // Server: HE layers on the PRE path, plaintext layers in the clear
+        auto t = Clock::now();
+        CiphertextSet averaged = AverageCiphertexts(cc, params, ids[0], rekeys, threads);
+        auto plain_start = Clock::now();
+        PlainLayers plain_avg;
+        for (const PlainLayers& layers : plain) AccumulatePlainLayers(plain_avg, layers);
+        ScalePlainLayers(plain_avg, 1.0 / n);
+        r.plain_ms += MillisSince(plain_start);
+        r.server_ms += MillisSince(t);
+
+        std::vector<std::vector<std::vector<double>>> results(n);
+        ParallelFor(n, threads, [&](size_t i) {
+            auto t = Clock::now();
+            results[i] = DecryptLayers(cc, keys[i].secretKey, averaged.at(ids[i]), chunk_counts, orig_sizes, 1);
+            for (const auto& [index, values] : plain_avg) results[i][index] = values;
+            dec_ms[i] = MillisSince(t);
+        });
+
+        r.encrypt_ms += Mean(enc_ms);
+        r.decrypt_ms += Mean(dec_ms);
+        for (const auto& layers : results) r.max_error = std::max(r.max_error, MaxLayerError(layers, expected));
+    }
+    return r;
+}
+
+int main(int argc, char** argv) {
+    size_t n = argc >= 2 ? std::stoul(argv[1]) : 4;
+    std::vector<std::string> policy_names = Split(argc >= 3 ? argv[2] : "all,layer_policy.txt", ',');
+    std::vector<std::vector<size_t>> shapes = ParseLayerShapes(argc >= 4 ? argv[3] : "16x200,50x200,200,50x1,1");
+    size_t rounds = argc >= 5 ? std::stoul(argv[4]) : 3;
+    size_t threads = ResolveThreadCount(argc >= 6 ? std::stol(argv[5]) : 0);
+
+    if (n < 2) {
+        std::cerr << "[bench_layer_policy] Aggregation needs at least 2 clients\n";
+        return 1;
+    }
+
+    CryptoContext<DCRTPoly> cc;
+    std::vector<LayerPolicy> policies;
+    try {
+        auto config = LoadConfig("cc_config.txt");
+        config["aggregationMode"] = "pre";
+        cc = GenerateCC(config);
+        for (const std::string& name : policy_names) {
+            policies.push_back(name == "all" ? LayerPolicy{} : LoadLayerPolicy(name));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_layer_policy] " << e.what() << "\n";
+        return 1;
+    }
+    WarmUpCC(cc);
+
+    // Setup (not timed): key pairs and the rekeys to and from the hub c0
+    std::vector<std::string> ids(n);
+    for (size_t i = 0; i < n; ++i) ids[i] = "c" + std::to_string(i);
+    HubReKeys rekeys;
+    std::vector<KeyPair<DCRTPoly>> keys = MakeHubKeys(cc, ids, threads, rekeys);
+
+    size_t total_values = 0;
+    for (const auto& shape : shapes) {
+        size_t size = 1;
+        for (size_t d : shape) size *= d;
+        total_values += size;
+    }
+    std::cout << "[bench_layer_policy] ring=" << cc->GetRingDimension() << " clients=" << n
+              << " layers=" << shapes.size() << " values/client=" << total_values << " rounds=" << rounds
+              << " threads=" << threads << " (ms per round; upload KB per client)\n";
+    std::cout << std::left << std::setw(20) << "policy" << std::setw(9) << "he_lay" << std::setw(8) << "chunks"
+              << std::setw(10) << "encrypt" << std::setw(10) << "server" << std::setw(10) << "(plain)"
+              << std::setw(10) << "decrypt" << std::setw(11) << "upload_KB" << std::setw(10) << "enc_save"
+              << std::setw(10) << "srv_save" << std::setw(10) << "byte_save" << "max_err\n";
+
+    PolicyResult baseline;
+    for (size_t p = 0; p < policies.size(); ++p) {
+        PolicyResult r;
+        try {
+            r = RunPolicy(cc, policies[p], keys, rekeys, shapes, rounds, threads);
+        } catch (const std::exception& e) {
+            std::cerr << "[bench_layer_policy] " << policy_names[p] << ": " << e.what() << "\n";
+            return 1;
+        }
+        if (p == 0) baseline = r;
+
+        auto saved = [](double base, double value) { return base > 0 ? 100.0 * (1.0 - value / base) : 0.0; };
+        double per_round = 1.0 / rounds;
+        std::cout << std::left << std::fixed << std::setprecision(1)
+                  << std::setw(20) << policy_names[p]
+                  << std::setw(9) << (std::to_string(r.encrypted_layers) + "/" + std::to_string(shapes.size()))
+                  << std::setw(8) << r.chunks
+                  << std::setw(10) << r.encrypt_ms * per_round << std::setw(10) << r.server_ms * per_round
+                  << std::setprecision(3) << std::setw(10) << r.plain_ms * per_round << std::setprecision(1)
+                  << std::setw(10) << r.decrypt_ms * per_round << std::setw(11) << r.upload_bytes * per_round / 1024.0
+                  << std::setw(10) << (std::to_string(static_cast<int>(saved(baseline.encrypt_ms, r.encrypt_ms))) + "%")
+                  << std::setw(10) << (std::to_string(static_cast<int>(saved(baseline.server_ms, r.server_ms))) + "%")
+                  << std::setw(10) << (std::to_string(static_cast<int>(saved(baseline.upload_bytes, r.upload_bytes))) + "%")
+                  << std::scientific << std::setprecision(1) << r.max_error << "\n";
+        if (r.max_error > 1e-3) {
+            std::cerr << "[bench_layer_policy] FAIL: " << policy_names[p]
+                      << " aggregate does not match the plaintext average\n";
+            return 1;
+        }
+    }
+    return 0;
+}
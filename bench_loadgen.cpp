@@ -0,0 +1,211 @@
+// Synthetic multi-client load generator against a running api_server.
+// Simulates N clients in-process with random weight tensors instead of training and runs
+// the real PRE-mode pipeline steps for each of them: keygen, rekeygen (to and from the hub
+// client), encrypt + upload, N-client aggregation (aggregation.h) and download + decrypt. For every
+// N it reports round latency percentiles, per-client upload/download latency, server
+// throughput scraped from /metrics and the server's peak RSS.
+// With client sampling on the server (clientsPerRound), only the sampled clients upload, the
+// aggregate must match their average, and every other client must get no aggregate (run it
+// against a fresh server then: every client with a key, earlier sweep steps' too, is sampled).
+//
+// Usage: ./bench_loadgen <api_server_pid> [clients=2,8,32,128,256] [rounds=3]
+//                        [layer_shapes=64x64,64] [threads=hardware]
+//
+// Needs cc.bin (./cc). Clients are named lg<N>_<i> and use rounds 1000*N+r, so a sweep
+// never touches real clients' data; the server keeps everything it stores, so its RSS
+// includes earlier sweep steps.
+
+#include "aggregation.h"
+#include "bench_utils.h"
+#include "cc.h"
+#include "client_ops.h"
+#include "curl_utils.h"
+#include "parallel_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+static std::string Millis(const std::vector<double>& seconds) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << "p50=" << Percentile(seconds, 50) * 1e3
+        << " p95=" << Percentile(seconds, 95) * 1e3 << " p99=" << Percentile(seconds, 99) * 1e3 << " ms";
+    return out.str();
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <api_server_pid> [clients=2,8,32,128,256] [rounds=3]"
+                  << " [layer_shapes=64x64,64] [threads=hardware]\n";
+        return 1;
+    }
+    long server_pid = std::stol(argv[1]);
+    std::vector<std::string> client_counts = Split(argc >= 3 ? argv[2] : "2,8,32,128,256", ',');
+    size_t rounds = argc >= 4 ? std::stoul(argv[3]) : 3;
+    std::vector<size_t> layer_sizes = ParseLayerSizes(argc >= 5 ? argv[4] : "64x64,64");
+    size_t threads = ResolveThreadCount(argc >= 6 ? std::stol(argv[5]) : 0);
+
+    if (ReadRssBytes(server_pid) == 0) {
+        std::cerr << "[bench_loadgen] ERROR: cannot read RSS of pid " << server_pid << "\n";
+        return 1;
+    }
+
+    // The pipeline steps log every request; keep the report readable
+    DiscardCout quiet;
+    std::ostream report(quiet.original());
+
+    try {
+        CryptoContext<DCRTPoly> cc = LoadCC("cc.bin");
+        WarmUpCC(cc);
+        std::filesystem::create_directories("loadgen_data");
+
+        size_t total_values = 0;
+        for (size_t n : layer_sizes) total_values += n;
+        report << "[bench_loadgen] ring=" << cc->GetRingDimension() << " layers=" << layer_sizes.size()
+               << " values/client=" << total_values << " rounds=" << rounds << " threads=" << threads << "\n";
+
+        for (const std::string& count_arg : client_counts) {
+            const size_t n = std::stoul(count_arg);
+            if (n < 2) {
+                std::cerr << "[bench_loadgen] Skipping N=" << n << ": aggregation needs at least 2 clients\n";
+                continue;
+            }
+
+            std::vector<ClientContext> clients(n);
+            for (size_t i = 0; i < n; ++i) {
+                clients[i].client_id = "lg" + std::to_string(n) + "_" + std::to_string(i);
+                clients[i].data_dir = "loadgen_data";
+                clients[i].cc = cc;
+            }
+            const std::string& hub = clients[0].client_id;
+
+            // jthread: an exception mid-sweep stops and joins the sampler on unwind
+            std::atomic<size_t> peak_rss{ReadRssBytes(server_pid)};
+            std::jthread sampler([&](std::stop_token stop) {
+                while (!stop.stop_requested()) {
+                    size_t rss = ReadRssBytes(server_pid);
+                    if (rss > peak_rss) peak_rss = rss;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                }
+            });
+
+            // Setup: every client's key pair, then rekeys to and from the hub
+            auto setup_start = Clock::now();
+            SimulateHubSetup(clients, threads);
+            double setup_s = SecondsSince(setup_start);
+
+            std::string metrics_before = HttpGetJson(ServerUrl() + "/metrics");
+            std::vector<double> round_s, upload_s, aggregate_s, download_s;
+            double max_error = 0;
+
+            for (size_t r = 0; r < rounds; ++r) {
+                int round = static_cast<int>(1000 * n + r);
+
+                // Fresh random weights per client, generated outside the timed region
+                std::vector<std::vector<double>> expected;
+                auto weights = RandomRound(n, layer_sizes, round, expected);
+
+                std::vector<double> up(n), down(n);
+                std::vector<char> uploaded(n);
+                std::vector<std::optional<std::vector<std::vector<double>>>> results(n);
+                auto round_start = Clock::now();
+
+                ParallelFor(n, threads, [&](size_t i) {
+                    auto start = Clock::now();
+                    uploaded[i] = UploadLayers(clients[i], round, ViewLayers(weights[i]));
+                    up[i] = SecondsSince(start);
+                });
+
+                // Sampled round: the aggregate is the average of the clients that uploaded
+                size_t participants = std::count(uploaded.begin(), uploaded.end(), 1);
+                if (participants == 0) throw std::runtime_error("no client uploaded round " + std::to_string(round));
+                if (participants < n) {
+                    for (size_t l = 0; l < layer_sizes.size(); ++l) {
+                        for (size_t j = 0; j < layer_sizes[l]; ++j) {
+                            double sum = 0;
+                            for (size_t i = 0; i < n; ++i) {
+                                if (uploaded[i]) sum += weights[i][l][j];
+                            }
+                            expected[l][j] = sum / participants;
+                        }
+                    }
+                }
+
+                auto agg_start = Clock::now();
+                AggregateRound(cc, round, "pre", hub, threads);
+                aggregate_s.push_back(SecondsSince(agg_start));
+
+                ParallelFor(n, threads, [&](size_t i) {
+                    auto start = Clock::now();
+                    results[i] = DownloadLayersIfParticipant(clients[i], round);
+                    down[i] = SecondsSince(start);
+                });
+
+                round_s.push_back(SecondsSince(round_start));
+                upload_s.insert(upload_s.end(), up.begin(), up.end());
+                download_s.insert(download_s.end(), down.begin(), down.end());
+
+                // Every participant must decrypt the same average; the others get nothing
+                for (size_t i = 0; i < n; ++i) {
+                    if (results[i].has_value() != static_cast<bool>(uploaded[i])) {
+                        throw std::runtime_error(clients[i].client_id + (uploaded[i] ? " uploaded but got no aggregate"
+                                                                                     : " got an aggregate of a round it was not in"));
+                    }
+                    if (results[i]) max_error = std::max(max_error, MaxLayerError(*results[i], expected));
+                }
+            }
+
+            std::string metrics_after = HttpGetJson(ServerUrl() + "/metrics");
+            sampler.request_stop();
+            sampler.join();
+
+            double busy_s = 0;
+            for (double s : round_s) busy_s += s;
+            double requests = SumSeries(metrics_after, "fl_http_requests_total") -
+                              SumSeries(metrics_before, "fl_http_requests_total");
+            double bytes = SumSeries(metrics_after, "fl_http_request_bytes_total") -
+                           SumSeries(metrics_before, "fl_http_request_bytes_total") +
+                           SumSeries(metrics_after, "fl_http_response_bytes_total") -
+                           SumSeries(metrics_before, "fl_http_response_bytes_total");
+
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+
+            report << std::fixed << std::setprecision(1)
+                   << "[bench_loadgen] N=" << n << " setup=" << setup_s << "s\n"
+                   << "  round     " << Millis(round_s) << "\n"
+                   << "  upload    " << Millis(upload_s) << " (per client)\n"
+                   << "  aggregate " << Millis(aggregate_s) << "\n"
+                   << "  download  " << Millis(download_s) << " (per client)\n"
+                   << "  server    " << requests / busy_s << " req/s, " << bytes / busy_s / (1 << 20)
+                   << " MB/s, peak RSS " << peak_rss / (1 << 20) << " MB\n"
+                   << "  loadgen   peak RSS " << usage.ru_maxrss / 1024 << " MB"
+                   << std::scientific << std::setprecision(2) << ", max |error| " << max_error << "\n";
+
+            if (max_error > 1e-3) {
+                std::cerr << "[bench_loadgen] FAIL: aggregate does not match the plaintext average\n";
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_loadgen] Exception: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+// Micro-benchmarks for every HE, serialization and encoding primitive the round pipeline
+// uses. Sweeps ring dimension (ringDim/4 .. ringDim from cc_config.txt) and multiplicative
+// depth (1 .. multiplicativeDepth) and writes one JSON document with, per primitive:
+// ns/op, output bytes/op, heap allocations/op and allocated bytes/op (alloc_hooks.cpp, counted
+// on the calling thread; allocations in OpenFHE's OpenMP helper threads are not included).
+//
+// Usage: ./bench_primitives [min_seconds_per_op=0.5] > bench_primitives.json
+//        (or `make bench-primitives`)
+//
+// Ring dimensions below the 128-bit minimum are built with securityLevel=HEStd_NotSet;
+// they are for comparing scaling, not for deployment.
+
+#include "alloc_stats.h"
+#include "base64_utils.h"
+#include "cc.h"
+#include "config_utils.h"
+#include "messages.h"
+#include "serialization_utils.h"
+
+#include "cryptocontext-ser.h"
+#include "pke/ciphertext-ser.h"
+#include "scheme/ckksrns/ckksrns-ser.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <unistd.h>
+
+using namespace lbcrypto;
+using json = nlohmann::json;
+
+// ---- Harness ----
+
+struct Result {
+    double ns_per_op;
+    double bytes_per_op;
+    double allocs_per_op;
+    double alloc_bytes_per_op;
+    uint64_t iterations;
+};
+
+// Run op() repeatedly for at least min_seconds (and 3 iterations) after one warm-up call.
+// op returns the size in bytes of what it produced (0 when not meaningful).
+static Result Measure(double min_seconds, const std::function<size_t()>& op) {
+    op();
+    uint64_t iterations = 0;
+    size_t bytes = 0;
+    AllocCounters allocs0 = ThreadAllocCounters();
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    while (iterations < 3 || elapsed < min_seconds) {
+        bytes += op();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    AllocCounters allocs = ThreadAllocCounters();
+    double n = static_cast<double>(iterations);
+    return {elapsed * 1e9 / n, bytes / n, (allocs.allocs - allocs0.allocs) / n,
+            (allocs.bytes - allocs0.bytes) / n, iterations};
+}
+
+static json ToJson(const std::string& name, const Result& r) {
+    return {{"name", name}, {"ns_per_op", r.ns_per_op}, {"bytes_per_op", r.bytes_per_op},
+            {"allocs_per_op", r.allocs_per_op}, {"alloc_bytes_per_op", r.alloc_bytes_per_op},
+            {"iterations", r.iterations}};
+}
+
+// All primitives for one (ringDim, depth) context
+static json BenchContext(const std::unordered_map<std::string, std::string>& config, double min_s) {
+    CryptoContext<DCRTPoly> cc = GenerateCC(config);
+    auto alice = cc->KeyGen();
+    auto bob = cc->KeyGen();
+    cc->EvalMultKeyGen(alice.secretKey);
+    EvalKey<DCRTPoly> rekey = cc->ReKeyGen(alice.secretKey, bob.publicKey);
+
+    size_t slots = cc->GetRingDimension() / 2;
+    std::vector<double> values(slots);
+    for (size_t i = 0; i < slots; ++i) values[i] = 0.001 * static_cast<double>(i % 1000);
+    Plaintext pt = cc->MakeCKKSPackedPlaintext(values);
+    Ciphertext<DCRTPoly> ct = cc->Encrypt(alice.publicKey, pt);
+    Ciphertext<DCRTPoly> ct2 = cc->Encrypt(alice.publicKey, pt);
+
+    // Serialization inputs sized like one small model upload (8 chunks)
+    std::vector<Ciphertext<DCRTPoly>> cts(8, ct);
+    std::string serialized;
+    {
+        std::ostringstream os;
+        Serial::Serialize(cts, os, SerType::BINARY);
+        serialized = os.str();
+    }
+    std::vector<uint8_t> raw(serialized.begin(), serialized.end());
+    std::string b64 = Base64Encode(raw);
+    std::string payload = json{{"metadata", {{"client_id", "bench"}, {"round", 1}}},
+                               {"data", {{"params", b64}, {"chunk_counts", {8}}, {"orig_sizes", {8 * slots}}}}}.dump();
+    // A small control message: a round plan of 16 participants
+    RoundPlanResponse plan_msg;
+    plan_msg.sampling = true;
+    for (int i = 0; i < 16; ++i) plan_msg.participants.push_back("client" + std::to_string(i));
+    plan_msg.uploaded = plan_msg.participants;
+    const std::string plan = WriteMessage(plan_msg);
+
+    json results = json::array();
+    auto run = [&](const std::string& name, const std::function<size_t()>& op) {
+        results.push_back(ToJson(name, Measure(min_s, op)));
+    };
+
+    run("encode", [&] { cc->MakeCKKSPackedPlaintext(values); return size_t(0); });
+    run("encrypt", [&] { cc->Encrypt(alice.publicKey, pt); return size_t(0); });
+    run("reencrypt", [&] { cc->ReEncrypt(ct, rekey); return size_t(0); });
+    run("eval_add", [&] { cc->EvalAdd(ct, ct2); return size_t(0); });
+    run("eval_mult_scalar", [&] { cc->EvalMult(ct, 0.5); return size_t(0); });
+    run("eval_mult_plain", [&] { cc->EvalMult(ct, pt); return size_t(0); });
+    run("eval_mult_ct", [&] { cc->EvalMult(ct, ct2); return size_t(0); });
+    run("decrypt", [&] {
+        Plaintext out;
+        cc->Decrypt(alice.secretKey, ct, &out);
+        return size_t(0);
+    });
+    run("serialize_ct_vector_x8", [&] {
+        std::ostringstream os;
+        Serial::Serialize(cts, os, SerType::BINARY);
+        return os.str().size();
+    });
+    run("deserialize_ct_vector_x8", [&] {
+        std::istringstream is(serialized);
+        std::vector<Ciphertext<DCRTPoly>> out;
+        Serial::Deserialize(out, is, SerType::BINARY);
+        return serialized.size();
+    });
+    run("base64_encode_x8", [&] { return Base64Encode(raw).size(); });
+    run("base64_decode_x8", [&] { return Base64Decode(b64).size(); });
+    run("json_parse_params_x8", [&] {
+        json parsed = json::parse(payload);
+        return parsed.is_object() ? payload.size() : size_t(0);
+    });
+    run("json_dump_params_x8", [&] {
+        json j = {{"data", {{"params", b64}}}};
+        return j.dump().size();
+    });
+    run("message_parse_params_x8", [&] { return ParseMessage<ParamsUpload>(payload).data.params.size(); });
+    run("message_write_params_x8", [&] {
+        ParamsUpload msg;
+        msg.data.params = Blob::View(b64);
+        return WriteMessage(msg).size();
+    });
+    run("json_parse_round_plan", [&] { return json::parse(plan)["participants"].size(); });
+    run("message_parse_round_plan", [&] { return ParseMessage<RoundPlanResponse>(plan).participants.size(); });
+
+    cc->ClearEvalMultKeys();
+    return {{"ring_dim", cc->GetRingDimension()},
+            {"depth", std::stoi(config.at("multiplicativeDepth"))},
+            {"ciphertext_bytes", serialized.size() / cts.size()},
+            {"results", results}};
+}
+
+int main(int argc, char** argv) {
+    double min_s = argc >= 2 ? std::stod(argv[1]) : 0.5;
+    auto base = LoadConfig("cc_config.txt");
+    long max_ring = ConfigLong(base, "ringDim", 16384);
+    long max_depth = ConfigLong(base, "multiplicativeDepth", 2);
+
+    char host[256] = "unknown";
+    gethostname(host, sizeof(host) - 1);
+
+    json report = {
+        {"schema", 1},
+        {"benchmark", "bench_primitives"},
+        {"timestamp", static_cast<long>(std::time(nullptr))},
+        {"host", host},
+        {"cc_config", base},
+        {"min_seconds_per_op", min_s},
+        {"contexts", json::array()}
+    };
+
+    for (long ring = max_ring / 4; ring <= max_ring; ring *= 2) {
+        for (long depth = 1; depth <= max_depth; ++depth) {
+            auto config = base;
+            config["ringDim"] = std::to_string(ring);
+            config["batchSize"] = std::to_string(ring / 2);
+            config["multiplicativeDepth"] = std::to_string(depth);
+            if (ring < max_ring) config["securityLevel"] = "HEStd_NotSet";
+            std::cerr << "[bench_primitives] ringDim=" << ring << " depth=" << depth << std::endl;
+            try {
+                report["contexts"].push_back(BenchContext(config, min_s));
+            } catch (const std::exception& e) {
+                std::cerr << "[bench_primitives] skipped ringDim=" << ring << " depth=" << depth << ": " << e.what() << std::endl;
+            }
+        }
+    }
+
+    std::cout << report.dump(2) << std::endl;
+    return 0;
+}
@@ -0,0 +1,244 @@
+// Large-model scaling against a running api_server: synthetic float32 weights of 1M, 10M and
+// 100M parameters (one flat layer per simulated client) through the real PRE pipeline —
+// encrypt + upload (in parts of part_chunks ciphertexts, maxPartChunks in client_config.txt),
+// AggregateRound (part by part) and download + decrypt. Clients run one after another, each on
+// every thread. Per scale it reports throughput of each stage in parameters/s, upload and
+// download payload per client, the largest single request, and peak RSS of the server and of
+// this process, and checks every client decrypts the plaintext average.
+//
+// The sweep stops at the first hard limit and says which: a request over the server's body
+// cap (part_chunks=0 sends each model in one request), a server that did not store an
+// upload, or not enough memory for the server's copies of every payload (checked up front
+// against MemAvailable, so the host is not driven into the OOM killer).
+//
+// Usage: ./bench_scale <api_server_pid> [params=1M,10M,100M] [clients=2] [part_chunks=64]
+//                      [threads=budget]
+//
+// Needs cc.bin (./cc). Clients are named sc<params>_<i> and use round 2000+<scale index>;
+// the server keeps what it stores unless keepRounds is set, so its RSS includes earlier scales.
+
+#include "aggregation.h"
+#include "bench_utils.h"
+#include "cc.h"
+#include "client_ops.h"
+#include "curl_utils.h"
+#include "messages.h"
+#include "parallel_utils.h"
+#include "serialization_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+// api_server's MG_MAX_HTTP_REQUEST_SIZE (Makefile)
+static const size_t kServerBodyCap = 100 * 1024 * 1024;
+
+// "1M" -> 1000000 (K, M and G suffixes)
+static size_t ParseCount(const std::string& text) {
+    size_t multiplier = 1;
+    switch (text.back()) {
+        case 'K': case 'k': multiplier = 1000; break;
+        case 'M': case 'm': multiplier = 1000000; break;
+        case 'G': case 'g': multiplier = 1000000000; break;
+    }
+    return static_cast<size_t>(std::stod(multiplier == 1 ? text : text.substr(0, text.size() - 1)) * multiplier);
+}
+
+static double Megabytes(double bytes) {
+    return bytes / (1 << 20);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <api_server_pid> [params=1M,10M,100M] [clients=2]"
+                  << " [part_chunks=64] [threads=budget]\n";
+        return 1;
+    }
+    long server_pid = std::stol(argv[1]);
+    std::vector<std::string> scales = Split(argc >= 3 ? argv[2] : "1M,10M,100M", ',');
+    size_t n = argc >= 4 ? std::stoul(argv[3]) : 2;
+    size_t part_chunks = argc >= 5 ? std::stoul(argv[4]) : 64;
+    size_t threads = ResolveThreadCount(argc >= 6 ? std::stol(argv[5]) : 0);
+
+    if (n < 2) {
+        std::cerr << "[bench_scale] Aggregation needs at least 2 clients\n";
+        return 1;
+    }
+    if (ReadRssBytes(server_pid) == 0) {
+        std::cerr << "[bench_scale] ERROR: cannot read RSS of pid " << server_pid << "\n";
+        return 1;
+    }
+
+    // The pipeline steps log every request; keep the report readable
+    DiscardCout quiet;
+    std::ostream report(quiet.original());
+
+    try {
+        CryptoContext<DCRTPoly> cc = LoadCC("cc.bin");
+        WarmUpCC(cc);
+        std::filesystem::create_directories("scale_data");
+        const size_t slots = cc->GetRingDimension() / 2;
+
+        // Size of one uploaded chunk, from a throwaway key
+        auto probe_keys = cc->KeyGen();
+        const size_t ct_bytes = SerializeCiphertextVectorToBase64(
+            {cc->Encrypt(probe_keys.publicKey, cc->MakeCKKSPackedPlaintext(std::vector<double>(slots, 0.5)))}).size();
+
+        report << std::fixed << std::setprecision(2) << "[bench_scale] ring=" << cc->GetRingDimension()
+               << " ciphertext=" << Megabytes(ct_bytes) << " MB (Base64, " << slots << " params) clients=" << n
+               << " part_chunks=" << part_chunks << " threads=" << threads << "\n";
+
+        for (size_t s = 0; s < scales.size(); ++s) {
+            const size_t params = ParseCount(scales[s]);
+            const int round = static_cast<int>(2000 + s);
+            const size_t chunks = (params + slots - 1) / slots;
+            const size_t per_part = part_chunks == 0 ? chunks : std::min(part_chunks, chunks);
+            const size_t parts = (chunks + per_part - 1) / per_part;
+            const double upload_bytes = static_cast<double>(chunks) * ct_bytes;
+            const double request_bytes = static_cast<double>(per_part) * ct_bytes;
+            report << "[bench_scale] params=" << scales[s] << " (" << params << ") chunks=" << chunks
+                   << " parts=" << parts << " largest request ~" << Megabytes(request_bytes) << " MB\n";
+
+            // The server holds every client's params and aggregate as Base64; this process the
+            // weights, one client's decrypted average and its aggregate ciphertexts
+            const double server_need = 2.0 * n * upload_bytes;
+            const double bench_need = n * params * sizeof(float) + params * sizeof(double) + upload_bytes * 3 / 4;
+            const size_t available = ReadProcKb("/proc/meminfo", "MemAvailable:");
+            if (server_need + bench_need > available) {
+                report << "[bench_scale] LIMIT at " << scales[s] << ": needs ~" << Megabytes(server_need) / 1024
+                       << " GB on the server and ~" << Megabytes(bench_need) / 1024 << " GB here, "
+                       << Megabytes(available) / 1024 << " GB available\n";
+                break;
+            }
+            if (request_bytes > kServerBodyCap) {
+                report << "  (a request of ~" << Megabytes(request_bytes) << " MB exceeds the server's "
+                       << Megabytes(kServerBodyCap) << " MB body cap; expect it to be refused)\n";
+            }
+
+            std::vector<ClientContext> clients(n);
+            for (size_t i = 0; i < n; ++i) {
+                clients[i].client_id = "sc" + scales[s] + "_" + std::to_string(i);
+                clients[i].data_dir = "scale_data";
+                clients[i].cc = cc;
+                clients[i].encrypt_threads = threads;
+                clients[i].decrypt_threads = threads;
+                clients[i].max_part_chunks = part_chunks;
+            }
+            const std::string& hub = clients[0].client_id;
+
+            SimulateHubSetup(clients, threads);
+
+            // Synthetic weights, generated outside the timed region
+            std::vector<std::vector<float>> weights(n, std::vector<float>(params));
+            ParallelFor(n, threads, [&](size_t i) {
+                std::mt19937_64 rng(round * 7919 + i);
+                std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+                for (float& w : weights[i]) w = dist(rng);
+            });
+
+            // jthread: an exception mid-scale stops and joins the sampler on unwind
+            std::atomic<size_t> peak_rss{ReadRssBytes(server_pid)};
+            std::jthread sampler([&](std::stop_token stop) {
+                while (!stop.stop_requested()) {
+                    size_t rss = ReadRssBytes(server_pid);
+                    if (rss > peak_rss) peak_rss = rss;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                }
+            });
+
+            std::string limit;
+            double upload_s = 0, aggregate_s = 0, download_s = 0, max_error = 0;
+            double upload_payload = 0, download_payload = 0;
+            try {
+                std::string metrics = HttpGetJson(ServerUrl() + "/metrics");
+                auto start = Clock::now();
+                for (size_t i = 0; i < n; ++i) {
+                    WeightsLayerView view{weights[i].data(), params, WeightsDType::Float32, {params}};
+                    UploadLayers(clients[i], round, {view});
+                }
+                upload_s = SecondsSince(start);
+                std::string after = HttpGetJson(ServerUrl() + "/metrics");
+                upload_payload = (SumSeries(after, "fl_http_request_bytes_total") -
+                                  SumSeries(metrics, "fl_http_request_bytes_total")) / n;
+
+                // A refused request does not throw; the round plan shows whose upload is missing
+                auto plan = ParseMessage<RoundPlanResponse>(
+                    HttpGetJson(ServerUrl() + "/s2c/round_plan?round=" + std::to_string(round)));
+                if (plan.uploaded.size() < n) {
+                    throw std::runtime_error("the server stored " + std::to_string(plan.uploaded.size()) + " of " +
+                                             std::to_string(n) + " uploads (largest request ~" +
+                                             std::to_string(static_cast<size_t>(Megabytes(request_bytes))) + " MB)");
+                }
+
+                start = Clock::now();
+                AggregateRound(cc, round, "pre", hub, threads);
+                aggregate_s = SecondsSince(start);
+
+                metrics = HttpGetJson(ServerUrl() + "/metrics");
+                for (size_t i = 0; i < n; ++i) {
+                    start = Clock::now();
+                    std::vector<std::vector<double>> result = DownloadLayers(clients[i], round);
+                    download_s += SecondsSince(start);
+
+                    // Every client must decrypt the average of all inputs
+                    const std::vector<double>& layer = result.at(0);
+                    for (size_t j = 0; j < params; ++j) {
+                        double expected = 0;
+                        for (size_t k = 0; k < n; ++k) expected += weights[k][j];
+                        max_error = std::max(max_error, std::abs(layer[j] - expected / n));
+                    }
+                }
+                after = HttpGetJson(ServerUrl() + "/metrics");
+                download_payload = (SumSeries(after, "fl_http_response_bytes_total") -
+                                    SumSeries(metrics, "fl_http_response_bytes_total")) / n;
+            } catch (const std::exception& e) {
+                limit = e.what();
+            }
+            sampler.request_stop();
+            sampler.join();
+
+            rusage usage{};
+            getrusage(RUSAGE_SELF, &usage);
+            if (!limit.empty()) {
+                report << "[bench_scale] LIMIT at " << scales[s] << ": " << limit << "\n"
+                       << "  server peak RSS " << peak_rss / (1 << 20) << " MB, bench peak RSS "
+                       << usage.ru_maxrss / 1024 << " MB\n";
+                break;
+            }
+
+            const double total = static_cast<double>(n) * params;
+            report << std::fixed << std::setprecision(2)
+                   << "  upload    " << upload_s << " s (encrypt + POST, " << total / upload_s / 1e6 << " Mparams/s), "
+                   << Megabytes(upload_payload) << " MB per client\n"
+                   << "  aggregate " << aggregate_s << " s (" << total / aggregate_s / 1e6 << " Mparams/s)\n"
+                   << "  download  " << download_s << " s (GET + decrypt, " << total / download_s / 1e6
+                   << " Mparams/s), " << Megabytes(download_payload) << " MB per client\n"
+                   << "  memory    server peak RSS " << peak_rss / (1 << 20) << " MB, bench peak RSS "
+                   << usage.ru_maxrss / 1024 << " MB"
+                   << std::scientific << std::setprecision(2) << ", max |error| " << max_error << "\n";
+
+            if (max_error > 1e-3) {
+                std::cerr << "[bench_scale] FAIL: aggregate does not match the plaintext average\n";
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[bench_scale] Exception: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+// Transport comparison for co-located binaries: loopback TCP against the Unix domain socket,
+// with bodies inline and through shared memory (local_transport.h).
+// Needs a running api_server listening on both URLs (`listen` in server_config.txt) with
+// clientsPerRound=0; uploads go to rounds 3000+ as clients tp_tcp / tp_unix / tp_unix_shm,
+// one storage slot per transport and size.
+// Reports small-message latency (p50/p99 of GET /s2c/job) and large-blob throughput (MB/s of
+// POST /c2s/params and GET /s2c/params, medians), checking the blob comes back intact.
+//
+// Usage: ./bench_transport [unix_url=http+unix://%2Ftmp%2Ffl_server.sock] [tcp_url=http://localhost:8000]
+//                          [sizes_mb=1,16,64] [reps=5]
+
+#include "bench_utils.h"
+#include "curl_utils.h"
+#include "local_transport.h"
+#include "messages.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct Transport {
+    std::string name;
+    std::string url;
+    bool shm;  // bodies of FL_SHM_MIN_BYTES and up through shared memory
+};
+
+// Random Base64 text of `bytes` characters, like an uploaded ciphertext vector
+static std::string RandomBase64(size_t bytes) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::mt19937_64 rng(bytes);
+    std::string text(bytes, 'A');
+    for (char& c : text) c = alphabet[rng() & 63];
+    return text;
+}
+
+int main(int argc, char** argv) {
+    std::string unix_url = argc >= 2 ? argv[1] : "http+unix://%2Ftmp%2Ffl_server.sock";
+    std::string tcp_url = argc >= 3 ? argv[2] : "http://localhost:8000";
+    std::vector<size_t> sizes_mb = ParseList(argc >= 4 ? argv[3] : "1,16,64");
+    size_t reps = argc >= 5 ? std::stoul(argv[4]) : 5;
+    if (reps == 0 || sizes_mb.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [unix_url] [tcp_url] [sizes_mb=1,16,64] [reps=5]\n";
+        return 1;
+    }
+
+    const char* env = std::getenv("FL_SHM_MIN_BYTES");
+    const std::string shm_min = env && *env ? env : std::to_string(ShmMinBytes());
+    if (shm_min == "0") {
+        std::cerr << "[bench_transport] FL_SHM_MIN_BYTES=0 disables the shared-memory transport\n";
+        return 1;
+    }
+    const std::vector<Transport> transports = {
+        {"tcp", tcp_url, false},
+        {"unix", unix_url, false},
+        {"unix_shm", unix_url, true},
+    };
+
+    for (size_t t = 0; t < transports.size(); ++t) {
+        const Transport& transport = transports[t];
+        // Read by curl_utils on every request
+        setenv("FL_SHM_MIN_BYTES", transport.shm ? shm_min.c_str() : "0", 1);
+
+        try {
+            // Small control messages: round trip of a status GET
+            std::vector<double> latencies_us;
+            HttpGetJson(transport.url + "/s2c/job");
+            for (size_t i = 0; i < 200 * reps; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                HttpGetJson(transport.url + "/s2c/job");
+                latencies_us.push_back(1e6 * SecondsSince(start));
+            }
+            std::cout << "[bench_transport] " << transport.name << " GET /s2c/job p50=" << Percentile(latencies_us, 50)
+                      << "us p99=" << Percentile(latencies_us, 99) << "us\n";
+
+            // Large blobs: one upload and one download of a client's params per rep
+            for (size_t s = 0; s < sizes_mb.size(); ++s) {
+                ParamsUpload upload;
+                upload.metadata.client_id = "tp_" + transport.name;
+                upload.metadata.round = static_cast<int>(3000 + 100 * t + s);
+                upload.data.params = RandomBase64(sizes_mb[s] << 20);
+                const std::string body = WriteMessage(upload);
+                const std::string params_url = transport.url + "/s2c/params?round=" + std::to_string(upload.metadata.round);
+
+                std::vector<double> up_mbps, down_mbps;
+                for (size_t rep = 0; rep < reps; ++rep) {
+                    auto start = std::chrono::steady_clock::now();
+                    std::string stored = HttpPostJson(transport.url + "/c2s/params", body);
+                    up_mbps.push_back(body.size() / 1e6 / SecondsSince(start));
+                    if (stored.find("params stored") == std::string::npos) {
+                        throw std::runtime_error("upload rejected: " + stored);
+                    }
+
+                    start = std::chrono::steady_clock::now();
+                    std::string response = HttpGetJson(params_url);
+                    auto params = ParseMessage<std::map<std::string, Blob>>(response);
+                    down_mbps.push_back(response.size() / 1e6 / SecondsSince(start));
+                    if (rep == 0) {
+                        auto it = params.find(upload.metadata.client_id);
+                        if (it == params.end() || it->second.view() != upload.data.params.view()) {
+                            throw std::runtime_error("params of round " + std::to_string(upload.metadata.round) +
+                                                     " came back different");
+                        }
+                    }
+                }
+                std::cout << "[bench_transport] " << transport.name << " " << sizes_mb[s] << "MB params upload="
+                          << Percentile(up_mbps, 50) << "MB/s download=" << Percentile(down_mbps, 50) << "MB/s\n";
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[bench_transport] " << transport.name << " (" << transport.url << "): " << e.what() << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Load test for api_server admission control.
+// Fires a burst of simultaneous large /c2s/params uploads at a running server and
+// samples the server's RSS while they drain, checking that memory stays bounded by
+// the admission budget in server_config.txt rather than growing with the burst size.
+//
+// Usage: ./bench_upload_burst <api_server_pid> [clients=50] [payload_mb=8] [server_url]
+
+#include "admission_control.h"
+#include "bench_utils.h"
+#include "curl_utils.h"
+#include "messages.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Pull one counter value out of the Prometheus text served at /metrics
+static long ScrapeCounter(const std::string& metrics, const std::string& series) {
+    size_t pos = metrics.find(series + " ");
+    if (pos == std::string::npos) return 0;
+    return std::stol(metrics.substr(pos + series.size() + 1));
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " <api_server_pid> [clients=50] [payload_mb=8] [server_url]\n";
+        return 1;
+    }
+    long server_pid = std::stol(argv[1]);
+    size_t clients = argc >= 3 ? std::stoul(argv[2]) : 50;
+    size_t payload_mb = argc >= 4 ? std::stoul(argv[3]) : 8;
+    std::string server = argc >= 5 ? argv[4] : "http://localhost:8000";
+
+    AdmissionConfig admission = LoadAdmissionConfig("server_config.txt");
+    size_t payload_bytes = payload_mb << 20;
+
+    // All uploads overwrite the same storage slot so retained data stays one payload
+    ParamsUpload payload;
+    payload.metadata.client_id = "loadtest";
+    payload.data.params = Blob(std::string(payload_bytes, 'A'));
+    const std::string body = WriteMessage(payload);
+
+    long rejected_before = ScrapeCounter(HttpGetJson(server + "/metrics"), "fl_http_responses_total{code=\"429\"}");
+    size_t rss_before = ReadRssBytes(server_pid);
+    if (rss_before == 0) {
+        std::cerr << "[bench_upload_burst] ERROR: cannot read RSS of pid " << server_pid << "\n";
+        return 1;
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> peak_rss{rss_before};
+    std::thread sampler([&] {
+        while (!done) {
+            size_t rss = ReadRssBytes(server_pid);
+            if (rss > peak_rss) peak_rss = rss;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    });
+
+    std::atomic<size_t> succeeded{0}, failed{0};
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> uploaders;
+    for (size_t i = 0; i < clients; ++i) {
+        uploaders.emplace_back([&] {
+            try {
+                HttpPostJson(server + "/c2s/params", body);
+                succeeded++;
+            } catch (const std::exception& e) {
+                std::cerr << "[bench_upload_burst] upload failed: " << e.what() << "\n";
+                failed++;
+            }
+        });
+    }
+    for (auto& t : uploaders) t.join();
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    done = true;
+    sampler.join();
+
+    long rejected = ScrapeCounter(HttpGetJson(server + "/metrics"), "fl_http_responses_total{code=\"429\"}") - rejected_before;
+
+    // While a request is handled the server briefly holds a few copies of one body
+    // (recv buffer, body string, parsed JSON, stored params) on top of the admitted budget.
+    size_t growth = peak_rss > rss_before ? peak_rss - rss_before : 0;
+    size_t bound = std::min(admission.max_inflight_bytes,
+                            admission.max_concurrent_large_uploads * body.size()) + 5 * body.size();
+    size_t unbounded = clients * body.size();
+
+    std::cout << "[bench_upload_burst] clients=" << clients << " payload=" << body.size() / (1 << 20) << "MB"
+              << " ok=" << succeeded << " failed=" << failed << " 429s=" << rejected
+              << " elapsed=" << elapsed_s << "s\n";
+    std::cout << "[bench_upload_burst] server RSS before=" << rss_before / (1 << 20) << "MB"
+              << " peak=" << peak_rss / (1 << 20) << "MB growth=" << growth / (1 << 20) << "MB"
+              << " bound=" << bound / (1 << 20) << "MB (whole burst buffered would be "
+              << unbounded / (1 << 20) << "MB)\n";
+
+    if (failed > 0 || growth > bound) {
+        std::cout << "[bench_upload_burst] FAIL\n";
+        return 1;
+    }
+    std::cout << "[bench_upload_burst] PASS: memory stayed bounded\n";
+    return 0;
+}
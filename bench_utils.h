@@ -0,0 +1,242 @@
+#pragma once
+
+#include "aggregation.h"
+#include "client_ops.h"
+#include "curl_utils.h"
+#include "messages.h"
+#include "parallel_utils.h"
+#include "serialization_utils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Helpers shared by the bench_* programs: argument parsing, timing and percentiles,
+// /proc and /metrics scraping, a quiet std::cout, and simulated clients (keys, rekeys and
+// random weights) for the pipeline benchmarks.
+
+inline double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline double MillisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline double Mean(const std::vector<double>& values) {
+    double sum = 0;
+    for (double v : values) sum += v;
+    return values.empty() ? 0 : sum / values.size();
+}
+
+// Nearest-rank percentile (p in [0, 100])
+inline double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::max<size_t>(rank, 1) - 1];
+}
+
+// Non-empty items of `text` between `sep`s
+inline std::vector<std::string> Split(const std::string& text, char sep) {
+    std::vector<std::string> out;
+    std::istringstream iss(text);
+    std::string item;
+    while (std::getline(iss, item, sep)) {
+        if (!item.empty()) out.push_back(item);
+    }
+    return out;
+}
+
+// "2,4,8" -> {2, 4, 8}
+inline std::vector<size_t> ParseList(const std::string& csv) {
+    std::vector<size_t> out;
+    for (const std::string& item : Split(csv, ',')) out.push_back(std::stoul(item));
+    return out;
+}
+
+// "50x200,200" -> shapes {{50, 200}, {200}}
+inline std::vector<std::vector<size_t>> ParseLayerShapes(const std::string& shapes) {
+    std::vector<std::vector<size_t>> out;
+    for (const std::string& shape : Split(shapes, ',')) {
+        std::vector<size_t> dims;
+        for (const std::string& dim : Split(shape, 'x')) dims.push_back(std::stoul(dim));
+        out.push_back(std::move(dims));
+    }
+    return out;
+}
+
+// "64x64,64" -> element counts {4096, 64}
+inline std::vector<size_t> ParseLayerSizes(const std::string& shapes) {
+    std::vector<size_t> sizes;
+    for (const auto& dims : ParseLayerShapes(shapes)) {
+        size_t n = 1;
+        for (size_t d : dims) n *= d;
+        sizes.push_back(n);
+    }
+    return sizes;
+}
+
+// A kB value of /proc/<pid>/status or /proc/meminfo, in bytes
+inline size_t ReadProcKb(const std::string& path, const std::string& key) {
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.rfind(key, 0) == 0) {
+            std::istringstream iss(line.substr(key.size()));
+            size_t kb = 0;
+            iss >> kb;
+            return kb * 1024;
+        }
+    }
+    return 0;
+}
+
+// Resident set size of a process in bytes (VmRSS from /proc)
+inline size_t ReadRssBytes(long pid) {
+    return ReadProcKb("/proc/" + std::to_string(pid) + "/status", "VmRSS:");
+}
+
+// Sum one Prometheus counter over all of its label sets
+inline double SumSeries(const std::string& metrics, const std::string& name) {
+    double total = 0;
+    std::istringstream iss(metrics);
+    std::string line;
+    while (std::getline(iss, line)) {
+        if (line.rfind(name + "{", 0) != 0) continue;
+        size_t space = line.rfind(' ');
+        if (space != std::string::npos) total += std::stod(line.substr(space + 1));
+    }
+    return total;
+}
+
+// Discards everything written to it (stateless, so workers can share it)
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override { return ch; }
+};
+
+// Sends std::cout to a NullBuffer while in scope, restoring it before the buffer goes away
+class DiscardCout {
+public:
+    DiscardCout() : saved_(std::cout.rdbuf(&discard_)) {}
+    ~DiscardCout() { std::cout.rdbuf(saved_); }
+    DiscardCout(const DiscardCout&) = delete;
+    DiscardCout& operator=(const DiscardCout&) = delete;
+
+    // Where std::cout wrote before
+    std::streambuf* original() const { return saved_; }
+
+private:
+    NullBuffer discard_;
+    std::streambuf* saved_;
+};
+
+// Key pair generated in memory and published the way GenerateClientKeys does
+inline void SimulateKeygen(ClientContext& ctx) {
+    auto kp = ctx.cc->KeyGen();
+    ctx.public_key = kp.publicKey;
+    ctx.private_key = kp.secretKey;
+    PublicKeyUpload payload;
+    payload.client_id = ctx.client_id;
+    payload.public_key = Blob(SerializePublicKeyToBase64(ctx.public_key));
+    HttpPostJson(ServerUrl() + "/c2s/public_key", WriteMessage(payload));
+}
+
+// Rekey from one simulated client to another, fetching the target key like GenerateReKey
+inline void SimulateReKeygen(const ClientContext& from, const std::string& to_client_id) {
+    std::string response = HttpGetJson(ServerUrl() + "/s2c/public_key?client_id=" + to_client_id);
+    lbcrypto::PublicKey<lbcrypto::DCRTPoly> to_pk =
+        DeserializePublicKeyFromBase64(ParseMessage<PublicKeyResponse>(response).public_key.view());
+    RekeyUpload payload;
+    payload.from_client_id = from.client_id;
+    payload.to_client_id = to_client_id;
+    payload.rekey = Blob(SerializeEvalKeyToBase64(from.cc->ReKeyGen(from.private_key, to_pk)));
+    HttpPostJson(ServerUrl() + "/c2s/rekey", WriteMessage(payload));
+}
+
+// Server-side setup of simulated clients: every key pair, then the rekeys to and from the
+// first client (the hub)
+inline void SimulateHubSetup(std::vector<ClientContext>& clients, size_t threads) {
+    const size_t n = clients.size();
+    ParallelFor(n, threads, [&](size_t i) { SimulateKeygen(clients[i]); });
+    if (n < 2) return;
+    ParallelFor(2 * (n - 1), threads, [&](size_t k) {
+        size_t i = 1 + k / 2;
+        if (k % 2 == 0) SimulateReKeygen(clients[i], clients[0].client_id);
+        else SimulateReKeygen(clients[0], clients[i].client_id);
+    });
+}
+
+// The same setup in memory (no server): key pairs for `ids` and the rekeys to and from ids[0]
+inline std::vector<lbcrypto::KeyPair<lbcrypto::DCRTPoly>> MakeHubKeys(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc, const std::vector<std::string>& ids, size_t threads,
+    HubReKeys& rekeys) {
+    const size_t n = ids.size();
+    std::vector<lbcrypto::KeyPair<lbcrypto::DCRTPoly>> keys(n);
+    std::vector<lbcrypto::EvalKey<lbcrypto::DCRTPoly>> to_hub(n), from_hub(n);
+    ParallelFor(n, threads, [&](size_t i) { keys[i] = cc->KeyGen(); });
+    if (n >= 2) {
+        ParallelFor(2 * (n - 1), threads, [&](size_t k) {
+            size_t i = 1 + k / 2;
+            if (k % 2 == 0) to_hub[i] = cc->ReKeyGen(keys[i].secretKey, keys[0].publicKey);
+            else from_hub[i] = cc->ReKeyGen(keys[0].secretKey, keys[i].publicKey);
+        });
+    }
+    for (size_t i = 1; i < n; ++i) {
+        rekeys.to_hub[ids[i]] = to_hub[i];
+        rekeys.from_hub[ids[i]] = from_hub[i];
+    }
+    return keys;
+}
+
+// Random weights in [-1, 1) for one client's training step
+inline std::vector<std::vector<double>> RandomLayers(const std::vector<size_t>& layer_sizes, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<std::vector<double>> layers;
+    for (size_t size : layer_sizes) {
+        std::vector<double> layer(size);
+        for (double& v : layer) v = dist(rng);
+        layers.push_back(std::move(layer));
+    }
+    return layers;
+}
+
+// Random weights of `n` clients for one round (seeded by round and client) and, per layer,
+// their plaintext average
+inline std::vector<std::vector<std::vector<double>>> RandomRound(size_t n, const std::vector<size_t>& layer_sizes,
+                                                                 uint64_t round,
+                                                                 std::vector<std::vector<double>>& expected) {
+    std::vector<std::vector<std::vector<double>>> weights(n);
+    expected.assign(layer_sizes.size(), {});
+    for (size_t l = 0; l < layer_sizes.size(); ++l) expected[l].assign(layer_sizes[l], 0.0);
+    for (size_t i = 0; i < n; ++i) {
+        weights[i] = RandomLayers(layer_sizes, round * 7919 + i);
+        for (size_t l = 0; l < layer_sizes.size(); ++l) {
+            for (size_t j = 0; j < layer_sizes[l]; ++j) expected[l][j] += weights[i][l][j] / n;
+        }
+    }
+    return weights;
+}
+
+// Largest absolute difference between decrypted layers and the expected ones (infinite
+// when the layouts differ)
+inline double MaxLayerError(const std::vector<std::vector<double>>& layers,
+                            const std::vector<std::vector<double>>& expected) {
+    if (layers.size() != expected.size()) return INFINITY;
+    double err = 0;
+    for (size_t l = 0; l < layers.size(); ++l) {
+        if (layers[l].size() != expected[l].size()) return INFINITY;
+        for (size_t j = 0; j < layers[l].size(); ++j) err = std::max(err, std::abs(layers[l][j] - expected[l][j]));
+    }
+    return err;
+}
@@ -0,0 +1,97 @@
+// Latency benchmark for offline/online encryption with a zero pool.
+// Offline: cost of precomputing (and persisting) one Enc(0).
+// Online: per-chunk latency of encode + Encrypt (today) vs encode + EvalAdd(Enc(0), pt),
+// on the production parameters from cc_config.txt. Also checks pooled ciphertexts decrypt
+// to the right values.
+//
+// Usage: ./bench_zero_pool [chunks=32]
+
+#include "bench_utils.h"
+#include "cc.h"
+#include "zero_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace lbcrypto;
+
+using Clock = std::chrono::steady_clock;
+
+static void Report(const std::string& label, std::vector<double> ms) {
+    std::sort(ms.begin(), ms.end());
+    double total = 0;
+    for (double v : ms) total += v;
+    std::cout << std::left << std::setw(28) << label << std::fixed << std::setprecision(2)
+              << " mean=" << std::setw(9) << total / ms.size()
+              << " p50=" << std::setw(9) << ms[ms.size() / 2]
+              << " p99=" << std::setw(9) << ms[std::min(ms.size() - 1, ms.size() * 99 / 100)] << " ms\n";
+}
+
+int main(int argc, char** argv) {
+    size_t chunks = argc >= 2 ? std::stoul(argv[1]) : 32;
+    const std::string pool_dir = "bench_zero_pool.tmp";
+
+    CryptoContext<DCRTPoly> cc = GenerateCC();
+    auto kp = cc->KeyGen();
+    size_t slots = cc->GetRingDimension() / 2;
+    std::cout << "[bench_zero_pool] ringDim=" << cc->GetRingDimension() << " chunks=" << chunks << "\n";
+
+    std::vector<std::vector<double>> inputs(chunks, std::vector<double>(slots));
+    for (size_t c = 0; c < chunks; ++c) {
+        for (size_t i = 0; i < slots; ++i) inputs[c][i] = 0.001 * static_cast<double>((c * 31 + i) % 1000);
+    }
+
+    // Warm up NTT tables and the allocator before timing anything
+    cc->Encrypt(kp.publicKey, cc->MakeCKKSPackedPlaintext(inputs[0]));
+
+    ZeroPool::Clear(pool_dir);
+    ZeroPool pool(cc, kp.publicKey, pool_dir, chunks);
+    std::vector<double> offline_ms;
+    for (size_t c = 0; c < chunks; ++c) {
+        auto start = Clock::now();
+        pool.FillOne();
+        offline_ms.push_back(MillisSince(start));
+    }
+
+    std::vector<double> fresh_ms, pooled_ms, encode_ms;
+    std::vector<Ciphertext<DCRTPoly>> pooled(chunks);
+    for (size_t c = 0; c < chunks; ++c) {
+        auto start = Clock::now();
+        Plaintext pt = cc->MakeCKKSPackedPlaintext(inputs[c]);
+        encode_ms.push_back(MillisSince(start));
+        cc->Encrypt(kp.publicKey, pt);
+        fresh_ms.push_back(MillisSince(start));
+
+        start = Clock::now();
+        Plaintext pt2 = cc->MakeCKKSPackedPlaintext(inputs[c]);
+        pooled[c] = cc->EvalAdd(pool.Take(), pt2);
+        pooled_ms.push_back(MillisSince(start));
+    }
+
+    Report("offline Enc(0)+persist", offline_ms);
+    Report("online encode only", encode_ms);
+    Report("online encode+Encrypt", fresh_ms);
+    Report("online encode+EvalAdd(pool)", pooled_ms);
+
+    double max_err = 0;
+    for (size_t c = 0; c < chunks; ++c) {
+        Plaintext out;
+        cc->Decrypt(kp.secretKey, pooled[c], &out);
+        out->SetLength(slots);
+        auto vals = out->GetRealPackedValue();
+        for (size_t i = 0; i < slots; ++i) max_err = std::max(max_err, std::abs(vals[i] - inputs[c][i]));
+    }
+    ZeroPool::Clear(pool_dir);
+
+    std::cout << "[bench_zero_pool] pooled decrypt max error " << std::scientific << max_err << "\n";
+    if (max_err > 1e-3) {
+        std::cout << "[bench_zero_pool] FAIL\n";
+        return 1;
+    }
+    return 0;
+}
@@ -1,99 +1,56 @@
 #include "openfhe.h"
 #include "scheme/ckksrns/ckksrns-ser.h"
 #include "cryptocontext-ser.h"
+#include "cc.h"
+#include "config_utils.h"
+#include "keystore.h"
+#include "trace_utils.h"
+#include <filesystem>
 #include <iostream>
 #include <fstream>
-#include <sstream>
-#include <unordered_map>
 #include <stdexcept>
+#include <string>
 
 using namespace lbcrypto;
 using namespace std;
 
-// Simple config key-value loader
-unordered_map<string, string> LoadConfig(const string& filename) {
-    unordered_map<string, string> config;
-    ifstream file(filename);
-    string line;
-
-    while (getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        size_t eqPos = line.find('=');
-        if (eqPos == string::npos) continue;
-        string key = line.substr(0, eqPos);
-        string val = line.substr(eqPos + 1);
-        config[key] = val;
-    }
-    return config;
-}
-
-int main() {
-    auto config = LoadConfig("cc_config.txt");
+// Usage: ./cc [force]
+// Reuses cc.bin when cc.fingerprint matches cc_config.txt (keys made for it stay valid);
+// `force` regenerates it regardless.
+int main(int argc, char** argv) {
+    TraceInit("cc");
+    TraceSetId("setup");
 
     try {
-        CCParams<CryptoContextCKKSRNS> params;
+        auto config = LoadConfig("cc_config.txt");
+        std::string fingerprint = ContextFingerprint(config);
+        bool force = argc >= 2 && std::string(argv[1]) == "force";
 
-        params.SetMultiplicativeDepth(stoi(config.at("multiplicativeDepth")));
-        params.SetScalingModSize(stoi(config.at("scalingModSize")));
-        params.SetBatchSize(stoi(config.at("batchSize")));
-
-        if (config.count("ringDim"))
-            params.SetRingDim(stoi(config.at("ringDim")));
-
-        // Note: Use case-insensitive lookup for scaling technique key (support SCALINGTECHNIQUE as in cc_config.txt)
-        std::string scalingKey = "rescaleTechnique";
-        if (!config.count(scalingKey)) {
-            // fallback to uppercase SCALINGTECHNIQUE key
-            scalingKey = "SCALINGTECHNIQUE";
-        }
-        if (config.count(scalingKey)) {
-            std::string rescale = config.at(scalingKey);
-            if (rescale == "FIXEDMANUAL")
-                params.SetScalingTechnique(lbcrypto::ScalingTechnique::FIXEDMANUAL);
-            else if (rescale == "FLEXIBLEAUTO")
-                params.SetScalingTechnique(lbcrypto::ScalingTechnique::FLEXIBLEAUTO);
-            else if (rescale == "FLEXIBLEAUTOEXT")
-                params.SetScalingTechnique(lbcrypto::ScalingTechnique::FLEXIBLEAUTOEXT);
-            else if (rescale == "NORESCALE")
-                params.SetScalingTechnique(lbcrypto::ScalingTechnique::NORESCALE);
-            else {
-                std::cerr << "[cc.cpp] Invalid rescaleTechnique in config: " << rescale << std::endl;
-                return 1;
-            }
+        if (!force && std::filesystem::exists("cc.bin") && ReadContextFingerprint() == fingerprint) {
+            cout << "[cc.cpp] cc.bin is up to date (context " << fingerprint << "), reusing it" << endl;
+            return 0;
         }
 
-        // PRE mode — client-defined secure param
-        if (!config.count("preMode")) {
-            std::cerr << "[cc.cpp] No preMode specified in config." << std::endl;
-            return 1;
-        }
-        string preModeStr = config["preMode"];
-        if (preModeStr == "INDCPA")
-            params.SetPREMode(INDCPA);
-        else if (preModeStr == "INDCCA") // Still INDCPA internally by OpenFHE
-            params.SetPREMode(INDCPA);
-        else {
-            cerr << "[cc.cpp] Invalid PREMode! Supported: INDCPA or INDCCA." << endl;
-            return 1;
+        CryptoContext<DCRTPoly> cc;
+        {
+            TraceSpan span("context_generate");
+            cc = GenerateCC(config);
         }
 
-        CryptoContext<DCRTPoly> cc = GenCryptoContext(params);
-        cc->Enable(PKESchemeFeature::PKE);
-        cc->Enable(PKESchemeFeature::LEVELEDSHE);
-        cc->Enable(PKESchemeFeature::PRE);
-        cc->Enable(PKESchemeFeature::KEYSWITCH);
-        cc->Enable(PKESchemeFeature::ADVANCEDSHE);
-
         ofstream ccOut("cc.bin", ios::binary);
         if (!ccOut.is_open()) {
             cerr << "[cc.cpp] Failed to open cc.bin for writing!" << endl;
             return 1;
         }
 
-        Serial::Serialize(cc, ccOut, SerType::BINARY);
+        {
+            TraceSpan span("serialize");
+            Serial::Serialize(cc, ccOut, SerType::BINARY);
+        }
         ccOut.close();
+        WriteContextFingerprint(fingerprint);
 
-        cout << "[cc.cpp] CryptoContext created and saved to cc.bin" << endl;
+        cout << "[cc.cpp] CryptoContext " << fingerprint << " created and saved to cc.bin" << endl;
 
     } catch (const std::exception& e) {
         cerr << "[cc.cpp] Exception: " << e.what() << endl;
@@ -102,4 +59,3 @@ int main() {
 
     return 0;
 }
-
@@ -1,5 +1,21 @@
 #pragma once
 #include "openfhe.h"
+#include <string>
+#include <unordered_map>
 
+// Build the CKKS/PRE CryptoContext described by cc_config.txt
 lbcrypto::CryptoContext<lbcrypto::DCRTPoly> GenerateCC();
 
+// Build a CryptoContext from config values (same keys as cc_config.txt).
+// Throws std::runtime_error on missing or invalid settings.
+lbcrypto::CryptoContext<lbcrypto::DCRTPoly> GenerateCC(const std::unordered_map<std::string, std::string>& config);
+
+// Process-wide context registry: the first call for a context deserializes `path`, later
+// calls with the same fingerprint (cc.fingerprint, else a hash of the file) share it.
+lbcrypto::CryptoContext<lbcrypto::DCRTPoly> LoadCC(const std::string& path = "cc.bin");
+
+// Build OpenFHE's lazily computed tables (NTT, samplers) now instead of in the first timed
+// encode/encrypt/decrypt. Keys are optional; each one given extends the warm-up.
+void WarmUpCC(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+              const lbcrypto::PublicKey<lbcrypto::DCRTPoly>& public_key = nullptr,
+              const lbcrypto::PrivateKey<lbcrypto::DCRTPoly>& private_key = nullptr);
@@ -4,3 +4,141 @@
 #include "pke/ciphertext-ser.h"
 #include "pke/scheme/ckksrns/ckksrns-ser.h"
 
+#include "cc.h"
+#include "config_utils.h"
+#include "keystore.h"
+#include "trace_utils.h"
+
+#include <fstream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace lbcrypto;
+using namespace std;
+
+CryptoContext<DCRTPoly> GenerateCC() {
+    return GenerateCC(LoadConfig("cc_config.txt"));
+}
+
+CryptoContext<DCRTPoly> GenerateCC(const unordered_map<string, string>& config) {
+    CCParams<CryptoContextCKKSRNS> params;
+
+    params.SetMultiplicativeDepth(stoi(config.at("multiplicativeDepth")));
+    params.SetScalingModSize(stoi(config.at("scalingModSize")));
+    params.SetBatchSize(stoi(config.at("batchSize")));
+
+    if (config.count("ringDim"))
+        params.SetRingDim(stoi(config.at("ringDim")));
+
+    // Benchmarks sweep ring dimensions below the 128-bit minimum
+    if (ConfigString(config, "securityLevel", "") == "HEStd_NotSet")
+        params.SetSecurityLevel(HEStd_NotSet);
+
+    // Note: Use case-insensitive lookup for scaling technique key (support SCALINGTECHNIQUE as in cc_config.txt)
+    string scalingKey = "rescaleTechnique";
+    if (!config.count(scalingKey)) {
+        // fallback to uppercase SCALINGTECHNIQUE key
+        scalingKey = "SCALINGTECHNIQUE";
+    }
+    if (config.count(scalingKey)) {
+        string rescale = config.at(scalingKey);
+        if (rescale == "FIXEDMANUAL")
+            params.SetScalingTechnique(ScalingTechnique::FIXEDMANUAL);
+        else if (rescale == "FLEXIBLEAUTO")
+            params.SetScalingTechnique(ScalingTechnique::FLEXIBLEAUTO);
+        else if (rescale == "FLEXIBLEAUTOEXT")
+            params.SetScalingTechnique(ScalingTechnique::FLEXIBLEAUTOEXT);
+        else if (rescale == "NORESCALE")
+            params.SetScalingTechnique(ScalingTechnique::NORESCALE);
+        else
+            throw runtime_error("Invalid rescaleTechnique in config: " + rescale);
+    }
+
+    // PRE mode — client-defined secure param
+    if (!config.count("preMode"))
+        throw runtime_error("No preMode specified in config.");
+    string preModeStr = config.at("preMode");
+    if (preModeStr == "INDCPA")
+        params.SetPREMode(INDCPA);
+    else if (preModeStr == "INDCCA") // Still INDCPA internally by OpenFHE
+        params.SetPREMode(INDCPA);
+    else
+        throw runtime_error("Invalid PREMode! Supported: INDCPA or INDCCA.");
+
+    // Threshold aggregation decrypts through partial decryptions; flood their noise so a
+    // published partial does not leak the client's secret share
+    string aggregationMode = ConfigString(config, "aggregationMode", "pre");
+    if (aggregationMode == "threshold")
+        params.SetMultipartyMode(NOISE_FLOODING_MULTIPARTY);
+    else if (aggregationMode != "pre")
+        throw runtime_error("Invalid aggregationMode! Supported: pre or threshold.");
+
+    CryptoContext<DCRTPoly> cc = GenCryptoContext(params);
+    cc->Enable(PKESchemeFeature::PKE);
+    cc->Enable(PKESchemeFeature::LEVELEDSHE);
+    cc->Enable(PKESchemeFeature::PRE);
+    cc->Enable(PKESchemeFeature::KEYSWITCH);
+    cc->Enable(PKESchemeFeature::ADVANCEDSHE);
+    if (aggregationMode == "threshold")
+        cc->Enable(PKESchemeFeature::MULTIPARTY);
+    return cc;
+}
+
+// Contexts loaded so far in this process, by fingerprint
+static mutex registry_mtx;
+static unordered_map<string, CryptoContext<DCRTPoly>> registry;
+
+CryptoContext<DCRTPoly> LoadCC(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("Could not open " + path);
+    }
+
+    // cc.fingerprint identifies cc.bin without reading it; other files hash their bytes
+    string fingerprint = path == "cc.bin" ? ReadContextFingerprint() : "";
+    string bytes;
+    if (fingerprint.empty()) {
+        ostringstream ss;
+        ss << in.rdbuf();
+        bytes = ss.str();
+        fingerprint = Fingerprint(bytes);
+    }
+
+    lock_guard<mutex> lock(registry_mtx);
+    auto it = registry.find(fingerprint);
+    if (it != registry.end()) return it->second;
+
+    CryptoContext<DCRTPoly> cc;
+    {
+        TraceSpan span("context_load", "{\"fingerprint\":\"" + fingerprint + "\"}");
+        if (bytes.empty()) {
+            Serial::Deserialize(cc, in, SerType::BINARY);
+        } else {
+            istringstream ss(bytes);
+            Serial::Deserialize(cc, ss, SerType::BINARY);
+        }
+    }
+    if (!cc) {
+        throw runtime_error("Could not deserialize CryptoContext from " + path);
+    }
+    registry.emplace(fingerprint, cc);
+    return cc;
+}
+
+void WarmUpCC(const CryptoContext<DCRTPoly>& cc, const PublicKey<DCRTPoly>& public_key,
+              const PrivateKey<DCRTPoly>& private_key) {
+    TraceSpan span("context_warmup");
+
+    // Encoding switches the plaintext to evaluation form over every tower, which builds
+    // the NTT tables; encrypt/decrypt then touch the samplers and key-side tables
+    Plaintext pt = cc->MakeCKKSPackedPlaintext(vector<double>(cc->GetRingDimension() / 2, 0.0));
+    if (!public_key) return;
+    Ciphertext<DCRTPoly> ct = cc->Encrypt(public_key, pt);
+    if (!private_key) return;
+    Plaintext out;
+    cc->Decrypt(private_key, ct, &out);
+}
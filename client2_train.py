@@ -9,6 +9,7 @@ from tensorflow.keras.optimizers import Adam
 from tensorflow.keras.losses import BinaryCrossentropy
 from sklearn.preprocessing import StandardScaler
 import pickle
+from weights_io import load_model_weights, set_model_layers, weights_format, write_weights
 
 def extract_time_features(df):
     # "Time" is 'HH:MM:SS'
@@ -114,6 +115,7 @@ def train_model(
     category_column_path = "client2_data/category_columns.json"
     scaler_path = "client2_data/scaler.pkl"
     weights_json_path = "client2_data/wc.json"
+    weights_bin_path = "client2_data/wc.bin"
 
     # --- Data loading and preprocessing (fit structure fresh) ---
     df = pd.read_csv(train_csv)
@@ -127,11 +129,33 @@ def train_model(
 
     model = create_lstm_model(input_shape=(window_size, X_train.shape[2]))
 
-    if warm_start_json and os.path.isfile(warm_start_json) and os.path.getsize(warm_start_json) > 0:
+    # FL_INPROCESS_CLIENT=1: encrypt/decrypt through the fl_client bindings in this process
+    # (context and keys loaded once, weights passed as arrays instead of files)
+    client = None
+    if os.environ.get("FL_INPROCESS_CLIENT") == "1":
+        import fl_client
+        fl_client.trace_init("client2_train")
+        client = fl_client.Client("client2")
+        current_round = fl_client.read_round_counter()
+
+    # None when a sampled round went on without this client: keep the local model instead
+    aggregate = None
+    if client is not None and current_round > 1:
+        aggregate = client.download_and_decrypt(current_round - 1)
+        if aggregate is None:
+            print(f"[client2_train.py] Not in round {current_round - 1}; keeping the local model")
+
+    if aggregate is not None:
+        set_model_layers(model, aggregate)
+        print(f"[client2_train.py] Warm start: Decrypted round {current_round - 1} aggregate in-process")
+    elif warm_start_json and os.path.isfile(warm_start_json) and os.path.getsize(warm_start_json) > 0:
         try:
-            with open(warm_start_json, "r") as f:
-                weights_json = json.load(f)
-            set_model_weights_from_json(model, weights_json)
+            if warm_start_json.endswith(".bin"):
+                load_model_weights(model, warm_start_json)
+            else:
+                with open(warm_start_json, "r") as f:
+                    weights_json = json.load(f)
+                set_model_weights_from_json(model, weights_json)
             print(f"[client2_train.py] Warm start: Loaded model weights from {warm_start_json}")
         except Exception as e:
             print(f"[client2_train.py] WARNING: Could not load warm start weights: {e}")
@@ -141,12 +165,31 @@ def train_model(
     model.fit(X_train, y_train, epochs=epochs, batch_size=batch_size, verbose=2)
 
     model.save(model_h5_path)
-    weights_json = get_model_weights_as_json(model)
-    with open(weights_json_path, "w") as f:
-        json.dump(weights_json, f, indent=2)
+    if client is not None:
+        client.encrypt_and_upload(model.get_weights(), current_round)
+        fl_client.trace_flush()
+        weights_path = "server (in-process upload)"
+    elif weights_format() == "json":
+        weights_path = weights_json_path
+        weights_json = get_model_weights_as_json(model)
+        with open(weights_json_path, "w") as f:
+            json.dump(weights_json, f, indent=2)
+    else:
+        # Binary weights keep layer shapes and are mapped in place by client_agent
+        weights_path = weights_bin_path
+        write_weights(weights_bin_path, model.get_weights())
     with open(scaler_path, "wb") as f:
         pickle.dump(scaler, f)
-    print(f"[client2_train.py] Model and weights saved to {model_h5_path}, {weights_json_path}.\nScaler/column info saved for future rounds.")
+    print(f"[client2_train.py] Model and weights saved to {model_h5_path}, {weights_path}.\nScaler/column info saved for future rounds.")
+
+    # Hand the new weights straight to the resident client agent, if one is running
+    agent_socket = os.environ.get("FL_AGENT_SOCKET_CLIENT2")
+    if agent_socket:
+        from agent_client import agent_request
+        reply = agent_request(agent_socket, "encrypt")
+        print(f"[client2_train.py] Agent encrypt: {reply}")
+        if reply.get("status") != "ok":
+            sys.exit(1)
 
 if __name__ == "__main__":
     if len(sys.argv) < 3:
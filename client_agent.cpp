@@ -0,0 +1,248 @@
+// Single client binary, parameterized by client ID (replaces client1_*/client2_*).
+//
+//   ./client_agent <client_id> keygen [force]
+//   ./client_agent <client_id> rekeygen <to_client_id> [force]
+//   ./client_agent <client_id> jointkey
+//   ./client_agent <client_id> encrypt [round]
+//   ./client_agent <client_id> partial [round]
+//   ./client_agent <client_id> decrypt [round]
+//   ./client_agent <client_id> plan [round]
+//   ./client_agent <client_id> precompute
+//   ./client_agent <client_id> serve [socket_path]
+//
+// keygen/rekeygen reuse keys from the client's keystore (<client_id>_data/keystore.json)
+// when they were made for the current cc.fingerprint; `force` regenerates them.
+// With aggregationMode=threshold (cc_config.txt) rekeygen is not needed: `jointkey` fetches
+// the joint public key after `operations joint_key`, and every client posts its `partial`
+// decryption of the round's aggregate before any client can `decrypt`.
+// With client sampling (clientsPerRound in server_config.txt) `plan` reports whether this
+// client takes part in the round; `encrypt` and `decrypt` skip rounds it is not part of.
+//
+// One-shot commands load cc.bin and the client's keys, run one step and exit.
+// `serve` loads them once and keeps them resident, answering one command per
+// connection on a Unix socket (default <client_id>_data/agent.sock):
+//   request:  "encrypt [round]\n" | "partial [round]\n" | "decrypt [round]\n" | "plan [round]\n" | "precompute\n" | "ping\n" | "shutdown\n"
+//   response: one JSON line, e.g. {"status":"ok","elapsed_ms":...,"startup_saved_ms":...}
+// startup_saved_ms is the context + key load a one-shot process would have paid.
+// `precompute` fills the zero pool (zeroPoolSize in client_config.txt); a serving agent
+// also tops it up one entry at a time whenever no request is waiting.
+
+#include "client_ops.h"
+#include "trace_utils.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <nlohmann/json.hpp>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+// A trainer that connects and stalls, or sends garbage, must not hold the agent
+static constexpr size_t kMaxCommandBytes = 256;
+static constexpr int kReadTimeoutSeconds = 5;
+
+static double MillisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static int RoundArg(const std::string& arg) {
+    return arg.empty() ? ReadRoundCounter() : std::stoi(arg);
+}
+
+// Run one encrypt/partial/decrypt/plan step against the resident context
+static json RunCommand(ClientContext& ctx, const std::string& command, const std::string& arg) {
+    auto start = std::chrono::steady_clock::now();
+    json reply = {{"status", "ok"}, {"command", command}};
+
+    if (command == "encrypt" || command == "partial" || command == "decrypt") {
+        int round = RoundArg(arg);
+        TraceSetId("round-" + std::to_string(round));
+        if (command == "encrypt") EncryptAndUpload(ctx, round);
+        else if (command == "partial") PostPartialDecryption(ctx, round);
+        else DownloadAndDecrypt(ctx, round);
+        reply["round"] = round;
+    } else if (command == "plan") {
+        int round = RoundArg(arg);
+        RoundPlan plan = FetchRoundPlan(ctx, round);
+        reply["round"] = round;
+        reply["selected"] = plan.selected;
+        reply["participants"] = plan.participants;
+        reply["deadline_unix_ms"] = plan.deadline_unix_ms;
+    } else if (command == "precompute") {
+        reply["added"] = PrecomputeZeroPool(ctx);
+        reply["pool_size"] = ctx.zero_pool ? ctx.zero_pool->Size() : 0;
+    } else if (command != "ping") {
+        throw std::runtime_error("Unknown command: " + command);
+    }
+
+    reply["elapsed_ms"] = MillisSince(start);
+    return reply;
+}
+
+// Read one command line (the newline may be left off before the peer closes); false on
+// timeout, an empty disconnect or a line over kMaxCommandBytes
+static bool ReadCommandLine(int conn, std::string& line) {
+    char buf[64];
+    while (true) {
+        ssize_t n = recv(conn, buf, sizeof(buf), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0) return !line.empty();
+        if (n < 0) return false;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] == '\n') return true;
+            line += buf[i];
+        }
+        if (line.size() > kMaxCommandBytes) return false;
+    }
+}
+
+// Write the whole reply; MSG_NOSIGNAL so a trainer that hung up yields EPIPE, not SIGPIPE
+static bool SendAll(int conn, const std::string& out) {
+    size_t sent = 0;
+    while (sent < out.size()) {
+        ssize_t n = send(conn, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+static int Serve(ClientContext& ctx, const std::string& socket_path, double startup_ms) {
+    int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (server_fd < 0) {
+        std::cerr << "[" << ctx.client_id << "_agent] socket() failed: " << strerror(errno) << std::endl;
+        return 1;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[" << ctx.client_id << "_agent] Socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    std::strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(socket_path.c_str());
+
+    if (bind(server_fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(server_fd, 8) < 0) {
+        std::cerr << "[" << ctx.client_id << "_agent] Could not listen on " << socket_path << ": " << strerror(errno) << std::endl;
+        close(server_fd);
+        return 1;
+    }
+    std::cout << "[" << ctx.client_id << "_agent] Serving on " << socket_path
+              << " (context + keys resident, startup " << startup_ms << " ms)" << std::endl;
+
+    bool running = true;
+    while (running) {
+        // Idle: spend the time precomputing encryptions of zero, one per wakeup, so a
+        // request never waits for more than one of them
+        bool pool_hungry = ctx.zero_pool && ctx.zero_pool->Size() < ctx.zero_pool->Capacity();
+        pollfd pfd{server_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, pool_hungry ? 0 : -1);
+        if (ready == 0) {
+            try {
+                ctx.zero_pool->FillOne();
+            } catch (const std::exception& e) {
+                std::cerr << "[" << ctx.client_id << "_agent] Zero pool fill failed: " << e.what() << std::endl;
+                ctx.zero_pool.reset();
+            }
+            continue;
+        }
+
+        int conn = accept(server_fd, nullptr, nullptr);
+        if (conn < 0) continue;
+
+        timeval timeout{kReadTimeoutSeconds, 0};
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string line;
+        if (!ReadCommandLine(conn, line)) {
+            std::cerr << "[" << ctx.client_id << "_agent] Dropped a connection without a command line"
+                      << " (timeout, disconnect or over " << kMaxCommandBytes << " bytes)" << std::endl;
+            close(conn);
+            continue;
+        }
+
+        std::istringstream iss(line);
+        std::string command, arg;
+        iss >> command >> arg;
+
+        json reply;
+        if (command == "shutdown") {
+            reply = {{"status", "ok"}, {"command", command}};
+            running = false;
+        } else {
+            try {
+                reply = RunCommand(ctx, command, arg);
+                reply["startup_saved_ms"] = startup_ms;
+            } catch (const std::exception& e) {
+                std::cerr << "[" << ctx.client_id << "_agent] " << command << " failed: " << e.what() << std::endl;
+                reply = {{"status", "error"}, {"command", command}, {"error", e.what()}};
+            }
+            TraceFlush();
+        }
+
+        std::string out = reply.dump() + "\n";
+        if (!SendAll(conn, out)) {
+            std::cerr << "[" << ctx.client_id << "_agent] Failed to reply: " << strerror(errno) << std::endl;
+        }
+        close(conn);
+    }
+
+    close(server_fd);
+    unlink(socket_path.c_str());
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <client_id> <keygen [force]|rekeygen <to> [force]|jointkey|"
+                  << "encrypt [round]|partial [round]|decrypt [round]|plan [round]|precompute|serve [socket]>\n";
+        return 1;
+    }
+    std::string client_id = argv[1];
+    std::string command = argv[2];
+    std::string arg = argc >= 4 ? argv[3] : "";
+    std::string arg2 = argc >= 5 ? argv[4] : "";
+
+    TraceInit(client_id + "_" + (command == "serve" ? "agent" : command));
+    if (command == "keygen" || command == "rekeygen" || command == "jointkey") TraceSetId("setup");
+
+    try {
+        auto start = std::chrono::steady_clock::now();
+        ClientContext ctx = LoadClientContext(client_id);
+        double startup_ms = MillisSince(start);
+        std::cout << "[" << client_id << "_" << command << "] Startup (context + keys): " << startup_ms << " ms" << std::endl;
+
+        if (command == "keygen") {
+            GenerateClientKeys(ctx, arg == "force");
+        } else if (command == "rekeygen") {
+            if (arg.empty()) {
+                std::cerr << "[" << client_id << "_rekeygen] Missing target client ID\n";
+                return 1;
+            }
+            GenerateReKey(ctx, arg, arg2 == "force");
+        } else if (command == "jointkey") {
+            FetchJointKey(ctx);
+        } else if (command == "serve") {
+            std::string socket_path = arg.empty() ? ctx.data_dir + "/agent.sock" : arg;
+            return Serve(ctx, socket_path, startup_ms);
+        } else {
+            json reply = RunCommand(ctx, command, arg);
+            if (command == "plan") std::cout << reply.dump() << std::endl;
+            std::cout << "[" << client_id << "_" << command << "] Done in " << reply["elapsed_ms"].get<double>() << " ms" << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "[" << client_id << "_" << command << "] Exception: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,963 @@
+#include "client_ops.h"
+
+#include "openfhe.h"
+#include "cryptocontext-ser.h"
+#include "pke/key/key-ser.h"
+#include "pke/ciphertext-ser.h"
+#include "base64_utils.h"
+#include "curl_utils.h"
+#include "serialization_utils.h"
+#include "trace_utils.h"
+#include "config_utils.h"
+#include "parallel_utils.h"
+#include "weights_io.h"
+#include "keystore.h"
+#include "layer_policy.h"
+#include "messages.h"
+#include "aggregation.h"
+#include "cc.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+using namespace lbcrypto;
+using json = nlohmann::json;
+
+// Log/error prefix, e.g. "[client1_encrypt]"
+static std::string Tag(const ClientContext& ctx, const std::string& step) {
+    return "[" + ctx.client_id + "_" + step + "] ";
+}
+
+// (Re)open the zero pool for the key this client currently encrypts under; entries made
+// under another key are discarded as the pool loads
+static void ResetZeroPool(ClientContext& ctx) {
+    ctx.zero_pool.reset();
+    const PublicKey<DCRTPoly>& key = ctx.aggregation_mode == "threshold" ? ctx.joint_public_key : ctx.public_key;
+    if (key && ctx.zero_pool_size > 0) {
+        ctx.zero_pool = std::make_shared<ZeroPool>(ctx.cc, key, ctx.data_dir + "/zero_pool", ctx.zero_pool_size);
+    }
+}
+
+ClientContext LoadClientContext(const std::string& client_id) {
+    ClientContext ctx;
+    ctx.client_id = client_id;
+    ctx.data_dir = client_id + "_data";
+
+    auto config = LoadConfig("client_config.txt");
+    try {
+        SetComputeBudget(LoadComputeBudget(config), client_id);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Tag(ctx, "load") + e.what());
+    }
+    ctx.encrypt_threads = ResolveThreadCount(ConfigLong(config, "encryptThreads", 0));
+    ctx.decrypt_threads = ResolveThreadCount(ConfigLong(config, "decryptThreads", 0));
+    ctx.weights_format = ConfigString(config, "weightsFormat", "binary");
+    ctx.weights_dtype = ConfigString(config, "weightsDtype", "float32");
+    if (ctx.weights_format != "binary" && ctx.weights_format != "json") {
+        throw std::runtime_error(Tag(ctx, "load") + "weightsFormat must be binary or json");
+    }
+    ParseWeightsDType(ctx.weights_dtype);
+    ctx.zero_pool_size = static_cast<size_t>(std::max(0L, ConfigLong(config, "zeroPoolSize", 0)));
+    ctx.partial_wait_seconds = ConfigLong(config, "partialWaitSeconds", 120);
+    ctx.max_part_chunks = static_cast<size_t>(std::max(0L, ConfigLong(config, "maxPartChunks", 64)));
+    try {
+        ctx.layer_policy = LoadLayerPolicy(ConfigString(config, "layerPolicy", ""));
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Tag(ctx, "load") + e.what());
+    }
+
+    std::istringstream eval_keys(ConfigString(config, "evalKeys", ""));
+    for (std::string kind; std::getline(eval_keys, kind, ',');) {
+        if (kind.empty()) continue;
+        if (kind != "mult" && kind != "sum") {
+            throw std::runtime_error(Tag(ctx, "load") + "evalKeys entries must be mult or sum, got " + kind);
+        }
+        ctx.eval_keys.push_back(kind);
+    }
+    ctx.context_fp = ReadContextFingerprint();
+
+    auto cc_config = LoadConfig("cc_config.txt");
+    ctx.aggregation_mode = ConfigString(cc_config, "aggregationMode", "pre");
+    ctx.threshold_lead = ConfigString(cc_config, "thresholdLead", "client1");
+
+    bool warm_up = ConfigLong(config, "warmUpContext", 1) != 0;
+
+    try {
+        ctx.cc = LoadCC("cc.bin");
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Tag(ctx, "load") + e.what());
+    }
+
+    std::string pk_path = ctx.data_dir + "/" + client_id + "_public.key";
+    std::string sk_path = ctx.data_dir + "/" + client_id + "_private.key";
+    {
+        TraceSpan span("key_load");
+        std::ifstream pkFile(pk_path, std::ios::binary);
+        if (pkFile) {
+            Serial::Deserialize(ctx.public_key, pkFile, SerType::BINARY);
+        }
+        std::ifstream skFile(sk_path, std::ios::binary);
+        if (skFile) {
+            Serial::Deserialize(ctx.private_key, skFile, SerType::BINARY);
+        }
+        std::ifstream jointFile(ctx.data_dir + "/joint_public.key", std::ios::binary);
+        if (ctx.aggregation_mode == "threshold" && jointFile) {
+            Serial::Deserialize(ctx.joint_public_key, jointFile, SerType::BINARY);
+        }
+    }
+
+    // Pay for lazy precomputation at load time, not inside the first timed encrypt/decrypt
+    if (warm_up) {
+        WarmUpCC(ctx.cc, ctx.public_key, ctx.private_key);
+    }
+    ResetZeroPool(ctx);
+    return ctx;
+}
+
+const PublicKey<DCRTPoly>& EncryptionKey(const ClientContext& ctx) {
+    if (ctx.aggregation_mode == "threshold") {
+        if (!ctx.joint_public_key) {
+            throw std::runtime_error(Tag(ctx, "encrypt") + "No joint public key; run `client_agent " +
+                                     ctx.client_id + " jointkey` after setup");
+        }
+        return ctx.joint_public_key;
+    }
+    if (!ctx.public_key) {
+        throw std::runtime_error(Tag(ctx, "encrypt") + "Could not open " + ctx.client_id + " public key");
+    }
+    return ctx.public_key;
+}
+
+int ReadRoundCounter() {
+    std::ifstream roundFile("round_counter.txt");
+    if (!roundFile) {
+        throw std::runtime_error("Could not read round_counter.txt");
+    }
+    int roundnum = 0;
+    roundFile >> roundnum;
+    return roundnum;
+}
+
+static std::string ReadTextFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Could not read " + path);
+    }
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+static void WriteTextFile(const std::string& path, const std::string& contents) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    out << contents;
+}
+
+void GenerateClientKeys(ClientContext& ctx, bool force) {
+    // Keys under another job's context would be useless to this job's aggregator
+    auto job = ParseMessage<JobResponse>(HttpGetJson(ServerUrl() + "/s2c/job"));
+    const std::string& job_fp = job.context_fingerprint;
+    if (!job_fp.empty() && !ctx.context_fp.empty() && job_fp != ctx.context_fp) {
+        throw std::runtime_error(Tag(ctx, "keygen") + "Context " + ctx.context_fp + " does not match job " +
+                                 job.job + " (context " + job_fp + ") at " + ServerUrl());
+    }
+
+    std::filesystem::create_directories(ctx.data_dir);
+    KeyStore store(ctx.data_dir);
+
+    std::string pk_file = ctx.client_id + "_public.key";
+    std::string sk_file = ctx.client_id + "_private.key";
+
+    // Threshold mode: shares must all be derived from the lead's public key (its public
+    // randomness), so a share is stale as soon as the lead's key changes
+    bool key_share = ctx.aggregation_mode == "threshold" && ctx.client_id != ctx.threshold_lead;
+    std::string lead_response;
+    std::string_view lead_pk_b64;  // a view into lead_response
+    if (key_share) {
+        lead_response = HttpGetJson(ServerUrl() + "/s2c/public_key?client_id=" + ctx.threshold_lead);
+        try {
+            lead_pk_b64 = ParseMessage<PublicKeyResponse>(lead_response).public_key.view();
+        } catch (const MessageError&) {
+            throw std::runtime_error(Tag(ctx, "keygen") + "Lead " + ctx.threshold_lead + " has not published its key yet");
+        }
+    }
+    std::string lead_fp = key_share ? Fingerprint(lead_pk_b64) : "";
+
+    if (!force && ctx.public_key && ctx.private_key && store.Valid("keypair", ctx.context_fp, lead_fp)) {
+        std::cout << Tag(ctx, "keygen") << "Reusing key pair for context " << ctx.context_fp << std::endl;
+    } else {
+        {
+            TraceSpan span("keygen", key_share ? "{\"kind\":\"share\"}" : "");
+            auto kp = key_share
+                ? ctx.cc->MultipartyKeyGen(DeserializePublicKeyFromBase64(lead_pk_b64), false, true)
+                : ctx.cc->KeyGen();
+            ctx.public_key = kp.publicKey;
+            ctx.private_key = kp.secretKey;
+        }
+
+        // Save keys locally
+        std::ofstream pkOut(store.Path(pk_file), std::ios::binary);
+        if (!pkOut.is_open()) {
+            throw std::runtime_error(Tag(ctx, "keygen") + "Unable to write public key");
+        }
+        Serial::Serialize(ctx.public_key, pkOut, SerType::BINARY);
+        pkOut.close();
+
+        std::ofstream skOut(store.Path(sk_file), std::ios::binary);
+        if (!skOut.is_open()) {
+            throw std::runtime_error(Tag(ctx, "keygen") + "Unable to write private key");
+        }
+        Serial::Serialize(ctx.private_key, skOut, SerType::BINARY);
+        skOut.close();
+
+        store.Record("keypair", ctx.context_fp, {pk_file, sk_file}, lead_fp);
+        std::cout << Tag(ctx, "keygen") << "Generated key pair for context " << ctx.context_fp << std::endl;
+
+        // Precomputed encryptions of zero belong to the old key; so does a joint key
+        ZeroPool::Clear(ctx.data_dir + "/zero_pool");
+        ctx.joint_public_key = nullptr;
+        std::filesystem::remove(ctx.data_dir + "/joint_public.key");
+        ResetZeroPool(ctx);
+    }
+
+    // Serialize keys to Base64 for posting
+    PublicKeyUpload payload;
+    payload.client_id = ctx.client_id;
+    std::string public_key_b64 = SerializePublicKeyToBase64(ctx.public_key);
+    std::string keypair_fp = Fingerprint(public_key_b64);
+    payload.public_key = Blob(std::move(public_key_b64));
+
+    // Eval keys are only generated when requested (evalKeys in client_config.txt):
+    // PRE aggregation never multiplies or rotates ciphertexts
+    for (const std::string& kind : ctx.eval_keys) {
+        std::string file = "eval_" + kind + "_key.b64";
+        if (force || !store.Valid("eval_" + kind, ctx.context_fp, keypair_fp)) {
+            std::string b64;
+            {
+                TraceSpan span("keygen", "{\"kind\":\"" + kind + "\"}");
+                if (kind == "mult") {
+                    ctx.cc->EvalMultKeyGen(ctx.private_key);
+                    b64 = SerializeEvalMultKeyToBase64(ctx.cc);
+                } else {
+                    ctx.cc->EvalSumKeyGen(ctx.private_key);
+                    b64 = SerializeEvalSumKeyToBase64(ctx.cc);
+                }
+            }
+            WriteTextFile(store.Path(file), b64);
+            store.Record("eval_" + kind, ctx.context_fp, {file}, keypair_fp);
+            std::cout << Tag(ctx, "keygen") << "Generated eval " << kind << " key" << std::endl;
+        }
+        (kind == "mult" ? payload.eval_mult_key : payload.eval_sum_key) = Blob(ReadTextFile(store.Path(file)));
+    }
+
+    // The server keeps keys in memory only, so publish on every setup
+    auto response = HttpPostJson(ServerUrl() + "/c2s/public_key", WriteMessage(payload));
+    std::cout << Tag(ctx, "keygen") << "Keys posted, server response: " << response << std::endl;
+}
+
+void FetchJointKey(ClientContext& ctx) {
+    if (ctx.aggregation_mode != "threshold") {
+        throw std::runtime_error(Tag(ctx, "jointkey") + "aggregationMode is not threshold");
+    }
+    std::string response = HttpGetJson(ServerUrl() + "/s2c/public_key?client_id=" + kJointKeyId);
+    PublicKeyResponse key;
+    try {
+        key = ParseMessage<PublicKeyResponse>(response);
+    } catch (const MessageError&) {
+        throw std::runtime_error(Tag(ctx, "jointkey") + "Joint public key not published yet (operations joint_key)");
+    }
+    ctx.joint_public_key = DeserializePublicKeyFromBase64(key.public_key.view());
+
+    std::ofstream out(ctx.data_dir + "/joint_public.key", std::ios::binary);
+    if (!out.is_open()) {
+        throw std::runtime_error(Tag(ctx, "jointkey") + "Unable to write joint public key");
+    }
+    Serial::Serialize(ctx.joint_public_key, out, SerType::BINARY);
+    out.close();
+
+    ResetZeroPool(ctx);
+    std::cout << Tag(ctx, "jointkey") << "Joint public key saved" << std::endl;
+}
+
+void GenerateReKey(const ClientContext& ctx, const std::string& to_client_id, bool force) {
+    if (!ctx.private_key) {
+        throw std::runtime_error(Tag(ctx, "rekeygen") + ctx.client_id + " private key not found");
+    }
+
+    // GET the target client's public key from server
+    std::string response = HttpGetJson(ServerUrl() + "/s2c/public_key?client_id=" + to_client_id);
+    std::string_view to_pk_b64;  // a view into response
+    try {
+        to_pk_b64 = ParseMessage<PublicKeyResponse>(response).public_key.view();
+    } catch (const MessageError&) {
+        throw std::runtime_error(Tag(ctx, "rekeygen") + "Response missing public key for " + to_client_id);
+    }
+
+    // A rekey is stale as soon as either side's key pair changes
+    KeyStore store(ctx.data_dir);
+    std::string kind = "rekey_to_" + to_client_id;
+    std::string file = kind + ".b64";
+    std::string depends_fp = Fingerprint(SerializePublicKeyToBase64(ctx.public_key)) + ":" + Fingerprint(to_pk_b64);
+
+    std::string rekey_b64;
+    if (!force && store.Valid(kind, ctx.context_fp, depends_fp)) {
+        rekey_b64 = ReadTextFile(store.Path(file));
+        std::cout << Tag(ctx, "rekeygen") << "Reusing ReEncryption key to " << to_client_id << ".\n";
+    } else {
+        PublicKey<DCRTPoly> to_pk = DeserializePublicKeyFromBase64(to_pk_b64);
+        std::cout << Tag(ctx, "rekeygen") << "Public key for " << to_client_id << " loaded from server.\n";
+
+        // Generate proxy re-encryption key (from this client to the target)
+        EvalKey<DCRTPoly> rekey;
+        {
+            TraceSpan span("rekeygen");
+            rekey = ctx.cc->ReKeyGen(ctx.private_key, to_pk);
+        }
+        rekey_b64 = SerializeEvalKeyToBase64(rekey);
+        WriteTextFile(store.Path(file), rekey_b64);
+        store.Record(kind, ctx.context_fp, {file}, depends_fp);
+        std::cout << Tag(ctx, "rekeygen") << "ReEncryption Key generated.\n";
+    }
+
+    RekeyUpload postPayload;
+    postPayload.from_client_id = ctx.client_id;
+    postPayload.to_client_id   = to_client_id;
+    postPayload.rekey          = Blob(std::move(rekey_b64));
+
+    auto post_resp = HttpPostJson(ServerUrl() + "/c2s/rekey", WriteMessage(postPayload));
+    std::cout << Tag(ctx, "rekeygen") << "Server Response: " << post_resp << std::endl;
+}
+
+std::vector<Ciphertext<DCRTPoly>> EncryptLayers(const CryptoContext<DCRTPoly>& cc,
+                                                const PublicKey<DCRTPoly>& public_key,
+                                                const std::vector<WeightsLayerView>& layers,
+                                                size_t threads,
+                                                std::vector<size_t>& chunk_counts,
+                                                ZeroPool* zero_pool) {
+    // Maximum number of slots per ciphertext for CKKS = ringDim/2
+    const size_t max_chunk_size = cc->GetRingDimension() / 2;
+
+    // Lay out every chunk up front so each worker writes a fixed output slot
+    struct Chunk {
+        const WeightsLayerView* layer;
+        size_t start;
+        size_t len;
+    };
+    std::vector<Chunk> chunks;
+    chunk_counts.clear();
+    for (const auto& layer : layers) {
+        size_t chunks_for_array = 0;
+        for (size_t start = 0; start < layer.size; start += max_chunk_size) {
+            chunks.push_back({&layer, start, std::min(max_chunk_size, layer.size - start)});
+            chunks_for_array++;
+        }
+        chunk_counts.push_back(chunks_for_array);
+    }
+
+    std::vector<Ciphertext<DCRTPoly>> ciphertexts(chunks.size());
+    ParallelFor(chunks.size(), threads, [&](size_t i) {
+        const Chunk& c = chunks[i];
+        std::vector<double> values(c.len);
+        for (size_t k = 0; k < c.len; ++k) {
+            values[k] = c.layer->At(c.start + k);
+        }
+
+        std::string chunk_args = "{\"chunk\":" + std::to_string(i) + "}";
+        Plaintext pt;
+        {
+            TraceSpan span("encode", chunk_args);
+            pt = cc->MakeCKKSPackedPlaintext(values);
+        }
+        // Online phase: a precomputed Enc(0) plus the plaintext is a fresh encryption of it
+        Ciphertext<DCRTPoly> zero = zero_pool ? zero_pool->Take() : nullptr;
+        TraceSpan span(zero ? "encrypt_pooled" : "encrypt", chunk_args);
+        ciphertexts[i] = zero ? cc->EvalAdd(zero, pt) : cc->Encrypt(public_key, pt);
+    });
+    return ciphertexts;
+}
+
+size_t PrecomputeZeroPool(const ClientContext& ctx) {
+    if (!ctx.zero_pool) {
+        std::cout << Tag(ctx, "precompute") << "Zero pool disabled (zeroPoolSize=0 or no encryption key)" << std::endl;
+        return 0;
+    }
+    size_t added = ctx.zero_pool->Fill(ctx.encrypt_threads);
+    std::cout << Tag(ctx, "precompute") << "Zero pool: +" << added << " -> "
+              << ctx.zero_pool->Size() << "/" << ctx.zero_pool->Capacity() << std::endl;
+    return added;
+}
+
+// Lay out the chunks of each layer (as EncryptLayers made them) and decode chunk i, once
+// decrypt_chunk(i, &pt) has produced its plaintext, into presized per-layer buffers
+static std::vector<std::vector<double>> DecodeLayers(const CryptoContext<DCRTPoly>& cc,
+                                                     const std::vector<size_t>& chunk_counts,
+                                                     const std::vector<size_t>& orig_sizes,
+                                                     double scale,
+                                                     size_t threads,
+                                                     const std::function<void(size_t, Plaintext*)>& decrypt_chunk) {
+    // Chunks hold ringDim/2 values each except possibly the last one of a layer
+    const size_t max_chunk_size = cc->GetRingDimension() / 2;
+
+    struct Chunk {
+        size_t layer;
+        size_t start;
+    };
+    std::vector<Chunk> chunks;
+    std::vector<std::vector<double>> layers(chunk_counts.size());
+    for (size_t layer_idx = 0; layer_idx < chunk_counts.size(); ++layer_idx) {
+        // Layers without chunks were sent in plaintext; the caller fills them in
+        if (chunk_counts[layer_idx] > 0 && orig_sizes[layer_idx] > chunk_counts[layer_idx] * max_chunk_size) {
+            throw std::runtime_error("Layer " + std::to_string(layer_idx) + " has " + std::to_string(orig_sizes[layer_idx]) +
+                                     " values but only " + std::to_string(chunk_counts[layer_idx]) + " chunks");
+        }
+        layers[layer_idx].resize(orig_sizes[layer_idx]);
+        for (size_t i = 0; i < chunk_counts[layer_idx]; ++i) {
+            chunks.push_back({layer_idx, i * max_chunk_size});
+        }
+    }
+
+    ParallelFor(chunks.size(), threads, [&](size_t i) {
+        const Chunk& c = chunks[i];
+        std::vector<double>& layer = layers[c.layer];
+        if (c.start >= layer.size()) return;  // chunk is all padding
+        size_t len = std::min(max_chunk_size, layer.size() - c.start);
+
+        Plaintext pt;
+        decrypt_chunk(i, &pt);
+
+        TraceSpan span("decode", "{\"chunk\":" + std::to_string(i) + "}");
+        pt->SetLength(len);
+        const auto& vals = pt->GetCKKSPackedValue();
+        for (size_t k = 0; k < len; ++k) {
+            layer[c.start + k] = vals[k].real() * scale;
+        }
+    });
+    return layers;
+}
+
+std::vector<std::vector<double>> DecryptLayers(const CryptoContext<DCRTPoly>& cc,
+                                               const PrivateKey<DCRTPoly>& private_key,
+                                               const std::vector<Ciphertext<DCRTPoly>>& ciphertexts,
+                                               const std::vector<size_t>& chunk_counts,
+                                               const std::vector<size_t>& orig_sizes,
+                                               size_t threads) {
+    return DecodeLayers(cc, chunk_counts, orig_sizes, 1.0, threads, [&](size_t i, Plaintext* pt) {
+        TraceSpan span("decrypt", "{\"chunk\":" + std::to_string(i) + "}");
+        auto decrypt_result = cc->Decrypt(private_key, ciphertexts[i], pt);
+        if (!decrypt_result.isValid) {
+            throw std::runtime_error("Decryption failed for ciphertext index " + std::to_string(i));
+        }
+    });
+}
+
+std::vector<std::vector<double>> FuseLayers(const CryptoContext<DCRTPoly>& cc,
+                                            const std::vector<std::vector<Ciphertext<DCRTPoly>>>& partials,
+                                            const std::vector<size_t>& chunk_counts,
+                                            const std::vector<size_t>& orig_sizes,
+                                            double scale,
+                                            size_t threads) {
+    return DecodeLayers(cc, chunk_counts, orig_sizes, scale, threads, [&](size_t i, Plaintext* pt) {
+        std::vector<Ciphertext<DCRTPoly>> shares;
+        shares.reserve(partials.size());
+        for (const auto& client_partials : partials) shares.push_back(client_partials[i]);
+
+        TraceSpan span("decrypt_fuse", "{\"chunk\":" + std::to_string(i) + "}");
+        auto decrypt_result = cc->MultipartyDecryptFusion(shares, pt);
+        if (!decrypt_result.isValid) {
+            throw std::runtime_error("Fusing partial decryptions failed for ciphertext index " + std::to_string(i));
+        }
+    });
+}
+
+// Legacy wc.json input: nested arrays per layer, flattened into owned buffers
+static std::vector<std::vector<double>> ReadJsonWeights(const ClientContext& ctx) {
+    // Load full LSTM weights JSON (list of arrays)
+    std::ifstream infile(ctx.data_dir + "/wc.json");
+    if (!infile) {
+        throw std::runtime_error(Tag(ctx, "encrypt") + "Could not open wc.json");
+    }
+    json weights_json;
+    {
+        TraceSpan span("json_parse");
+        infile >> weights_json;
+    }
+    infile.close();
+
+    // Lambda: recursively flatten nested JSON arrays of doubles into flat vector
+    std::function<void(const json&, std::vector<double>&)> flatten_json = [&](const json& j, std::vector<double>& out_vec) {
+        if (j.is_array()) {
+            for (const auto& el : j) {
+                flatten_json(el, out_vec);
+            }
+        } else if (j.is_number_float() || j.is_number_integer()) {
+            out_vec.push_back(j.get<double>());
+        } else {
+            throw std::runtime_error(Tag(ctx, "encrypt") + "Non-numeric element inside weights JSON.");
+        }
+    };
+
+    std::vector<std::vector<double>> layers;
+    for (const auto& weight_array : weights_json) {
+        std::vector<double> flat_weights;
+        flatten_json(weight_array, flat_weights);
+        layers.push_back(std::move(flat_weights));
+    }
+    return layers;
+}
+
+void EncryptAndUpload(const ClientContext& ctx, int round) {
+    EncryptionKey(ctx);  // fail before mapping the weights
+
+    // Binary weights (wc.bin) are mapped and encrypted in place; JSON is parsed and flattened
+    std::unique_ptr<MappedWeightsFile> mapped;
+    std::vector<std::vector<double>> json_layers;
+    std::vector<WeightsLayerView> layers;
+    if (ctx.weights_format == "json") {
+        json_layers = ReadJsonWeights(ctx);
+        layers = ViewLayers(json_layers);
+    } else {
+        TraceSpan span("weights_map");
+        mapped = std::make_unique<MappedWeightsFile>(ctx.data_dir + "/wc.bin");
+        layers = mapped->Layers();
+    }
+
+    UploadLayers(ctx, round, layers);
+}
+
+RoundPlan FetchRoundPlan(const ClientContext& ctx, int round) {
+    auto response = ParseMessage<RoundPlanResponse>(HttpGetJson(
+        ServerUrl() + "/s2c/round_plan?round=" + std::to_string(round) + "&client_id=" + ctx.client_id));
+    if (!response.selected) {
+        throw std::runtime_error(Tag(ctx, "plan") + "round plan without a selection for " + ctx.client_id);
+    }
+    RoundPlan plan;
+    plan.sampling = response.sampling;
+    plan.selected = *response.selected;
+    plan.participants = std::move(response.participants);
+    const std::vector<std::string>& uploaded = response.uploaded;
+    plan.uploaded = std::find(uploaded.begin(), uploaded.end(), ctx.client_id) != uploaded.end();
+    plan.deadline_unix_ms = response.deadline_unix_ms;
+    plan.now_unix_ms = response.now_unix_ms;
+    return plan;
+}
+
+// Views of chunks [first, first + count) of `layers`, numbered the way EncryptLayers lays
+// them out; cut at chunk boundaries, so encrypting the views yields exactly those chunks
+static std::vector<WeightsLayerView> SliceChunks(const std::vector<WeightsLayerView>& layers, size_t slots,
+                                                 size_t first, size_t count) {
+    std::vector<WeightsLayerView> slices;
+    size_t layer_first = 0;  // number of the layer's first chunk
+    for (const auto& layer : layers) {
+        size_t layer_chunks = (layer.size + slots - 1) / slots;
+        size_t begin = std::max(first, layer_first);
+        size_t end = std::min(first + count, layer_first + layer_chunks);
+        if (begin < end) {
+            size_t offset = (begin - layer_first) * slots;
+            size_t elem = layer.dtype == WeightsDType::Float64 ? sizeof(double) : sizeof(float);
+            WeightsLayerView slice = layer;
+            slice.data = static_cast<const char*>(layer.data) + offset * elem;
+            slice.size = std::min(layer.size, (end - layer_first) * slots) - offset;
+            slices.push_back(std::move(slice));
+        }
+        layer_first += layer_chunks;
+    }
+    return slices;
+}
+
+// True when `response` is a {"status": ...} reply with this status
+static bool HasStatus(const std::string& response, std::string_view status) {
+    try {
+        return ParseMessage<StatusResponse>(response).status == status;
+    } catch (const MessageError&) {
+        return false;
+    }
+}
+
+bool UploadLayers(const ClientContext& ctx, int round, const std::vector<WeightsLayerView>& layers) {
+    const PublicKey<DCRTPoly>& key = EncryptionKey(ctx);
+
+    // Sampled rounds: skip the encryption the server would refuse anyway
+    RoundPlan plan = FetchRoundPlan(ctx, round);
+    if (!plan.selected) {
+        std::cout << Tag(ctx, "encrypt") << "Not selected for round " << round << " ("
+                  << plan.participants.size() << " participants); skipping upload" << std::endl;
+        return false;
+    }
+    if (plan.deadline_unix_ms > 0 && plan.now_unix_ms > plan.deadline_unix_ms) {
+        std::cout << Tag(ctx, "encrypt") << "Missed the upload deadline of round " << round
+                  << " by " << plan.now_unix_ms - plan.deadline_unix_ms << " ms; skipping upload" << std::endl;
+        return false;
+    }
+
+    std::cout << Tag(ctx, "encrypt") << "Ring dimension: " << ctx.cc->GetRingDimension()
+              << ", encrypt threads: " << ctx.encrypt_threads << std::endl;
+
+    std::vector<size_t> origSizes;     // The original flattened length per array
+    for (const auto& layer : layers) {
+        origSizes.push_back(layer.size);
+    }
+
+    // Layers the layer policy leaves in plaintext skip encryption and go out as raw float64
+    PlainLayers plain;
+    std::vector<WeightsLayerView> encrypted = SplitLayers(ctx.layer_policy, layers, plain);
+
+    // EncryptLayers makes ceil(size / slots) chunks per layer
+    const size_t slots = ctx.cc->GetRingDimension() / 2;
+    std::vector<size_t> chunkCounts;   // Number of chunks per weight array (0 for plaintext layers)
+    size_t total_chunks = 0;
+    for (size_t i = 0, next = 0; i < layers.size(); ++i) {
+        chunkCounts.push_back(plain.count(i) ? 0 : (encrypted[next++].size + slots - 1) / slots);
+        total_chunks += chunkCounts.back();
+    }
+
+    // Models over maxPartChunks chunks go up in parts, each encrypted, serialized and
+    // posted before the next, keeping every request under the server's size cap and
+    // only one part's ciphertexts in memory; the last part carries the layout
+    const size_t per_part = ctx.max_part_chunks == 0 ? std::max<size_t>(total_chunks, 1) : ctx.max_part_chunks;
+    const size_t parts = std::max<size_t>(1, (total_chunks + per_part - 1) / per_part);
+    size_t upload_bytes = 0;
+    std::string response;
+    for (size_t part = 0; part < parts; ++part) {
+        std::vector<size_t> partCounts;
+        std::vector<Ciphertext<DCRTPoly>> ciphertexts =
+            EncryptLayers(ctx.cc, key, SliceChunks(encrypted, slots, part * per_part, per_part),
+                          ctx.encrypt_threads, partCounts, ctx.zero_pool.get());
+
+        // Payload with explicit "metadata" and "data" keys
+        ParamsUpload payload;
+        payload.metadata.client_id = ctx.client_id;
+        payload.metadata.round = round;
+        payload.metadata.model_name = "LSTM";
+        payload.metadata.trace_id = TraceId();
+        payload.data.params = Blob(SerializeCiphertextVectorToBase64(ciphertexts));
+        ciphertexts.clear();
+        if (parts > 1) {
+            payload.metadata.part = part;
+            payload.metadata.parts = parts;
+        }
+        if (part + 1 == parts) {
+            payload.data.chunk_counts = chunkCounts;
+            payload.data.orig_sizes = origSizes;
+            if (!plain.empty()) {
+                payload.data.plain_layers = EncodePlainLayers(plain);
+            }
+        }
+
+        // POST encrypted weights to server
+        std::string payload_str = WriteMessage(payload);
+        payload = ParamsUpload();
+        upload_bytes += payload_str.size();
+        long status = 0;
+        response = HttpPostJson(ServerUrl() + "/c2s/params", payload_str, status);
+
+        // The round's plan can still refuse the upload (not selected, deadline passed since
+        // the plan was fetched); anything else that was not stored is an error. A lost part
+        // would only show once the last one is refused, so every part is checked
+        if (status == 403 || status == 409) {
+            std::cout << Tag(ctx, "encrypt") << "Upload refused for round " << round << ": " << response << std::endl;
+            return false;
+        }
+        const bool last = part + 1 == parts;
+        if (!HasStatus(response, last ? "params stored" : "params part stored")) {
+            throw std::runtime_error(Tag(ctx, "encrypt") + "part " + std::to_string(part) + " of " +
+                                     std::to_string(parts) + " refused (HTTP " + std::to_string(status) + "): " + response);
+        }
+    }
+
+    // Log communication upload size (payload size in bytes, all parts) to CSV (no headers)
+    std::ofstream logFile(ctx.data_dir + "/comm_logs.csv", std::ios_base::app);
+    logFile << round << "," << ctx.client_id << ",upload," << upload_bytes << "\n";
+    logFile.close();
+
+    std::cout << Tag(ctx, "encrypt") << "POST response" << (parts > 1 ? " (" + std::to_string(parts) + " parts)" : "")
+              << ": " << response << std::endl;
+    return true;
+}
+
+// Shapes of this client's own wc.bin when they fit the decrypted layers (same model),
+// so the aggregate keeps the model's layer shapes; otherwise empty (flat layers)
+static std::vector<std::vector<size_t>> LocalLayerShapes(const ClientContext& ctx,
+                                                         const std::vector<std::vector<double>>& layers) {
+    std::vector<std::vector<size_t>> shapes;
+    try {
+        MappedWeightsFile local(ctx.data_dir + "/wc.bin");
+        if (local.Layers().size() != layers.size()) return {};
+        for (size_t i = 0; i < layers.size(); ++i) {
+            if (local.Layers()[i].size != layers[i].size()) return {};
+            shapes.push_back(local.Layers()[i].shape);
+        }
+    } catch (const std::exception&) {
+        return {};
+    }
+    return shapes;
+}
+
+// Put an aggregate's averaged plaintext layers into the layers that came without chunks
+static void MergePlainLayers(const ClientContext& ctx, std::vector<std::vector<double>>& layers,
+                             const std::vector<size_t>& chunk_counts, PlainLayers plain) {
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (chunk_counts[i] > 0 || layers[i].empty()) continue;
+        auto it = plain.find(i);
+        if (it == plain.end() || it->second.size() != layers[i].size()) {
+            throw std::runtime_error(Tag(ctx, "decrypt") + "plaintext layer " + std::to_string(i) +
+                                     " missing or of the wrong size in the aggregate");
+        }
+        layers[i] = std::move(it->second);
+    }
+}
+
+// Fetch this round's aggregated ciphertexts for this client, with their chunk layout and
+// the averaged plaintext layers
+static std::vector<Ciphertext<DCRTPoly>> FetchAggregate(const ClientContext& ctx, int round,
+                                                        std::vector<size_t>& chunk_counts,
+                                                        std::vector<size_t>& orig_sizes,
+                                                        PlainLayers* plain_layers = nullptr) {
+    // Fetch aggregated encrypted params from server
+    std::string url = ServerUrl() + "/s2c/agg_params?client_id=" + ctx.client_id + "&round=" + std::to_string(round);
+    std::string response = HttpGetJson(url);
+    size_t download_bytes = response.size();
+
+    // The ciphertexts stay a view into the response until they are decoded
+    AggregateDownload resp_msg;
+    {
+        TraceSpan span("json_parse");
+        try {
+            resp_msg = ParseMessage<AggregateDownload>(response);
+        } catch (const MessageError& e) {
+            throw std::runtime_error(Tag(ctx, "decrypt") + "malformed server response: " + e.what());
+        }
+    }
+    AggregateData& data = resp_msg.data;
+
+    if (!data.chunk_counts) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + "chunk_counts missing in data");
+    }
+    if (!data.orig_sizes) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + "orig_sizes missing in data");
+    }
+
+    chunk_counts = std::move(*data.chunk_counts);
+    orig_sizes = std::move(*data.orig_sizes);
+    if (plain_layers && data.plain_layers) {
+        *plain_layers = DecodePlainLayers(*data.plain_layers);
+    }
+
+    // A multipart aggregate continues in parts 1.., fetched and decoded one at a time
+    const size_t parts = data.parts.value_or(1);
+
+    // Decode and deserialize vector of ciphertexts (chunks)
+    std::vector<Ciphertext<DCRTPoly>> ciphertexts = DeserializeCiphertextVectorFromBase64(data.agg_params.view());
+    resp_msg = AggregateDownload();
+    response.clear();
+    response.shrink_to_fit();
+
+    for (size_t part = 1; part < parts; ++part) {
+        std::string part_response = HttpGetJson(url + "&part=" + std::to_string(part));
+        download_bytes += part_response.size();
+        AggregateDownload part_msg;
+        try {
+            part_msg = ParseMessage<AggregateDownload>(part_response);
+        } catch (const MessageError& e) {
+            throw std::runtime_error(Tag(ctx, "decrypt") + "part " + std::to_string(part) + " of " +
+                                     std::to_string(parts) + " missing in server response: " + e.what());
+        }
+        for (auto& ct : DeserializeCiphertextVectorFromBase64(part_msg.data.agg_params.view())) {
+            ciphertexts.push_back(std::move(ct));
+        }
+    }
+
+    // Log communication download size (response size in bytes, all parts) to CSV (no headers)
+    std::ofstream logFile(ctx.data_dir + "/comm_logs.csv", std::ios_base::app);
+    logFile << round << "," << ctx.client_id << ",download," << download_bytes << "\n";
+    logFile.close();
+
+    // Sanity check: total ciphertexts should equal sum of chunk_counts
+    size_t total_chunks = 0;
+    for (size_t cnt : chunk_counts) total_chunks += cnt;
+
+    if (total_chunks != ciphertexts.size()) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + "mismatch between chunk_counts sum (" + std::to_string(total_chunks) +
+                                 ") and ciphertexts size (" + std::to_string(ciphertexts.size()) + ")");
+    }
+    if (chunk_counts.size() != orig_sizes.size()) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + "chunk_counts and orig_sizes size mismatch");
+    }
+    return ciphertexts;
+}
+
+void PostPartialDecryption(const ClientContext& ctx, int round) {
+    if (!ctx.private_key) {
+        throw std::runtime_error(Tag(ctx, "partial") + "could not open " + ctx.client_id + "_private.key");
+    }
+    std::vector<size_t> chunk_counts, orig_sizes;
+    std::vector<Ciphertext<DCRTPoly>> aggregate = FetchAggregate(ctx, round, chunk_counts, orig_sizes);
+
+    // The lead's share carries the ciphertext's c0 term; every other share only its own key part
+    const bool lead = ctx.client_id == ctx.threshold_lead;
+    std::vector<Ciphertext<DCRTPoly>> partial(aggregate.size());
+    ParallelFor(aggregate.size(), ctx.decrypt_threads, [&](size_t i) {
+        TraceSpan span("decrypt_partial", "{\"chunk\":" + std::to_string(i) + "}");
+        partial[i] = lead ? ctx.cc->MultipartyDecryptLead({aggregate[i]}, ctx.private_key)[0]
+                          : ctx.cc->MultipartyDecryptMain({aggregate[i]}, ctx.private_key)[0];
+    });
+
+    PartialDecryptionUpload payload;
+    payload.client_id = ctx.client_id;
+    payload.round = round;
+    payload.partial = Blob(SerializeCiphertextVectorToBase64(partial));
+    std::string payload_str = WriteMessage(payload);
+    std::ofstream logFile(ctx.data_dir + "/comm_logs.csv", std::ios_base::app);
+    logFile << round << "," << ctx.client_id << ",partial_upload," << payload_str.size() << "\n";
+    logFile.close();
+
+    std::string response = HttpPostJson(ServerUrl() + "/c2s/partial_dec", payload_str);
+    std::cout << Tag(ctx, "partial") << "POST response: " << response << std::endl;
+}
+
+// Threshold mode: wait until every joint key holder has posted its partial decryption, then
+// fuse them and divide the sum by the number of clients that uploaded
+static std::vector<std::vector<double>> DownloadAndFuse(const ClientContext& ctx, int round) {
+    const std::string url = ServerUrl() + "/s2c/partial_dec?client_id=" + ctx.client_id + "&round=" + std::to_string(round);
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(ctx.partial_wait_seconds);
+
+    // The partials stay views into the response until they are decoded
+    std::string response;
+    PartialDecryptionsResponse resp_msg;
+    bool posted = false;
+    while (true) {
+        response = HttpGetJson(url);
+        {
+            TraceSpan span("json_parse");
+            try {
+                resp_msg = ParseMessage<PartialDecryptionsResponse>(response);
+            } catch (const MessageError& e) {
+                throw std::runtime_error(Tag(ctx, "decrypt") + "malformed server response: " + e.what());
+            }
+        }
+        const std::vector<std::string>& received = resp_msg.metadata.received;
+        if (!posted && std::find(received.begin(), received.end(), ctx.client_id) == received.end()) {
+            PostPartialDecryption(ctx, round);
+            posted = true;
+            continue;
+        }
+        if (resp_msg.data) {
+            std::ofstream logFile(ctx.data_dir + "/comm_logs.csv", std::ios_base::app);
+            logFile << round << "," << ctx.client_id << ",download," << response.size() << "\n";
+            break;
+        }
+        if (std::chrono::steady_clock::now() > deadline) {
+            throw std::runtime_error(Tag(ctx, "decrypt") + "timed out waiting for partial decryptions (" +
+                                     std::to_string(received.size()) + " of " +
+                                     std::to_string(resp_msg.metadata.expected.size()) + ")");
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+    }
+
+    PartialDecryptionsData& data = *resp_msg.data;
+    const std::vector<size_t>& chunk_counts = data.chunk_counts;
+    const std::vector<size_t>& orig_sizes = data.orig_sizes;
+    std::vector<std::string> client_ids;
+    for (const auto& [client_id, partial] : data.partials) client_ids.push_back(client_id);
+    const size_t uploaded = data.clients.size();
+    if (uploaded == 0) throw std::runtime_error(Tag(ctx, "decrypt") + "no client uploaded round " + std::to_string(round));
+
+    std::vector<std::vector<Ciphertext<DCRTPoly>>> partials(client_ids.size());
+    ParallelFor(client_ids.size(), ctx.decrypt_threads, [&](size_t i) {
+        partials[i] = DeserializeCiphertextVectorFromBase64(data.partials.at(client_ids[i]).view());
+    });
+
+    size_t total_chunks = 0;
+    for (size_t cnt : chunk_counts) total_chunks += cnt;
+    for (size_t i = 0; i < partials.size(); ++i) {
+        if (partials[i].size() != total_chunks) {
+            throw std::runtime_error(Tag(ctx, "decrypt") + "partial decryption of " + client_ids[i] + " has " +
+                                     std::to_string(partials[i].size()) + " chunks, expected " + std::to_string(total_chunks));
+        }
+    }
+
+    std::vector<std::vector<double>> layers;
+    try {
+        layers = FuseLayers(ctx.cc, partials, chunk_counts, orig_sizes, 1.0 / static_cast<double>(uploaded),
+                            ctx.decrypt_threads);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + e.what());
+    }
+    MergePlainLayers(ctx, layers, chunk_counts, DecodePlainLayers(data.plain_layers.value_or(json::object())));
+    return layers;
+}
+
+std::vector<std::vector<double>> DownloadLayers(const ClientContext& ctx, int round) {
+    if (!ctx.private_key) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + "could not open " + ctx.client_id + "_private.key");
+    }
+    if (ctx.aggregation_mode == "threshold") {
+        return DownloadAndFuse(ctx, round);
+    }
+
+    std::vector<size_t> chunk_counts, orig_sizes;
+    PlainLayers plain;
+    std::vector<Ciphertext<DCRTPoly>> ciphertexts = FetchAggregate(ctx, round, chunk_counts, orig_sizes, &plain);
+
+    // Decrypt every chunk in parallel directly into its layer's buffer
+    std::vector<std::vector<double>> layers;
+    try {
+        layers = DecryptLayers(ctx.cc, ctx.private_key, ciphertexts, chunk_counts, orig_sizes, ctx.decrypt_threads);
+    } catch (const std::exception& e) {
+        throw std::runtime_error(Tag(ctx, "decrypt") + e.what());
+    }
+    MergePlainLayers(ctx, layers, chunk_counts, std::move(plain));
+    return layers;
+}
+
+int LatestModelVersion(const ClientContext& ctx) {
+    return ParseMessage<ModelVersionResponse>(
+        HttpGetJson(ServerUrl() + "/s2c/model_version?client_id=" + ctx.client_id)).version;
+}
+
+std::optional<std::vector<std::vector<double>>> DownloadLayersIfParticipant(const ClientContext& ctx, int round) {
+    // Only the clients whose params went into a sampled round get its aggregate
+    RoundPlan plan = FetchRoundPlan(ctx, round);
+    if (plan.sampling && !plan.uploaded) {
+        std::cout << Tag(ctx, "decrypt") << "Did not take part in round " << round << std::endl;
+        return std::nullopt;
+    }
+    return DownloadLayers(ctx, round);
+}
+
+void DownloadAndDecrypt(const ClientContext& ctx, int round) {
+    std::optional<std::vector<std::vector<double>>> downloaded = DownloadLayersIfParticipant(ctx, round);
+    if (!downloaded) {
+        std::cout << Tag(ctx, "decrypt") << "Keeping the previous aggregate" << std::endl;
+        return;
+    }
+    std::vector<std::vector<double>> layers = std::move(*downloaded);
+
+    // Save decrypted aggregated weights for warm start
+    std::string out_name = ctx.weights_format == "json" ? "agg_wc.json" : "agg_wc.bin";
+    std::string out_path = ctx.data_dir + "/" + out_name;
+    TraceSpan span("write_output");
+    if (ctx.weights_format == "json") {
+        std::ofstream outFile(out_path);
+        if (!outFile) {
+            throw std::runtime_error(Tag(ctx, "decrypt") + "could not write " + out_name);
+        }
+        outFile << json(layers).dump(4);
+    } else {
+        WriteWeightsFile(out_path, layers, LocalLayerShapes(ctx, layers), ParseWeightsDType(ctx.weights_dtype));
+    }
+
+    std::cout << Tag(ctx, "decrypt") << "Saved decrypted aggregated weights to " << out_name << std::endl;
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include "openfhe.h"
+#include "layer_policy.h"
+#include "weights_io.h"
+#include "zero_pool.h"
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Client-side pipeline steps shared by every client (previously copy-pasted per client
+// in client1_*/client2_*). All file paths derive from the client ID: keys and weights
+// live in "<client_id>_data/". Every step throws std::runtime_error on failure.
+
+struct ClientContext {
+    std::string client_id;   // e.g. "client1"
+    std::string data_dir;    // e.g. "client1_data"
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc;
+    lbcrypto::PublicKey<lbcrypto::DCRTPoly> public_key;    // null until keygen has run
+    lbcrypto::PrivateKey<lbcrypto::DCRTPoly> private_key;  // null until keygen has run
+    size_t encrypt_threads = 1;  // workers for chunk encryption (client_config.txt)
+    size_t decrypt_threads = 1;  // workers for chunk decryption (client_config.txt)
+    std::string weights_format = "binary";  // weight exchange: "binary" (wc.bin/agg_wc.bin) or "json" (wc.json/agg_wc.json)
+    std::string weights_dtype = "float32";  // element type of binary weights files written here
+    std::shared_ptr<ZeroPool> zero_pool;    // precomputed Enc(0) under the encryption key; null when disabled
+    size_t zero_pool_size = 0;              // zeroPoolSize (client_config.txt)
+    std::string context_fp;                 // cc.fingerprint, recorded with every key in the keystore
+    std::vector<std::string> eval_keys;     // eval key kinds to generate on keygen ("mult", "sum")
+    std::string aggregation_mode = "pre";   // aggregationMode (cc_config.txt): "pre" or "threshold"
+    std::string threshold_lead;             // threshold mode: client holding the first key share
+    lbcrypto::PublicKey<lbcrypto::DCRTPoly> joint_public_key;  // threshold mode: null until jointkey has run
+    long partial_wait_seconds = 120;        // threshold mode: how long decrypt waits for other clients' partials
+    LayerPolicy layer_policy;               // layerPolicy (client_config.txt): which layers are encrypted
+    size_t max_part_chunks = 64;            // maxPartChunks (client_config.txt): ciphertexts per upload request (0 = one request)
+};
+
+// Deserialize cc.bin and, when they exist, this client's key pair; read client_config.txt
+ClientContext LoadClientContext(const std::string& client_id);
+
+// Key this client encrypts under: its own public key (pre) or the joint key (threshold)
+const lbcrypto::PublicKey<lbcrypto::DCRTPoly>& EncryptionKey(const ClientContext& ctx);
+
+// Encode + encrypt layer views (read in place, no copy of the layer) in chunks of ringDim/2 slots on `threads` workers.
+// Ciphertexts come back in deterministic order (layer by layer, chunk by chunk);
+// chunk_counts receives the number of chunks per layer. With a zero pool, chunks are
+// encrypted as Enc(0) + plaintext while entries last, then fall back to fresh encryption.
+std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>> EncryptLayers(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+    const lbcrypto::PublicKey<lbcrypto::DCRTPoly>& public_key,
+    const std::vector<WeightsLayerView>& layers,
+    size_t threads,
+    std::vector<size_t>& chunk_counts,
+    ZeroPool* zero_pool = nullptr);
+
+// Decrypt chunks (as laid out by EncryptLayers) on `threads` workers straight into
+// per-layer buffers of orig_sizes[i] values; padding in the last chunk is dropped.
+std::vector<std::vector<double>> DecryptLayers(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+    const lbcrypto::PrivateKey<lbcrypto::DCRTPoly>& private_key,
+    const std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>>& ciphertexts,
+    const std::vector<size_t>& chunk_counts,
+    const std::vector<size_t>& orig_sizes,
+    size_t threads);
+
+// Threshold mode: fuse every client's partial decryptions of a summed aggregate (one chunk
+// vector per client, laid out by EncryptLayers) into per-layer buffers, times `scale`
+std::vector<std::vector<double>> FuseLayers(
+    const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc,
+    const std::vector<std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>>>& partials,
+    const std::vector<size_t>& chunk_counts,
+    const std::vector<size_t>& orig_sizes,
+    double scale,
+    size_t threads);
+
+// Top up the zero pool to its configured size (offline phase); returns entries added
+size_t PrecomputeZeroPool(const ClientContext& ctx);
+
+// Current federated round from round_counter.txt
+int ReadRoundCounter();
+
+// Publish this client's public key (+ requested eval keys). Keys recorded in the keystore
+// for the current context are reused; missing or stale ones (or all, with force) are
+// generated and saved first. In threshold mode every client but the lead derives its key
+// share from the lead's published public key. Throws if the server's job (FL_SERVER_URL)
+// runs under a different context.
+void GenerateClientKeys(ClientContext& ctx, bool force = false);
+
+// Threshold mode: fetch the joint public key (published by `operations joint_key`) and
+// save it as <data_dir>/joint_public.key for encryption
+void FetchJointKey(ClientContext& ctx);
+
+// Publish the proxy re-encryption key from this client to `to_client_id`, reusing the
+// stored one unless the context or either public key changed (or force)
+void GenerateReKey(const ClientContext& ctx, const std::string& to_client_id, bool force = false);
+
+// Encrypt <data_dir>/wc.bin (mapped, or wc.json when weightsFormat=json) chunk by chunk
+// and upload it as this round's params
+void EncryptAndUpload(const ClientContext& ctx, int round);
+
+// A round's participation plan as the server announced it (clientsPerRound /
+// roundDeadlineSeconds in server_config.txt); without sampling every client is selected
+struct RoundPlan {
+    bool sampling = false;
+    bool selected = true;                 // this client may upload this round
+    bool uploaded = false;                // this client's params for the round are in
+    std::vector<std::string> participants;
+    long long deadline_unix_ms = 0;       // 0 = no deadline
+    long long now_unix_ms = 0;            // server clock when the plan was fetched
+};
+
+// Fetch (and, on the round's first request, open) this round's plan
+RoundPlan FetchRoundPlan(const ClientContext& ctx, int round);
+
+// Encrypt in-memory layers and upload them as this round's params
+// (EncryptAndUpload without the weights file; used by the Python bindings).
+// Layers the layer policy leaves in plaintext are sent as raw float64 instead.
+// Returns false when this client is not a participant of the round or its upload deadline
+// has passed (without encrypting when the plan says so up front, or when the server refuses
+// the upload with 403/409); throws when the server does not store the params otherwise.
+bool UploadLayers(const ClientContext& ctx, int round, const std::vector<WeightsLayerView>& layers);
+
+// Threshold mode: download this round's summed aggregate and publish this client's
+// partial decryption of it
+void PostPartialDecryption(const ClientContext& ctx, int round);
+
+// Download and decrypt this round's aggregated params into flat per-layer buffers
+// (plaintext layers come back averaged in the clear).
+// Threshold mode waits (partialWaitSeconds) for every client's partial decryption and
+// fuses them, posting this client's own first if it has not yet.
+std::vector<std::vector<double>> DownloadLayers(const ClientContext& ctx, int round);
+
+// DownloadLayers for a client that took part in the round; nullopt, without downloading,
+// when a sampled round went on without it (not selected, or its upload missed the deadline)
+// and no aggregate was made for it
+std::optional<std::vector<std::vector<double>>> DownloadLayersIfParticipant(const ClientContext& ctx, int round);
+
+// Async aggregation: newest model version published for this client (0 before the first);
+// download it with DownloadLayers(ctx, version) and upload the next params under it
+int LatestModelVersion(const ClientContext& ctx);
+
+// Download this round's aggregated params and write them to <data_dir>/agg_wc.bin
+// (or agg_wc.json when weightsFormat=json). A client that did not take part in a sampled
+// round keeps its previous aggregate.
+void DownloadAndDecrypt(const ClientContext& ctx, int round);
@@ -0,0 +1,46 @@
+#include "config_utils.h"
+
+#include <fstream>
+#include <stdexcept>
+
+using namespace std;
+
+// Trim surrounding whitespace (config files are hand-edited)
+static string Trim(const string& s) {
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == string::npos) return "";
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+unordered_map<string, string> LoadConfig(const string& filename) {
+    unordered_map<string, string> config;
+    ifstream file(filename);
+    string line;
+
+    while (getline(file, line)) {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') continue;
+        size_t eqPos = line.find('=');
+        if (eqPos == string::npos) continue;
+        string key = Trim(line.substr(0, eqPos));
+        string val = Trim(line.substr(eqPos + 1));
+        config[key] = val;
+    }
+    return config;
+}
+
+long ConfigLong(const unordered_map<string, string>& config, const string& key, long fallback) {
+    auto it = config.find(key);
+    if (it == config.end() || it->second.empty()) return fallback;
+    try {
+        return stol(it->second);
+    } catch (const exception&) {
+        throw runtime_error("Invalid integer for config key '" + key + "': " + it->second);
+    }
+}
+
+string ConfigString(const unordered_map<string, string>& config, const string& key, const string& fallback) {
+    auto it = config.find(key);
+    return it == config.end() ? fallback : it->second;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+// Load a simple key=value config file (lines starting with '#' are comments).
+// A missing file yields an empty map.
+std::unordered_map<std::string, std::string> LoadConfig(const std::string& filename);
+
+// Typed lookups with a default for absent keys
+long ConfigLong(const std::unordered_map<std::string, std::string>& config, const std::string& key, long fallback);
+std::string ConfigString(const std::unordered_map<std::string, std::string>& config, const std::string& key, const std::string& fallback);
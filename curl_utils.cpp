@@ -1,7 +1,16 @@
 #include "curl_utils.h"
+#include "local_transport.h"
+#include "trace_utils.h"
 #include <curl/curl.h>
 #include <stdexcept>
 #include <sstream>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <thread>
+#include <algorithm>
 
 // Internal callback to capture response
 static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
@@ -9,60 +18,174 @@ static size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* use
     return size * nmemb;
 }
 
-std::string HttpPostJson(const std::string& url, const std::string& jsonPayload) {
-    CURL* curl = curl_easy_init();
-    if (!curl) throw std::runtime_error("curl_easy_init() failed");
+// Response headers the retry loop and the local transport act on
+struct ResponseHeaders {
+    long retry_after = 0;   // Retry-After (seconds form)
+    std::string shm_body;   // segment holding the body (local_transport.h)
+};
 
-    std::string response;
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+// Value of header `name` ("name:" in lower case) in `line`, trimmed; false for other headers
+static bool HeaderValue(const std::string& line, const std::string& name, std::string& value) {
+    if (line.size() <= name.size()) return false;
+    std::string prefix = line.substr(0, name.size());
+    std::transform(prefix.begin(), prefix.end(), prefix.begin(), ::tolower);
+    if (prefix != name) return false;
+    size_t begin = line.find_first_not_of(" \t", name.size());
+    size_t end = line.find_last_not_of(" \t\r\n");
+    value = begin == std::string::npos || end < begin ? "" : line.substr(begin, end - begin + 1);
+    return true;
+}
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_POST, 1L);
-    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, jsonPayload.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+// Internal callback to pick up the Retry-After and X-Shm-Body headers
+static size_t HeaderCallback(char* buffer, size_t size, size_t nitems, void* userp) {
+    size_t len = size * nitems;
+    std::string line(buffer, len);
+    auto* headers = (ResponseHeaders*)userp;
+    std::string value;
+    if (HeaderValue(line, "retry-after:", value)) {
+        headers->retry_after = std::strtol(value.c_str(), nullptr, 10);
+    } else if (HeaderValue(line, "x-shm-body:", value)) {
+        headers->shm_body = value;
+    }
+    return len;
+}
 
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+// Propagate the round/trace ID so server-side spans join the client's trace
+static struct curl_slist* AppendTraceHeader(struct curl_slist* headers) {
+    std::string trace_id = TraceId();
+    if (trace_id.empty()) return headers;
+    return curl_slist_append(headers, ("X-Trace-Id: " + trace_id).c_str());
+}
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        std::string error = curl_easy_strerror(res);
-        curl_easy_cleanup(curl);
-        curl_slist_free_all(headers);
-        throw std::runtime_error("HTTP POST failed: " + error);
-    }
+// Max attempts after a 429/503 (FL_HTTP_MAX_RETRIES, default 10)
+static int MaxRetries() {
+    const char* env = std::getenv("FL_HTTP_MAX_RETRIES");
+    return env && *env ? std::atoi(env) : 10;
+}
 
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
-    return response;
+// Exponential backoff from the server's Retry-After hint, with ±50% jitter so a
+// burst of rejected clients does not come back in lockstep
+static std::chrono::milliseconds RetryDelay(long retry_after_s, int attempt) {
+    static thread_local std::mt19937 rng(std::random_device{}());
+    double base_ms = 1000.0 * std::max(1L, retry_after_s);
+    double delay_ms = std::min(base_ms * (1 << std::min(attempt, 4)), 30000.0);
+    std::uniform_real_distribution<double> jitter(0.5, 1.5);
+    return std::chrono::milliseconds(static_cast<long>(delay_ms * jitter(rng)));
 }
 
-std::string HttpGetJson(const std::string& url) {
-    CURL* curl = curl_easy_init();
-    if (!curl) throw std::runtime_error("curl_easy_init() failed");
+// Perform one request (POST when body != nullptr), retrying while the server answers 429/503
+static std::string PerformWithRetry(const std::string& url, const std::string* body, long* status_out = nullptr) {
+    const char* method = body ? "POST" : "GET";
+    const int max_retries = MaxRetries();
+
+    // http+unix:// URLs reach a co-located server over its Unix socket, with large bodies
+    // in shared memory both ways (local_transport.h); the request's segment serves every retry
+    UnixSocketUrl local;
+    const bool unix_socket = ParseUnixSocketUrl(url, local);
+    const size_t shm_min = unix_socket ? ShmMinBytes() : 0;
+    std::optional<SharedBody> shm_request;
+    if (body && shm_min > 0 && body->size() >= shm_min) {
+        TraceSpan span("shm_write", "{\"bytes\":" + std::to_string(body->size()) + "}");
+        shm_request = SharedBody::Create(*body);
+    }
+
+    for (int attempt = 0;; ++attempt) {
+        CURL* curl = curl_easy_init();
+        if (!curl) throw std::runtime_error("curl_easy_init() failed");
+
+        std::string response;
+        ResponseHeaders response_headers;
+        struct curl_slist* headers = nullptr;
+        headers = curl_slist_append(headers, body ? "Content-Type: application/json" : "Accept: application/json");
+        headers = AppendTraceHeader(headers);
+        if (shm_request) {
+            headers = curl_slist_append(headers, (std::string(kShmBodyHeader) + ": " + shm_request->name()).c_str());
+            headers = curl_slist_append(headers, (std::string(kShmBodyLengthHeader) + ": " +
+                                                  std::to_string(body->size())).c_str());
+        }
+        if (shm_min > 0) headers = curl_slist_append(headers, (std::string(kShmAcceptHeader) + ": 1").c_str());
 
-    std::string response;
-    struct curl_slist* headers = nullptr;
-    headers = curl_slist_append(headers, "Accept: application/json");
+        curl_easy_setopt(curl, CURLOPT_URL, unix_socket ? local.http_url.c_str() : url.c_str());
+        if (unix_socket) curl_easy_setopt(curl, CURLOPT_UNIX_SOCKET_PATH, local.socket_path.c_str());
+        if (body) {
+            curl_easy_setopt(curl, CURLOPT_POST, 1L);
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDS, shm_request ? "" : body->c_str());
+            curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)(shm_request ? 0 : body->size()));
+        } else {
+            curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
+        }
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_HTTPGET, 1L);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+        curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response_headers);
 
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+        CURLcode res;
+        {
+            TraceSpan span(body ? "http_post" : "http_get",
+                           "{\"bytes\":" + std::to_string(body ? body->size() : 0) + ",\"attempt\":" + std::to_string(attempt) + "}");
+            res = curl_easy_perform(curl);
+        }
+
+        long status = 0;
+        if (res == CURLE_OK) curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+
+        // The server left a large response body in shared memory for us to read and remove.
+        // Map it while the connection is still open: the server removes what it sent over a
+        // connection once that connection closes
+        std::optional<SharedBody> shm_response;
+        std::string shm_error;
+        if (res == CURLE_OK && !response_headers.shm_body.empty()) {
+            try {
+                shm_response.emplace(SharedBody::Open(response_headers.shm_body));
+                shm_response->Unlink();
+            } catch (const std::exception& e) {
+                shm_error = e.what();
+            }
+        }
 
-    CURLcode res = curl_easy_perform(curl);
-    if (res != CURLE_OK) {
-        std::string error = curl_easy_strerror(res);
         curl_easy_cleanup(curl);
         curl_slist_free_all(headers);
-        throw std::runtime_error("HTTP GET failed: " + error);
+
+        if (res != CURLE_OK) {
+            throw std::runtime_error(std::string("HTTP ") + method + " failed: " + curl_easy_strerror(res));
+        }
+        if (!shm_error.empty()) throw std::runtime_error(shm_error);
+        if (shm_response) {
+            TraceSpan span("shm_read");
+            response.assign(shm_response->view());
+        }
+
+        bool backpressure = status == 429 || status == 503;
+        if (!backpressure) {
+            if (status_out) *status_out = status;
+            return response;
+        }
+        if (attempt >= max_retries) {
+            throw std::runtime_error(std::string("HTTP ") + method + " failed: server still busy (" +
+                                     std::to_string(status) + ") after " + std::to_string(attempt + 1) + " attempts");
+        }
+
+        auto delay = RetryDelay(response_headers.retry_after, attempt);
+        std::cerr << "[curl_utils] " << status << " from " << url << ", retrying in " << delay.count() << " ms" << std::endl;
+        std::this_thread::sleep_for(delay);
     }
+}
 
-    curl_easy_cleanup(curl);
-    curl_slist_free_all(headers);
-    return response;
+std::string HttpPostJson(const std::string& url, const std::string& jsonPayload) {
+    return PerformWithRetry(url, &jsonPayload);
 }
 
+std::string HttpPostJson(const std::string& url, const std::string& jsonPayload, long& status) {
+    return PerformWithRetry(url, &jsonPayload, &status);
+}
+
+std::string HttpGetJson(const std::string& url) {
+    return PerformWithRetry(url, nullptr);
+}
+
+std::string ServerUrl() {
+    const char* env = std::getenv("FL_SERVER_URL");
+    return env && *env ? std::string(env) : std::string("http://localhost:8000");
+}
@@ -4,9 +4,17 @@
 
 // Perform a POST request with a JSON payload.
 // Returns response as string. Throws std::runtime_error on failure.
+// 429/503 responses are retried with jittered backoff honoring Retry-After.
 std::string HttpPostJson(const std::string& url, const std::string& jsonPayload);
 
+// HttpPostJson that also reports the final HTTP status code, for callers that tell refusals apart
+std::string HttpPostJson(const std::string& url, const std::string& jsonPayload, long& status);
+
 // Perform a GET request.
-// Returns response as string. Throws std::runtime_error on failure.
+// Returns response as string. Throws std::runtime_error on failure (retries like HttpPostJson).
 std::string HttpGetJson(const std::string& url);
 
+// Base URL of the REST server (FL_SERVER_URL, default http://localhost:8000). Binaries on the
+// server's host may use its Unix socket instead, e.g. http+unix://%2Ftmp%2Ffl_server.sock
+// (local_transport.h); every request above takes either form.
+std::string ServerUrl();
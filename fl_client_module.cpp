@@ -0,0 +1,106 @@
+// Python extension exposing the client pipeline in-process (built with `make python`).
+//
+//   import fl_client
+//   client = fl_client.Client("client1")          # loads cc.bin + keys once
+//   client.encrypt_and_upload(model.get_weights())  # numpy arrays read in place
+//   layers = client.download_and_decrypt(round)     # list of flat float64 arrays, or None
+//                                                   # when a sampled round went on without it
+//
+// Weights cross the boundary through the buffer protocol: C-contiguous float32/float64
+// arrays are encrypted straight from their memory, and decrypted layers are handed to
+// numpy without a copy. The GIL is released while encrypting, uploading and decrypting.
+
+#include "client_ops.h"
+#include "trace_utils.h"
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace py = pybind11;
+
+class PyClient {
+public:
+    explicit PyClient(const std::string& client_id) : ctx_(LoadClientContext(client_id)) {}
+
+    bool EncryptAndUpload(const py::list& weights, std::optional<int> round) {
+        int r = round ? *round : ReadRoundCounter();
+
+        // Views into the numpy buffers; `held` keeps them (or converted copies) alive
+        std::vector<py::array> held;
+        std::vector<WeightsLayerView> layers;
+        for (const auto& item : weights) {
+            py::array arr = py::array::ensure(item);
+            if (!arr) {
+                throw std::runtime_error("weights must be a list of numeric arrays");
+            }
+            bool contiguous = arr.flags() & py::array::c_style;
+            if (!contiguous || !(arr.dtype().is(py::dtype::of<double>()) || arr.dtype().is(py::dtype::of<float>()))) {
+                arr = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure(arr);
+            }
+            WeightsLayerView view;
+            view.data = arr.data();
+            view.size = static_cast<size_t>(arr.size());
+            view.dtype = arr.dtype().is(py::dtype::of<float>()) ? WeightsDType::Float32 : WeightsDType::Float64;
+            for (py::ssize_t d = 0; d < arr.ndim(); ++d) view.shape.push_back(static_cast<size_t>(arr.shape(d)));
+            layers.push_back(std::move(view));
+            held.push_back(std::move(arr));
+        }
+
+        TraceSetId("round-" + std::to_string(r));
+        py::gil_scoped_release release;
+        return UploadLayers(ctx_, r, layers);
+    }
+
+    std::optional<py::list> DownloadAndDecrypt(std::optional<int> round) {
+        int r = round ? *round : ReadRoundCounter();
+        TraceSetId("round-" + std::to_string(r));
+
+        // Same participation check as the client binary's decrypt step
+        std::optional<std::vector<std::vector<double>>> downloaded;
+        {
+            py::gil_scoped_release release;
+            downloaded = DownloadLayersIfParticipant(ctx_, r);
+        }
+        if (!downloaded) return std::nullopt;
+        std::vector<std::vector<double>>& layers = *downloaded;
+
+        // Move each buffer into a capsule so numpy owns it without copying
+        py::list out;
+        for (auto& layer : layers) {
+            auto* owned = new std::vector<double>(std::move(layer));
+            py::capsule free_when_done(owned, [](void* p) { delete static_cast<std::vector<double>*>(p); });
+            out.append(py::array_t<double>({static_cast<py::ssize_t>(owned->size())}, owned->data(), free_when_done));
+        }
+        return out;
+    }
+
+    const std::string& ClientId() const { return ctx_.client_id; }
+
+private:
+    ClientContext ctx_;
+};
+
+PYBIND11_MODULE(fl_client, m) {
+    m.doc() = "In-process client pipeline: CKKS encrypt/upload and download/decrypt";
+
+    m.def("read_round_counter", &ReadRoundCounter, "Current federated round from round_counter.txt");
+    m.def("trace_init", &TraceInit, py::arg("process_name"), "Enable span tracing (FL_TRACE_DIR) for this process");
+    m.def("trace_flush", &TraceFlush, "Write buffered trace spans");
+
+    py::class_<PyClient>(m, "Client")
+        .def(py::init<const std::string&>(), py::arg("client_id"),
+             "Load cc.bin and this client's keys once; they stay resident for every call")
+        .def_property_readonly("client_id", &PyClient::ClientId)
+        .def("encrypt_and_upload", &PyClient::EncryptAndUpload, py::arg("weights"), py::arg("round") = py::none(),
+             "Encrypt a list of weight arrays and upload them as this round's params; "
+             "False when this client is not a participant of the round")
+        .def("download_and_decrypt", &PyClient::DownloadAndDecrypt, py::arg("round") = py::none(),
+             "Download and decrypt this round's aggregated params as a list of flat float64 arrays; "
+             "None when this client did not take part in the (sampled) round");
+}
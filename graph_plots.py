@@ -1,3 +1,4 @@
+import os
 import pandas as pd
 import matplotlib.pyplot as plt
 
@@ -55,3 +56,53 @@ def plot_comm(comm_df, client_label, color_upload, color_download, fname):
 plot_comm(c1_comm, "Client 1", 'blue', 'green', "client1_comm_overhead.png")
 plot_comm(c2_comm, "Client 2", 'red', 'orange', "client2_comm_overhead.png")
 
+
+# Per-phase breakdown from the C++ binaries' phase log (FL_PHASE_LOG, written by run.sh)
+phase_log = os.environ.get("FL_PHASE_LOG", "logs/phase_timings.csv")
+if os.path.exists(phase_log) and os.path.getsize(phase_log) > 0:
+    phases = pd.read_csv(phase_log)
+    phases = phases[phases["schema"] == 2].dropna(subset=["round"])
+    phases["round"] = phases["round"].astype(int)
+
+    per_round = phases.pivot_table(index="round", columns="phase", values="total_ms", aggfunc="sum").fillna(0)
+    per_round.plot(kind="bar", stacked=True, figsize=(10, 6))
+    plt.xlabel("Round")
+    plt.ylabel("Time (ms, summed over processes and threads)")
+    plt.title("Time per Phase per Round")
+    plt.legend(bbox_to_anchor=(1.02, 1), loc="upper left", fontsize="small")
+    plt.tight_layout()
+    plt.savefig("phase_breakdown.png")
+    print("Saved plot to phase_breakdown.png")
+
+    peak_rss = phases.groupby(["round", "process"])["peak_rss_kb"].max().unstack().fillna(0) / 1024
+    peak_rss.plot(marker='o', figsize=(8, 5))
+    plt.xlabel("Round")
+    plt.ylabel("Peak RSS (MB)")
+    plt.title("Peak Memory per Binary per Round")
+    plt.grid(True, linestyle="--", alpha=0.6)
+    plt.tight_layout()
+    plt.savefig("peak_rss_per_round.png")
+    print("Saved plot to peak_rss_per_round.png")
+
+    # Allocation columns are only filled in binaries built with ALLOC_STATS=1
+    if phases["allocs"].sum() > 0:
+        alloc_mb = phases.pivot_table(index="round", columns="phase", values="alloc_kb", aggfunc="sum").fillna(0) / 1024
+        alloc_mb.plot(kind="bar", stacked=True, figsize=(10, 6))
+        plt.xlabel("Round")
+        plt.ylabel("Allocated (MB, summed over processes and threads)")
+        plt.title("Heap Allocation per Phase per Round")
+        plt.legend(bbox_to_anchor=(1.02, 1), loc="upper left", fontsize="small")
+        plt.tight_layout()
+        plt.savefig("alloc_per_phase.png")
+        print("Saved plot to alloc_per_phase.png")
+
+    # Empty where the allocator does not report live bytes (mimalloc without ALLOC_STATS=1)
+    frag = phases.groupby(["round", "process"])["heap_frag"].max().unstack()
+    frag.plot(marker='o', figsize=(8, 5))
+    plt.xlabel("Round")
+    plt.ylabel("Heap fragmentation (1 - in use / resident)")
+    plt.title("Heap Fragmentation per Binary per Round")
+    plt.grid(True, linestyle="--", alpha=0.6)
+    plt.tight_layout()
+    plt.savefig("heap_fragmentation_per_round.png")
+    print("Saved plot to heap_fragmentation_per_round.png")
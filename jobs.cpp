@@ -0,0 +1,217 @@
+#include "jobs.h"
+
+#include "config_utils.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+// <job>.<key> when set, else <key>, else the fallback
+static std::string JobValue(const std::unordered_map<std::string, std::string>& config, const std::string& job,
+                            const std::string& key, const std::string& fallback) {
+    return ConfigString(config, job + "." + key, ConfigString(config, key, fallback));
+}
+
+static long JobLong(const std::unordered_map<std::string, std::string>& config, const std::string& job,
+                    const std::string& key, long fallback) {
+    return ConfigLong(config, job + "." + key, ConfigLong(config, key, fallback));
+}
+
+// aggregationMode and context fingerprint from the job's directory
+static void ReadJobContext(JobConfig& job) {
+    job.aggregation_mode = ConfigString(LoadConfig(job.dir + "/cc_config.txt"), "aggregationMode", "pre");
+    job.context_fp.clear();
+    std::ifstream fp_file(job.dir + "/cc.fingerprint");
+    if (fp_file) std::getline(fp_file, job.context_fp);
+}
+
+static bool ValidJobName(const std::string& name) {
+    return !name.empty() && std::all_of(name.begin(), name.end(), [](char ch) {
+        return std::isalnum(static_cast<unsigned char>(ch)) || ch == '_' || ch == '-';
+    });
+}
+
+std::vector<JobConfig> LoadJobConfigs(const std::string& filename) {
+    auto config = LoadConfig(filename);
+
+    std::vector<std::string> names = {kDefaultJob};
+    std::istringstream listed(ConfigString(config, "jobs", ""));
+    for (std::string name; std::getline(listed, name, ',');) {
+        name.erase(std::remove_if(name.begin(), name.end(), [](unsigned char ch) { return std::isspace(ch); }), name.end());
+        if (name.empty()) continue;
+        if (!ValidJobName(name)) {
+            throw std::runtime_error("Invalid job name '" + name + "' (letters, digits, _ and - only)");
+        }
+        if (std::find(names.begin(), names.end(), name) != names.end()) {
+            throw std::runtime_error("Job " + name + " listed twice");
+        }
+        names.push_back(name);
+    }
+
+    std::vector<JobConfig> jobs;
+    for (const std::string& name : names) {
+        JobConfig job;
+        job.name = name;
+        job.dir = JobValue(config, name, "dir", ".");
+        ReadJobContext(job);
+        job.clients_per_round = static_cast<size_t>(std::max(0L, JobLong(config, name, "clientsPerRound", 0)));
+        job.deadline_seconds = JobLong(config, name, "roundDeadlineSeconds", 0);
+        job.keep_rounds = static_cast<int>(JobLong(config, name, "keepRounds", 0));
+        job.weight = std::stod(JobValue(config, name, "aggregationWeight", "1"));
+        if (job.weight <= 0) {
+            throw std::runtime_error("Job " + name + ": aggregationWeight must be positive");
+        }
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+bool SplitJobPath(const std::string& uri, std::string& job, std::string& path) {
+    static const std::string kPrefix = "/jobs/";
+    if (uri.rfind(kPrefix, 0) != 0) {
+        job = kDefaultJob;
+        path = uri;
+        return true;
+    }
+    size_t slash = uri.find('/', kPrefix.size());
+    if (slash == std::string::npos || slash + 1 == uri.size()) return false;
+    job = uri.substr(kPrefix.size(), slash - kPrefix.size());
+    path = uri.substr(slash);
+    return true;
+}
+
+JobRegistry::JobRegistry(const std::vector<JobConfig>& configs) {
+    for (const JobConfig& config : configs) {
+        auto storage = std::make_unique<FederatedStorage>();
+        storage->ConfigureRetention(config.keep_rounds);
+        configured_[config.name] = config;
+        configs_[config.name] = config;
+        storages_[config.name] = std::move(storage);
+        Refresh(config.name);
+    }
+}
+
+const JobConfig* JobRegistry::Refresh(const std::string& job) {
+    auto it = configs_.find(job);
+    if (it == configs_.end()) return nullptr;
+    JobConfig& config = it->second;
+
+    // A missing file stamps as the minimum time, so creating it counts as a change
+    std::error_code ec;
+    ContextStamp stamp{std::filesystem::last_write_time(config.dir + "/cc_config.txt", ec),
+                       std::filesystem::last_write_time(config.dir + "/cc.fingerprint", ec)};
+    auto known = stamps_.find(job);
+    if (known != stamps_.end() && known->second == stamp) return &config;
+    bool first = known == stamps_.end();
+    stamps_[job] = stamp;
+
+    const std::string mode = config.aggregation_mode, fp = config.context_fp;
+    ReadJobContext(config);
+    // Threshold decryption needs every key holder, so sampling stays off there
+    const JobConfig& configured = configured_.at(job);
+    bool sampling = config.aggregation_mode != "threshold";
+    config.clients_per_round = sampling ? configured.clients_per_round : 0;
+    config.deadline_seconds = sampling ? configured.deadline_seconds : 0;
+    storages_.at(job)->ConfigureSampling(config.clients_per_round, config.deadline_seconds);
+    if (!first && (config.aggregation_mode != mode || config.context_fp != fp)) {
+        std::cout << "[jobs] Job " << job << " context changed: " << config.aggregation_mode << " mode, fingerprint "
+                  << (config.context_fp.empty() ? "none" : config.context_fp) << "\n";
+    }
+    return &config;
+}
+
+FederatedStorage* JobRegistry::Storage(const std::string& job) {
+    auto it = storages_.find(job);
+    return it == storages_.end() ? nullptr : it->second.get();
+}
+
+const JobConfig* JobRegistry::Config(const std::string& job) const {
+    auto it = configs_.find(job);
+    return it == configs_.end() ? nullptr : &it->second;
+}
+
+std::vector<std::string> JobRegistry::Names() const {
+    std::vector<std::string> names;
+    for (const auto& [name, config] : configs_) names.push_back(name);
+    return names;
+}
+
+std::map<std::string, size_t> JobRegistry::StorageBytes() {
+    std::map<std::string, size_t> total;
+    for (auto& [name, storage] : storages_) {
+        for (const auto& [category, bytes] : storage->StorageBytes()) total[category] += bytes;
+    }
+    return total;
+}
+
+WorkerPool::Lease WorkerPool::Acquire(const std::string& job, double weight, size_t want, size_t holders) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ExpireLocked();
+
+    // Weighted share among the jobs holding leases, counting this one once
+    std::map<std::string, double> active;
+    size_t held_by_job = 0, held_total = 0, leases_by_job = 0;
+    for (const auto& [id, held] : leases_) {
+        active[held.job] = held.weight;
+        held_total += held.threads;
+        if (held.job == job) {
+            held_by_job += held.threads;
+            ++leases_by_job;
+        }
+    }
+    active[job] = weight;
+    double total_weight = 0;
+    for (const auto& [name, w] : active) total_weight += w;
+    size_t share = std::max<size_t>(1, static_cast<size_t>(threads_ * weight / total_weight));
+
+    // What is left of the job's share and of the pool; at least one thread so nobody waits
+    size_t left = std::min(share - std::min(share, held_by_job), threads_ - std::min(threads_, held_total));
+    // Without a cap, this aggregator's slice of the share, so the first of several does not take it all
+    size_t slice = std::max<size_t>(1, share / std::max(holders, leases_by_job + 1));
+    size_t granted = std::max<size_t>(1, std::min(want == 0 ? slice : want, left));
+    std::string id = job + "-" + std::to_string(++next_id_);
+    leases_[id] = {job, weight, granted, Clock::now()};
+    return {id, granted, active.size()};
+}
+
+void WorkerPool::Release(const std::string& lease_id) {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = leases_.find(lease_id);
+    if (it != leases_.end()) ReleaseLocked(it);
+}
+
+void WorkerPool::ReleaseLocked(std::map<std::string, Held>::iterator it) {
+    double seconds = std::chrono::duration<double>(Clock::now() - it->second.start).count();
+    thread_seconds_[it->second.job] += seconds * it->second.threads;
+    leases_.erase(it);
+}
+
+void WorkerPool::ExpireLocked() {
+    auto cutoff = Clock::now() - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(lease_seconds_));
+    for (auto it = leases_.begin(); it != leases_.end();) {
+        auto next = std::next(it);
+        if (it->second.start < cutoff) ReleaseLocked(it);
+        it = next;
+    }
+}
+
+json WorkerPool::Status() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    ExpireLocked();
+    json status = json::object();
+    for (const auto& [job, seconds] : thread_seconds_) {
+        status[job] = {{"leases", 0}, {"threads", 0}, {"thread_seconds", seconds}};
+    }
+    for (const auto& [id, held] : leases_) {
+        if (!status.contains(held.job)) status[held.job] = {{"leases", 0}, {"threads", 0}, {"thread_seconds", 0.0}};
+        status[held.job]["leases"] = status[held.job]["leases"].get<int>() + 1;
+        status[held.job]["threads"] = status[held.job]["threads"].get<size_t>() + held.threads;
+    }
+    return status;
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include "rest_storage.h"
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Multi-federation tenancy for api_server. Every job (one federated training run) has its
+// own storage (clients, keys, rounds, aggregates), context, sampling and retention settings,
+// all served from one process. Job <name> lives under /jobs/<name>/...; the bare endpoints
+// belong to the "default" job, so single-federation setups change nothing. Clients and
+// ./operations pick a job through FL_SERVER_URL (http://host:8000/jobs/<name>).
+
+// Job served by the endpoints without a /jobs/<name> prefix
+constexpr const char* kDefaultJob = "default";
+
+struct JobConfig {
+    std::string name;
+    std::string dir = ".";              // the job's working directory (cc_config.txt, cc.bin)
+    std::string aggregation_mode = "pre";
+    std::string context_fp;             // <dir>/cc.fingerprint, empty until ./cc has run there
+    size_t clients_per_round = 0;       // sampling, off (0) while the job is in threshold mode
+    long deadline_seconds = 0;
+    int keep_rounds = 0;                // rounds of payloads kept (0 = all)
+    double weight = 1.0;                // share of the aggregation worker pool
+};
+
+// "default" plus every job listed in `jobs` (comma-separated) in server_config.txt.
+// <name>.<key> overrides <key> for one job. Throws std::runtime_error on a bad job name.
+std::vector<JobConfig> LoadJobConfigs(const std::string& filename);
+
+// Split "/jobs/<name>/<endpoint>" into the job name and "/<endpoint>"; any other URI
+// belongs to the default job. Returns false for a job prefix without an endpoint.
+bool SplitJobPath(const std::string& uri, std::string& job, std::string& path);
+
+// Every job's storage and settings; the set of jobs is fixed at startup, while each job's
+// context (aggregationMode in <dir>/cc_config.txt, <dir>/cc.fingerprint) follows ./cc
+class JobRegistry {
+public:
+    explicit JobRegistry(const std::vector<JobConfig>& configs);
+
+    // Null for unknown jobs
+    FederatedStorage* Storage(const std::string& job);
+    const JobConfig* Config(const std::string& job) const;
+
+    // Config() after re-reading the job's context files if either changed since they were
+    // last read, switching the job's sampling off in threshold mode and back on otherwise
+    const JobConfig* Refresh(const std::string& job);
+
+    std::vector<std::string> Names() const;
+
+    // Bytes held per category, summed over jobs (for /metrics)
+    std::map<std::string, size_t> StorageBytes();
+
+private:
+    using ContextStamp = std::pair<std::filesystem::file_time_type, std::filesystem::file_time_type>;
+
+    std::map<std::string, JobConfig> configured_;   // sampling as set in server_config.txt
+    std::map<std::string, JobConfig> configs_;
+    std::map<std::string, ContextStamp> stamps_;    // cc_config.txt and cc.fingerprint times last read
+    std::map<std::string, std::unique_ptr<FederatedStorage>> storages_;
+};
+
+// Aggregation threads shared by every job's ./operations. Each aggregation leases its
+// threads for its compute phase; a lease gets its slice of its job's weighted share of the
+// pool among the jobs holding leases at the time (all of it when the job aggregates alone),
+// and never more than what is left of that share and of the pool's unleased threads. The
+// slice divides the share among the job's concurrent aggregators: the leases the job
+// already holds plus this one, or as many as the caller says will run at once (the edges
+// of a round), whichever is more. Grants never wait: a lease gets at least one thread even
+// when nothing is left, so the pool can be oversubscribed briefly until leases are
+// released. Leases not released in time expire.
+class WorkerPool {
+public:
+    WorkerPool(size_t threads, double lease_seconds) : threads_(threads), lease_seconds_(lease_seconds) {}
+
+    struct Lease {
+        std::string id;
+        size_t threads;
+        size_t active_jobs;   // jobs holding leases, this one included
+    };
+
+    // Lease up to `want` threads (0 = the job's share divided among `holders` concurrent
+    // aggregators) for `job`
+    Lease Acquire(const std::string& job, double weight, size_t want, size_t holders = 1);
+    void Release(const std::string& lease_id);
+
+    size_t Threads() const { return threads_; }
+
+    // Per job: { "leases", "threads", "thread_seconds" } (thread-seconds of released leases)
+    nlohmann::json Status();
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Held {
+        std::string job;
+        double weight;
+        size_t threads;
+        Clock::time_point start;
+    };
+
+    // Drop leases older than lease_seconds_ (mtx_ held)
+    void ExpireLocked();
+    void ReleaseLocked(std::map<std::string, Held>::iterator it);
+
+    size_t threads_;
+    double lease_seconds_;
+    std::mutex mtx_;
+    std::map<std::string, Held> leases_;
+    std::map<std::string, double> thread_seconds_;   // job → used
+    unsigned long long next_id_ = 0;
+};
@@ -0,0 +1,92 @@
+#include "keystore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+std::string Fingerprint(std::string_view bytes) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char ch : bytes) {
+        hash ^= ch;
+        hash *= 1099511628211ull;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    return hex;
+}
+
+std::string ContextFingerprint(const std::unordered_map<std::string, std::string>& config) {
+    std::vector<std::pair<std::string, std::string>> entries(config.begin(), config.end());
+    std::sort(entries.begin(), entries.end());
+    std::string canonical;
+    for (const auto& [key, value] : entries) canonical += key + "=" + value + "\n";
+    return Fingerprint(canonical);
+}
+
+std::string ReadContextFingerprint(const std::string& path) {
+    std::ifstream in(path);
+    std::string fp;
+    in >> fp;
+    return fp;
+}
+
+void WriteContextFingerprint(const std::string& fingerprint, const std::string& path) {
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Could not write " + path);
+    }
+    out << fingerprint << "\n";
+}
+
+KeyStore::KeyStore(std::string dir) : dir_(std::move(dir)), manifest_(json::object()) {
+    std::ifstream in(Path("keystore.json"));
+    if (!in) return;
+    try {
+        in >> manifest_;
+    } catch (const std::exception&) {
+        manifest_ = json::object();  // unreadable manifest: treat every key as missing
+    }
+}
+
+bool KeyStore::Valid(const std::string& kind, const std::string& context_fp, const std::string& depends_fp) const {
+    if (context_fp.empty() || !manifest_.contains(kind)) return false;
+    const json& entry = manifest_[kind];
+    if (entry.value("context", "") != context_fp || entry.value("depends", "") != depends_fp) return false;
+    for (const auto& file : entry.value("files", json::array())) {
+        std::error_code ec;
+        if (!std::filesystem::exists(Path(file.get<std::string>()), ec)) return false;
+    }
+    return true;
+}
+
+void KeyStore::Record(const std::string& kind, const std::string& context_fp,
+                      const std::vector<std::string>& files, const std::string& depends_fp) {
+    manifest_[kind] = {
+        {"context", context_fp},
+        {"depends", depends_fp},
+        {"files", files},
+        {"created", std::chrono::duration_cast<std::chrono::seconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count()}
+    };
+    Save();
+}
+
+void KeyStore::Save() const {
+    std::filesystem::create_directories(dir_);
+    std::string tmp = Path("keystore.json.tmp");
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            throw std::runtime_error("Could not write " + tmp);
+        }
+        out << manifest_.dump(2) << "\n";
+    }
+    std::filesystem::rename(tmp, Path("keystore.json"));
+}
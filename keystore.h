@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// 64-bit FNV-1a of `bytes` as 16 hex digits (identity check, not a security hash)
+std::string Fingerprint(std::string_view bytes);
+
+// Fingerprint of a CryptoContext configuration (cc_config.txt values, order-independent).
+// OpenFHE parameter generation is deterministic, so equal fingerprints mean keys made
+// for one context are valid for the other.
+std::string ContextFingerprint(const std::unordered_map<std::string, std::string>& config);
+
+// Fingerprint ./cc recorded next to cc.bin; empty when missing
+std::string ReadContextFingerprint(const std::string& path = "cc.fingerprint");
+void WriteContextFingerprint(const std::string& fingerprint, const std::string& path = "cc.fingerprint");
+
+// Per-client manifest (<dir>/keystore.json) of generated key material. Each entry
+// records the context fingerprint it was made for, an optional fingerprint of what it
+// depends on (e.g. both public keys for a rekey) and the files holding it, so setup can
+// reuse what is still valid and regenerate only what is missing or stale.
+class KeyStore {
+public:
+    explicit KeyStore(std::string dir);
+
+    // True when `kind` was recorded for this context/dependency and all its files exist
+    bool Valid(const std::string& kind, const std::string& context_fp, const std::string& depends_fp = "") const;
+
+    // Record (or replace) an entry and write the manifest
+    void Record(const std::string& kind, const std::string& context_fp,
+                const std::vector<std::string>& files, const std::string& depends_fp = "");
+
+    // Path of a file inside the keystore directory
+    std::string Path(const std::string& file) const { return dir_ + "/" + file; }
+
+private:
+    void Save() const;
+
+    std::string dir_;
+    nlohmann::json manifest_;
+};
@@ -0,0 +1,121 @@
+#include "layer_policy.h"
+
+#include "base64_utils.h"
+#include "config_utils.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+
+using json = nlohmann::json;
+
+static bool ParseMode(const std::string& key, const std::string& value) {
+    if (value == "encrypt") return true;
+    if (value == "plain") return false;
+    throw std::runtime_error("Layer policy: " + key + " must be encrypt or plain, got " + value);
+}
+
+bool LayerPolicy::Encrypted(size_t index, const std::vector<size_t>& shape) const {
+    auto it = layers.find(index);
+    if (it != layers.end()) return it->second;
+    if (shape.size() == 1 && vectors_encrypted >= 0) return vectors_encrypted == 1;
+    return default_encrypted;
+}
+
+LayerPolicy LoadLayerPolicy(const std::string& path) {
+    LayerPolicy policy;
+    if (path.empty()) return policy;
+    if (!std::filesystem::exists(path)) {
+        throw std::runtime_error("Layer policy file " + path + " not found");
+    }
+
+    for (const auto& [key, value] : LoadConfig(path)) {
+        if (key == "default") {
+            policy.default_encrypted = ParseMode(key, value);
+        } else if (key == "vectors") {
+            policy.vectors_encrypted = ParseMode(key, value) ? 1 : 0;
+        } else if (key.rfind("layer", 0) == 0 && key.size() > 5 &&
+                   key.find_first_not_of("0123456789", 5) == std::string::npos) {
+            policy.layers[std::stoul(key.substr(5))] = ParseMode(key, value);
+        } else {
+            throw std::runtime_error("Layer policy: unknown key " + key);
+        }
+    }
+    return policy;
+}
+
+std::vector<WeightsLayerView> SplitLayers(const LayerPolicy& policy, const std::vector<WeightsLayerView>& layers,
+                                          PlainLayers& plain) {
+    std::vector<WeightsLayerView> encrypted;
+    plain.clear();
+    for (size_t i = 0; i < layers.size(); ++i) {
+        if (policy.Encrypted(i, layers[i].shape)) {
+            encrypted.push_back(layers[i]);
+            continue;
+        }
+        std::vector<double>& values = plain[i];
+        values.resize(layers[i].size);
+        for (size_t k = 0; k < values.size(); ++k) values[k] = layers[i].At(k);
+    }
+    return encrypted;
+}
+
+json EncodePlainLayers(const PlainLayers& layers) {
+    json encoded = json::object();
+    for (const auto& [index, values] : layers) {
+        std::vector<uint8_t> bytes(values.size() * sizeof(double));
+        std::memcpy(bytes.data(), values.data(), bytes.size());
+        encoded[std::to_string(index)] = Base64Encode(bytes);
+    }
+    return encoded;
+}
+
+PlainLayers DecodePlainLayers(const json& encoded) {
+    PlainLayers layers;
+    if (encoded.is_null()) return layers;
+    for (auto it = encoded.begin(); it != encoded.end(); ++it) {
+        std::vector<uint8_t> bytes = Base64Decode(it.value().get<std::string>());
+        if (bytes.size() % sizeof(double) != 0) {
+            throw std::runtime_error("Plaintext layer " + it.key() + " is not a whole number of float64 values");
+        }
+        std::vector<double>& values = layers[std::stoul(it.key())];
+        values.resize(bytes.size() / sizeof(double));
+        std::memcpy(values.data(), bytes.data(), bytes.size());
+    }
+    return layers;
+}
+
+// Plain, unaliased loops over contiguous doubles: the compiler emits packed SIMD for them
+// (layer_policy.o is built with -fopenmp-simd, see the Makefile)
+static void Axpy(double* __restrict out, const double* __restrict in, size_t n, double weight) {
+#pragma omp simd
+    for (size_t k = 0; k < n; ++k) out[k] += weight * in[k];
+}
+
+static void Scale(double* __restrict values, size_t n, double scale) {
+#pragma omp simd
+    for (size_t k = 0; k < n; ++k) values[k] *= scale;
+}
+
+void AccumulatePlainLayers(PlainLayers& sum, const PlainLayers& layers, double weight) {
+    if (sum.empty()) {
+        for (const auto& [index, values] : layers) sum[index].assign(values.size(), 0.0);
+    }
+    if (layers.size() != sum.size()) {
+        throw std::runtime_error("Plaintext layer sets differ: " + std::to_string(layers.size()) + " vs " +
+                                 std::to_string(sum.size()) + " layers (clients must share one layer policy)");
+    }
+    for (const auto& [index, values] : layers) {
+        auto it = sum.find(index);
+        if (it == sum.end() || it->second.size() != values.size()) {
+            throw std::runtime_error("Plaintext layer " + std::to_string(index) +
+                                     " differs between clients (clients must share one layer policy)");
+        }
+        Axpy(it->second.data(), values.data(), values.size(), weight);
+    }
+}
+
+void ScalePlainLayers(PlainLayers& layers, double scale) {
+    for (auto& [index, values] : layers) Scale(values.data(), values.size(), scale);
+}
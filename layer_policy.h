@@ -0,0 +1,46 @@
+#pragma once
+
+#include "weights_io.h"
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Per-layer selective encryption (layerPolicy in client_config.txt, e.g. layer_policy.txt).
+// A policy marks each weight array as encrypted or plaintext: encrypted layers take the
+// CKKS path, plaintext ones travel next to the ciphertexts as raw float64 and are averaged
+// in the clear by the aggregator. Every client of a deployment must use the same policy.
+
+struct LayerPolicy {
+    bool default_encrypted = true;
+    int vectors_encrypted = -1;       // 1-D layers (biases): 1 / 0, -1 = default
+    std::map<size_t, bool> layers;    // by layer index; overrides everything else
+
+    // Whether layer `index` (of `shape`) is encrypted
+    bool Encrypted(size_t index, const std::vector<size_t>& shape) const;
+};
+
+// Load a policy file (keys default, vectors, layer<N>; values encrypt or plain).
+// An empty path encrypts every layer. Throws std::runtime_error on a missing file or bad value.
+LayerPolicy LoadLayerPolicy(const std::string& path);
+
+// Plaintext layers by layer index
+using PlainLayers = std::map<size_t, std::vector<double>>;
+
+// Split layers by policy: returns views of the encrypted layers (in order) and copies the
+// plaintext ones, as float64, into `plain`
+std::vector<WeightsLayerView> SplitLayers(const LayerPolicy& policy, const std::vector<WeightsLayerView>& layers,
+                                          PlainLayers& plain);
+
+// Wire format: { "<layer index>": "<Base64 of little-endian float64 values>" }
+nlohmann::json EncodePlainLayers(const PlainLayers& layers);
+PlainLayers DecodePlainLayers(const nlohmann::json& encoded);
+
+// sum += weight * layers, layer by layer (vectorized). An empty sum takes the layer set of
+// the first input; later inputs must have the same layers and sizes (throws otherwise).
+void AccumulatePlainLayers(PlainLayers& sum, const PlainLayers& layers, double weight = 1.0);
+
+// layers *= scale (vectorized)
+void ScalePlainLayers(PlainLayers& layers, double scale);
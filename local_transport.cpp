@@ -0,0 +1,185 @@
+#include "local_transport.h"
+
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const std::string kUnixScheme = "http+unix://";
+static const std::string kShmPrefix = "/fl-";
+
+static std::string SysError(const std::string& what) {
+    return "[local_transport] " + what + ": " + std::strerror(errno);
+}
+
+static int HexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool ParseUnixSocketUrl(const std::string& url, UnixSocketUrl& out) {
+    if (url.compare(0, kUnixScheme.size(), kUnixScheme) != 0) return false;
+
+    // The socket path is the %-encoded host part; the rest is the request path
+    size_t host_end = url.find('/', kUnixScheme.size());
+    if (host_end == std::string::npos) host_end = url.size();
+    std::string path;
+    for (size_t i = kUnixScheme.size(); i < host_end; ++i) {
+        if (url[i] == '%' && i + 2 < host_end && HexDigit(url[i + 1]) >= 0 && HexDigit(url[i + 2]) >= 0) {
+            path += static_cast<char>(HexDigit(url[i + 1]) * 16 + HexDigit(url[i + 2]));
+            i += 2;
+        } else {
+            path += url[i];
+        }
+    }
+    if (path.empty()) throw std::runtime_error("[local_transport] No socket path in " + url);
+
+    out.socket_path = path;
+    out.http_url = "http://localhost" + (host_end < url.size() ? url.substr(host_end) : std::string("/"));
+    return true;
+}
+
+int ListenUnixSocket(const std::string& path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("[local_transport] Socket path too long: " + path);
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket file left by an earlier server would make bind fail
+    struct stat st{};
+    if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) throw std::runtime_error(SysError("socket"));
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        std::string error = SysError("listening on " + path);
+        close(fd);
+        throw std::runtime_error(error);
+    }
+    return fd;
+}
+
+size_t ShmMinBytes() {
+    const char* env = std::getenv("FL_SHM_MIN_BYTES");
+    return env && *env ? std::strtoull(env, nullptr, 10) : 64 * 1024;
+}
+
+// Unique per process and call, and not guessable from the PID alone
+static std::string NewSegmentName() {
+    static std::atomic<uint64_t> counter{0};
+    static thread_local std::mt19937_64 rng(std::random_device{}());
+    return kShmPrefix + std::to_string(getpid()) + "-" + std::to_string(counter.fetch_add(1)) + "-" +
+           std::to_string(rng() % 1000000000);
+}
+
+SharedBody SharedBody::Create(std::string_view data) {
+    SharedBody body;
+    body.name_ = NewSegmentName();
+    body.size_ = data.size();
+    int fd = shm_open(body.name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) throw std::runtime_error(SysError("shm_open " + body.name_));
+    body.owner_ = true;
+
+    if (ftruncate(fd, static_cast<off_t>(data.size())) != 0) {
+        std::string error = SysError("sizing " + body.name_);
+        close(fd);
+        throw std::runtime_error(error);
+    }
+    if (!data.empty()) {
+        void* map = mmap(nullptr, data.size(), PROT_WRITE, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            std::string error = SysError("mapping " + body.name_);
+            close(fd);
+            throw std::runtime_error(error);
+        }
+        std::memcpy(map, data.data(), data.size());
+        munmap(map, data.size());
+    }
+    close(fd);
+    return body;
+}
+
+SharedBody SharedBody::Open(const std::string& name) {
+    // Only our own segments, so a header cannot point the reader at anything else
+    bool valid = name.size() > kShmPrefix.size() && name.size() < 64 &&
+                 name.compare(0, kShmPrefix.size(), kShmPrefix) == 0;
+    for (size_t i = kShmPrefix.size(); valid && i < name.size(); ++i) {
+        valid = std::isalnum(static_cast<unsigned char>(name[i])) || name[i] == '-';
+    }
+    if (!valid) throw std::runtime_error("[local_transport] Invalid shared-memory segment name " + name);
+
+    SharedBody body;
+    body.name_ = name;
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) throw std::runtime_error(SysError("shm_open " + name));
+    struct stat st{};
+    if (fstat(fd, &st) != 0) {
+        std::string error = SysError("fstat " + name);
+        close(fd);
+        throw std::runtime_error(error);
+    }
+    body.size_ = static_cast<size_t>(st.st_size);
+    if (body.size_ > 0) {
+        body.data_ = mmap(nullptr, body.size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (body.data_ == MAP_FAILED) {
+            body.data_ = nullptr;
+            std::string error = SysError("mapping " + name);
+            close(fd);
+            throw std::runtime_error(error);
+        }
+    }
+    close(fd);
+    body.mapped_ = true;
+    return body;
+}
+
+SharedBody::SharedBody(SharedBody&& other) noexcept {
+    *this = std::move(other);
+}
+
+SharedBody& SharedBody::operator=(SharedBody&& other) noexcept {
+    if (this != &other) {
+        Reset();
+        name_ = std::move(other.name_);
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        owner_ = other.owner_;
+        other.data_ = nullptr;
+        other.size_ = 0;
+        other.mapped_ = false;
+        other.owner_ = false;
+    }
+    return *this;
+}
+
+SharedBody::~SharedBody() {
+    Reset();
+}
+
+void SharedBody::Unlink() {
+    if (!name_.empty()) shm_unlink(name_.c_str());
+    owner_ = false;
+}
+
+void SharedBody::Reset() {
+    if (data_) munmap(data_, size_);
+    if (owner_) shm_unlink(name_.c_str());
+    data_ = nullptr;
+    size_ = 0;
+    mapped_ = false;
+    owner_ = false;
+}
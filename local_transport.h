@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Transport for binaries on the same host as api_server: HTTP over a Unix domain socket
+// instead of loopback TCP, selected by the URL scheme http+unix://<%-encoded socket path>
+// (e.g. FL_SERVER_URL=http+unix://%2Ftmp%2Ffl_server.sock, and the same URL in
+// api_server's `listen` in server_config.txt). Over it, bodies of at least FL_SHM_MIN_BYTES
+// do not go through the socket at all: the sender writes them to a POSIX shared-memory
+// segment and names it in the X-Shm-Body header, and the receiver maps it and parses the
+// JSON in place. Control messages stay inline.
+
+// Names the shared-memory segment holding a request's or response's body
+inline constexpr const char* kShmBodyHeader = "X-Shm-Body";
+// Declared size of that body (admission control charges it like a Content-Length)
+inline constexpr const char* kShmBodyLengthHeader = "X-Shm-Body-Length";
+// Sent by clients that take response bodies from shared memory
+inline constexpr const char* kShmAcceptHeader = "X-Shm-Accept";
+
+struct UnixSocketUrl {
+    std::string socket_path;  // filesystem path of the socket
+    std::string http_url;     // the same request as http://localhost/...
+};
+
+// True, with its parts in `out`, when `url` uses the http+unix scheme
+bool ParseUnixSocketUrl(const std::string& url, UnixSocketUrl& out);
+
+// Non-blocking listening socket at `path`, replacing a stale socket file there
+int ListenUnixSocket(const std::string& path);
+
+// Bodies at least this large go through shared memory (FL_SHM_MIN_BYTES, default 64 KB;
+// 0 sends everything through the socket)
+size_t ShmMinBytes();
+
+// A body in a POSIX shared-memory segment (/dev/shm/fl-*). The side that creates a request
+// segment removes it once the request is done; response segments are removed by the client
+// that reads them, and by the server when that client's connection closes or it never read
+// them in time.
+class SharedBody {
+public:
+    // New segment holding `data`; removed when this is destroyed unless Release()d
+    static SharedBody Create(std::string_view data);
+    // Map the segment a peer named (only fl-* names are accepted)
+    static SharedBody Open(const std::string& name);
+
+    SharedBody(SharedBody&& other) noexcept;
+    SharedBody& operator=(SharedBody&& other) noexcept;
+    SharedBody(const SharedBody&) = delete;
+    SharedBody& operator=(const SharedBody&) = delete;
+    ~SharedBody();
+
+    const std::string& name() const { return name_; }
+    // Contents of an opened segment (empty for created ones, which are not kept mapped)
+    std::string_view view() const {
+        return mapped_ ? std::string_view(static_cast<const char*>(data_), size_) : std::string_view();
+    }
+    size_t size() const { return size_; }
+
+    // Leave the segment for its reader to remove
+    void Release() { owner_ = false; }
+    // Remove the segment's name now; the mapping stays valid
+    void Unlink();
+
+private:
+    SharedBody() = default;
+    void Reset();
+
+    std::string name_;
+    void* data_ = nullptr;
+    size_t size_ = 0;
+    bool mapped_ = false;
+    bool owner_ = false;
+};
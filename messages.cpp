@@ -0,0 +1,341 @@
+#include "messages.h"
+
+#include <charconv>
+#include <cstring>
+
+JsonReader::JsonReader(std::string_view text) : text_(text) {
+    first_.reserve(8);
+    path_.reserve(8);
+}
+
+void JsonReader::Fail(const std::string& what) const {
+    std::string where;
+    for (std::string_view name : path_) {
+        if (!where.empty()) where += '.';
+        where += name;
+    }
+    throw MessageError(where.empty() ? what : where + ": " + what);
+}
+
+void JsonReader::Missing(std::string_view field) const {
+    std::string where;
+    for (std::string_view name : path_) {
+        where += name;
+        where += '.';
+    }
+    throw MessageError("missing field " + where + std::string(field));
+}
+
+// Next non-whitespace character, '\0' at the end of the text
+char JsonReader::Peek() {
+    while (pos_ < text_.size()) {
+        char c = text_[pos_];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') return c;
+        ++pos_;
+    }
+    return '\0';
+}
+
+void JsonReader::Expect(char c) {
+    if (Peek() != c) {
+        if (pos_ >= text_.size()) Fail(std::string("expected '") + c + "' at end of message");
+        Fail(std::string("expected '") + c + "' at offset " + std::to_string(pos_));
+    }
+    ++pos_;
+}
+
+void JsonReader::BeginObject() {
+    if (Peek() != '{') Fail("expected an object");
+    ++pos_;
+    first_.push_back(true);
+}
+
+bool JsonReader::NextKey(std::string_view& key) {
+    if (Peek() == '}') {
+        ++pos_;
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back()) Expect(',');
+    first_.back() = false;
+    if (Peek() != '"') Fail("expected a field name at offset " + std::to_string(pos_));
+    key = ReadString(key_scratch_);
+    Expect(':');
+    return true;
+}
+
+void JsonReader::BeginArray() {
+    if (Peek() != '[') Fail("expected an array");
+    ++pos_;
+    first_.push_back(true);
+}
+
+bool JsonReader::NextElement() {
+    if (Peek() == ']') {
+        ++pos_;
+        first_.pop_back();
+        return false;
+    }
+    if (!first_.back()) Expect(',');
+    first_.back() = false;
+    return true;
+}
+
+void JsonReader::End() {
+    if (Peek() != '\0') Fail("unexpected characters after the message at offset " + std::to_string(pos_));
+}
+
+bool JsonReader::ReadNull() {
+    if (Peek() != 'n') return false;
+    if (text_.substr(pos_, 4) != "null") Fail("invalid literal");
+    pos_ += 4;
+    return true;
+}
+
+bool JsonReader::ReadBool() {
+    char c = Peek();
+    if (c == 't' && text_.substr(pos_, 4) == "true") {
+        pos_ += 4;
+        return true;
+    }
+    if (c == 'f' && text_.substr(pos_, 5) == "false") {
+        pos_ += 5;
+        return false;
+    }
+    Fail("expected a boolean");
+}
+
+std::string_view JsonReader::NumberToken() {
+    Peek();
+    size_t start = pos_;
+    while (pos_ < text_.size()) {
+        char c = text_[pos_];
+        if ((c < '0' || c > '9') && c != '-' && c != '+' && c != '.' && c != 'e' && c != 'E') break;
+        ++pos_;
+    }
+    return text_.substr(start, pos_ - start);
+}
+
+int64_t JsonReader::ReadInt() {
+    std::string_view token = NumberToken();
+    int64_t value = 0;
+    auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || ec != std::errc() || end != token.data() + token.size()) Fail("expected an integer");
+    return value;
+}
+
+uint64_t JsonReader::ReadUint() {
+    std::string_view token = NumberToken();
+    uint64_t value = 0;
+    auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || ec != std::errc() || end != token.data() + token.size()) {
+        Fail("expected a non-negative integer");
+    }
+    return value;
+}
+
+double JsonReader::ReadDouble() {
+    std::string_view token = NumberToken();
+    double value = 0;
+    auto [end, ec] = std::from_chars(token.data(), token.data() + token.size(), value);
+    if (token.empty() || ec != std::errc() || end != token.data() + token.size()) Fail("expected a number");
+    return value;
+}
+
+// Append code point `cp` as UTF-8
+static void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+std::string_view JsonReader::ReadString(std::string& scratch) {
+    if (Peek() != '"') Fail("expected a string");
+    size_t start = ++pos_;
+    // Base64 payloads never contain escapes: find the closing quote and return a view
+    const char* begin = text_.data() + start;
+    size_t rest = text_.size() - start;
+    const char* quote = static_cast<const char*>(std::memchr(begin, '"', rest));
+    if (!quote) Fail("unterminated string");
+    if (!std::memchr(begin, '\\', quote - begin)) {
+        pos_ = quote - text_.data() + 1;
+        return std::string_view(begin, quote - begin);
+    }
+
+    scratch.clear();
+    auto hex4 = [&]() -> uint32_t {
+        if (pos_ + 4 > text_.size()) Fail("truncated unicode escape");
+        uint32_t value = 0;
+        auto [end, ec] = std::from_chars(text_.data() + pos_, text_.data() + pos_ + 4, value, 16);
+        if (ec != std::errc() || end != text_.data() + pos_ + 4) Fail("invalid unicode escape");
+        pos_ += 4;
+        return value;
+    };
+    while (true) {
+        if (pos_ >= text_.size()) Fail("unterminated string");
+        char c = text_[pos_++];
+        if (c == '"') break;
+        if (c != '\\') {
+            scratch += c;
+            continue;
+        }
+        if (pos_ >= text_.size()) Fail("unterminated string");
+        switch (text_[pos_++]) {
+            case '"': scratch += '"'; break;
+            case '\\': scratch += '\\'; break;
+            case '/': scratch += '/'; break;
+            case 'b': scratch += '\b'; break;
+            case 'f': scratch += '\f'; break;
+            case 'n': scratch += '\n'; break;
+            case 'r': scratch += '\r'; break;
+            case 't': scratch += '\t'; break;
+            case 'u': {
+                uint32_t cp = hex4();
+                if (cp >= 0xD800 && cp < 0xDC00 && text_.substr(pos_, 2) == "\\u") {
+                    pos_ += 2;
+                    uint32_t low = hex4();
+                    if (low < 0xDC00 || low >= 0xE000) Fail("invalid surrogate pair");
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+                AppendUtf8(scratch, cp);
+                break;
+            }
+            default: Fail("invalid escape");
+        }
+    }
+    return scratch;
+}
+
+void JsonReader::SkipString() {
+    size_t i = pos_ + 1;
+    while (true) {
+        const char* quote = static_cast<const char*>(std::memchr(text_.data() + i, '"', text_.size() - i));
+        if (!quote) Fail("unterminated string");
+        size_t q = quote - text_.data();
+        // The quote closes the string unless an odd run of backslashes precedes it
+        size_t backslashes = 0;
+        while (q - backslashes > i && text_[q - backslashes - 1] == '\\') ++backslashes;
+        i = q + 1;
+        if (backslashes % 2 == 0) break;
+    }
+    pos_ = i;
+}
+
+std::string_view JsonReader::SkipValue() {
+    char c = Peek();
+    size_t start = pos_;
+    if (c == '"') {
+        SkipString();
+    } else if (c == '{' || c == '[') {
+        size_t depth = 0;
+        do {
+            c = text_[pos_];
+            if (c == '"') {
+                SkipString();
+                continue;
+            }
+            if (c == '{' || c == '[') ++depth;
+            else if (c == '}' || c == ']') --depth;
+            ++pos_;
+        } while (depth > 0 && pos_ < text_.size());
+        if (depth > 0) Fail("unterminated " + std::string(text_[start] == '{' ? "object" : "array"));
+    } else if (c == 't' || c == 'f') {
+        ReadBool();
+    } else if (c == 'n') {
+        ReadNull();
+    } else if (NumberToken().empty()) {
+        Fail(pos_ >= text_.size() ? "expected a value at end of message"
+                                  : "expected a value at offset " + std::to_string(pos_));
+    }
+    return text_.substr(start, pos_ - start);
+}
+
+void JsonWriter::Separator() {
+    if (after_key_) {
+        after_key_ = false;
+        return;
+    }
+    if (first_.empty()) return;
+    if (!first_.back()) out_ += ',';
+    first_.back() = false;
+}
+
+void JsonWriter::BeginObject() {
+    Separator();
+    out_ += '{';
+    first_.push_back(true);
+}
+
+void JsonWriter::Key(std::string_view key) {
+    String(key);
+    out_ += ':';
+    after_key_ = true;
+}
+
+void JsonWriter::EndObject() {
+    out_ += '}';
+    first_.pop_back();
+}
+
+void JsonWriter::BeginArray() {
+    Separator();
+    out_ += '[';
+    first_.push_back(true);
+}
+
+void JsonWriter::EndArray() {
+    out_ += ']';
+    first_.pop_back();
+}
+
+void JsonWriter::String(std::string_view value) {
+    Separator();
+    out_ += '"';
+    // Base64 and IDs need no escaping and are copied in one go
+    size_t plain = 0;
+    while (plain < value.size()) {
+        unsigned char c = value[plain];
+        if (c == '"' || c == '\\' || c < 0x20) break;
+        ++plain;
+    }
+    out_.append(value.data(), plain);
+    for (size_t i = plain; i < value.size(); ++i) {
+        unsigned char c = value[i];
+        switch (c) {
+            case '"': out_ += "\\\""; break;
+            case '\\': out_ += "\\\\"; break;
+            case '\b': out_ += "\\b"; break;
+            case '\f': out_ += "\\f"; break;
+            case '\n': out_ += "\\n"; break;
+            case '\r': out_ += "\\r"; break;
+            case '\t': out_ += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    static const char digits[] = "0123456789abcdef";
+                    out_ += "\\u00";
+                    out_ += digits[c >> 4];
+                    out_ += digits[c & 0xF];
+                } else {
+                    out_ += static_cast<char>(c);
+                }
+        }
+    }
+    out_ += '"';
+}
+
+void JsonWriter::Raw(std::string_view value) {
+    Separator();
+    out_.append(value);
+}
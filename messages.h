@@ -0,0 +1,656 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Typed REST messages shared by api_server and its clients. Each message is a struct whose
+// fields are listed once with FL_MESSAGE; ParseMessage and WriteMessage are generated from
+// that list at compile time. Parsing reads the JSON text in one pass without building a DOM,
+// checks that every field that is not std::optional is present and of the right type
+// (MessageError names the field otherwise), skips unknown fields, and leaves Base64 payloads
+// (Blob) as views into the text instead of copying them. Wire names are the member names.
+
+using json = nlohmann::json;
+
+// A message that is not valid JSON, lacks a required field or has one of the wrong type
+class MessageError : public std::runtime_error {
+public:
+    using std::runtime_error::runtime_error;
+};
+
+// Large Base64 payload (ciphertexts, keys): a view into the text it was parsed from, valid
+// while that text lives, or an owned string in messages built to be sent
+class Blob {
+public:
+    Blob() = default;
+    Blob(std::string owned) : owned_(std::move(owned)), owning_(true) {}
+    static Blob View(std::string_view text) {
+        Blob blob;
+        blob.view_ = text;
+        return blob;
+    }
+
+    std::string_view view() const { return owning_ ? std::string_view(owned_) : view_; }
+    std::string str() const { return std::string(view()); }
+    size_t size() const { return view().size(); }
+    bool empty() const { return view().empty(); }
+
+private:
+    std::string_view view_;
+    std::string owned_;
+    bool owning_ = false;
+};
+
+// One pass over a JSON text; every read throws MessageError on anything unexpected
+class JsonReader {
+public:
+    explicit JsonReader(std::string_view text);
+
+    // Containers: the Next* calls step past separators and return false at the closing bracket
+    void BeginObject();
+    bool NextKey(std::string_view& key);
+    void BeginArray();
+    bool NextElement();
+    // Only whitespace may follow the top-level value
+    void End();
+
+    bool ReadNull();  // consumes a null if one comes next
+    bool ReadBool();
+    int64_t ReadInt();
+    uint64_t ReadUint();
+    double ReadDouble();
+    // A string's text, viewed in place when it has no escapes, else unescaped into `scratch`
+    std::string_view ReadString(std::string& scratch);
+    // Raw text of the next value, whatever it is
+    std::string_view SkipValue();
+
+    // Field path for error messages ("metadata.client_id")
+    void Enter(std::string_view name) { path_.push_back(name); }
+    void Leave() { path_.pop_back(); }
+    [[noreturn]] void Fail(const std::string& what) const;
+    [[noreturn]] void Missing(std::string_view field) const;
+
+private:
+    char Peek();
+    void Expect(char c);
+    void SkipString();
+    std::string_view NumberToken();
+
+    std::string_view text_;
+    size_t pos_ = 0;
+    std::vector<bool> first_;  // per open container: no element read yet
+    std::vector<std::string_view> path_;
+    std::string key_scratch_;
+};
+
+// Appends JSON to a string; commas and colons are placed automatically
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : out_(out) {}
+
+    void BeginObject();
+    void Key(std::string_view key);
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    void String(std::string_view value);
+    // Pre-encoded JSON (numbers, literals, dumped DOM values)
+    void Raw(std::string_view value);
+
+private:
+    void Separator();
+
+    std::string& out_;
+    std::vector<bool> first_;
+    bool after_key_ = false;
+};
+
+template <typename T, typename M>
+struct MessageField {
+    std::string_view name;
+    M T::*member;
+};
+
+// Field list of a message, specialized by FL_MESSAGE
+template <typename T>
+struct MessageFields;
+
+template <typename T>
+concept MessageType = requires { MessageFields<T>::fields; };
+
+#define FL_FIELD(name) MessageField<Self, decltype(Self::name)>{#name, &Self::name}
+#define FL_MESSAGE(Type, ...)                                        \
+    template <>                                                      \
+    struct MessageFields<Type> {                                     \
+        using Self = Type;                                           \
+        static constexpr auto fields = std::make_tuple(__VA_ARGS__); \
+    }
+
+namespace message_detail {
+
+template <typename T>
+struct IsOptional : std::false_type {};
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <typename T, typename F, size_t... I>
+void ForEachField(F&& f, std::index_sequence<I...>) {
+    (f(std::get<I>(MessageFields<T>::fields), I), ...);
+}
+
+template <typename T, typename F>
+void ForEachField(F&& f) {
+    ForEachField<T>(f, std::make_index_sequence<std::tuple_size_v<decltype(MessageFields<T>::fields)>>{});
+}
+
+}  // namespace message_detail
+
+// Reading: one overload per field type
+
+inline void ReadValue(JsonReader& r, std::string& out) {
+    std::string scratch;
+    out = r.ReadString(scratch);
+}
+
+inline void ReadValue(JsonReader& r, Blob& out) {
+    std::string scratch;
+    std::string_view text = r.ReadString(scratch);
+    // Escaped strings were unescaped into scratch; everything else stays a view
+    out = text.data() == scratch.data() ? Blob(std::move(scratch)) : Blob::View(text);
+}
+
+inline void ReadValue(JsonReader& r, bool& out) {
+    out = r.ReadBool();
+}
+
+template <typename T>
+    requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+void ReadValue(JsonReader& r, T& out) {
+    if constexpr (std::is_signed_v<T>) {
+        int64_t value = r.ReadInt();
+        if (value < std::numeric_limits<T>::min() || value > std::numeric_limits<T>::max()) r.Fail("integer out of range");
+        out = static_cast<T>(value);
+    } else {
+        uint64_t value = r.ReadUint();
+        if (value > std::numeric_limits<T>::max()) r.Fail("integer out of range");
+        out = static_cast<T>(value);
+    }
+}
+
+inline void ReadValue(JsonReader& r, double& out) {
+    out = r.ReadDouble();
+}
+
+// Free-form fields (e.g. plain layers) keep the generic DOM
+inline void ReadValue(JsonReader& r, json& out) {
+    std::string_view text = r.SkipValue();
+    try {
+        out = json::parse(text);
+    } catch (const json::exception& e) {
+        r.Fail(e.what());
+    }
+}
+
+template <typename T>
+void ReadValue(JsonReader& r, std::optional<T>& out) {
+    if (r.ReadNull()) {
+        out.reset();
+        return;
+    }
+    ReadValue(r, out.emplace());
+}
+
+template <typename T>
+void ReadValue(JsonReader& r, std::vector<T>& out) {
+    out.clear();
+    r.BeginArray();
+    while (r.NextElement()) ReadValue(r, out.emplace_back());
+}
+
+template <typename T>
+void ReadValue(JsonReader& r, std::map<std::string, T>& out) {
+    out.clear();
+    r.BeginObject();
+    std::string_view key;
+    while (r.NextKey(key)) {
+        T& value = out[std::string(key)];
+        r.Enter(key);
+        ReadValue(r, value);
+        r.Leave();
+    }
+}
+
+template <MessageType T>
+void ReadValue(JsonReader& r, T& msg) {
+    static_assert(std::tuple_size_v<decltype(MessageFields<T>::fields)> <= 64, "too many fields");
+    uint64_t seen = 0;
+    r.BeginObject();
+    std::string_view key;
+    while (r.NextKey(key)) {
+        bool known = false;
+        message_detail::ForEachField<T>([&](const auto& field, size_t i) {
+            if (known || field.name != key) return;
+            known = true;
+            seen |= uint64_t{1} << i;
+            r.Enter(field.name);
+            ReadValue(r, msg.*field.member);
+            r.Leave();
+        });
+        if (!known) r.SkipValue();
+    }
+    message_detail::ForEachField<T>([&](const auto& field, size_t i) {
+        using M = std::remove_cvref_t<decltype(msg.*field.member)>;
+        if (!message_detail::IsOptional<M>::value && !(seen >> i & 1)) r.Missing(field.name);
+    });
+}
+
+// Writing: one overload per field type
+
+inline void WriteValue(JsonWriter& w, std::string_view value) {
+    w.String(value);
+}
+
+inline void WriteValue(JsonWriter& w, const std::string& value) {
+    w.String(value);
+}
+
+inline void WriteValue(JsonWriter& w, const Blob& value) {
+    w.String(value.view());
+}
+
+inline void WriteValue(JsonWriter& w, bool value) {
+    w.Raw(value ? "true" : "false");
+}
+
+template <typename T>
+    requires(std::is_integral_v<T> && !std::is_same_v<T, bool>)
+void WriteValue(JsonWriter& w, T value) {
+    w.Raw(std::to_string(value));
+}
+
+inline void WriteValue(JsonWriter& w, double value) {
+    w.Raw(json(value).dump());
+}
+
+inline void WriteValue(JsonWriter& w, const json& value) {
+    w.Raw(value.dump());
+}
+
+template <typename T>
+void WriteValue(JsonWriter& w, const std::optional<T>& value) {
+    if (value) WriteValue(w, *value);
+    else w.Raw("null");
+}
+
+template <typename T>
+void WriteValue(JsonWriter& w, const std::vector<T>& values) {
+    w.BeginArray();
+    for (const T& value : values) WriteValue(w, value);
+    w.EndArray();
+}
+
+template <typename T>
+void WriteValue(JsonWriter& w, const std::map<std::string, T>& values) {
+    w.BeginObject();
+    for (const auto& [key, value] : values) {
+        w.Key(key);
+        WriteValue(w, value);
+    }
+    w.EndObject();
+}
+
+// Optional fields that are not set are left out
+template <MessageType T>
+void WriteValue(JsonWriter& w, const T& msg) {
+    w.BeginObject();
+    message_detail::ForEachField<T>([&](const auto& field, size_t) {
+        const auto& value = msg.*field.member;
+        if constexpr (message_detail::IsOptional<std::remove_cvref_t<decltype(value)>>::value) {
+            if (!value) return;
+        }
+        w.Key(field.name);
+        WriteValue(w, value);
+    });
+    w.EndObject();
+}
+
+// Bytes of string payload in a value, to size the output buffer once
+inline size_t PayloadBytes(const std::string& value) { return value.size(); }
+inline size_t PayloadBytes(const Blob& value) { return value.size(); }
+template <typename T>
+size_t PayloadBytes(const T&) { return 0; }
+template <typename T>
+size_t PayloadBytes(const std::optional<T>& value) { return value ? PayloadBytes(*value) : 0; }
+template <typename T>
+size_t PayloadBytes(const std::vector<T>& values) {
+    size_t bytes = 0;
+    for (const T& value : values) bytes += PayloadBytes(value);
+    return bytes;
+}
+template <typename T>
+size_t PayloadBytes(const std::map<std::string, T>& values) {
+    size_t bytes = 0;
+    for (const auto& [key, value] : values) bytes += key.size() + PayloadBytes(value);
+    return bytes;
+}
+template <MessageType T>
+size_t PayloadBytes(const T& msg) {
+    size_t bytes = 0;
+    message_detail::ForEachField<T>([&](const auto& field, size_t) { bytes += PayloadBytes(msg.*field.member); });
+    return bytes;
+}
+
+// Parse a message (or any supported field type) from JSON text; Blob fields view `text`
+template <typename T>
+T ParseMessage(std::string_view text) {
+    JsonReader reader(text);
+    T msg{};
+    ReadValue(reader, msg);
+    reader.End();
+    return msg;
+}
+
+template <typename T>
+std::string WriteMessage(const T& msg) {
+    std::string out;
+    out.reserve(PayloadBytes(msg) + 256);
+    JsonWriter writer(out);
+    WriteValue(writer, msg);
+    return out;
+}
+
+// ---- Messages ----
+
+// POST /c2s/public_key (eval keys only of the kinds the client generates; the threshold
+// joint key lists the clients whose shares it combines)
+struct PublicKeyUpload {
+    std::string client_id;
+    Blob public_key;
+    std::optional<Blob> eval_mult_key;
+    std::optional<Blob> eval_sum_key;
+    std::optional<std::vector<std::string>> participants;
+};
+FL_MESSAGE(PublicKeyUpload, FL_FIELD(client_id), FL_FIELD(public_key), FL_FIELD(eval_mult_key), FL_FIELD(eval_sum_key),
+           FL_FIELD(participants));
+
+// GET /s2c/public_key response
+struct PublicKeyResponse {
+    Blob public_key;
+    std::optional<Blob> eval_mult_key;
+    std::optional<Blob> eval_sum_key;
+};
+FL_MESSAGE(PublicKeyResponse, FL_FIELD(public_key), FL_FIELD(eval_mult_key), FL_FIELD(eval_sum_key));
+
+// POST /c2s/rekey
+struct RekeyUpload {
+    std::string from_client_id;
+    std::string to_client_id;
+    Blob rekey;
+};
+FL_MESSAGE(RekeyUpload, FL_FIELD(from_client_id), FL_FIELD(to_client_id), FL_FIELD(rekey));
+
+// GET /s2c/rekey response
+struct RekeyResponse {
+    std::string from;
+    std::string to;
+    Blob rekey;
+};
+FL_MESSAGE(RekeyResponse, FL_FIELD(from), FL_FIELD(to), FL_FIELD(rekey));
+
+// POST /c2s/params; part/parts for multipart uploads, the layout with the last part
+struct ParamsMetadata {
+    std::string client_id;
+    int round = 0;
+    std::optional<std::string> model_name;
+    std::optional<std::string> trace_id;
+    std::optional<size_t> part;
+    std::optional<size_t> parts;
+};
+FL_MESSAGE(ParamsMetadata, FL_FIELD(client_id), FL_FIELD(round), FL_FIELD(model_name), FL_FIELD(trace_id),
+           FL_FIELD(part), FL_FIELD(parts));
+
+struct ParamsData {
+    Blob params;
+    std::optional<std::vector<size_t>> chunk_counts;
+    std::optional<std::vector<size_t>> orig_sizes;
+    std::optional<json> plain_layers;  // { "<index>": "base64" }
+};
+FL_MESSAGE(ParamsData, FL_FIELD(params), FL_FIELD(chunk_counts), FL_FIELD(orig_sizes), FL_FIELD(plain_layers));
+
+struct ParamsUpload {
+    ParamsMetadata metadata;
+    ParamsData data;
+};
+FL_MESSAGE(ParamsUpload, FL_FIELD(metadata), FL_FIELD(data));
+
+// POST /c2s/server/agg_params: aggregates by client ID ("*" = every client); async
+// versions add the layout and the buffered params they consumed
+struct AggregateUpload {
+    int round = 0;
+    std::optional<std::string> trace_id;
+    std::map<std::string, Blob> agg_params;
+    std::optional<json> plain_layers;
+    std::optional<std::vector<size_t>> chunk_counts;
+    std::optional<std::vector<size_t>> orig_sizes;
+    std::optional<std::map<std::string, int>> consumed;
+    std::optional<size_t> part;
+    std::optional<size_t> parts;
+};
+FL_MESSAGE(AggregateUpload, FL_FIELD(round), FL_FIELD(trace_id), FL_FIELD(agg_params), FL_FIELD(plain_layers),
+           FL_FIELD(chunk_counts), FL_FIELD(orig_sizes), FL_FIELD(consumed), FL_FIELD(part), FL_FIELD(parts));
+
+// GET /s2c/agg_params response; parts after the first carry only the ciphertexts
+struct AggregateMetadata {
+    std::string client_id;
+    int round = 0;
+    std::optional<size_t> part;
+};
+FL_MESSAGE(AggregateMetadata, FL_FIELD(client_id), FL_FIELD(round), FL_FIELD(part));
+
+struct AggregateData {
+    Blob agg_params;
+    std::optional<size_t> parts;
+    std::optional<std::vector<size_t>> chunk_counts;
+    std::optional<std::vector<size_t>> orig_sizes;
+    std::optional<json> plain_layers;
+};
+FL_MESSAGE(AggregateData, FL_FIELD(agg_params), FL_FIELD(parts), FL_FIELD(chunk_counts), FL_FIELD(orig_sizes),
+           FL_FIELD(plain_layers));
+
+struct AggregateDownload {
+    AggregateMetadata metadata;
+    AggregateData data;
+};
+FL_MESSAGE(AggregateDownload, FL_FIELD(metadata), FL_FIELD(data));
+
+// POST /c2s/partial_dec (threshold mode)
+struct PartialDecryptionUpload {
+    std::string client_id;
+    int round = 0;
+    Blob partial;
+};
+FL_MESSAGE(PartialDecryptionUpload, FL_FIELD(client_id), FL_FIELD(round), FL_FIELD(partial));
+
+// GET /s2c/partial_dec response; data only once every joint key holder's partial is in
+struct PartialDecryptionsMetadata {
+    std::string client_id;
+    int round = 0;
+    std::vector<std::string> expected;
+    std::vector<std::string> received;
+};
+FL_MESSAGE(PartialDecryptionsMetadata, FL_FIELD(client_id), FL_FIELD(round), FL_FIELD(expected), FL_FIELD(received));
+
+struct PartialDecryptionsData {
+    std::map<std::string, Blob> partials;
+    std::vector<std::string> clients;  // the clients that uploaded params
+    std::vector<size_t> chunk_counts;
+    std::vector<size_t> orig_sizes;
+    std::optional<json> plain_layers;
+};
+FL_MESSAGE(PartialDecryptionsData, FL_FIELD(partials), FL_FIELD(clients), FL_FIELD(chunk_counts), FL_FIELD(orig_sizes),
+           FL_FIELD(plain_layers));
+
+struct PartialDecryptionsResponse {
+    PartialDecryptionsMetadata metadata;
+    std::optional<PartialDecryptionsData> data;
+};
+FL_MESSAGE(PartialDecryptionsResponse, FL_FIELD(metadata), FL_FIELD(data));
+
+// POST /c2s/partial_sum (edge aggregators; sum is empty for an empty shard)
+struct PartialSumUpload {
+    std::string edge_id;
+    int round = 0;
+    std::optional<std::string> trace_id;
+    std::vector<std::string> clients;
+    Blob sum;
+    std::optional<json> plain_sum;
+};
+FL_MESSAGE(PartialSumUpload, FL_FIELD(edge_id), FL_FIELD(round), FL_FIELD(trace_id), FL_FIELD(clients), FL_FIELD(sum),
+           FL_FIELD(plain_sum));
+
+// GET /s2c/partial_sums response; data only once the sums cover every client, and never
+// with summary=1
+struct PartialSumsMetadata {
+    int round = 0;
+    std::vector<std::string> expected;
+    std::vector<std::string> covered;
+    bool complete = false;
+};
+FL_MESSAGE(PartialSumsMetadata, FL_FIELD(round), FL_FIELD(expected), FL_FIELD(covered), FL_FIELD(complete));
+
+struct PartialSumEntry {
+    std::vector<std::string> clients;
+    Blob sum;
+    std::optional<json> plain_sum;
+};
+FL_MESSAGE(PartialSumEntry, FL_FIELD(clients), FL_FIELD(sum), FL_FIELD(plain_sum));
+
+struct PartialSumsData {
+    std::map<std::string, PartialSumEntry> edges;
+};
+FL_MESSAGE(PartialSumsData, FL_FIELD(edges));
+
+struct PartialSumsResponse {
+    PartialSumsMetadata metadata;
+    std::optional<PartialSumsData> data;
+};
+FL_MESSAGE(PartialSumsResponse, FL_FIELD(metadata), FL_FIELD(data));
+
+// GET /s2c/async_buffer response; data only once min_updates are buffered
+struct AsyncBufferMetadata {
+    std::string hub;
+    int version = 0;
+    std::vector<std::string> clients;
+    size_t buffered = 0;
+    size_t stale = 0;
+};
+FL_MESSAGE(AsyncBufferMetadata, FL_FIELD(hub), FL_FIELD(version), FL_FIELD(clients), FL_FIELD(buffered),
+           FL_FIELD(stale));
+
+// A client's latest params not yet aggregated, with the round it trained from
+struct BufferedUpdate {
+    int round = 0;
+    Blob params;
+    std::vector<size_t> chunk_counts;
+    std::vector<size_t> orig_sizes;
+    std::optional<size_t> parts;
+    std::optional<json> plain_layers;
+};
+FL_MESSAGE(BufferedUpdate, FL_FIELD(round), FL_FIELD(params), FL_FIELD(chunk_counts), FL_FIELD(orig_sizes),
+           FL_FIELD(parts), FL_FIELD(plain_layers));
+
+struct AsyncBufferData {
+    std::map<std::string, BufferedUpdate> updates;
+};
+FL_MESSAGE(AsyncBufferData, FL_FIELD(updates));
+
+struct AsyncBufferResponse {
+    AsyncBufferMetadata metadata;
+    std::optional<AsyncBufferData> data;
+};
+FL_MESSAGE(AsyncBufferResponse, FL_FIELD(metadata), FL_FIELD(data));
+
+// POST /c2s/result
+struct ResultUpload {
+    std::string client_id;
+    int round = 0;
+    double accuracy = 0;
+    std::string model;
+};
+FL_MESSAGE(ResultUpload, FL_FIELD(client_id), FL_FIELD(round), FL_FIELD(accuracy), FL_FIELD(model));
+
+// GET /s2c/job response: the job's configuration and progress
+struct JobResponse {
+    std::string job;
+    std::string context_fingerprint;
+    std::string aggregation_mode;
+    int latest_round = 0;
+    std::vector<std::string> clients;
+    size_t clients_per_round = 0;
+    int64_t round_deadline_seconds = 0;
+    int keep_rounds = 0;
+    double aggregation_weight = 1;
+};
+FL_MESSAGE(JobResponse, FL_FIELD(job), FL_FIELD(context_fingerprint), FL_FIELD(aggregation_mode),
+           FL_FIELD(latest_round), FL_FIELD(clients), FL_FIELD(clients_per_round), FL_FIELD(round_deadline_seconds),
+           FL_FIELD(keep_rounds), FL_FIELD(aggregation_weight));
+
+// GET /s2c/model_version response (async mode: latest round with an aggregate for the client)
+struct ModelVersionResponse {
+    std::string client_id;
+    int version = 0;
+};
+FL_MESSAGE(ModelVersionResponse, FL_FIELD(client_id), FL_FIELD(version));
+
+// POST /c2s/workers/acquire (want 0 or absent = the job's share divided among `holders`
+// aggregators running at once, 1 if absent) and its response
+struct WorkerAcquireRequest {
+    std::optional<size_t> want;
+    std::optional<size_t> holders;
+};
+FL_MESSAGE(WorkerAcquireRequest, FL_FIELD(want), FL_FIELD(holders));
+
+struct WorkerLeaseResponse {
+    std::string lease_id;
+    size_t threads = 0;
+    size_t pool = 0;
+    size_t active_jobs = 1;
+};
+FL_MESSAGE(WorkerLeaseResponse, FL_FIELD(lease_id), FL_FIELD(threads), FL_FIELD(pool), FL_FIELD(active_jobs));
+
+// POST /c2s/workers/release
+struct WorkerReleaseRequest {
+    std::string lease_id;
+};
+FL_MESSAGE(WorkerReleaseRequest, FL_FIELD(lease_id));
+
+// GET /s2c/round_plan response (client_id/selected when asked for one client)
+struct RoundPlanResponse {
+    int round = 0;
+    bool sampling = false;
+    std::vector<std::string> participants;
+    std::vector<std::string> uploaded;
+    int64_t deadline_unix_ms = 0;
+    int64_t now_unix_ms = 0;
+    std::optional<std::string> client_id;
+    std::optional<bool> selected;
+};
+FL_MESSAGE(RoundPlanResponse, FL_FIELD(round), FL_FIELD(sampling), FL_FIELD(participants), FL_FIELD(uploaded),
+           FL_FIELD(deadline_unix_ms), FL_FIELD(now_unix_ms), FL_FIELD(client_id), FL_FIELD(selected));
+
+// {"status": "..."} replies to uploads
+struct StatusResponse {
+    std::string status;
+};
+FL_MESSAGE(StatusResponse, FL_FIELD(status));
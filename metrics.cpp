@@ -0,0 +1,224 @@
+#include "metrics.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+// Recording is lock-free on the hot path: every thread owns a shard of plain
+// atomics that only it writes (relaxed load+store, no RMW), and a scrape sums
+// all shards. The registry mutex is only taken once per thread to publish its shard.
+
+static constexpr size_t kMaxEndpoints = 32;
+static constexpr size_t kOtherSlot = 0;
+
+// Latency histogram upper bounds in seconds (the +Inf bucket is implicit)
+static constexpr std::array<double, 12> kLatencyBounds = {
+    0.0001, 0.0005, 0.001, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 5.0
+};
+static constexpr size_t kNumBuckets = kLatencyBounds.size() + 1;
+
+// Status codes reported individually; anything else lands in the last slot
+static constexpr std::array<int, 7> kStatusCodes = {200, 400, 404, 413, 429, 500, 503};
+static constexpr size_t kNumStatus = kStatusCodes.size() + 1;
+
+struct EndpointCounters {
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> latency_ns_sum{0};
+    std::atomic<uint64_t> buckets[kNumBuckets] = {};
+    std::atomic<uint64_t> bytes_in{0};
+    std::atomic<uint64_t> bytes_out{0};
+};
+
+struct MetricsShard {
+    EndpointCounters endpoints[kMaxEndpoints];
+    std::atomic<uint64_t> responses[kNumStatus] = {};
+    std::atomic<uint64_t> mutex_wait_ns{0};
+    std::atomic<uint64_t> mutex_contended{0};
+};
+
+// Endpoint names: written only by MetricsRegisterEndpoint (before serving), read afterwards
+static std::array<std::string, kMaxEndpoints> endpoint_names = {"other"};
+static std::atomic<size_t> endpoint_count{1};
+
+static std::mutex registry_mtx;
+static std::vector<std::unique_ptr<MetricsShard>> shards;
+
+// Per-thread request in flight
+struct InFlight {
+    int slot = -1;
+    std::chrono::steady_clock::time_point start;
+};
+static thread_local InFlight in_flight;
+
+// Single-writer increment: only the owning thread writes its shard
+static inline void Bump(std::atomic<uint64_t>& counter, uint64_t delta) {
+    counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+static MetricsShard& LocalShard() {
+    static thread_local MetricsShard* shard = nullptr;
+    if (!shard) {
+        auto owned = std::make_unique<MetricsShard>();
+        shard = owned.get();
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        shards.push_back(std::move(owned));
+    }
+    return *shard;
+}
+
+int MetricsRegisterEndpoint(const std::string& uri) {
+    std::lock_guard<std::mutex> lock(registry_mtx);
+    size_t count = endpoint_count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < count; ++i) {
+        if (endpoint_names[i] == uri) return static_cast<int>(i);
+    }
+    if (count == kMaxEndpoints) return static_cast<int>(kOtherSlot);
+    endpoint_names[count] = uri;
+    endpoint_count.store(count + 1, std::memory_order_release);
+    return static_cast<int>(count);
+}
+
+int MetricsEndpointSlot(const std::string& uri) {
+    size_t count = endpoint_count.load(std::memory_order_acquire);
+    for (size_t i = 1; i < count; ++i) {
+        if (endpoint_names[i] == uri) return static_cast<int>(i);
+    }
+    return static_cast<int>(kOtherSlot);
+}
+
+void MetricsBeginRequest(int endpoint_slot) {
+    in_flight.slot = endpoint_slot;
+    in_flight.start = std::chrono::steady_clock::now();
+}
+
+void MetricsRecordResponse(int status_code, uint64_t bytes_out) {
+    MetricsShard& shard = LocalShard();
+
+    size_t status_idx = kStatusCodes.size();
+    for (size_t i = 0; i < kStatusCodes.size(); ++i) {
+        if (kStatusCodes[i] == status_code) { status_idx = i; break; }
+    }
+    Bump(shard.responses[status_idx], 1);
+
+    size_t slot = in_flight.slot >= 0 ? static_cast<size_t>(in_flight.slot) : kOtherSlot;
+    Bump(shard.endpoints[slot].bytes_out, bytes_out);
+}
+
+void MetricsEndRequest(uint64_t bytes_in) {
+    if (in_flight.slot < 0) return;
+
+    auto elapsed = std::chrono::steady_clock::now() - in_flight.start;
+    uint64_t latency_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    double latency_s = static_cast<double>(latency_ns) / 1e9;
+
+    size_t bucket = kLatencyBounds.size();
+    for (size_t i = 0; i < kLatencyBounds.size(); ++i) {
+        if (latency_s <= kLatencyBounds[i]) { bucket = i; break; }
+    }
+
+    EndpointCounters& ep = LocalShard().endpoints[in_flight.slot];
+    Bump(ep.requests, 1);
+    Bump(ep.latency_ns_sum, latency_ns);
+    Bump(ep.buckets[bucket], 1);
+    Bump(ep.bytes_in, bytes_in);
+
+    in_flight.slot = -1;
+}
+
+void MetricsRecordMutexWait(uint64_t wait_ns) {
+    MetricsShard& shard = LocalShard();
+    Bump(shard.mutex_wait_ns, wait_ns);
+    Bump(shard.mutex_contended, 1);
+}
+
+std::string MetricsRenderPrometheus(const std::map<std::string, size_t>& storage_bytes) {
+    // Sum every thread's shard into one snapshot
+    struct Totals {
+        uint64_t requests = 0, latency_ns_sum = 0, bytes_in = 0, bytes_out = 0;
+        uint64_t buckets[kNumBuckets] = {};
+    };
+    std::array<Totals, kMaxEndpoints> ep{};
+    uint64_t responses[kNumStatus] = {};
+    uint64_t mutex_wait_ns = 0, mutex_contended = 0;
+
+    {
+        std::lock_guard<std::mutex> lock(registry_mtx);
+        for (const auto& shard : shards) {
+            for (size_t e = 0; e < kMaxEndpoints; ++e) {
+                const EndpointCounters& src = shard->endpoints[e];
+                ep[e].requests       += src.requests.load(std::memory_order_relaxed);
+                ep[e].latency_ns_sum += src.latency_ns_sum.load(std::memory_order_relaxed);
+                ep[e].bytes_in       += src.bytes_in.load(std::memory_order_relaxed);
+                ep[e].bytes_out      += src.bytes_out.load(std::memory_order_relaxed);
+                for (size_t b = 0; b < kNumBuckets; ++b)
+                    ep[e].buckets[b] += src.buckets[b].load(std::memory_order_relaxed);
+            }
+            for (size_t s = 0; s < kNumStatus; ++s)
+                responses[s] += shard->responses[s].load(std::memory_order_relaxed);
+            mutex_wait_ns   += shard->mutex_wait_ns.load(std::memory_order_relaxed);
+            mutex_contended += shard->mutex_contended.load(std::memory_order_relaxed);
+        }
+    }
+
+    size_t count = endpoint_count.load(std::memory_order_acquire);
+    std::ostringstream out;
+
+    out << "# HELP fl_http_requests_total Requests handled per endpoint.\n"
+        << "# TYPE fl_http_requests_total counter\n";
+    for (size_t e = 0; e < count; ++e)
+        out << "fl_http_requests_total{endpoint=\"" << endpoint_names[e] << "\"} " << ep[e].requests << "\n";
+
+    out << "# HELP fl_http_request_duration_seconds Request handling latency per endpoint.\n"
+        << "# TYPE fl_http_request_duration_seconds histogram\n";
+    for (size_t e = 0; e < count; ++e) {
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < kNumBuckets; ++b) {
+            cumulative += ep[e].buckets[b];
+            out << "fl_http_request_duration_seconds_bucket{endpoint=\"" << endpoint_names[e] << "\",le=\"";
+            if (b < kLatencyBounds.size()) out << kLatencyBounds[b];
+            else out << "+Inf";
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "fl_http_request_duration_seconds_sum{endpoint=\"" << endpoint_names[e] << "\"} "
+            << static_cast<double>(ep[e].latency_ns_sum) / 1e9 << "\n";
+        out << "fl_http_request_duration_seconds_count{endpoint=\"" << endpoint_names[e] << "\"} "
+            << ep[e].requests << "\n";
+    }
+
+    out << "# HELP fl_http_request_bytes_total Request body bytes received per endpoint.\n"
+        << "# TYPE fl_http_request_bytes_total counter\n";
+    for (size_t e = 0; e < count; ++e)
+        out << "fl_http_request_bytes_total{endpoint=\"" << endpoint_names[e] << "\"} " << ep[e].bytes_in << "\n";
+
+    out << "# HELP fl_http_response_bytes_total Response body bytes sent per endpoint.\n"
+        << "# TYPE fl_http_response_bytes_total counter\n";
+    for (size_t e = 0; e < count; ++e)
+        out << "fl_http_response_bytes_total{endpoint=\"" << endpoint_names[e] << "\"} " << ep[e].bytes_out << "\n";
+
+    out << "# HELP fl_http_responses_total Responses sent per status code.\n"
+        << "# TYPE fl_http_responses_total counter\n";
+    for (size_t s = 0; s < kNumStatus; ++s) {
+        out << "fl_http_responses_total{code=\"";
+        if (s < kStatusCodes.size()) out << kStatusCodes[s];
+        else out << "other";
+        out << "\"} " << responses[s] << "\n";
+    }
+
+    out << "# HELP fl_storage_bytes Bytes currently held in server storage per category.\n"
+        << "# TYPE fl_storage_bytes gauge\n";
+    for (const auto& [category, bytes] : storage_bytes)
+        out << "fl_storage_bytes{category=\"" << category << "\"} " << bytes << "\n";
+
+    out << "# HELP fl_storage_mutex_wait_seconds_total Time spent waiting for the storage mutex.\n"
+        << "# TYPE fl_storage_mutex_wait_seconds_total counter\n"
+        << "fl_storage_mutex_wait_seconds_total " << static_cast<double>(mutex_wait_ns) / 1e9 << "\n";
+    out << "# HELP fl_storage_mutex_contended_total Storage mutex acquisitions that had to wait.\n"
+        << "# TYPE fl_storage_mutex_contended_total counter\n"
+        << "fl_storage_mutex_contended_total " << mutex_contended << "\n";
+
+    return out.str();
+}
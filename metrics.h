@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Register an endpoint (URI) for per-endpoint counters. Call before serving requests.
+// Returns the endpoint slot; unknown URIs share a catch-all "other" slot.
+int MetricsRegisterEndpoint(const std::string& uri);
+
+// Look up the slot of a registered endpoint (or the "other" slot)
+int MetricsEndpointSlot(const std::string& uri);
+
+// Mark the start of a request on the calling thread
+void MetricsBeginRequest(int endpoint_slot);
+
+// Attribute a response (status code + body bytes) to the request in flight on this thread
+void MetricsRecordResponse(int status_code, uint64_t bytes_out);
+
+// Finish the request in flight on this thread, recording latency and request body bytes
+void MetricsEndRequest(uint64_t bytes_in);
+
+// Record time spent waiting for a contended storage mutex
+void MetricsRecordMutexWait(uint64_t wait_ns);
+
+// Render every counter in Prometheus text exposition format.
+// storage_bytes: category → bytes currently held by the storage layer.
+std::string MetricsRenderPrometheus(const std::map<std::string, size_t>& storage_bytes);
+
+// RAII helper: Begin on construction, End on destruction (covers every early return)
+class MetricsRequestScope {
+public:
+    MetricsRequestScope(int endpoint_slot, uint64_t bytes_in) : bytes_in_(bytes_in) {
+        MetricsBeginRequest(endpoint_slot);
+    }
+    ~MetricsRequestScope() { MetricsEndRequest(bytes_in_); }
+
+    MetricsRequestScope(const MetricsRequestScope&) = delete;
+    MetricsRequestScope& operator=(const MetricsRequestScope&) = delete;
+
+private:
+    uint64_t bytes_in_;
+};
@@ -1,112 +1,143 @@
 #include "openfhe.h"
-#include "cryptocontext-ser.h"
-#include "pke/key/key-ser.h"
 
-#include "base64_utils.h"
-#include "serialization_utils.h"
-#include "curl_utils.h"
+#include "aggregation.h"
+#include "config_utils.h"
+#include "parallel_utils.h"
+#include "trace_utils.h"
+#include "cc.h"
 
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <thread>
 #include <vector>
-#include <nlohmann/json.hpp>
 
-using json = nlohmann::json;
 using namespace lbcrypto;
 
-int main() {
+// ./operations [options]                                  aggregate the current round
+// ./operations [options] edge <edge_id> <shard> <shards>  sum one shard of the clients (tree, edge)
+// ./operations [options] root                             combine the edges' partial sums (tree, root)
+// ./operations [options] async [versions=1]               buffered async mode: publish that many model versions
+// ./operations joint_key <client_id>...                   threshold mode setup: combine the clients' key shares
+// Options override server_config.txt / round_counter.txt: --round <n> --threads <n> --hub <client_id>
+int main(int argc, char** argv) {
+    TraceInit("operations");
     try {
-        // Load CryptoContext
-        CryptoContext<DCRTPoly> cc;
-        std::ifstream ccIn("cc.bin", std::ios::binary);
-        if (!ccIn.is_open()) {
-            std::cerr << "[operations] ERROR: could not open cc.bin\n";
-            return 1;
+        auto config = LoadConfig("server_config.txt");
+        SetComputeBudget(LoadComputeBudget(config), "operations");
+
+        // Load CryptoContext (through the registry, keyed by cc.fingerprint)
+        CryptoContext<DCRTPoly> cc = LoadCC("cc.bin");
+
+        if (argc >= 2 && std::string(argv[1]) == "joint_key") {
+            TraceSetId("setup");
+            std::vector<std::string> client_ids(argv + 2, argv + argc);
+            if (client_ids.empty()) {
+                std::cerr << "[operations] Usage: " << argv[0] << " joint_key <client_id>...\n";
+                return 1;
+            }
+            PublishJointKey(cc, client_ids);
+            return 0;
         }
-        Serial::Deserialize(cc, ccIn, SerType::BINARY);
-        ccIn.close();
 
-        // Get current round
-        std::ifstream roundFile("round_counter.txt");
-        if (!roundFile.is_open()) {
-            std::cerr << "[operations] ERROR: could not open round_counter.txt\n";
-            return 1;
+        std::string mode = ConfigString(LoadConfig("cc_config.txt"), "aggregationMode", "pre");
+        std::string hub = ConfigString(config, "aggregationHub", "client1");
+        long thread_setting = ConfigLong(config, "aggregationThreads", 0);
+        int round = -1;
+
+        std::vector<std::string> args;
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if ((arg == "--round" || arg == "--threads" || arg == "--hub") && i + 1 < argc) {
+                std::string value = argv[++i];
+                if (arg == "--round") round = std::stoi(value);
+                else if (arg == "--threads") thread_setting = std::stol(value);
+                else hub = value;
+            } else {
+                args.push_back(arg);
+            }
         }
-        int round;
-        roundFile >> round;
-        roundFile.close();
-
-        std::cout << "[operations] Current round: " << round << "\n";
-
-        // Fetch encrypted params for this round from server
-        std::string params_url = "http://localhost:8000/s2c/params?round=" + std::to_string(round);
-        json all_params = json::parse(HttpGetJson(params_url));
-
-        // Check client params presence
-        if (!all_params.contains("client1") || !all_params.contains("client2")) {
-            std::cerr << "[operations] ERROR: missing client params in response\n";
-            return 1;
+        // Threads come from the server's aggregation pool, shared fairly between its jobs and
+        // leased only once the round's inputs are in, for the compute; aggregationThreads /
+        // --threads caps this aggregation's lease (0 = its slice of the job's share)
+        size_t want = thread_setting > 0 ? ResolveThreadCount(thread_setting) : 0;
+
+        if (!args.empty() && args[0] == "async") {
+            // Round numbers are model versions here, so no round counter is involved
+            TraceSetId("async");
+            AsyncPolicy policy;
+            policy.buffer_size = ConfigLong(config, "asyncBufferSize", 2);
+            policy.max_staleness = ConfigLong(config, "asyncMaxStaleness", 4);
+            policy.staleness_exponent = std::stod(ConfigString(config, "asyncStalenessExponent", "0.5"));
+            long versions = args.size() >= 2 ? std::stol(args[1]) : 1;
+            CheckAsyncJob();
+
+            // Wait for a full buffer without holding threads, then lease them for one version
+            // only, so the pool rebalances between versions and idle polling never expires a lease
+            for (long published = 0; published < versions;) {
+                if (AsyncBufferedUpdates(hub, policy) < policy.buffer_size) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(250));
+                    continue;
+                }
+                WorkerLease lease(want);
+                size_t updates = AsyncAggregateStep(cc, mode, hub, policy, lease.Threads());
+                if (updates == 0) continue;
+                std::cout << "[operations] Published a model version from " << updates << " updates\n";
+                ++published;
+            }
+            return 0;
         }
 
-        // Deserialize ciphertext vectors for each client
-        std::vector<Ciphertext<DCRTPoly>> c1_ct_vec = DeserializeCiphertextVectorFromBase64(all_params["client1"]);
-        std::vector<Ciphertext<DCRTPoly>> c2_ct_vec = DeserializeCiphertextVectorFromBase64(all_params["client2"]);
-
-        // Ensure matching array counts
-        if (c1_ct_vec.size() != c2_ct_vec.size()) {
-            std::cerr << "[operations] ERROR: client ciphertext vector size mismatch: "
-                      << c1_ct_vec.size() << " vs " << c2_ct_vec.size() << "\n";
-            return 1;
+        // Get current round
+        if (round < 0) {
+            std::ifstream roundFile("round_counter.txt");
+            if (!roundFile.is_open()) {
+                std::cerr << "[operations] ERROR: could not open round_counter.txt\n";
+                return 1;
+            }
+            roundFile >> round;
+            roundFile.close();
         }
+        TraceSetId("round-" + std::to_string(round));
 
-        size_t num_ct = c1_ct_vec.size();
-
-        // Fetch proxy re-encryption keys for both directions
-        std::string rk_c2_to_c1_b64 = json::parse(HttpGetJson("http://localhost:8000/s2c/rekey?from=client2&to=client1"))["rekey"];
-        std::string rk_c1_to_c2_b64 = json::parse(HttpGetJson("http://localhost:8000/s2c/rekey?from=client1&to=client2"))["rekey"];
-
-        EvalKey<DCRTPoly> rk_c2_to_c1 = DeserializeEvalKeyFromBase64(rk_c2_to_c1_b64);
-        EvalKey<DCRTPoly> rk_c1_to_c2 = DeserializeEvalKeyFromBase64(rk_c1_to_c2_b64);
+        std::cout << "[operations] Current round: " << round << "\n";
 
-        // Re-encrypt client2's ciphertexts to client1's domain
-        for (size_t i = 0; i < num_ct; i++) {
-            c2_ct_vec[i] = cc->ReEncrypt(c2_ct_vec[i], rk_c2_to_c1);
+        if (!args.empty() && args[0] == "edge") {
+            if (args.size() != 4) {
+                std::cerr << "[operations] Usage: " << argv[0] << " edge <edge_id> <shard> <shards>\n";
+                return 1;
+            }
+            size_t shards = std::stoul(args[3]);
+            WaitForUploads(round);
+            // The round's edges aggregate at once and split the job's share
+            WorkerLease lease(want, shards);
+            size_t clients = EdgeAggregateRound(cc, round, mode, hub, args[1], std::stoul(args[2]), shards,
+                                                lease.Threads());
+            std::cout << "[operations] " << args[1] << " summed " << clients << " clients\n";
+            return 0;
         }
 
-        std::vector<Ciphertext<DCRTPoly>> avg_ct_vec(num_ct);
-        Plaintext half = cc->MakeCKKSPackedPlaintext(std::vector<double>{0.5});
-
-        // Homomorphic averaging in client1 domain
-        for (size_t i = 0; i < num_ct; i++) {
-            auto sum = cc->EvalAdd(c1_ct_vec[i], c2_ct_vec[i]);
-            avg_ct_vec[i] = cc->EvalMult(sum, half);
+        if (!args.empty() && args[0] == "root") {
+            long wait_seconds = ConfigLong(config, "aggregationRootWaitSeconds", 120);
+            WaitForPartialSums(round, wait_seconds);
+            WorkerLease lease(want);
+            size_t clients = RootAggregateRound(cc, round, mode, hub, lease.Threads());
+            std::cout << "[operations] Aggregated " << clients << " clients\n";
+            return 0;
         }
 
-        // Re-encrypt averaged ciphertexts to client2's domain
-        std::vector<Ciphertext<DCRTPoly>> avg_ct_vec_c2(num_ct);
-        for (size_t i = 0; i < num_ct; i++) {
-            avg_ct_vec_c2[i] = cc->ReEncrypt(avg_ct_vec[i], rk_c1_to_c2);
+        if (!args.empty()) {
+            std::cerr << "[operations] Unknown command " << args[0] << "\n";
+            return 1;
         }
 
-        // Serialize and Base64 encode aggregated ciphertext vectors
-        std::string agg_c1 = SerializeCiphertextVectorToBase64(avg_ct_vec);
-        std::string agg_c2 = SerializeCiphertextVectorToBase64(avg_ct_vec_c2);
-
-        // Construct JSON payload for server
-        json payload = {
-            {"round", round},
-            {"agg_params", {
-                {"client1", agg_c1},
-                {"client2", agg_c2}
-            }}
-        };
-
-        // POST aggregated encrypted weights to server
-        std::string post_url = "http://localhost:8000/c2s/server/agg_params";
-        std::string resp = HttpPostJson(post_url, payload.dump());
-
-        std::cout << "[operations] POST response: " << resp << std::endl;
+        // Every client that uploaded this round is aggregated: averaged in the hub's key
+        // domain (pre) or summed under the joint key (threshold)
+        WaitForUploads(round);
+        WorkerLease lease(want);
+        size_t clients = AggregateRound(cc, round, mode, hub, lease.Threads());
+        std::cout << "[operations] Aggregated " << clients << " clients\n";
 
         return 0;
     } catch (const std::exception &e) {
@@ -114,4 +145,3 @@ int main() {
         return 1;
     }
 }
-
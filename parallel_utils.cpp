@@ -0,0 +1,288 @@
+#include "parallel_utils.h"
+
+#include "config_utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+struct BudgetState {
+    ComputeBudget budget;
+    std::string process = "process";
+    std::vector<int> cpus;                     // the budget's cores
+    std::vector<std::vector<int>> node_cpus;   // the budget's cores by NUMA node
+    std::set<std::pair<size_t, size_t>> logged_splits;
+    bool installed = false;                    // SetComputeBudget has run
+};
+
+std::mutex state_mtx;
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+std::vector<int> ParseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    std::istringstream iss(list);
+    std::string range;
+    while (std::getline(iss, range, ',')) {
+        if (range.empty() || range == "\n") continue;
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+// CPUs this process may run on (its affinity mask, else every hardware thread)
+std::vector<int> AllowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+    if (cpus.empty()) {
+        unsigned hw = std::thread::hardware_concurrency();
+        for (unsigned cpu = 0; cpu < std::max(hw, 1u); ++cpu) cpus.push_back(static_cast<int>(cpu));
+    }
+    return cpus;
+}
+
+// `cpus` grouped by NUMA node (sysfs); one group when the topology is unknown
+std::vector<std::vector<int>> NodeCpus(const std::vector<int>& cpus) {
+    std::vector<std::vector<int>> nodes;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("node", 0) != 0 || name.find_first_not_of("0123456789", 4) != std::string::npos) continue;
+        std::ifstream file(entry.path() / "cpulist");
+        std::string list;
+        if (!std::getline(file, list)) continue;
+        std::vector<int> node;
+        for (int cpu : ParseCpuList(list)) {
+            if (std::find(cpus.begin(), cpus.end(), cpu) != cpus.end()) node.push_back(cpu);
+        }
+        if (!node.empty()) nodes.push_back(std::move(node));
+    }
+    if (nodes.empty()) nodes.push_back(cpus);
+    return nodes;
+}
+
+void ResolveBudget(BudgetState& state, const ComputeBudget& budget) {
+    std::vector<int> allowed = AllowedCpus();
+    state.budget = budget;
+    state.budget.cores = budget.cores > 0 ? std::min(budget.cores, allowed.size()) : allowed.size();
+    state.cpus.assign(allowed.begin(), allowed.begin() + state.budget.cores);
+    state.node_cpus = NodeCpus(state.cpus);
+    state.logged_splits.clear();
+}
+
+BudgetState& State() {
+    static BudgetState state = [] {
+        BudgetState initial;
+        ResolveBudget(initial, ComputeBudget{});
+        return initial;
+    }();
+    return state;
+}
+
+void SetOpenMPThreads(size_t threads) {
+#ifdef _OPENMP
+    omp_set_num_threads(static_cast<int>(threads));
+#endif
+}
+
+size_t OpenMPThreads() {
+#ifdef _OPENMP
+    return static_cast<size_t>(omp_get_max_threads());
+#else
+    return 1;
+#endif
+}
+
+// Cores worker `w` runs on under the pinning mode (empty = not pinned)
+std::vector<int> WorkerCpus(const BudgetState& state, const ComputeSplit& split, size_t w) {
+    if (state.budget.pinning == "numa") {
+        return state.node_cpus[w * state.node_cpus.size() / split.workers];
+    }
+    if (state.budget.pinning == "cores") {
+        std::vector<int> cpus;
+        for (size_t k = 0; k < split.inner; ++k) cpus.push_back(state.cpus[(w * split.inner + k) % state.cpus.size()]);
+        return cpus;
+    }
+    return {};
+}
+
+bool GetAffinity(cpu_set_t& set) {
+    CPU_ZERO(&set);
+    return pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+void SetAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty()) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// PlanComputeSplit under a budget already looked up
+ComputeSplit PlanSplit(const ComputeBudget& budget, size_t count, size_t num_threads) {
+    size_t threads = std::max<size_t>(1, num_threads);
+    size_t tasks = std::max<size_t>(1, count);
+    if (budget.inner > 0) {
+        // Fixed OpenMP width: as many workers as fit in the threads
+        return {std::clamp<size_t>(threads / budget.inner, 1, tasks), budget.inner};
+    }
+    // Outer parallelism first (independent tasks scale better than OpenFHE's inner loops);
+    // threads the tasks cannot use go to OpenMP
+    size_t workers = std::min(threads, tasks);
+    return {workers, std::max<size_t>(1, threads / workers)};
+}
+
+// Gives the calling thread a worker's OpenMP width and cores, and its own back afterwards
+class CallerAsWorker {
+public:
+    CallerAsWorker(size_t inner, const std::vector<int>& cpus) : omp_threads_(OpenMPThreads()) {
+        pinned_ = !cpus.empty() && GetAffinity(saved_);
+        SetOpenMPThreads(inner);
+        if (pinned_) SetAffinity(cpus);
+    }
+    ~CallerAsWorker() {
+        SetOpenMPThreads(omp_threads_);
+        if (pinned_) pthread_setaffinity_np(pthread_self(), sizeof(saved_), &saved_);
+    }
+
+private:
+    size_t omp_threads_;
+    bool pinned_ = false;
+    cpu_set_t saved_;
+};
+
+}  // namespace
+
+ComputeBudget LoadComputeBudget(const std::unordered_map<std::string, std::string>& config) {
+    ComputeBudget budget;
+    budget.cores = static_cast<size_t>(std::max(0L, ConfigLong(config, "computeCores", 0)));
+    budget.inner = static_cast<size_t>(std::max(0L, ConfigLong(config, "computeInnerThreads", 0)));
+    budget.pinning = ConfigString(config, "computePinning", "none");
+    if (budget.pinning != "none" && budget.pinning != "cores" && budget.pinning != "numa") {
+        throw std::runtime_error("computePinning must be none, cores or numa, got " + budget.pinning);
+    }
+    return budget;
+}
+
+void SetComputeBudget(const ComputeBudget& budget, const std::string& process) {
+    std::lock_guard<std::mutex> lock(state_mtx);
+    BudgetState& state = State();
+    BudgetState resolved;
+    ResolveBudget(resolved, budget);
+    if (state.installed && resolved.budget == state.budget) return;
+    const bool changed = state.installed;
+    resolved.process = process;
+    resolved.installed = true;
+    state = std::move(resolved);
+    SetOpenMPThreads(state.budget.cores);
+
+    std::cout << "[compute] " << process << (changed ? ": budget changed to " : ": ") << state.budget.cores << " cores, OpenMP threads per worker "
+              << (state.budget.inner ? std::to_string(state.budget.inner) : "auto") << ", pinning "
+              << state.budget.pinning;
+    if (state.budget.pinning == "numa") std::cout << " (" << state.node_cpus.size() << " nodes)";
+#ifndef _OPENMP
+    std::cout << " (built without OpenMP: OpenFHE's thread count is left alone)";
+#endif
+    std::cout << std::endl;
+}
+
+ComputeBudget CurrentComputeBudget() {
+    std::lock_guard<std::mutex> lock(state_mtx);
+    return State().budget;
+}
+
+ComputeSplit PlanComputeSplit(size_t count, size_t num_threads) {
+    return PlanSplit(CurrentComputeBudget(), count, num_threads);
+}
+
+size_t ResolveThreadCount(long configured) {
+    if (configured > 0) return static_cast<size_t>(configured);
+    return CurrentComputeBudget().cores;
+}
+
+void ParallelFor(size_t count, size_t num_threads, const std::function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    // Split and cores from one look at the budget, so a concurrent SetComputeBudget cannot mix two
+    ComputeSplit split;
+    std::vector<std::vector<int>> worker_cpus;
+    {
+        std::lock_guard<std::mutex> lock(state_mtx);
+        BudgetState& state = State();
+        split = PlanSplit(state.budget, count, num_threads);
+        worker_cpus.resize(split.workers);
+        for (size_t w = 0; w < split.workers; ++w) worker_cpus[w] = WorkerCpus(state, split, w);
+        if (state.logged_splits.insert({split.workers, split.inner}).second) {
+            std::cout << "[compute] " << state.process << ": " << count << " tasks on " << num_threads
+                      << " threads -> " << split.workers << " workers x " << split.inner << " OpenMP threads"
+                      << std::endl;
+        }
+    }
+
+    CallerAsWorker caller(split.inner, worker_cpus[0]);
+    if (split.workers == 1) {
+        for (size_t i = 0; i < count; ++i) body(i);
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::atomic<bool> failed{false};
+    std::exception_ptr first_error;
+    std::mutex error_mtx;
+
+    auto worker = [&] {
+        while (!failed.load(std::memory_order_relaxed)) {
+            size_t i = next.fetch_add(1, std::memory_order_relaxed);
+            if (i >= count) return;
+            try {
+                body(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mtx);
+                if (!first_error) first_error = std::current_exception();
+                failed = true;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    workers.reserve(split.workers - 1);
+    for (size_t t = 1; t < split.workers; ++t) {
+        workers.emplace_back([&, t] {
+            // A new thread starts with the process-wide OpenMP width, not the caller's
+            SetOpenMPThreads(split.inner);
+            SetAffinity(worker_cpus[t]);
+            worker();
+        });
+    }
+    worker();  // the calling thread works too
+    for (auto& w : workers) w.join();
+
+    if (first_error) std::rethrow_exception(first_error);
+}
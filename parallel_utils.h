@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// Process-wide compute budget. OpenFHE parallelizes inside each operation with OpenMP, so
+// every ParallelFor splits the threads it is given between its own workers (one task each,
+// "outer") and the OpenMP threads OpenFHE may use inside each worker ("inner"), instead of
+// letting every worker start one OpenMP thread per core.
+struct ComputeBudget {
+    size_t cores = 0;                 // cores the process uses (0 = every core it may run on)
+    size_t inner = 0;                 // OpenMP threads per worker (0 = what the outer tasks leave)
+    std::string pinning = "none";     // none, cores (each worker on its own cores) or numa (workers spread over nodes)
+
+    bool operator==(const ComputeBudget&) const = default;
+};
+
+// computeCores / computeInnerThreads / computePinning from a loaded config file.
+// Throws std::runtime_error on an unknown pinning mode.
+ComputeBudget LoadComputeBudget(const std::unordered_map<std::string, std::string>& config);
+
+// Install the budget for this process (and the calling thread's OpenMP width) and log it.
+// Meant to run once per process: installing the same budget again is a no-op, a different
+// one replaces it (logged as a change) under any ParallelFor already running.
+void SetComputeBudget(const ComputeBudget& budget, const std::string& process);
+
+// A copy of the installed budget, with cores resolved
+ComputeBudget CurrentComputeBudget();
+
+// How a ParallelFor over `count` tasks uses `num_threads` threads
+struct ComputeSplit {
+    size_t workers;   // outer
+    size_t inner;     // OpenMP threads per worker
+};
+ComputeSplit PlanComputeSplit(size_t count, size_t num_threads);
+
+// Resolve a configured worker count: values <= 0 mean "every core of the compute budget"
+size_t ResolveThreadCount(long configured);
+
+// Run body(i) for every i in [0, count) on up to num_threads workers (split with OpenMP
+// as PlanComputeSplit says; each distinct split is logged once).
+// Indices are handed out dynamically; callers write results by index, so output
+// order never depends on scheduling. The first exception thrown by any worker is
+// rethrown on the calling thread after all workers have stopped.
+void ParallelFor(size_t count, size_t num_threads, const std::function<void(size_t)>& body);
@@ -1,27 +1,228 @@
 #include "rest_storage.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <iterator>
+#include <limits>
 
 using namespace std;
 
+/* Locking */
+unique_lock<mutex> FederatedStorage::Lock()
+{
+    // Fast path: uncontended acquisitions never touch the clock
+    unique_lock<mutex> lock(mtx_, try_to_lock);
+    if (lock.owns_lock()) return lock;
+
+    auto start = chrono::steady_clock::now();
+    lock.lock();
+    auto waited = chrono::steady_clock::now() - start;
+    MetricsRecordMutexWait(chrono::duration_cast<chrono::nanoseconds>(waited).count());
+    return lock;
+}
+
+/* Per-round client sampling */
+static long long UnixMillis()
+{
+    return chrono::duration_cast<chrono::milliseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+void FederatedStorage::ConfigureSampling(size_t clients_per_round, long deadline_seconds)
+{
+    auto lock = Lock();
+    clients_per_round_ = clients_per_round;
+    deadline_seconds_ = deadline_seconds;
+}
+
+const json& FederatedStorage::PlanLocked(int round)
+{
+    static const json kNoPlan;
+    if (clients_per_round_ == 0 && deadline_seconds_ == 0) return kNoPlan;
+
+    auto it = round_plans_.find(round);
+    if (it != round_plans_.end()) return it->second;
+
+    // Population: every client with a public key (the threshold joint key is not a client)
+    std::vector<std::string> population;
+    for (const auto& [client, keys] : public_keys_) {
+        if (client != "joint") population.push_back(client);
+    }
+    std::sort(population.begin(), population.end());
+
+    std::vector<std::string> participants;
+    size_t sample = clients_per_round_ == 0 ? population.size() : std::min(clients_per_round_, population.size());
+    std::sample(population.begin(), population.end(), std::back_inserter(participants), sample, rng_);
+
+    long long deadline = deadline_seconds_ > 0 ? UnixMillis() + deadline_seconds_ * 1000LL : 0;
+    return round_plans_[round] = {{"participants", participants}, {"deadline_unix_ms", deadline}};
+}
+
+void FederatedStorage::ConfigureRetention(int keep_rounds)
+{
+    auto lock = Lock();
+    keep_rounds_ = std::max(keep_rounds, 0);
+}
+
+int FederatedStorage::LatestRound()
+{
+    auto lock = Lock();
+    return latest_round_;
+}
+
+std::vector<std::string> FederatedStorage::GetClients()
+{
+    auto lock = Lock();
+    std::vector<std::string> clients;
+    for (const auto& [client, keys] : public_keys_) {
+        if (client != "joint") clients.push_back(client);
+    }
+    std::sort(clients.begin(), clients.end());
+    return clients;
+}
+
+/* Storage size: string payload bytes of stored values (metadata such as layouts counts 0) */
+static size_t StoredBytes(const string& s)
+{
+    return s.size();
+}
+
+static size_t StoredBytes(const shared_ptr<const string>& s)
+{
+    return s ? s->size() : 0;
+}
+
+static size_t StoredBytes(const json& j)
+{
+    if (j.is_string()) return j.get_ref<const string&>().size();
+    size_t total = 0;
+    if (j.is_structured()) {
+        for (const auto& el : j) total += StoredBytes(el);
+    }
+    return total;
+}
+
+template <typename T>
+static size_t StoredBytes(const T&)
+{
+    return 0;
+}
+
+template <typename K, typename V>
+static size_t StoredBytes(const map<K, V>& entries)
+{
+    size_t total = 0;
+    for (const auto& [key, value] : entries) total += StoredBytes(value);
+    return total;
+}
+
+template <typename K, typename V>
+static size_t StoredBytes(const unordered_map<K, V>& entries)
+{
+    size_t total = 0;
+    for (const auto& [key, value] : entries) total += StoredBytes(value);
+    return total;
+}
+
+void FederatedStorage::AccountLocked(const string& category, size_t before, size_t after)
+{
+    size_t& total = bytes_[category];
+    total = total - before + after;
+}
+
+size_t FederatedStorage::ParamsBytesLocked(const string& client_id, int round)
+{
+    size_t total = 0;
+    auto enc = encrypted_params_.find(client_id);
+    if (enc != encrypted_params_.end() && enc->second.count(round)) total += enc->second.at(round).size();
+    auto plain = plain_params_.find(client_id);
+    if (plain != plain_params_.end() && plain->second.count(round)) total += StoredBytes(plain->second.at(round));
+    auto parts = param_parts_.find(client_id);
+    if (parts != param_parts_.end() && parts->second.count(round)) total += StoredBytes(parts->second.at(round));
+    return total;
+}
+
+// Erase every entry of a round-keyed map up to and including `cutoff`; returns the bytes erased
+template <typename RoundMap>
+static size_t EraseRoundsUpTo(RoundMap& by_round, int cutoff)
+{
+    size_t erased = 0;
+    for (auto it = by_round.begin(); it != by_round.end();) {
+        if (it->first <= cutoff) {
+            erased += StoredBytes(it->second);
+            it = by_round.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return erased;
+}
+
+void FederatedStorage::PruneLocked(int round)
+{
+    if (keep_rounds_ == 0) return;
+    const int cutoff = round - keep_rounds_;
+    size_t params = 0, agg = 0;
+    for (auto& [client, rounds] : encrypted_params_) params += EraseRoundsUpTo(rounds, cutoff);
+    for (auto& [client, rounds] : chunk_counts_) EraseRoundsUpTo(rounds, cutoff);
+    for (auto& [client, rounds] : orig_sizes_) EraseRoundsUpTo(rounds, cutoff);
+    for (auto& [client, rounds] : plain_params_) params += EraseRoundsUpTo(rounds, cutoff);
+    for (auto& [client, rounds] : param_parts_) params += EraseRoundsUpTo(rounds, cutoff);
+    for (auto& [client, rounds] : part_counts_) EraseRoundsUpTo(rounds, cutoff);
+    agg += EraseRoundsUpTo(aggregated_params_, cutoff);
+    agg += EraseRoundsUpTo(agg_parts_, cutoff);
+    EraseRoundsUpTo(agg_part_counts_, cutoff);
+    EraseRoundsUpTo(agg_layouts_, cutoff);
+    agg += EraseRoundsUpTo(agg_plain_layers_, cutoff);
+    AccountLocked("params", params, 0);
+    AccountLocked("agg_params", agg, 0);
+    AccountLocked("partial_decs", EraseRoundsUpTo(partial_decs_, cutoff), 0);
+    AccountLocked("partial_sums", EraseRoundsUpTo(partial_sums_, cutoff), 0);
+    EraseRoundsUpTo(round_plans_, cutoff);
+}
+
+json FederatedStorage::GetRoundPlan(int round)
+{
+    auto lock = Lock();
+    const json& plan = PlanLocked(round);
+
+    std::vector<std::string> uploaded;
+    for (const auto& [client, rounds] : encrypted_params_) {
+        if (rounds.count(round)) uploaded.push_back(client);
+    }
+
+    json response = {
+        {"round", round},
+        {"sampling", !plan.is_null()},
+        {"participants", plan.is_null() ? json::array() : plan["participants"]},
+        {"uploaded", uploaded},
+        {"deadline_unix_ms", plan.is_null() ? 0LL : plan["deadline_unix_ms"].get<long long>()},
+        {"now_unix_ms", UnixMillis()}
+    };
+    return response;
+}
+
 /* Public Keys */
 void FederatedStorage::StorePublicKey(const string& client_id,
                                       const string& pubkey_b64,
                                       const string& eval_mult_b64,
                                       const string& eval_sum_b64) 
 {
-    lock_guard<mutex> lock(mtx_);
-    public_keys_[client_id] = {
-        {"public_key", pubkey_b64},
-        {"eval_mult_key", eval_mult_b64},
-        {"eval_sum_key", eval_sum_b64}
-    };
+    json entry = {{"public_key", pubkey_b64}};
+    if (!eval_mult_b64.empty()) entry["eval_mult_key"] = eval_mult_b64;
+    if (!eval_sum_b64.empty()) entry["eval_sum_key"] = eval_sum_b64;
+
+    auto lock = Lock();
+    json& stored = public_keys_[client_id];
+    AccountLocked("public_keys", StoredBytes(stored), StoredBytes(entry));
+    stored = std::move(entry);
 }
 
 json FederatedStorage::GetPublicKey(const string& client_id) 
 {
-    lock_guard<mutex> lock(mtx_);
+    auto lock = Lock();
     if (public_keys_.count(client_id))
         return public_keys_[client_id];
     return json();  // Empty response if not found
@@ -30,17 +231,20 @@ json FederatedStorage::GetPublicKey(const string& client_id)
 /* ReKey */
 void FederatedStorage::StoreRekey(const string& from_id, const string& to_id, const string& rekey_b64) 
 {
-    lock_guard<mutex> lock(mtx_);
-    rekeys_[from_id][to_id] = {
+    auto lock = Lock();
+    json& stored = rekeys_[from_id][to_id];
+    size_t before = StoredBytes(stored);
+    stored = {
         {"from", from_id},
         {"to", to_id},
         {"rekey", rekey_b64}
     };
+    AccountLocked("rekeys", before, StoredBytes(stored));
 }
 
 json FederatedStorage::GetRekey(const string& from_id, const string& to_id) 
 {
-    lock_guard<mutex> lock(mtx_);
+    auto lock = Lock();
     if (rekeys_.count(from_id) && rekeys_[from_id].count(to_id)) {
         return rekeys_[from_id][to_id];
     }
@@ -48,14 +252,51 @@ json FederatedStorage::GetRekey(const string& from_id, const string& to_id)
 }
 
 /* Encrypted Parameters (Base64 serialized ciphertext vector string) */
-void FederatedStorage::StoreParams(const std::string& client_id, int round, const std::string& params_b64, const std::vector<size_t>& chunk_counts) {
+ParamsStatus FederatedStorage::StoreParams(const std::string& client_id, int round, const std::string& params_b64, const std::vector<size_t>& chunk_counts) {
     // Overload to accept orig_sizes optional parameter
-    StoreParams(client_id, round, params_b64, chunk_counts, {});
+    return StoreParams(client_id, round, params_b64, chunk_counts, {});
+}
+
+ParamsStatus FederatedStorage::AdmitLocked(const std::string& client_id, int round) {
+    const json& plan = PlanLocked(round);
+    if (!plan.is_null()) {
+        const json& participants = plan["participants"];
+        if (std::find(participants.begin(), participants.end(), client_id) == participants.end()) {
+            return ParamsStatus::kNotSelected;
+        }
+        long long deadline = plan["deadline_unix_ms"];
+        if (deadline > 0 && UnixMillis() > deadline) {
+            return ParamsStatus::kPastDeadline;
+        }
+    }
+    return ParamsStatus::kStored;
 }
 
-void FederatedStorage::StoreParams(const std::string& client_id, int round, const std::string& params_b64, const std::vector<size_t>& chunk_counts, const std::vector<size_t>& orig_sizes) {
-    std::lock_guard<std::mutex> lock(mtx_);
-    encrypted_params_[client_id][round] = params_b64;
+ParamsStatus FederatedStorage::StoreParams(const std::string& client_id, int round, std::string_view params_b64, const std::vector<size_t>& chunk_counts, const std::vector<size_t>& orig_sizes, const json& plain_layers, size_t parts) {
+    auto lock = Lock();
+
+    // Checked under the lock: an aggregator that reads the params after the deadline sees
+    // every upload accepted before it
+    ParamsStatus admitted = AdmitLocked(client_id, round);
+    if (admitted != ParamsStatus::kStored) return admitted;
+
+    size_t before = ParamsBytesLocked(client_id, round);
+    if (parts > 1) {
+        auto& received = param_parts_[client_id][round];
+        for (size_t part = 0; part + 1 < parts; ++part) {
+            if (!received.count(part)) return ParamsStatus::kMissingParts;
+        }
+        encrypted_params_[client_id][round] = std::move(received[0]);
+        received.erase(0);
+        received[parts - 1] = params_b64;
+        part_counts_[client_id][round] = parts;
+    } else {
+        // A single-part upload replaces any earlier multipart one
+        if (param_parts_.count(client_id)) param_parts_[client_id].erase(round);
+        if (part_counts_.count(client_id)) part_counts_[client_id].erase(round);
+        encrypted_params_[client_id][round] = params_b64;
+    }
+    latest_round_ = std::max(latest_round_, round);
     
     if (!chunk_counts.empty()) {
         chunk_counts_[client_id][round] = chunk_counts;
@@ -64,10 +305,26 @@ void FederatedStorage::StoreParams(const std::string& client_id, int round, cons
     if (!orig_sizes.empty()) {
         orig_sizes_[client_id][round] = orig_sizes;
     }
+
+    if (!plain_layers.empty()) {
+        plain_params_[client_id][round] = plain_layers;
+    }
+    AccountLocked("params", before, ParamsBytesLocked(client_id, round));
+    return ParamsStatus::kStored;
+}
+
+ParamsStatus FederatedStorage::StoreParamsPart(const std::string& client_id, int round, size_t part, std::string_view params_b64) {
+    auto lock = Lock();
+    ParamsStatus admitted = AdmitLocked(client_id, round);
+    if (admitted != ParamsStatus::kStored) return admitted;
+    string& stored = param_parts_[client_id][round][part];
+    AccountLocked("params", stored.size(), params_b64.size());
+    stored = params_b64;
+    return ParamsStatus::kStored;
 }
 
 std::vector<size_t> FederatedStorage::GetChunkCounts(const std::string& client_id, int round) {
-    std::lock_guard<std::mutex> lock(mtx_);
+    auto lock = Lock();
     if (chunk_counts_.count(client_id) && chunk_counts_[client_id].count(round)) {
         return chunk_counts_[client_id][round];
     }
@@ -75,7 +332,7 @@ std::vector<size_t> FederatedStorage::GetChunkCounts(const std::string& client_i
 }
 
 std::vector<size_t> FederatedStorage::GetOrigSizes(const std::string& client_id, int round) {
-    std::lock_guard<std::mutex> lock(mtx_);
+    auto lock = Lock();
     if (orig_sizes_.count(client_id) && orig_sizes_[client_id].count(round)) {
         return orig_sizes_[client_id][round];
     }
@@ -84,7 +341,7 @@ std::vector<size_t> FederatedStorage::GetOrigSizes(const std::string& client_id,
 
 json FederatedStorage::GetAllParams(int round) 
 {
-    lock_guard<mutex> lock(mtx_);
+    auto lock = Lock();
     json round_data = json::object();
     for (const auto& [client, rounds] : encrypted_params_) {
         if (rounds.count(round)) {
@@ -94,41 +351,314 @@ json FederatedStorage::GetAllParams(int round)
     return round_data;
 }
 
+json FederatedStorage::GetParamsPart(int round, size_t part)
+{
+    if (part == 0) return GetAllParams(round);
+    auto lock = Lock();
+    json round_data = json::object();
+    for (const auto& [client, rounds] : encrypted_params_) {
+        if (!rounds.count(round) || !param_parts_.count(client)) continue;
+        const auto& by_round = param_parts_.at(client);
+        auto parts = by_round.find(round);
+        if (parts == by_round.end() || !parts->second.count(part)) continue;
+        round_data[client] = parts->second.at(part);
+    }
+    return round_data;
+}
+
+json FederatedStorage::GetParamsPartCounts(int round)
+{
+    auto lock = Lock();
+    json counts = json::object();
+    for (const auto& [client, rounds] : encrypted_params_) {
+        if (!rounds.count(round)) continue;
+        size_t parts = 1;
+        if (part_counts_.count(client) && part_counts_.at(client).count(round)) parts = part_counts_.at(client).at(round);
+        counts[client] = parts;
+    }
+    return counts;
+}
+
+json FederatedStorage::GetAllPlainParams(int round)
+{
+    auto lock = Lock();
+    json round_data = json::object();
+    for (const auto& [client, rounds] : plain_params_) {
+        if (rounds.count(round)) {
+            round_data[client] = rounds.at(round);
+        }
+    }
+    return round_data;
+}
+
+std::vector<std::string> FederatedStorage::ShardClientsLocked(int round, size_t shard, size_t shards)
+{
+    std::vector<std::string> clients;
+    for (const auto& [client, rounds] : encrypted_params_) {
+        if (rounds.count(round)) clients.push_back(client);
+    }
+    std::sort(clients.begin(), clients.end());
+
+    std::vector<std::string> shard_clients;
+    for (size_t i = shard; i < clients.size(); i += shards) shard_clients.push_back(clients[i]);
+    return shard_clients;
+}
+
+json FederatedStorage::GetParamsShard(int round, size_t shard, size_t shards)
+{
+    auto lock = Lock();
+    json shard_data = json::object();
+    for (const std::string& client : ShardClientsLocked(round, shard, shards)) {
+        shard_data[client] = encrypted_params_.at(client).at(round);
+    }
+    return shard_data;
+}
+
+json FederatedStorage::GetPlainParamsShard(int round, size_t shard, size_t shards)
+{
+    auto lock = Lock();
+    json shard_data = json::object();
+    for (const std::string& client : ShardClientsLocked(round, shard, shards)) {
+        auto it = plain_params_.find(client);
+        if (it != plain_params_.end() && it->second.count(round)) shard_data[client] = it->second.at(round);
+    }
+    return shard_data;
+}
+
+std::vector<std::string> FederatedStorage::GetParamsClients(int round)
+{
+    auto lock = Lock();
+    std::vector<std::string> clients;
+    for (const auto& [client, rounds] : encrypted_params_) {
+        if (rounds.count(round)) clients.push_back(client);
+    }
+    return clients;
+}
+
 /* Aggregated Parameters (Base64 serialized ciphertext vector string) */
-void FederatedStorage::StoreAggregatedParams(int round, const json& aggregated_param_map) 
+void FederatedStorage::StoreAggregatedParams(int round, map<string, string> aggregated_params, size_t part, size_t parts) 
+{
+    // Merged per client: async versions and sync rounds of other clients can share a number,
+    // and aggregators post large rounds in batches of clients
+    auto lock = Lock();
+    AggregateMap& agg = part > 0 ? agg_parts_[round][part] : aggregated_params_[round];
+    size_t before = StoredBytes(agg);
+    for (auto& [client, b64] : aggregated_params) {
+        agg[client] = make_shared<const string>(std::move(b64));
+    }
+    AccountLocked("agg_params", before, StoredBytes(agg));
+    if (part > 0) return;
+    if (parts > 1) agg_part_counts_[round] = parts;
+    latest_round_ = std::max(latest_round_, round);
+    PruneLocked(round);
+}
+
+shared_ptr<const string> FederatedStorage::GetAggregatedParam(const string& client_id, int round, size_t part, size_t& parts) 
+{
+    auto lock = Lock();
+    const AggregateMap* found = nullptr;
+    if (part == 0) {
+        if (aggregated_params_.count(round)) found = &aggregated_params_[round];
+    } else if (agg_parts_.count(round) && agg_parts_[round].count(part)) {
+        found = &agg_parts_[round][part];
+    }
+    if (!found) return nullptr;
+    auto it = found->find(client_id);
+    if (it == found->end()) it = found->find("*");
+    if (it == found->end()) return nullptr;
+    parts = agg_part_counts_.count(round) ? agg_part_counts_[round] : 1;
+    return it->second;
+}
+
+void FederatedStorage::StoreAggregatedLayout(int round, const std::vector<size_t>& chunk_counts, const std::vector<size_t>& orig_sizes)
+{
+    auto lock = Lock();
+    agg_layouts_[round] = {chunk_counts, orig_sizes};
+}
+
+std::vector<size_t> FederatedStorage::GetAggregatedChunkCounts(int round)
+{
+    auto lock = Lock();
+    return agg_layouts_.count(round) ? agg_layouts_[round].first : std::vector<size_t>{};
+}
+
+std::vector<size_t> FederatedStorage::GetAggregatedOrigSizes(int round)
+{
+    auto lock = Lock();
+    return agg_layouts_.count(round) ? agg_layouts_[round].second : std::vector<size_t>{};
+}
+
+void FederatedStorage::StoreAggregatedPlainLayers(int round, const json& plain_layers)
+{
+    auto lock = Lock();
+    json& stored = agg_plain_layers_[round];
+    AccountLocked("agg_params", StoredBytes(stored), StoredBytes(plain_layers));
+    stored = plain_layers;
+}
+
+json FederatedStorage::GetAggregatedPlainLayers(int round)
 {
-    lock_guard<mutex> lock(mtx_);
-    aggregated_params_[round] = aggregated_param_map;
+    auto lock = Lock();
+    return agg_plain_layers_.count(round) ? agg_plain_layers_[round] : json::object();
 }
 
-json FederatedStorage::GetAggregatedParam(const string& client_id, int round) 
+int FederatedStorage::LatestAggregatedRound(const string& client_id)
 {
-    lock_guard<mutex> lock(mtx_);
-    if (aggregated_params_.count(round) && aggregated_params_[round].contains(client_id)) {
-        return {
-            {"client_id", client_id},
-            {"round", round},
-            {"agg_params", aggregated_params_[round][client_id]}
+    auto lock = Lock();
+    int latest = 0;
+    for (const auto& [round, agg] : aggregated_params_) {
+        if (round > latest && agg.count(client_id)) latest = round;
+    }
+    return latest;
+}
+
+/* Async aggregation */
+std::vector<std::string> FederatedStorage::GetHubGroup(const string& hub)
+{
+    auto lock = Lock();
+    std::vector<std::string> group = {hub};
+    if (rekeys_.count(hub)) {
+        for (const auto& [client, rekey] : rekeys_[hub]) {
+            if (rekeys_.count(client) && rekeys_[client].count(hub)) group.push_back(client);
+        }
+    }
+    return group;
+}
+
+json FederatedStorage::GetPendingParams(const std::vector<std::string>& clients, int min_round, size_t& stale)
+{
+    auto lock = Lock();
+    json pending = json::object();
+    stale = 0;
+    for (const std::string& client : clients) {
+        if (!encrypted_params_.count(client)) continue;
+        int consumed = consumed_rounds_.count(client) ? consumed_rounds_[client] : std::numeric_limits<int>::min();
+        int latest = std::numeric_limits<int>::min();
+        for (const auto& [round, b64] : encrypted_params_[client]) {
+            if (round > consumed && round > latest) latest = round;
+        }
+        if (latest == std::numeric_limits<int>::min()) continue;
+        if (latest < min_round) {
+            ++stale;
+            continue;
+        }
+        pending[client] = {
+            {"round", latest},
+            {"params", encrypted_params_[client][latest]},
+            {"chunk_counts", chunk_counts_[client][latest]},
+            {"orig_sizes", orig_sizes_[client][latest]}
         };
+        if (part_counts_.count(client) && part_counts_[client].count(latest)) {
+            pending[client]["parts"] = part_counts_[client][latest];
+        }
+        if (plain_params_.count(client) && plain_params_[client].count(latest)) {
+            pending[client]["plain_layers"] = plain_params_[client][latest];
+        }
     }
-    return json();
+    return pending;
+}
+
+void FederatedStorage::MarkParamsConsumed(const string& client_id, int round)
+{
+    auto lock = Lock();
+    auto [it, inserted] = consumed_rounds_.emplace(client_id, round);
+    if (!inserted) it->second = std::max(it->second, round);
+}
+
+/* Partial Decryptions (threshold mode) */
+void FederatedStorage::StorePartialDecryption(const string& client_id, int round, const string& partial_b64)
+{
+    auto lock = Lock();
+    string& stored = partial_decs_[round][client_id];
+    AccountLocked("partial_decs", stored.size(), partial_b64.size());
+    stored = partial_b64;
+}
+
+json FederatedStorage::GetPartialDecryptions(int round)
+{
+    auto lock = Lock();
+    json partials = json::object();
+    if (partial_decs_.count(round)) {
+        for (const auto& [client, b64] : partial_decs_[round]) partials[client] = b64;
+    }
+    return partials;
+}
+
+void FederatedStorage::StoreJointKeyHolders(const std::vector<std::string>& client_ids)
+{
+    auto lock = Lock();
+    joint_key_holders_ = client_ids;
+    std::sort(joint_key_holders_.begin(), joint_key_holders_.end());
+    joint_key_holders_.erase(std::unique(joint_key_holders_.begin(), joint_key_holders_.end()), joint_key_holders_.end());
+}
+
+std::vector<std::string> FederatedStorage::GetJointKeyHolders()
+{
+    auto lock = Lock();
+    return joint_key_holders_;
+}
+
+std::vector<std::string> FederatedStorage::GetPartialDecryptionClients(int round)
+{
+    auto lock = Lock();
+    std::vector<std::string> clients;
+    if (partial_decs_.count(round)) {
+        for (const auto& [client, b64] : partial_decs_[round]) clients.push_back(client);
+    }
+    return clients;
+}
+
+/* Partial sums (hierarchical aggregation) */
+void FederatedStorage::StorePartialSum(const string& edge_id, int round, const std::vector<std::string>& clients, const string& sum_b64, const json& plain_sum)
+{
+    auto lock = Lock();
+    json& stored = partial_sums_[round][edge_id];
+    size_t before = StoredBytes(stored);
+    stored = {{"clients", clients}, {"sum", sum_b64}};
+    if (!plain_sum.empty()) stored["plain_sum"] = plain_sum;
+    AccountLocked("partial_sums", before, StoredBytes(stored));
+}
+
+json FederatedStorage::GetPartialSums(int round)
+{
+    auto lock = Lock();
+    json sums = json::object();
+    if (partial_sums_.count(round)) {
+        for (const auto& [edge, entry] : partial_sums_[round]) sums[edge] = entry;
+    }
+    return sums;
+}
+
+std::vector<std::string> FederatedStorage::GetPartialSumClients(int round)
+{
+    auto lock = Lock();
+    std::vector<std::string> clients;
+    if (partial_sums_.count(round)) {
+        for (const auto& [edge, entry] : partial_sums_[round]) {
+            for (const auto& client : entry["clients"]) clients.push_back(client.get<std::string>());
+        }
+    }
+    return clients;
 }
 
 /* Result */
 void FederatedStorage::StoreResult(const string& client_id, int round, double accuracy, const string& model_name) 
 {
-    lock_guard<mutex> lock(mtx_);
-    result_map_[round][client_id] = {
+    auto lock = Lock();
+    json& stored = result_map_[round][client_id];
+    size_t before = StoredBytes(stored);
+    stored = {
         {"client_id", client_id},
         {"round", round},
         {"accuracy", accuracy},
         {"model", model_name}
     };
+    AccountLocked("results", before, StoredBytes(stored));
 }
 
 json FederatedStorage::GetResult(const string& client_id, int round) 
 {
-    lock_guard<mutex> lock(mtx_);
+    auto lock = Lock();
     if (result_map_.count(round) && result_map_[round].count(client_id)) {
         return result_map_[round][client_id];
     }
@@ -138,7 +668,7 @@ json FederatedStorage::GetResult(const string& client_id, int round)
 /* Log */
 void FederatedStorage::LogRoundToFile(int round, const string& filepath) 
 {
-    lock_guard<mutex> lock(mtx_);
+    auto lock = Lock();
     filesystem::create_directories("logs");
     ofstream out(filepath);
     if (!out.is_open()) return;
@@ -146,7 +676,9 @@ void FederatedStorage::LogRoundToFile(int round, const string& filepath)
     out << "Round: " << round << "\n\n";
 
     if (aggregated_params_.count(round)) {
-        out << "[Aggregated Params]\n" << aggregated_params_[round].dump(4) << "\n\n";
+        json logged = json::object();
+        for (const auto& [client, b64] : aggregated_params_[round]) logged[client] = *b64;
+        out << "[Aggregated Params]\n" << logged.dump(4) << "\n\n";
     }
     if (result_map_.count(round)) {
         for (const auto& [client, result] : result_map_[round]) {
@@ -156,3 +688,9 @@ void FederatedStorage::LogRoundToFile(int round, const string& filepath)
     out.close();
 }
 
+/* Storage size */
+map<string, size_t> FederatedStorage::StorageBytes()
+{
+    auto lock = Lock();
+    return bytes_;
+}
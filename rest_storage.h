@@ -1,15 +1,38 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <random>
 #include <vector>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
 
+// Outcome of a params upload under per-round client sampling
+// (kMissingParts: the last part of a multipart upload arrived before the others)
+enum class ParamsStatus { kStored, kNotSelected, kPastDeadline, kMissingParts };
+
 class FederatedStorage {
 public:
+    // Per-round participation: sample clients_per_round of the registered clients (0 = all)
+    // and refuse params arriving deadline_seconds after the round opened (0 = no deadline).
+    // Both 0 (the default) keeps every client in every round.
+    void ConfigureSampling(size_t clients_per_round, long deadline_seconds);
+
+    // Retention: once a round is aggregated, drop the payloads (params, aggregates, partial
+    // sums and decryptions, plans) of rounds keep_rounds or more before it; 0 keeps everything.
+    // Results stay. Async mode needs keep_rounds above the staleness bound.
+    void ConfigureRetention(int keep_rounds);
+
+    // Newest round with params or an aggregate (0 before the first)
+    int LatestRound();
+
+    // Clients with a public key (the threshold joint key is not a client)
+    std::vector<std::string> GetClients();
 
     // Public Key & Eval Keys
     void StorePublicKey(const std::string& client_id,
@@ -23,9 +46,25 @@ public:
     json GetRekey(const std::string& from_id, const std::string& to_id);
 
     // Encrypted Parameters (Base64 string of serialized ciphertext vector) stored by client and round
-    void StoreParams(const std::string& client_id, int round, const std::string& params_b64, const std::vector<size_t>& chunk_counts = {});
-    void StoreParams(const std::string& client_id, int round, const std::string& params_b64, const std::vector<size_t>& chunk_counts, const std::vector<size_t>& orig_sizes);
+    // Params from clients outside the round's sample, or after its deadline, are not stored.
+    // plain_layers holds the layers the client's layer policy left unencrypted ({ "<index>": "base64" }).
+    ParamsStatus StoreParams(const std::string& client_id, int round, const std::string& params_b64, const std::vector<size_t>& chunk_counts = {});
+    // An upload in `parts` parts (maxPartChunks) posts parts 0..parts-2 with StoreParamsPart
+    // and ends with StoreParams, carrying the last part and the layout; the client counts as
+    // uploaded from then on. GetAllParams and GetParamsShard serve part 0.
+    ParamsStatus StoreParams(const std::string& client_id, int round, std::string_view params_b64, const std::vector<size_t>& chunk_counts, const std::vector<size_t>& orig_sizes, const json& plain_layers = json::object(), size_t parts = 1);
+    ParamsStatus StoreParamsPart(const std::string& client_id, int round, size_t part, std::string_view params_b64);
     json GetAllParams(int round);
+    // Part `part` of a round's params of every client done uploading: { "client1": "base64", ... }
+    json GetParamsPart(int round, size_t part);
+    // Number of parts each client of a round uploaded in: { "client1": 1, ... }
+    json GetParamsPartCounts(int round);
+    // A round's plaintext layers of every client that sent some: { "client1": { "<index>": "base64" }, ... }
+    json GetAllPlainParams(int round);
+    // Shard `shard` of `shards` of a round's params: every shards-th client ID in sorted order
+    json GetParamsShard(int round, size_t shard, size_t shards);
+    // Plaintext layers of the same shard's clients
+    json GetPlainParamsShard(int round, size_t shard, size_t shards);
 
     // Retrieve chunk counts for params
     std::vector<size_t> GetChunkCounts(const std::string& client_id, int round);
@@ -33,9 +72,62 @@ public:
     // Retrieve original sizes for params
     std::vector<size_t> GetOrigSizes(const std::string& client_id, int round);  // << New
 
-    // Aggregated Encrypted Parameters (Base64 string) mapping client_id → base64
-    void StoreAggregatedParams(int round, const json& aggregated_param_map); // { "client1": "base64", ... }
-    json GetAggregatedParam(const std::string& client_id, int round);
+    // Clients that uploaded params for a round
+    std::vector<std::string> GetParamsClients(int round);
+
+    // A round's participation plan, made when the round is first touched (this call or its
+    // first upload): { "sampling", "participants", "uploaded", "deadline_unix_ms", "now_unix_ms" }.
+    // Without sampling every client participates and the deadline is 0.
+    json GetRoundPlan(int round);
+
+    // Aggregated Encrypted Parameters (Base64 string) mapping client_id → base64.
+    // An entry under "*" is served to every client without its own (threshold mode: one
+    // aggregate under the joint key instead of a copy per client).
+    // Aggregates of multipart uploads come in the same parts; part 0 records their number
+    // and is posted last, so a client that sees it finds every other part in place.
+    void StoreAggregatedParams(int round, std::map<std::string, std::string> aggregated_params, size_t part = 0, size_t parts = 1);
+    // A client's aggregate (null when there is none), shared with the store so that serving
+    // it copies nothing; `parts` receives the number of parts of the round's aggregate
+    std::shared_ptr<const std::string> GetAggregatedParam(const std::string& client_id, int round, size_t part, size_t& parts);
+
+    // Layout (chunk counts, original sizes) posted with an aggregate, for clients that did
+    // not upload params in that round themselves (async mode)
+    void StoreAggregatedLayout(int round, const std::vector<size_t>& chunk_counts, const std::vector<size_t>& orig_sizes);
+    std::vector<size_t> GetAggregatedChunkCounts(int round);
+    std::vector<size_t> GetAggregatedOrigSizes(int round);
+
+    // Averaged plaintext layers of a round, the same for every client ({} when none)
+    void StoreAggregatedPlainLayers(int round, const json& plain_layers);
+    json GetAggregatedPlainLayers(int round);
+
+    // Async mode: latest round with an aggregate for this client (0 when there is none)
+    int LatestAggregatedRound(const std::string& client_id);
+
+    // Async mode: the hub and every client with rekeys to and from it
+    std::vector<std::string> GetHubGroup(const std::string& hub);
+
+    // Async mode: each client's latest params not yet aggregated, if uploaded for round
+    // min_round or later: { "client1": { "round", "params", "chunk_counts", "orig_sizes"[, "plain_layers"] }, ... }.
+    // `stale` receives the number of clients whose latest pending params are older.
+    json GetPendingParams(const std::vector<std::string>& clients, int min_round, size_t& stale);
+    // Mark a client's params up to `round` as aggregated
+    void MarkParamsConsumed(const std::string& client_id, int round);
+
+    // Threshold mode: the clients whose key shares the joint key combines, all of whom have to
+    // post a partial decryption (empty until the joint key is stored)
+    void StoreJointKeyHolders(const std::vector<std::string>& client_ids);
+    std::vector<std::string> GetJointKeyHolders();
+
+    // Threshold mode: each client's partial decryption (Base64 ciphertext vector) of a round's aggregate
+    void StorePartialDecryption(const std::string& client_id, int round, const std::string& partial_b64);
+    json GetPartialDecryptions(int round);  // { "client1": "base64", ... }
+    std::vector<std::string> GetPartialDecryptionClients(int round);
+
+    // Hierarchical aggregation: each edge aggregator's partial sum (Base64 ciphertext vector,
+    // empty for an empty shard), the sum of its clients' plaintext layers and the clients it covers
+    void StorePartialSum(const std::string& edge_id, int round, const std::vector<std::string>& clients, const std::string& sum_b64, const json& plain_sum = json::object());
+    json GetPartialSums(int round);  // { "edge0": { "clients": [...], "sum": "base64"[, "plain_sum": {...}] }, ... }
+    std::vector<std::string> GetPartialSumClients(int round);
 
     // Results / Accuracy information
     void StoreResult(const std::string& client_id, int round, double accuracy, const std::string& model_name);
@@ -43,7 +135,39 @@ public:
 
     void LogRoundToFile(int round, const std::string& filepath);
 
+    // Bytes currently held per category (public_keys, rekeys, params, agg_params, partial_decs, partial_sums, results),
+    // kept as running totals so /metrics scrapes do not walk the stores
+    std::map<std::string, size_t> StorageBytes();
+
 private:
+    // Acquire mtx_, reporting any time spent waiting to the metrics layer
+    std::unique_lock<std::mutex> Lock();
+
+    // The round's plan, drawn on first use (mtx_ held; null without sampling)
+    const json& PlanLocked(int round);
+
+    // Client IDs in shard `shard` of `shards` of a round's params (mtx_ held)
+    std::vector<std::string> ShardClientsLocked(int round, size_t shard, size_t shards);
+
+    // Apply the retention policy after `round` was aggregated (mtx_ held)
+    void PruneLocked(int round);
+
+    // Whether the round's plan takes params from this client now (mtx_ held)
+    ParamsStatus AdmitLocked(const std::string& client_id, int round);
+
+    // Payload bytes of one client's params for a round: full, plain and partial uploads (mtx_ held)
+    size_t ParamsBytesLocked(const std::string& client_id, int round);
+
+    // Move a category's running total from `before` to `after` bytes for a replaced entry (mtx_ held)
+    void AccountLocked(const std::string& category, size_t before, size_t after);
+
+    size_t clients_per_round_ = 0;
+    long deadline_seconds_ = 0;
+    std::mt19937_64 rng_{std::random_device{}()};
+    std::unordered_map<int, json> round_plans_;  // round → { participants, deadline_unix_ms }
+    int keep_rounds_ = 0;
+    int latest_round_ = 0;
+
     std::mutex mtx_;
 
     std::unordered_map<std::string, json> public_keys_;  // client_id → { pub, eval_mult, eval_sum }
@@ -55,9 +179,32 @@ private:
     
     // Map to store original sizes metadata: client_id → round → origSizes vector
     std::unordered_map<std::string, std::unordered_map<int, std::vector<size_t>>> orig_sizes_;  // << New
+
+    std::unordered_map<std::string, std::unordered_map<int, json>> plain_params_;  // client_id → round → { index: b64 }
+
+    // Multipart uploads: parts other than part 0 (and part 0 until the last part arrives)
+    std::unordered_map<std::string, std::unordered_map<int, std::map<size_t, std::string>>> param_parts_;  // client_id → round → part → b64
+    std::unordered_map<std::string, std::unordered_map<int, size_t>> part_counts_;  // client_id → round → parts (absent = 1)
     
-    std::unordered_map<int, json> aggregated_params_;  // round → { client_id: b64 }
+    using AggregateMap = std::map<std::string, std::shared_ptr<const std::string>>;  // client_id → b64
+    std::unordered_map<int, AggregateMap> aggregated_params_;  // round → aggregates
+    std::unordered_map<int, std::pair<std::vector<size_t>, std::vector<size_t>>> agg_layouts_;  // round → (chunk counts, orig sizes)
+    std::unordered_map<int, json> agg_plain_layers_;  // round → { index: b64 }
+    std::unordered_map<int, std::map<size_t, AggregateMap>> agg_parts_;  // round → part (1..) → aggregates
+    std::unordered_map<int, size_t> agg_part_counts_;  // round → parts (absent = 1)
+
+    std::unordered_map<std::string, int> consumed_rounds_;  // client_id → newest round already aggregated (async mode)
+
+    std::vector<std::string> joint_key_holders_;  // sorted
+    std::unordered_map<int, std::unordered_map<std::string, std::string>> partial_decs_;  // round → client_id → b64
+
+    std::unordered_map<int, std::unordered_map<std::string, json>> partial_sums_;  // round → edge_id → { clients, sum }
 
     std::unordered_map<int, std::unordered_map<std::string, json>> result_map_;  // round → client_id → result JSON
+
+    // Running StorageBytes totals, kept by the Store* calls and PruneLocked
+    std::map<std::string, size_t> bytes_ = {
+        {"public_keys", 0}, {"rekeys", 0}, {"params", 0}, {"agg_params", 0}, {"partial_decs", 0}, {"partial_sums", 0}, {"results", 0}
+    };
 };
 
@@ -6,30 +6,110 @@ set -o pipefail
 MAX_ROUNDS=$(grep -E "^rounds=" loop_config.txt | head -n1 | cut -d'=' -f2 | tr -d '[:space:]')
 echo "Configured to run $MAX_ROUNDS round(s)."
 
+# Per-round Chrome traces (start api_server with the same FL_TRACE_DIR to include server spans)
+export FL_TRACE_DIR=${FL_TRACE_DIR:-traces}
+# Per-phase timings and peak RSS of every C++ binary, one CSV for the whole run
+# (start api_server with the same FL_PHASE_LOG to include server phases)
+export FL_PHASE_LOG=${FL_PHASE_LOG:-logs/phase_timings.csv}
+mkdir -p "$(dirname "$FL_PHASE_LOG")"
+
 # Clear .csv at the start of each run
 > timing_rounds.csv
 > client1_data/accuracy_log.csv
 > client2_data/accuracy_log.csv
 > client1_data/comm_logs.csv
 > client2_data/comm_logs.csv
+> "$FL_PHASE_LOG"
 
 # Initial Setup (Run once before federated rounds)
-echo "Initial setup: generating CryptoContext..."
-./cc
-
-echo "🔑 Generating client1 keys..."
-./client1_keygen
-
-echo "🔑 Generating client2 keys..."
-./client2_keygen
-
-echo "🔐 Generating client1 re-encryption key..."
-./client1_rekeygen
-
-echo "🔐 Generating client2 re-encryption key..."
-./client2_rekeygen
-
-echo "✅ Initial setup done."
+# Keys and the context are reused from each client's keystore when still valid for
+# cc_config.txt; FORCE_KEYGEN=1 regenerates everything.
+SETUP_START=$(date +%s.%N)
+FORCE=""
+if [ "${FORCE_KEYGEN:-0}" = "1" ]; then FORCE=force; fi
+
+echo "Initial setup: CryptoContext..."
+./cc $FORCE
+
+# aggregationMode in cc_config.txt: pre (rekeys through a hub) or threshold (joint key)
+AGG_MODE=$(grep -E "^aggregationMode=" cc_config.txt | head -n1 | cut -d'=' -f2 | tr -d '[:space:]')
+# aggregationEdges in server_config.txt: >0 aggregates through that many edge aggregators and a root
+AGG_EDGES=$(grep -E "^aggregationEdges=" server_config.txt | head -n1 | cut -d'=' -f2 | tr -d '[:space:]')
+
+if [ "$AGG_MODE" = "threshold" ]; then
+    # Key shares derive from the lead's public key, so the lead goes first; the server
+    # then combines all shares into the joint key every client encrypts under
+    LEAD=$(grep -E "^thresholdLead=" cc_config.txt | head -n1 | cut -d'=' -f2 | tr -d '[:space:]')
+    LEAD=${LEAD:-client1}
+    echo "🔑 Threshold key shares (lead $LEAD first, then the others in parallel)..."
+    ./client_agent $LEAD keygen $FORCE
+    SHARE_PIDS=""
+    for CLIENT in client1 client2; do
+        if [ "$CLIENT" != "$LEAD" ]; then
+            ./client_agent $CLIENT keygen $FORCE &
+            SHARE_PIDS="$SHARE_PIDS $!"
+        fi
+    done
+    for PID in $SHARE_PIDS; do wait $PID; done
+
+    echo "🔐 Joint public key..."
+    ./operations joint_key client1 client2
+    ./client_agent client1 jointkey &
+    JOINT1_PID=$!
+    ./client_agent client2 jointkey &
+    JOINT2_PID=$!
+    wait $JOINT1_PID
+    wait $JOINT2_PID
+else
+    # Each client's keygen is independent; rekeygen needs both public keys on the server
+    echo "🔑 Client keys (client1, client2 in parallel)..."
+    ./client_agent client1 keygen $FORCE &
+    KEYGEN1_PID=$!
+    ./client_agent client2 keygen $FORCE &
+    KEYGEN2_PID=$!
+    wait $KEYGEN1_PID
+    wait $KEYGEN2_PID
+
+    echo "🔐 Re-encryption keys (client1→client2, client2→client1 in parallel)..."
+    ./client_agent client1 rekeygen client2 $FORCE &
+    REKEY1_PID=$!
+    ./client_agent client2 rekeygen client1 $FORCE &
+    REKEY2_PID=$!
+    wait $REKEY1_PID
+    wait $REKEY2_PID
+fi
+
+echo "✅ Initial setup done in $(awk "BEGIN { print $(date +%s.%N) - $SETUP_START }") s."
+
+# USE_CLIENT_AGENT=1 keeps one client_agent per client resident across rounds
+# (context and keys loaded once); the trainers then encrypt through its socket.
+USE_CLIENT_AGENT=${USE_CLIENT_AGENT:-0}
+if [ "$USE_CLIENT_AGENT" = "1" ]; then
+    ./client_agent client1 serve &
+    AGENT1_PID=$!
+    ./client_agent client2 serve &
+    AGENT2_PID=$!
+    trap 'kill $AGENT1_PID $AGENT2_PID 2>/dev/null || true' EXIT
+    for SOCK in client1_data/agent.sock client2_data/agent.sock; do
+        until [ -S "$SOCK" ]; do sleep 0.1; done
+    done
+    export FL_AGENT_SOCKET_CLIENT1=client1_data/agent.sock
+    export FL_AGENT_SOCKET_CLIENT2=client2_data/agent.sock
+fi
+
+# FL_INPROCESS_CLIENT=1 has the trainers encrypt/upload and download/decrypt themselves
+# through the fl_client Python module (make python): no weight files, no client processes.
+# Each trainer decrypts the previous round's aggregate as its warm start.
+export FL_INPROCESS_CLIENT=${FL_INPROCESS_CLIENT:-0}
+
+# Run one client step, through the resident agent when enabled
+client_step() {
+    if [ "$USE_CLIENT_AGENT" = "1" ]; then
+        python3 agent_client.py "$1_data/agent.sock" "$2"
+    else
+        ./client_agent "$1" "$2"
+    fi
+}
 
 # Initialize round counter
 echo 1 > round_counter.txt
@@ -40,6 +120,10 @@ source venv/bin/activate
 # Set window size to match train/test scripts
 WIN_SIZE=7
 
+# Weights exchanged with the trainers: wc.bin/agg_wc.bin unless weightsFormat=json
+WEIGHTS_FORMAT=$(grep -E "^weightsFormat=" client_config.txt 2>/dev/null | head -n1 | cut -d'=' -f2 | tr -d '[:space:]')
+if [ "$WEIGHTS_FORMAT" = "json" ]; then AGG_EXT=json; else AGG_EXT=bin; fi
+
 while true; do
     CURRENT_ROUND=$(cat round_counter.txt)
     if [ "$CURRENT_ROUND" -gt "$MAX_ROUNDS" ]; then
@@ -49,59 +133,109 @@ while true; do
 
     echo "-----------------------------------------------------------------------------------"
     echo "Starting round $CURRENT_ROUND..."
-    ROUND_START=$(date +%s)
+    ROUND_START=$(date +%s.%N)
+
+    # Open the round: with client sampling (clientsPerRound/roundDeadlineSeconds in
+    # server_config.txt) the server picks its participants and starts the upload deadline now;
+    # clients outside the sample skip encrypt and decrypt
+    curl -s "${FL_SERVER_URL:-http://localhost:8000}/s2c/round_plan?round=$CURRENT_ROUND" > /dev/null || true
 
     # ---- CLIENT 1 ----
+    # Precompute encryption randomness while the trainer runs (the agent does this on its own)
+    if [ "$USE_CLIENT_AGENT" != "1" ] && [ "$FL_INPROCESS_CLIENT" != "1" ]; then
+        ./client_agent client1 precompute > /dev/null &
+        PRECOMPUTE_PID=$!
+    fi
     echo "🟦 [Client 1] Training round $CURRENT_ROUND..."
     if [ "$CURRENT_ROUND" -eq "1" ]; then
         python3 client1_train.py client1_data/data1.csv client1_data/model.h5 "" 10 16 $WIN_SIZE
     else
-        python3 client1_train.py client1_data/data1.csv client1_data/model.h5 client1_data/agg_wc.json 10 16 $WIN_SIZE
+        python3 client1_train.py client1_data/data1.csv client1_data/model.h5 client1_data/agg_wc.$AGG_EXT 10 16 $WIN_SIZE
     fi
 
-    echo "🟦 [Client 1] Encrypting params..."
-    ./client1_encrypt
+    if [ "$USE_CLIENT_AGENT" != "1" ] && [ "$FL_INPROCESS_CLIENT" != "1" ]; then
+        wait $PRECOMPUTE_PID || echo "🟦 [Client 1] Zero pool precompute failed; encrypting online"
+        echo "🟦 [Client 1] Encrypting params..."
+        ./client_agent client1 encrypt
+    fi
 
     # ---- CLIENT 2 ----
+    # Precompute encryption randomness while the trainer runs (the agent does this on its own)
+    if [ "$USE_CLIENT_AGENT" != "1" ] && [ "$FL_INPROCESS_CLIENT" != "1" ]; then
+        ./client_agent client2 precompute > /dev/null &
+        PRECOMPUTE_PID=$!
+    fi
     echo "🟧 [Client 2] Training round $CURRENT_ROUND..."
     if [ "$CURRENT_ROUND" -eq "1" ]; then
         python3 client2_train.py client2_data/data2.csv client2_data/model.h5 "" 10 16 $WIN_SIZE
     else
-        python3 client2_train.py client2_data/data2.csv client2_data/model.h5 client2_data/agg_wc.json 10 16 $WIN_SIZE
+        python3 client2_train.py client2_data/data2.csv client2_data/model.h5 client2_data/agg_wc.$AGG_EXT 10 16 $WIN_SIZE
     fi
 
-    echo "🟧 [Client 2] Encrypting params..."
-    ./client2_encrypt
+    if [ "$USE_CLIENT_AGENT" != "1" ] && [ "$FL_INPROCESS_CLIENT" != "1" ]; then
+        wait $PRECOMPUTE_PID || echo "🟧 [Client 2] Zero pool precompute failed; encrypting online"
+        echo "🟧 [Client 2] Encrypting params..."
+        ./client_agent client2 encrypt
+    fi
 
     # ---- SERVER AGGREGATION ----
     echo "🟩 [SERVER] Performing homomorphic aggregation..."
-    ./operations
+    if [ "${AGG_EDGES:-0}" -gt 0 ]; then
+        # Aggregation tree: edges and root run side by side; the root waits for the edges
+        EDGE_PIDS=()
+        for ((e = 0; e < AGG_EDGES; e++)); do
+            ./operations edge edge$e $e $AGG_EDGES &
+            EDGE_PIDS+=($!)
+        done
+        ./operations root
+        for pid in "${EDGE_PIDS[@]}"; do wait $pid; done
+    else
+        ./operations
+    fi
 
-    # ---- CLIENT 1: DECRYPT AGGREGATED PARAMS ----
-    echo "🟦 [Client 1] Decrypting aggregated params..."
-    ./client1_decrypt
+    # Threshold mode: nobody can decrypt until every client has posted its partial decryption
+    if [ "$AGG_MODE" = "threshold" ]; then
+        echo "🟦🟧 [Clients] Posting partial decryptions..."
+        client_step client1 partial
+        client_step client2 partial
+    fi
 
-    # ---- CLIENT 2: DECRYPT AGGREGATED PARAMS ----
-    echo "🟧 [Client 2] Decrypting aggregated params..."
-    ./client2_decrypt
+    if [ "$FL_INPROCESS_CLIENT" != "1" ]; then
+        # ---- CLIENT 1: DECRYPT AGGREGATED PARAMS ----
+        echo "🟦 [Client 1] Decrypting aggregated params..."
+        client_step client1 decrypt
+
+        # ---- CLIENT 2: DECRYPT AGGREGATED PARAMS ----
+        echo "🟧 [Client 2] Decrypting aggregated params..."
+        client_step client2 decrypt
+    fi
 
     # ---- CLIENT 1: TEST & POST ACCURACY ----
     echo "🟦 [Client 1] Testing and posting accuracy..."
-    python3 client1_test.py client1_data/test1.csv client1_data/model.h5 client1_data/accuracy.json http://localhost:8000/c2s/result client1_data/accuracy_log.csv $WIN_SIZE
+    python3 client1_test.py client1_data/test1.csv client1_data/model.h5 client1_data/accuracy.json "${FL_SERVER_URL:-http://localhost:8000}/c2s/result" client1_data/accuracy_log.csv $WIN_SIZE
 
     # ---- CLIENT 2: TEST & POST ACCURACY ----
     echo "🟧 [Client 2] Testing and posting accuracy..."
-    python3 client2_test.py client2_data/test2.csv client2_data/model.h5 client2_data/accuracy.json http://localhost:8000/c2s/result client2_data/accuracy_log.csv $WIN_SIZE
+    python3 client2_test.py client2_data/test2.csv client2_data/model.h5 client2_data/accuracy.json "${FL_SERVER_URL:-http://localhost:8000}/c2s/result" client2_data/accuracy_log.csv $WIN_SIZE
 
-    ROUND_END=$(date +%s)
-    ROUND_TIME=$((ROUND_END - ROUND_START))
+    ROUND_TIME=$(awk "BEGIN { printf \"%.3f\", $(date +%s.%N) - $ROUND_START }")
     echo "$CURRENT_ROUND,$ROUND_TIME" >> timing_rounds.csv
 
+    # Merge this round's per-process traces into one timeline
+    if [ -d "$FL_TRACE_DIR/round-$CURRENT_ROUND" ]; then
+        python3 trace_merge.py "$FL_TRACE_DIR/round-$CURRENT_ROUND"
+    fi
+
     # ---- increment round ----
     echo $((CURRENT_ROUND + 1)) > round_counter.txt
     sleep 1
 done
 
+if [ "$USE_CLIENT_AGENT" = "1" ]; then
+    python3 agent_client.py client1_data/agent.sock shutdown || true
+    python3 agent_client.py client2_data/agent.sock shutdown || true
+fi
+
 deactivate
 
 echo "🎉 Federated rounds complete. Check logs and server for results."
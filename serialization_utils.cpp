@@ -1,5 +1,6 @@
 #include "serialization_utils.h"
 #include "base64_utils.h"
+#include "trace_utils.h"
 
 #include "openfhe.h"
 #include "scheme/ckksrns/ckksrns-ser.h"
@@ -56,7 +57,7 @@ std::string SerializePublicKeyToBase64(const PublicKey<DCRTPoly>& pk) {
 }
 
 // Deserialize PublicKey from Base64 string
-PublicKey<DCRTPoly> DeserializePublicKeyFromBase64(const std::string& base64) {
+PublicKey<DCRTPoly> DeserializePublicKeyFromBase64(std::string_view base64) {
     std::vector<uint8_t> decoded = Base64Decode(base64);
     std::string decodedStr(decoded.begin(), decoded.end());
     std::stringstream ss(decodedStr);
@@ -100,7 +101,7 @@ std::string SerializeEvalKeyToBase64(const EvalKey<DCRTPoly>& rk) {
 }
 
 // Deserialize EvalKey from Base64
-EvalKey<DCRTPoly> DeserializeEvalKeyFromBase64(const std::string& base64) {
+EvalKey<DCRTPoly> DeserializeEvalKeyFromBase64(std::string_view base64) {
     std::vector<uint8_t> decoded = Base64Decode(base64);
     std::string decodedStr(decoded.begin(), decoded.end());
     std::stringstream ss(decodedStr);
@@ -136,9 +137,13 @@ std::string SerializeEvalSumKeyToBase64(const CryptoContext<DCRTPoly>& cc) {
 // Serialize a vector of Ciphertext to Base64 string (e.g., multi-array weights)
 std::string SerializeCiphertextVectorToBase64(const std::vector<Ciphertext<DCRTPoly>>& cts) {
     std::stringstream ss;
-    Serial::Serialize(cts, ss, SerType::BINARY);
+    {
+        TraceSpan span("serialize", "{\"ciphertexts\":" + std::to_string(cts.size()) + "}");
+        Serial::Serialize(cts, ss, SerType::BINARY);
+    }
     std::string bin = ss.str();
 
+    TraceSpan span("base64_encode", "{\"bytes\":" + std::to_string(bin.size()) + "}");
     std::vector<uint8_t> byteData;
     byteData.reserve(bin.size());
     for (char ch : bin) byteData.push_back(static_cast<uint8_t>(ch));
@@ -146,11 +151,16 @@ std::string SerializeCiphertextVectorToBase64(const std::vector<Ciphertext<DCRTP
 }
 
 // Deserialize Base64 string to vector of Ciphertext (multi-array)
-std::vector<Ciphertext<DCRTPoly>> DeserializeCiphertextVectorFromBase64(const std::string& base64) {
-    std::vector<uint8_t> decoded = Base64Decode(base64);
+std::vector<Ciphertext<DCRTPoly>> DeserializeCiphertextVectorFromBase64(std::string_view base64) {
+    std::vector<uint8_t> decoded;
+    {
+        TraceSpan span("base64_decode", "{\"bytes\":" + std::to_string(base64.size()) + "}");
+        decoded = Base64Decode(base64);
+    }
     std::string decodedStr(decoded.begin(), decoded.end());
     std::stringstream ss(decodedStr);
     std::vector<Ciphertext<DCRTPoly>> cts;
+    TraceSpan span("deserialize", "{\"bytes\":" + std::to_string(decodedStr.size()) + "}");
     Serial::Deserialize(cts, ss, SerType::BINARY);
     return cts;
 }
@@ -2,6 +2,7 @@
 
 #include "openfhe.h"
 #include <string>
+#include <string_view>
 #include <vector>
 
 // Serialization and Base64 encoding for single ciphertext
@@ -10,7 +11,7 @@ lbcrypto::Ciphertext<lbcrypto::DCRTPoly> DeserializeCiphertextFromBase64(const s
 
 // Serialization and Base64 encoding for PublicKey
 std::string SerializePublicKeyToBase64(const lbcrypto::PublicKey<lbcrypto::DCRTPoly>& pk);
-lbcrypto::PublicKey<lbcrypto::DCRTPoly> DeserializePublicKeyFromBase64(const std::string& base64);
+lbcrypto::PublicKey<lbcrypto::DCRTPoly> DeserializePublicKeyFromBase64(std::string_view base64);
 
 // Serialization and Base64 encoding for PrivateKey
 std::string SerializePrivateKeyToBase64(const lbcrypto::PrivateKey<lbcrypto::DCRTPoly>& sk);
@@ -18,7 +19,7 @@ lbcrypto::PrivateKey<lbcrypto::DCRTPoly> DeserializePrivateKeyFromBase64(const s
 
 // Serialization and Base64 encoding for EvalKey
 std::string SerializeEvalKeyToBase64(const lbcrypto::EvalKey<lbcrypto::DCRTPoly>& rk);
-lbcrypto::EvalKey<lbcrypto::DCRTPoly> DeserializeEvalKeyFromBase64(const std::string& base64);
+lbcrypto::EvalKey<lbcrypto::DCRTPoly> DeserializeEvalKeyFromBase64(std::string_view base64);
 
 // Serialization and Base64 encoding for EvalMult/EvalSumKeys
 std::string SerializeEvalMultKeyToBase64(const lbcrypto::CryptoContext<lbcrypto::DCRTPoly>& cc);
@@ -26,5 +27,5 @@ std::string SerializeEvalSumKeyToBase64(const lbcrypto::CryptoContext<lbcrypto::
 
 // Serialize and deserialize vector of ciphertexts (multi-array of model weights)
 std::string SerializeCiphertextVectorToBase64(const std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>>& cts);
-std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>> DeserializeCiphertextVectorFromBase64(const std::string& base64);
+std::vector<lbcrypto::Ciphertext<lbcrypto::DCRTPoly>> DeserializeCiphertextVectorFromBase64(std::string_view base64);
 
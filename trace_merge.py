@@ -0,0 +1,43 @@
+import json
+import os
+import sys
+
+# Merge the per-process trace files of one round into a single Chrome trace.
+# Usage: python3 trace_merge.py <trace_round_dir> [output_json]
+# Open the output in chrome://tracing or https://ui.perfetto.dev
+
+
+def load_events(path):
+    with open(path, "r") as f:
+        text = f.read().strip()
+    if not text:
+        return []
+    # Files are written in JSON array format without the (optional) closing bracket
+    if not text.endswith("]"):
+        text = text.rstrip(",") + "]"
+    return json.loads(text)
+
+
+def merge_round(round_dir, output_path):
+    events = []
+    for name in sorted(os.listdir(round_dir)):
+        path = os.path.join(round_dir, name)
+        if not name.endswith(".json") or os.path.abspath(path) == os.path.abspath(output_path):
+            continue
+        try:
+            events.extend(load_events(path))
+        except json.JSONDecodeError as e:
+            print(f"[trace_merge.py] WARNING: skipping unreadable {path}: {e}")
+
+    with open(output_path, "w") as f:
+        json.dump({"traceEvents": events, "displayTimeUnit": "ns"}, f)
+    print(f"[trace_merge.py] Wrote {len(events)} events to {output_path}")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("Usage: python3 trace_merge.py <trace_round_dir> [output_json]")
+        sys.exit(1)
+    round_dir = sys.argv[1]
+    output = sys.argv[2] if len(sys.argv) >= 3 else os.path.join(os.path.dirname(round_dir.rstrip("/")), os.path.basename(round_dir.rstrip("/")) + ".trace.json")
+    merge_round(round_dir, output)
@@ -0,0 +1,253 @@
+#include "trace_utils.h"
+
+#include "alloc_stats.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <chrono>
+#include <fcntl.h>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <sys/file.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using json = nlohmann::json;
+
+struct TraceEvent {
+    std::string name;
+    std::string trace_id;
+    std::string args_json;
+    uint64_t start_ns;
+    uint64_t end_ns;
+    long tid;
+};
+
+struct PhaseStats {
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    uint64_t allocs = 0;
+    uint64_t alloc_bytes = 0;
+};
+
+static bool trace_enabled = false;
+static std::string trace_dir;
+static std::string trace_process = "process";
+
+static bool phase_enabled = false;
+static std::string phase_log_path;
+
+static std::mutex trace_mtx;
+static std::string trace_id = "untraced";
+static std::vector<TraceEvent> trace_events;
+static std::map<std::pair<std::string, std::string>, PhaseStats> phase_stats;  // (trace ID, span name)
+
+static long CurrentTid() {
+    static thread_local long tid = static_cast<long>(syscall(SYS_gettid));
+    return tid;
+}
+
+void TraceInit(const std::string& process_name) {
+    const char* dir = std::getenv("FL_TRACE_DIR");
+    const char* phase_log = std::getenv("FL_PHASE_LOG");
+    trace_process = process_name;
+
+    if (dir && *dir) {
+        trace_dir = dir;
+        trace_enabled = true;
+    }
+    if (phase_log && *phase_log) {
+        phase_log_path = phase_log;
+        phase_enabled = true;
+    }
+    if (!trace_enabled && !phase_enabled) return;
+
+    const char* id = std::getenv("FL_TRACE_ID");
+    if (id && *id) TraceSetId(id);
+
+    std::atexit(TraceFlush);
+}
+
+bool TraceEnabled() {
+    return trace_enabled;
+}
+
+void TraceSetId(const std::string& id) {
+    // IDs become directory names (and may arrive in request headers): keep them path-safe
+    std::string safe = id.substr(0, 64);
+    for (char& ch : safe) {
+        if (!std::isalnum(static_cast<unsigned char>(ch)) && ch != '-' && ch != '_') ch = '_';
+    }
+    if (safe.empty()) safe = "untraced";
+
+    std::lock_guard<std::mutex> lock(trace_mtx);
+    trace_id = safe;
+}
+
+std::string TraceId() {
+    std::lock_guard<std::mutex> lock(trace_mtx);
+    return trace_enabled || phase_enabled ? trace_id : std::string();
+}
+
+uint64_t TraceNowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+static uint64_t MonotonicNowNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void TraceRecord(const char* name, uint64_t start_ns, uint64_t end_ns, const std::string& args_json) {
+    if (!trace_enabled) return;
+    long tid = CurrentTid();
+    std::lock_guard<std::mutex> lock(trace_mtx);
+    trace_events.push_back({name, trace_id, args_json, start_ns, end_ns, tid});
+}
+
+static void PhaseRecord(const char* name, uint64_t duration_ns, uint64_t allocs, uint64_t alloc_bytes) {
+    std::lock_guard<std::mutex> lock(trace_mtx);
+    PhaseStats& stats = phase_stats[{trace_id, name}];
+    stats.count++;
+    stats.total_ns += duration_ns;
+    stats.max_ns = std::max(stats.max_ns, duration_ns);
+    stats.allocs += allocs;
+    stats.alloc_bytes += alloc_bytes;
+}
+
+// Append this flush's per-phase totals to the shared phase log. Several processes append
+// to the same file, so each flush is one write under an exclusive lock (which also makes
+// "write the header into an empty file" race-free).
+static void FlushPhases() {
+    std::map<std::pair<std::string, std::string>, PhaseStats> stats;
+    {
+        std::lock_guard<std::mutex> lock(trace_mtx);
+        stats.swap(phase_stats);
+    }
+    if (stats.empty()) return;
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    HeapStats heap = ReadHeapStats();
+    const long pid = static_cast<long>(getpid());
+    const uint64_t unix_ms = TraceNowNs() / 1000000;
+
+    std::ostringstream rows;
+    rows << std::fixed << std::setprecision(3);
+    for (const auto& [key, phase] : stats) {
+        const auto& [id, name] = key;
+        std::string round = id.rfind("round-", 0) == 0 ? id.substr(6) : "";
+        rows << kPhaseLogSchema << "," << unix_ms << "," << round << "," << id << "," << trace_process << ","
+             << pid << "," << name << "," << phase.count << "," << phase.total_ns / 1e6 << ","
+             << phase.max_ns / 1e6 << "," << usage.ru_maxrss << "," << phase.allocs << ","
+             << phase.alloc_bytes / 1024.0 << ",";
+        // In use and fragmentation stay empty where the allocator does not report live bytes
+        if (heap.in_use_known) rows << heap.in_use / 1024;
+        rows << "," << heap.resident / 1024 << ",";
+        if (auto frag = heap.Fragmentation()) rows << *frag;
+        rows << "\n";
+    }
+    std::string out = rows.str();
+
+    std::error_code ec;
+    std::filesystem::path parent = std::filesystem::path(phase_log_path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent, ec);
+
+    int fd = open(phase_log_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return;
+    flock(fd, LOCK_EX);
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size == 0) out = kPhaseLogHeader + std::string("\n") + out;
+    ssize_t written = write(fd, out.data(), out.size());
+    (void)written;
+    flock(fd, LOCK_UN);
+    close(fd);
+}
+
+// Chrome timestamps are microseconds; keep the nanosecond digits as the fraction
+static std::string MicrosFromNanos(uint64_t ns) {
+    std::ostringstream out;
+    out << ns / 1000 << "." << std::setw(3) << std::setfill('0') << ns % 1000;
+    return out.str();
+}
+
+void TraceFlush() {
+    if (phase_enabled) FlushPhases();
+    if (!trace_enabled) return;
+
+    std::vector<TraceEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(trace_mtx);
+        events.swap(trace_events);
+    }
+    if (events.empty()) return;
+
+    const long pid = static_cast<long>(getpid());
+    std::string file_name = trace_process + "-" + std::to_string(pid) + ".json";
+
+    // Group by trace ID so each round gets its own directory
+    std::vector<std::string> ids;
+    for (const auto& ev : events) {
+        if (std::find(ids.begin(), ids.end(), ev.trace_id) == ids.end()) ids.push_back(ev.trace_id);
+    }
+
+    for (const auto& id : ids) {
+        std::filesystem::path dir = std::filesystem::path(trace_dir) / id;
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        std::filesystem::path path = dir / file_name;
+
+        // JSON array format: the closing ']' is optional, which lets us append per flush
+        bool fresh = !std::filesystem::exists(path, ec) || std::filesystem::file_size(path, ec) == 0;
+        std::ofstream out(path, std::ios::app);
+        if (!out.is_open()) continue;
+
+        if (fresh) {
+            out << "[\n" << json{{"name", "process_name"}, {"ph", "M"}, {"pid", pid},
+                                 {"args", {{"name", trace_process}}}}.dump();
+        }
+        for (const auto& ev : events) {
+            if (ev.trace_id != id) continue;
+            out << ",\n{\"name\":" << json(ev.name).dump()
+                << ",\"cat\":\"fl\",\"ph\":\"X\""
+                << ",\"ts\":" << MicrosFromNanos(ev.start_ns)
+                << ",\"dur\":" << MicrosFromNanos(ev.end_ns - ev.start_ns)
+                << ",\"pid\":" << pid << ",\"tid\":" << ev.tid
+                << ",\"args\":" << (ev.args_json.empty() ? "{}" : ev.args_json) << "}";
+        }
+    }
+}
+
+TraceSpan::TraceSpan(const char* name, std::string args_json)
+    : name_(name), args_json_(std::move(args_json)),
+      start_ns_(trace_enabled ? TraceNowNs() : 0),
+      mono_start_ns_(phase_enabled ? MonotonicNowNs() : 0),
+      allocs_start_(0), alloc_bytes_start_(0) {
+    if (phase_enabled) {
+        AllocCounters counters = ThreadAllocCounters();
+        allocs_start_ = counters.allocs;
+        alloc_bytes_start_ = counters.bytes;
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    if (trace_enabled) TraceRecord(name_, start_ns_, TraceNowNs(), args_json_);
+    if (phase_enabled) {
+        AllocCounters counters = ThreadAllocCounters();
+        PhaseRecord(name_, MonotonicNowNs() - mono_start_ns_, counters.allocs - allocs_start_,
+                    counters.bytes - alloc_bytes_start_);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Lightweight per-round tracing shared by every binary.
+// Enabled when FL_TRACE_DIR is set; events are appended as Chrome trace-event JSON
+// (array format) to <FL_TRACE_DIR>/<trace_id>/<process>-<pid>.json.
+// Merge a round's files with `python3 trace_merge.py <FL_TRACE_DIR>/<trace_id>`.
+//
+// Independently, FL_PHASE_LOG=<file.csv> makes every span also count towards a per-phase
+// total (monotonic clock), appended to that CSV on each flush with the process's peak RSS
+// and heap state (alloc_stats.h):
+//   schema,unix_ms,round,trace_id,process,pid,phase,count,total_ms,max_ms,peak_rss_kb,
+//   allocs,alloc_kb,heap_in_use_kb,heap_resident_kb,heap_frag
+// Spans on worker threads are summed, so total_ms can exceed the wall time of a phase.
+// allocs/alloc_kb are the allocations made on the spans' threads (nested spans included;
+// zero unless built with ALLOC_STATS=1); the heap columns are the process's at flush time,
+// heap_in_use_kb and heap_frag empty where the allocator does not report live bytes.
+
+// Version of the phase log columns; bump when they change
+constexpr int kPhaseLogSchema = 2;
+constexpr const char* kPhaseLogHeader =
+    "schema,unix_ms,round,trace_id,process,pid,phase,count,total_ms,max_ms,peak_rss_kb,"
+    "allocs,alloc_kb,heap_in_use_kb,heap_resident_kb,heap_frag";
+
+// Initialise tracing (FL_TRACE_DIR) and phase logging (FL_PHASE_LOG) for this process;
+// process_name labels its row in the timeline and its phase log rows
+void TraceInit(const std::string& process_name);
+
+// True when FL_TRACE_DIR was set at TraceInit
+bool TraceEnabled();
+
+// Round/trace ID attached to every subsequent event (e.g. "round-3").
+// Also sent by the HTTP helpers as the X-Trace-Id header.
+void TraceSetId(const std::string& trace_id);
+std::string TraceId();
+
+// Wall-clock nanoseconds, comparable across processes on the same host
+uint64_t TraceNowNs();
+
+// Record a finished span. args_json, if non-empty, must be a JSON object.
+void TraceRecord(const char* name, uint64_t start_ns, uint64_t end_ns, const std::string& args_json = "");
+
+// Append buffered events to their trace files and phase totals to the phase log
+// (also runs at process exit)
+void TraceFlush();
+
+// RAII span: records [construction, destruction) under the current trace ID
+class TraceSpan {
+public:
+    explicit TraceSpan(const char* name, std::string args_json = "");
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* name_;
+    std::string args_json_;
+    uint64_t start_ns_;
+    uint64_t mono_start_ns_;
+    uint64_t allocs_start_;
+    uint64_t alloc_bytes_start_;
+};
@@ -0,0 +1,164 @@
+#include "weights_io.h"
+
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kWeightsMagic[4] = {'F', 'L', 'W', 'T'};
+static const uint32_t kWeightsVersion = 1;
+static const size_t kWeightsDataAlign = 64;
+
+WeightsDType ParseWeightsDType(const std::string& name) {
+    if (name == "float64") return WeightsDType::Float64;
+    if (name == "float32") return WeightsDType::Float32;
+    throw std::runtime_error("Unknown weights dtype: " + name);
+}
+
+template <typename T>
+static void Put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteWeightsFile(const std::string& path,
+                      const std::vector<std::vector<double>>& layers,
+                      const std::vector<std::vector<size_t>>& shapes,
+                      WeightsDType dtype) {
+    if (!shapes.empty() && shapes.size() != layers.size()) {
+        throw std::runtime_error("Weights file " + path + ": " + std::to_string(shapes.size()) +
+                                 " shapes for " + std::to_string(layers.size()) + " layers");
+    }
+
+    std::string header(kWeightsMagic, sizeof(kWeightsMagic));
+    Put<uint32_t>(header, kWeightsVersion);
+    Put<uint32_t>(header, static_cast<uint32_t>(dtype));
+    Put<uint32_t>(header, static_cast<uint32_t>(layers.size()));
+    for (size_t i = 0; i < layers.size(); ++i) {
+        std::vector<size_t> shape = shapes.empty() ? std::vector<size_t>{layers[i].size()} : shapes[i];
+        size_t elements = 1;
+        for (size_t d : shape) elements *= d;
+        if (elements != layers[i].size()) {
+            throw std::runtime_error("Weights file " + path + ": layer " + std::to_string(i) +
+                                     " shape does not match its " + std::to_string(layers[i].size()) + " values");
+        }
+        Put<uint32_t>(header, static_cast<uint32_t>(shape.size()));
+        for (size_t d : shape) Put<uint64_t>(header, static_cast<uint64_t>(d));
+    }
+    header.resize((header.size() + kWeightsDataAlign - 1) / kWeightsDataAlign * kWeightsDataAlign, '\0');
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Could not write weights file " + path);
+    }
+    out.write(header.data(), static_cast<std::streamsize>(header.size()));
+
+    for (const auto& layer : layers) {
+        if (dtype == WeightsDType::Float64) {
+            out.write(reinterpret_cast<const char*>(layer.data()),
+                      static_cast<std::streamsize>(layer.size() * sizeof(double)));
+        } else {
+            std::vector<float> narrowed(layer.begin(), layer.end());
+            out.write(reinterpret_cast<const char*>(narrowed.data()),
+                      static_cast<std::streamsize>(narrowed.size() * sizeof(float)));
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("Failed writing weights file " + path);
+    }
+}
+
+std::vector<WeightsLayerView> ViewLayers(const std::vector<std::vector<double>>& layers) {
+    std::vector<WeightsLayerView> views;
+    views.reserve(layers.size());
+    for (const auto& layer : layers) {
+        views.push_back({layer.data(), layer.size(), WeightsDType::Float64, {layer.size()}});
+    }
+    return views;
+}
+
+template <typename T>
+static T Get(const char* base, size_t length, size_t& offset, const std::string& path) {
+    if (offset + sizeof(T) > length) {
+        throw std::runtime_error("Weights file " + path + " is truncated");
+    }
+    T value;
+    std::memcpy(&value, base + offset, sizeof(T));
+    offset += sizeof(T);
+    return value;
+}
+
+MappedWeightsFile::MappedWeightsFile(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open weights file " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < 16) {
+        close(fd);
+        throw std::runtime_error("Weights file " + path + " is truncated");
+    }
+    length_ = static_cast<size_t>(st.st_size);
+    base_ = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base_ == MAP_FAILED) {
+        base_ = nullptr;
+        throw std::runtime_error("Could not map weights file " + path);
+    }
+
+    try {
+        const char* base = static_cast<const char*>(base_);
+        if (std::memcmp(base, kWeightsMagic, sizeof(kWeightsMagic)) != 0) {
+            throw std::runtime_error(path + " is not a weights file");
+        }
+        size_t offset = sizeof(kWeightsMagic);
+        uint32_t version = Get<uint32_t>(base, length_, offset, path);
+        uint32_t dtype = Get<uint32_t>(base, length_, offset, path);
+        uint32_t num_layers = Get<uint32_t>(base, length_, offset, path);
+        if (version != kWeightsVersion || dtype > static_cast<uint32_t>(WeightsDType::Float32)) {
+            throw std::runtime_error("Weights file " + path + ": unsupported version/dtype");
+        }
+
+        // Every layer takes at least its ndim field, so a larger count cannot be genuine
+        if (num_layers > (length_ - offset) / sizeof(uint32_t)) {
+            throw std::runtime_error("Weights file " + path + " is truncated");
+        }
+        const size_t elem = dtype == static_cast<uint32_t>(WeightsDType::Float64) ? sizeof(double) : sizeof(float);
+        layers_.resize(num_layers);
+        for (auto& layer : layers_) {
+            layer.dtype = static_cast<WeightsDType>(dtype);
+            uint32_t ndim = Get<uint32_t>(base, length_, offset, path);
+            layer.size = 1;
+            for (uint32_t d = 0; d < ndim; ++d) {
+                layer.shape.push_back(static_cast<size_t>(Get<uint64_t>(base, length_, offset, path)));
+                if (__builtin_mul_overflow(layer.size, layer.shape.back(), &layer.size)) {
+                    throw std::runtime_error("Weights file " + path + ": layer shape overflows");
+                }
+            }
+        }
+        offset = (offset + kWeightsDataAlign - 1) / kWeightsDataAlign * kWeightsDataAlign;
+
+        // Layer sizes come from the file: check each against what is left of the mapping
+        for (auto& layer : layers_) {
+            size_t bytes = 0;
+            if (__builtin_mul_overflow(layer.size, elem, &bytes) || offset > length_ || bytes > length_ - offset) {
+                throw std::runtime_error("Weights file " + path + " is truncated");
+            }
+            layer.data = base + offset;
+            offset += bytes;
+        }
+    } catch (...) {
+        munmap(base_, length_);
+        base_ = nullptr;
+        throw;
+    }
+
+    // Encrypt walks the layers front to back once
+    madvise(base_, length_, MADV_SEQUENTIAL);
+}
+
+MappedWeightsFile::~MappedWeightsFile() {
+    if (base_) munmap(base_, length_);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Binary weights file shared by the C++ client tools and the Python trainer
+// (weights_io.py). Little-endian layout:
+//
+//   char[4]  magic "FLWT"
+//   uint32   version (1)
+//   uint32   dtype (0 = float64, 1 = float32)
+//   uint32   layer count
+//   per layer: uint32 ndim, uint64 dims[ndim]
+//   zero padding up to a 64-byte boundary
+//   layer data, row-major, back to back in layer order
+//
+// A layer with ndim == 1 is a flat vector; the trainer reshapes it to the model's layer.
+// Layer data stays aligned to its element size, so readers can map the file and use
+// the data in place (MappedWeightsFile here, numpy.memmap in weights_io.py).
+
+enum class WeightsDType : uint32_t { Float64 = 0, Float32 = 1 };
+
+// Parse "float64" / "float32"; throws std::runtime_error on anything else
+WeightsDType ParseWeightsDType(const std::string& name);
+
+// Write flat layers (with their shapes, or 1-D shapes when `shapes` is empty) to `path`.
+// Throws std::runtime_error on I/O errors or when a shape does not match its layer size.
+void WriteWeightsFile(const std::string& path,
+                      const std::vector<std::vector<double>>& layers,
+                      const std::vector<std::vector<size_t>>& shapes,
+                      WeightsDType dtype);
+
+// Read-only view of one layer's contiguous data (no copy)
+struct WeightsLayerView {
+    const void* data = nullptr;
+    size_t size = 0;                       // element count
+    WeightsDType dtype = WeightsDType::Float64;
+    std::vector<size_t> shape;
+
+    double At(size_t i) const {
+        return dtype == WeightsDType::Float64 ? static_cast<const double*>(data)[i]
+                                              : static_cast<double>(static_cast<const float*>(data)[i]);
+    }
+};
+
+// Views over in-memory float64 layers (the vectors must outlive the views)
+std::vector<WeightsLayerView> ViewLayers(const std::vector<std::vector<double>>& layers);
+
+// A weights file mapped read-only into memory; layer views point into the mapping.
+// Throws std::runtime_error if the file is missing, truncated or not a weights file.
+class MappedWeightsFile {
+public:
+    explicit MappedWeightsFile(const std::string& path);
+    ~MappedWeightsFile();
+
+    MappedWeightsFile(const MappedWeightsFile&) = delete;
+    MappedWeightsFile& operator=(const MappedWeightsFile&) = delete;
+
+    const std::vector<WeightsLayerView>& Layers() const { return layers_; }
+
+private:
+    void* base_ = nullptr;
+    size_t length_ = 0;
+    std::vector<WeightsLayerView> layers_;
+};
@@ -0,0 +1,101 @@
+import os
+import struct
+
+import numpy as np
+
+# Reader/writer for the binary weights file shared with the C++ client tools
+# (layout documented in weights_io.h). Reads are numpy.memmap views: no parsing,
+# and pages are only touched when a layer is actually used.
+
+MAGIC = b"FLWT"
+VERSION = 1
+DTYPES = {0: np.float64, 1: np.float32}
+DATA_ALIGN = 64
+
+
+def _config_value(name, default, config_path="client_config.txt"):
+    if os.path.isfile(config_path):
+        with open(config_path) as f:
+            for line in f:
+                key, _, value = line.strip().partition("=")
+                if key == name and value.strip():
+                    return value.strip()
+    return default
+
+
+def weights_format(config_path="client_config.txt"):
+    """Weight exchange format from client_config.txt: "binary" (default) or "json"."""
+    return _config_value("weightsFormat", "binary", config_path)
+
+
+def weights_dtype(config_path="client_config.txt"):
+    """Element type of written weights files from client_config.txt: "float32" (default) or "float64"."""
+    name = _config_value("weightsDtype", "float32", config_path)
+    if name not in ("float32", "float64"):
+        raise ValueError(f"{config_path}: unknown weightsDtype {name}")
+    return np.dtype(name)
+
+
+def _read_header(path):
+    with open(path, "rb") as f:
+        fixed = f.read(16)
+        if len(fixed) < 16 or fixed[:4] != MAGIC:
+            raise ValueError(f"{path} is not a weights file")
+        version, dtype_code, num_layers = struct.unpack_from("<III", fixed, 4)
+        if version != VERSION or dtype_code not in DTYPES:
+            raise ValueError(f"{path}: unsupported version {version} / dtype {dtype_code}")
+        shapes = []
+        offset = 16
+        for _ in range(num_layers):
+            (ndim,) = struct.unpack("<I", f.read(4))
+            shapes.append(struct.unpack(f"<{ndim}Q", f.read(8 * ndim)))
+            offset += 4 + 8 * ndim
+    offset = (offset + DATA_ALIGN - 1) // DATA_ALIGN * DATA_ALIGN
+    return np.dtype(DTYPES[dtype_code]).newbyteorder("<"), shapes, offset
+
+
+def read_weights(path):
+    """Return the layers of a weights file as read-only memmap views (no copy)."""
+    dtype, shapes, offset = _read_header(path)
+    layers = []
+    for shape in shapes:
+        count = int(np.prod(shape, dtype=np.int64))
+        if count == 0:
+            # numpy.memmap cannot map zero bytes
+            empty = np.zeros(tuple(shape), dtype=dtype)
+            empty.flags.writeable = False
+            layers.append(empty)
+            continue
+        layers.append(np.memmap(path, dtype=dtype, mode="r", offset=offset, shape=tuple(shape)))
+        offset += count * dtype.itemsize
+    return layers
+
+
+def write_weights(path, arrays, dtype=None):
+    """Write arrays (keeping their shapes) as a weights file, as weightsDtype unless `dtype` is given."""
+    dtype = np.dtype(weights_dtype() if dtype is None else dtype).newbyteorder("<")
+    dtype_code = {np.dtype(v): k for k, v in DTYPES.items()}[np.dtype(dtype.type)]
+    header = MAGIC + struct.pack("<III", VERSION, dtype_code, len(arrays))
+    for a in arrays:
+        header += struct.pack("<I", a.ndim) + struct.pack(f"<{a.ndim}Q", *a.shape)
+    header += b"\0" * (-len(header) % DATA_ALIGN)
+
+    tmp_path = path + ".tmp"
+    with open(tmp_path, "wb") as f:
+        f.write(header)
+        for a in arrays:
+            f.write(np.ascontiguousarray(a, dtype=dtype).tobytes())
+    os.replace(tmp_path, path)  # readers never see a half-written file
+
+
+def load_model_weights(model, path):
+    """Set model weights from a weights file, reshaping flat layers to the model's shapes."""
+    set_model_layers(model, read_weights(path), path)
+
+
+def set_model_layers(model, layers, path="weights"):
+    """Set model weights from a list of arrays, reshaping flat layers to the model's shapes."""
+    targets = model.get_weights()
+    if len(layers) != len(targets):
+        raise ValueError(f"{path}: {len(layers)} layers, model has {len(targets)}")
+    model.set_weights([np.asarray(w, dtype=t.dtype).reshape(t.shape) for w, t in zip(layers, targets)])
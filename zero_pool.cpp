@@ -0,0 +1,174 @@
+#include "zero_pool.h"
+#include "parallel_utils.h"
+#include "trace_utils.h"
+
+#include "scheme/ckksrns/ckksrns-ser.h"
+#include "cryptocontext-ser.h"
+#include "pke/ciphertext-ser.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace lbcrypto;
+
+ZeroPool::ZeroPool(CryptoContext<DCRTPoly> cc, PublicKey<DCRTPoly> public_key, std::string dir, size_t capacity)
+    : cc_(std::move(cc)), public_key_(std::move(public_key)), dir_(std::move(dir)), capacity_(capacity) {}
+
+// Read persisted entries once (lazily, so binaries that never encrypt pay nothing)
+void ZeroPool::LoadLocked() {
+    if (loaded_) return;
+    loaded_ = true;
+
+    std::error_code ec;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(dir_, ec)) {
+        if (entry.path().extension() == ".ct") {
+            files.push_back(entry.path());
+        } else if (entry.path().extension() == ".tmp") {
+            std::filesystem::remove(entry.path(), ec);  // left by a crash mid-write
+        }
+    }
+    // Pools written before entries were private
+    if (!files.empty()) std::filesystem::permissions(dir_, std::filesystem::perms::owner_all, ec);
+    std::sort(files.begin(), files.end());
+
+    TraceSpan span("zero_pool_load");
+    for (const auto& path : files) {
+        Ciphertext<DCRTPoly> ct;
+        std::ifstream in(path, std::ios::binary);
+        bool ok = false;
+        if (in) {
+            try {
+                Serial::Deserialize(ct, in, SerType::BINARY);
+                ok = ct && ct->GetKeyTag() == public_key_->GetKeyTag();
+            } catch (const std::exception&) {
+                ok = false;
+            }
+        }
+        uint64_t seq = std::strtoull(path.stem().string().c_str(), nullptr, 10);
+        next_seq_ = std::max(next_seq_, seq + 1);
+        if (!ok || entries_.size() >= capacity_) {
+            std::filesystem::remove(path, ec);  // stale key, corrupt or over capacity
+            continue;
+        }
+        std::filesystem::permissions(path, std::filesystem::perms::owner_read | std::filesystem::perms::owner_write, ec);
+        entries_.emplace_back(path.string(), ct);
+    }
+}
+
+Ciphertext<DCRTPoly> ZeroPool::Take() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    LoadLocked();
+    // Deleting the file claims the entry: only one process sharing the directory succeeds,
+    // and a restart never sees it again
+    while (!entries_.empty()) {
+        auto entry = std::move(entries_.back());
+        entries_.pop_back();
+        if (unlink(entry.first.c_str()) == 0) return entry.second;
+    }
+    return nullptr;
+}
+
+Ciphertext<DCRTPoly> ZeroPool::EncryptZero() const {
+    size_t slots = cc_->GetRingDimension() / 2;
+    Plaintext zero = cc_->MakeCKKSPackedPlaintext(std::vector<double>(slots, 0.0));
+    return cc_->Encrypt(public_key_, zero);
+}
+
+void ZeroPool::Persist(const Ciphertext<DCRTPoly>& ct) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        std::ostringstream name;
+        // The PID keeps names unique between processes filling the same directory
+        name << std::setw(12) << std::setfill('0') << next_seq_++ << "-" << getpid() << ".ct";
+        path = (std::filesystem::path(dir_) / name.str()).string();
+    }
+
+    if (std::filesystem::create_directories(dir_)) {
+        std::filesystem::permissions(dir_, std::filesystem::perms::owner_all);
+    }
+    std::ostringstream serialized;
+    Serial::Serialize(ct, serialized, SerType::BINARY);
+    const std::string bytes = serialized.str();
+
+    // Created private rather than chmod-ed afterwards, so no reader can open it in between
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        throw std::runtime_error("Could not write zero pool entry " + tmp + ": " + std::strerror(errno));
+    }
+    size_t written = 0;
+    while (written < bytes.size()) {
+        ssize_t n = write(fd, bytes.data() + written, bytes.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        written += static_cast<size_t>(n);
+    }
+    close(fd);
+    std::error_code ec;
+    if (written < bytes.size()) {
+        std::filesystem::remove(tmp, ec);
+        throw std::runtime_error("Could not write zero pool entry " + tmp);
+    }
+    // Another process loading the pool may have removed the file as a crash leftover; the
+    // entry is then simply not added
+    std::filesystem::rename(tmp, path, ec);
+    if (ec) return;
+
+    std::lock_guard<std::mutex> lock(mtx_);
+    entries_.emplace_back(path, ct);
+}
+
+bool ZeroPool::FillOne() {
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        LoadLocked();
+        if (entries_.size() >= capacity_) return false;
+    }
+    Ciphertext<DCRTPoly> ct;
+    {
+        TraceSpan span("zero_pool_encrypt");
+        ct = EncryptZero();
+    }
+    Persist(ct);
+    return true;
+}
+
+size_t ZeroPool::Fill(size_t threads) {
+    size_t missing;
+    {
+        std::lock_guard<std::mutex> lock(mtx_);
+        LoadLocked();
+        missing = capacity_ > entries_.size() ? capacity_ - entries_.size() : 0;
+    }
+    ParallelFor(missing, threads, [&](size_t) {
+        Ciphertext<DCRTPoly> ct;
+        {
+            TraceSpan span("zero_pool_encrypt");
+            ct = EncryptZero();
+        }
+        Persist(ct);
+    });
+    return missing;
+}
+
+size_t ZeroPool::Size() {
+    std::lock_guard<std::mutex> lock(mtx_);
+    LoadLocked();
+    return entries_.size();
+}
+
+void ZeroPool::Clear(const std::string& dir) {
+    std::error_code ec;
+    std::filesystem::remove_all(dir, ec);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "openfhe.h"
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Offline/online split for public-key CKKS encryption.
+//
+// Offline (idle time): precompute encryptions of zero under the client's public key and
+// persist each one as <dir>/<seq>.ct. Online: Encrypt(pk, m) == Take() + m, so a chunk
+// costs an encode and one plaintext addition instead of fresh sampling and the
+// polynomial products against the public key.
+//
+// Entries are secret: anyone who reads one can strip it from the upload it masked. The
+// pool directory is created 0700 and entries 0600.
+//
+// Every entry is used at most once, also across processes sharing the directory and across
+// restarts: Take() claims an entry by deleting its file and skips entries another process
+// claimed first. Entries whose key tag does not match the current public key, and files
+// left half-written by a crash (*.tmp), are discarded on load.
+class ZeroPool {
+public:
+    ZeroPool(lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc,
+             lbcrypto::PublicKey<lbcrypto::DCRTPoly> public_key,
+             std::string dir,
+             size_t capacity);
+
+    // Pop one precomputed encryption of zero; null when the pool is empty
+    lbcrypto::Ciphertext<lbcrypto::DCRTPoly> Take();
+
+    // Generate and persist one entry; returns false when the pool is already full
+    bool FillOne();
+
+    // Fill up to capacity on `threads` workers; returns the number of entries added
+    size_t Fill(size_t threads);
+
+    size_t Size();
+    size_t Capacity() const { return capacity_; }
+
+    // Drop every persisted entry (e.g. after the key pair changed)
+    static void Clear(const std::string& dir);
+
+private:
+    void LoadLocked();
+    lbcrypto::Ciphertext<lbcrypto::DCRTPoly> EncryptZero() const;
+    void Persist(const lbcrypto::Ciphertext<lbcrypto::DCRTPoly>& ct);
+
+    lbcrypto::CryptoContext<lbcrypto::DCRTPoly> cc_;
+    lbcrypto::PublicKey<lbcrypto::DCRTPoly> public_key_;
+    std::string dir_;
+    size_t capacity_;
+
+    std::mutex mtx_;
+    bool loaded_ = false;
+    uint64_t next_seq_ = 0;
+    std::vector<std::pair<std::string, lbcrypto::Ciphertext<lbcrypto::DCRTPoly>>> entries_;  // path, ciphertext
+};